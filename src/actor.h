@@ -49,7 +49,6 @@
 #include "portal.h"
 
 struct subsector_t;
-struct FBlockNode;
 struct FPortalGroupArray;
 struct visstyle_t;
 class FLightDefaults;
@@ -79,7 +78,7 @@ class FLightDefaults;
 // The sound code uses the x,y, and sometimes z fields
 // to do stereo positioning of any sound emitted by the actor.
 //
-// The play simulation uses the blocklinks, x,y,z, radius, height
+// The play simulation uses the thing grid, x,y,z, radius, height
 // to determine when AActors are touching each other,
 // touching lines in the map, or hit by trace lines (gunshots,
 // lines of sight, etc).
@@ -127,7 +126,7 @@ enum ActorFlag
 	MF_SHOOTABLE		= 0x00000004,
 	MF_NOSECTOR			= 0x00000008,	// don't use the sector links
 										// (invisible but touchable)
-	MF_NOBLOCKMAP		= 0x00000010,	// don't use the blocklinks
+	MF_NOBLOCKMAP		= 0x00000010,	// don't use the thing grid
 										// (inert but displayable)
 	MF_AMBUSH			= 0x00000020,	// not activated by sound; deaf monster
 	MF_JUSTHIT			= 0x00000040,	// try to attack right back
@@ -1077,7 +1076,7 @@ public:
 	double			FloatSpeed;
 
 // interaction info
-	FBlockNode		*BlockNode;			// links in blocks (if needed)
+	unsigned		BlockLinks;			// links in the thing grid (if needed), 0 if none
 	struct sector_t	*Sector;
 	subsector_t *		subsector;
 	double			floorz, ceilingz;	// closest together of contacted secs
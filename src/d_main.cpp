@@ -97,6 +97,7 @@
 #include "vm.h"
 #include "types.h"
 #include "r_data/r_vanillatrans.h"
+#include "p_sightbatch.h"
 
 EXTERN_CVAR(Bool, hud_althud)
 void DrawHUD();
@@ -541,11 +542,13 @@ CUSTOM_CVAR (Int, compatflags, 0, CVAR_ARCHIVE|CVAR_SERVERINFO)
 	{
 		FPolyObj::ClearAllSubsectorLinks();
 	}
+	FSightBatch::GeometryChanged();
 }
 
 CUSTOM_CVAR (Int, compatflags2, 0, CVAR_ARCHIVE|CVAR_SERVERINFO)
 {
 	i_compatflags2 = GetCompatibility2(self) | ii_compatflags2;
+	FSightBatch::GeometryChanged();
 }
 
 CUSTOM_CVAR(Int, compatmode, 0, CVAR_ARCHIVE|CVAR_NOINITCALL)
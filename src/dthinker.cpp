@@ -40,6 +40,7 @@
 #include "vm.h"
 #include "c_dispatch.h"
 #include "v_text.h"
+#include "p_simprofile.h"
 
 
 static int ThinkCount;
@@ -47,6 +48,8 @@ static cycle_t ThinkCycles;
 extern cycle_t BotSupportCycles;
 extern cycle_t ActionCycles;
 extern int BotWTG;
+static FSimProfileZone ThinkersZone("RunThinkers");
+static FSimProfileZone TickZone("Tick");
 
 IMPLEMENT_CLASS(DThinker, false, false)
 
@@ -530,6 +533,7 @@ TMap<FName, ProfileInfo> Profiles;
 void DThinker::RunThinkers ()
 {
 	int i, count;
+	FSimProfileScope profile(ThinkersZone);
 
 	ThinkCount = 0;
 	ThinkCycles.Reset();
@@ -675,7 +679,10 @@ int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
 		if (!(node->ObjectFlags & OF_EuthanizeMe))
 		{ // Only tick thinkers not scheduled for destruction
 			ThinkCount++;
-			node->CallTick();
+			{
+				FSimProfileScope profile(TickZone, node->GetClass());
+				node->CallTick();
+			}
 			node->ObjectFlags &= ~OF_JustSpawned;
 			GC::CheckGC();
 		}
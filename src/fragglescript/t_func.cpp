@@ -48,6 +48,7 @@
 #include "r_utility.h"
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
 
 static FRandom pr_script("FScript");
 
@@ -2150,6 +2151,7 @@ void FParser::SF_SetLineBlocking(void)
 			{
 				level.lines[i].flags = (level.lines[i].flags & ~(ML_BLOCKING | ML_BLOCKEVERYTHING)) | blocking;
 			}
+			FSightBatch::GeometryChanged();
 		}
 	}
 }
@@ -3979,6 +3981,8 @@ void FParser::SF_SetLineTrigger()
 				(f & ~(ML_MONSTERSCANACTIVATE | ML_REPEAT_SPECIAL | ML_SPAC_MASK | ML_FIRSTSIDEONLY));
 
 		}
+		// Impact specials decide whether monsters see past block everything lines
+		FSightBatch::GeometryChanged();
 	}
 }
 
@@ -40,6 +40,8 @@
 #include "r_defs.h"
 #include "portal.h"
 #include "p_blockmap.h"
+#include "p_thinggrid.h"
+#include "p_soundgraph.h"
 
 struct FLevelLocals
 {
@@ -97,6 +99,8 @@ struct FLevelLocals
 	TArray<zone_t>	Zones;
 
 	FBlockmap blockmap;
+	FThingGrid thinggrid;
+	FSoundGraph soundgraph;
 
 	// These are copies of the loaded map data that get used by the savegame code to skip unaltered fields
 	// Without such a mechanism the savegame format would become too slow and large because more than 80-90% are normally still unaltered.
@@ -403,7 +403,6 @@ void GLSceneDrawer::RenderThings(subsector_t * sub, sector_t * sector)
 
 void GLSceneDrawer::DoSubsector(subsector_t * sub)
 {
-	unsigned int i;
 	sector_t * sector;
 	sector_t * fakesector;
 	sector_t fake;
@@ -456,7 +455,8 @@ void GLSceneDrawer::DoSubsector(subsector_t * sub)
 	{
 		SetupSprite.Clock();
 
-		for (i = ParticlesInSubsec[sub->Index()]; i != NO_PARTICLE; i = Particles[i].snext)
+		const FParticleSpan &span = ParticlesInSubsec[sub->Index()];
+		for (uint32_t i = span.First; i < span.First + span.Count; i++)
 		{
 			if (GLRenderer->mClipPortal)
 			{
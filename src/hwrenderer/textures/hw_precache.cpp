@@ -33,6 +33,8 @@
 #include "r_data/models/models.h"
 #include "textures/skyboxtexture.h"
 #include "hwrenderer/textures/hw_material.h"
+#include "resourcefiles/lumploader.h"
+#include "textures/texturedecoder.h"
 
 
 //==========================================================================
@@ -192,6 +194,26 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 
 	if (gl_precache)
 	{
+		// Let the image lumps decompress in the background while the textures are being set up
+		FLumpLoader::Instance()->BeginBatch();
+		for (int i = cnt - 1; i >= 0; i--)
+		{
+			FTexture *tex = TexMan.ByIndex(i);
+			if (tex != nullptr && (texhitlist[i] || (spritehitlist[i] != nullptr && (*spritehitlist[i]).CountUsed() > 0)))
+				FLumpLoader::Instance()->Prefetch(tex->GetSourceLump());
+		}
+		FLumpLoader::Instance()->EndBatch();
+
+		// Decode the images on the worker threads as well
+		for (int i = cnt - 1; i >= 0; i--)
+		{
+			FTexture *tex = TexMan.ByIndex(i);
+			if (tex != nullptr && (texhitlist[i] || (spritehitlist[i] != nullptr && (*spritehitlist[i]).CountUsed() > 0)))
+			{
+				FTextureDecoder::Instance()->Queue(tex->HiresTexture != nullptr ? tex->HiresTexture : tex);
+			}
+		}
+
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
@@ -214,6 +236,8 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 				Models[i]->BuildVertexBuffer(renderer);
 		}
 		delete renderer;
+		FTextureDecoder::Instance()->Flush();
+		FLumpLoader::Instance()->Flush();
 	}
 
 	delete[] spritehitlist;
@@ -39,6 +39,9 @@
 #ifdef _MSC_VER
 #include <malloc.h>		// for alloca()
 #endif
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 #include "m_crc32.h"
 #include "m_swap.h"
@@ -1060,10 +1063,118 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 //
 //==========================================================================
 
+#ifndef NO_SSE
+
+// The Sub, Average and Paeth filters depend on the pixel to the left, so
+// they can only be vectorized across the bytes of a pixel. This still beats
+// the byte at a time loops for RGB and RGBA images.
+
+template<int bpp>
+static inline __m128i LoadPixel (const uint8_t *p)
+{
+	uint32_t v = 0;
+	memcpy (&v, p, bpp);
+	return _mm_cvtsi32_si128 (v);
+}
+
+template<int bpp>
+static inline void StorePixel (uint8_t *p, __m128i v)
+{
+	uint32_t c = _mm_cvtsi128_si32 (v);
+	memcpy (p, &c, bpp);
+}
+
+template<int bpp>
+static void UnfilterRowSSE (int filter, int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	__m128i a = _mm_setzero_si128 ();
+	__m128i c = _mm_setzero_si128 ();
+	__m128i zero = _mm_setzero_si128 ();
+
+	switch (filter)
+	{
+	case 1:		// Sub
+		for (int x = 0; x < width; x += bpp)
+		{
+			a = _mm_add_epi8 (LoadPixel<bpp> (row + x), a);
+			StorePixel<bpp> (dest + x, a);
+		}
+		break;
+
+	case 3:		// Average
+		for (int x = 0; x < width; x += bpp)
+		{
+			__m128i b = LoadPixel<bpp> (prev + x);
+			// _mm_avg_epu8 rounds up, the PNG average rounds down
+			__m128i avg = _mm_sub_epi8 (_mm_avg_epu8 (a, b), _mm_and_si128 (_mm_xor_si128 (a, b), _mm_set1_epi8 (1)));
+			a = _mm_add_epi8 (LoadPixel<bpp> (row + x), avg);
+			StorePixel<bpp> (dest + x, a);
+		}
+		break;
+
+	case 4:		// Paeth
+		for (int x = 0; x < width; x += bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8 (LoadPixel<bpp> (prev + x), zero);
+			__m128i pa = _mm_sub_epi16 (b, c);
+			__m128i pb = _mm_sub_epi16 (a, c);
+			__m128i pc = _mm_add_epi16 (pa, pb);
+			pa = _mm_max_epi16 (pa, _mm_sub_epi16 (zero, pa));
+			pb = _mm_max_epi16 (pb, _mm_sub_epi16 (zero, pb));
+			pc = _mm_max_epi16 (pc, _mm_sub_epi16 (zero, pc));
+			__m128i smallest = _mm_min_epi16 (_mm_min_epi16 (pa, pb), pc);
+			__m128i usea = _mm_cmpeq_epi16 (pa, smallest);
+			__m128i useb = _mm_andnot_si128 (usea, _mm_cmpeq_epi16 (pb, smallest));
+			__m128i usec = _mm_andnot_si128 (_mm_or_si128 (usea, useb), _mm_set1_epi16 (-1));
+			__m128i nearest = _mm_or_si128 (_mm_or_si128 (_mm_and_si128 (usea, a), _mm_and_si128 (useb, b)), _mm_and_si128 (usec, c));
+			__m128i pixel = _mm_add_epi8 (LoadPixel<bpp> (row + x), _mm_packus_epi16 (nearest, zero));
+			StorePixel<bpp> (dest + x, pixel);
+			a = _mm_unpacklo_epi8 (pixel, zero);
+			c = b;
+		}
+		break;
+	}
+}
+
+#endif
+
 void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp)
 {
 	int x;
 
+#ifndef NO_SSE
+	switch (*row)
+	{
+	case 2:		// Up
+		row++;
+		for (x = 0; x + 16 <= width; x += 16)
+		{
+			__m128i sum = _mm_add_epi8 (_mm_loadu_si128 ((const __m128i *)(row + x)), _mm_loadu_si128 ((const __m128i *)(prev + x)));
+			_mm_storeu_si128 ((__m128i *)(dest + x), sum);
+		}
+		for (; x < width; x++)
+		{
+			dest[x] = row[x] + prev[x];
+		}
+		return;
+
+	case 1:
+	case 3:
+	case 4:
+		if (bpp == 3)
+		{
+			UnfilterRowSSE<3> (*row, width, dest, row + 1, prev);
+			return;
+		}
+		else if (bpp == 4)
+		{
+			UnfilterRowSSE<4> (*row, width, dest, row + 1, prev);
+			return;
+		}
+		break;
+	}
+#endif
+
 	switch (*row++)
 	{
 	case 1:		// Sub
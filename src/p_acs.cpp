@@ -74,6 +74,7 @@
 #include "g_levellocals.h"
 #include "actorinlines.h"
 #include "types.h"
+#include "p_sightbatch.h"
 
 	// P-codes for ACS scripts
 	enum
@@ -6392,6 +6393,7 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
 				{
 					level.lines[line].activation = args[1];
 				}
+				FSightBatch::GeometryChanged();
 			}
 			break;
 
@@ -9113,6 +9115,7 @@ scriptwait:
 						break;
 					}
 				}
+				FSightBatch::GeometryChanged();
 
 				sp -= 2;
 			}
@@ -9161,6 +9164,8 @@ scriptwait:
 					DPrintf(DMSG_SPAMMY, "Set special on line %d (id %d) to %d(%d,%d,%d,%d,%d)\n",
 						linenum, STACK(7), specnum, arg0, STACK(4), STACK(3), STACK(2), STACK(1));
 				}
+				// Impact specials decide whether monsters see past block everything lines
+				FSightBatch::GeometryChanged();
 				sp -= 7;
 			}
 			break;
@@ -3,31 +3,13 @@
 
 #include "doomtype.h"
 
-class AActor;
-
-// [RH] Like msecnode_t, but for the blockmap
-struct FBlockNode
-{
-	AActor *Me;						// actor this node references
-	int BlockIndex;					// index into blocklinks for the block this node is in
-	int Group;						// portal group this link belongs to (can be different than the actor's own group
-	FBlockNode **PrevActor;			// previous actor in this block
-	FBlockNode *NextActor;			// next actor in this block
-	FBlockNode **PrevBlock;			// previous block this actor is in
-	FBlockNode *NextBlock;			// next block this actor is in
-
-	static FBlockNode *Create (AActor *who, int x, int y, int group = -1);
-	void Release ();
-
-	static FBlockNode *FreeBlocks;
-};
-
 // BLOCKMAP
 // Created from axis aligned bounding box
 // of the map, a rectangular array of
 // blocks of size 128x128.
 // Used to speed up collision detection
 // by spatial subdivision in 2D.
+// Actors are kept in a separate grid, see p_thinggrid.h.
 //
 
 struct FBlockmap
@@ -39,7 +21,6 @@ struct FBlockmap
 	int					bmapheight; 	// in mapblocks
 	double				bmaporgx;
 	double				bmaporgy;		// origin of block map
-	FBlockNode**		blocklinks; 	// for thing chains
 
 	// mapblocks are used to check movement
 	// against lines and things
@@ -82,11 +63,6 @@ struct FBlockmap
 			delete[] blockmaplump;
 			blockmaplump = NULL;
 		}
-		if (blocklinks != NULL)
-		{
-			delete[] blocklinks;
-			blocklinks = NULL;
-		}
 	}
 
 };
@@ -34,6 +34,9 @@
 ** more useful.
 */
 
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 #include "doomtype.h"
 #include "doomstat.h"
 #include "i_system.h"
@@ -47,6 +50,7 @@
 #include "r_utility.h"
 #include "g_levellocals.h"
 #include "vm.h"
+#include "p_workers.h"
 
 CVAR (Int, cl_rockettrails, 1, CVAR_ARCHIVE);
 CVAR (Bool, r_rail_smartspiral, 0, CVAR_ARCHIVE);
@@ -59,11 +63,138 @@ FRandom pr_railtrail("RailTrail");
 #define FADEFROMTTL(a)	(1.f/(a))
 
 // [RH] particle globals
-uint16_t			NumParticles;
-uint16_t			ActiveParticles;
-uint16_t			InactiveParticles;
-particle_t		*Particles;
-TArray<uint16_t>	ParticlesInSubsec;
+TArray<particle_t>		Particles;
+TArray<FParticleSpan>	ParticlesInSubsec;
+
+//==========================================================================
+//
+// Particle storage
+//
+// Live particles are kept densely packed in a structure of arrays so that
+// P_ThinkParticles can integrate them with SIMD and split the work over
+// the play workers. Removing a particle moves the last one into its slot.
+// Spawned particles are set up as particle_t records and move into the
+// arrays at the next tic or frame, whichever comes first.
+//
+//==========================================================================
+
+enum
+{
+	PF_BRIGHT = 1,
+	PF_NOTIMEFREEZE = 2,
+};
+
+struct FParticleStore
+{
+	uint32_t Count = 0;
+	uint32_t Budget = 0;
+	TArray<double> PosX, PosY, PosZ;
+	TArray<double> VelX, VelY, VelZ;
+	TArray<double> AccX, AccY, AccZ;
+	TArray<double> Size, SizeStep;
+	TArray<float> Alpha, FadeStep;
+	TArray<int32_t> TTL;
+	TArray<int> Color;
+	TArray<uint8_t> Flags;
+	TArray<uint8_t> Dead;
+	TArray<subsector_t *> Subsector;
+
+	// Spawned since the last flush
+	TArray<particle_t> Spawned;
+
+	// Set when the subsector grouping needs to be redone
+	bool Moved = true;
+
+	void Grow(uint32_t count);
+	void Add(const particle_t &p);
+	void Remove(uint32_t i);
+	void Flush();
+	void Clear();
+};
+
+static FParticleStore ParticleStore;
+
+void FParticleStore::Grow(uint32_t count)
+{
+	if (count <= PosX.Size())
+		return;
+	count = MIN(MAX(count, PosX.Size() * 2), Budget);
+	for (auto arr : { &PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &AccX, &AccY, &AccZ, &Size, &SizeStep })
+		arr->Resize(count);
+	Alpha.Resize(count);
+	FadeStep.Resize(count);
+	TTL.Resize(count);
+	Color.Resize(count);
+	Flags.Resize(count);
+	Dead.Resize(count);
+	Subsector.Resize(count);
+}
+
+void FParticleStore::Add(const particle_t &p)
+{
+	uint32_t i = Count++;
+	PosX[i] = p.Pos.X;
+	PosY[i] = p.Pos.Y;
+	PosZ[i] = p.Pos.Z;
+	VelX[i] = p.Vel.X;
+	VelY[i] = p.Vel.Y;
+	VelZ[i] = p.Vel.Z;
+	AccX[i] = p.Acc.X;
+	AccY[i] = p.Acc.Y;
+	AccZ[i] = p.Acc.Z;
+	Size[i] = p.size;
+	SizeStep[i] = p.sizestep;
+	Alpha[i] = p.alpha;
+	FadeStep[i] = p.fadestep;
+	TTL[i] = p.ttl;
+	Color[i] = p.color;
+	Flags[i] = (p.bright ? PF_BRIGHT : 0) | (p.notimefreeze ? PF_NOTIMEFREEZE : 0);
+	Subsector[i] = p.subsector;
+}
+
+void FParticleStore::Remove(uint32_t i)
+{
+	uint32_t last = --Count;
+	if (i == last)
+		return;
+	PosX[i] = PosX[last];
+	PosY[i] = PosY[last];
+	PosZ[i] = PosZ[last];
+	VelX[i] = VelX[last];
+	VelY[i] = VelY[last];
+	VelZ[i] = VelZ[last];
+	AccX[i] = AccX[last];
+	AccY[i] = AccY[last];
+	AccZ[i] = AccZ[last];
+	Size[i] = Size[last];
+	SizeStep[i] = SizeStep[last];
+	Alpha[i] = Alpha[last];
+	FadeStep[i] = FadeStep[last];
+	TTL[i] = TTL[last];
+	Color[i] = Color[last];
+	Flags[i] = Flags[last];
+	Dead[i] = Dead[last];
+	Subsector[i] = Subsector[last];
+}
+
+void FParticleStore::Flush()
+{
+	if (Spawned.Size() == 0)
+		return;
+	Grow(Count + Spawned.Size());
+	for (auto &p : Spawned)
+		Add(p);
+	Spawned.Clear();
+	Moved = true;
+}
+
+void FParticleStore::Clear()
+{
+	Count = 0;
+	Spawned.Clear();
+	Particles.Clear();
+	Moved = true;
+}
 
 static int grey1, grey2, grey3, grey4, red, green, blue, yellow, black,
 		   red1, green1, blue1, yellow1, purple, purple1, white,
@@ -105,14 +236,12 @@ static const struct ColorList {
 
 inline particle_t *NewParticle (void)
 {
-	particle_t *result = NULL;
-	if (InactiveParticles != NO_PARTICLE)
-	{
-		result = Particles + InactiveParticles;
-		InactiveParticles = result->tnext;
-		result->tnext = ActiveParticles;
-		ActiveParticles = uint16_t(result - Particles);
-	}
+	auto &store = ParticleStore;
+	if (store.Count + store.Spawned.Size() >= store.Budget)
+		return NULL;
+
+	particle_t *result = &store.Spawned[store.Spawned.Reserve(1)];
+	memset (result, 0, sizeof(particle_t));
 	return result;
 }
 
@@ -128,8 +257,8 @@ CUSTOM_CVAR( Int, r_maxparticles, 4000, CVAR_ARCHIVE )
 {
 	if ( self == 0 )
 		self = 4000;
-	else if (self > 65535)
-		self = 65535;
+	else if (self > 1000000)
+		self = 1000000;
 	else if (self < 100)
 		self = 100;
 
@@ -152,59 +281,96 @@ void P_InitParticles ()
 		num = r_maxparticles;
 
 	// This should be good, but eh...
-	NumParticles = (uint16_t)clamp<int>(num, 100, 65535);
-
 	P_DeinitParticles();
-	Particles = new particle_t[NumParticles];
+	ParticleStore.Budget = (uint32_t)clamp<int>(num, 100, 1000000);
 	P_ClearParticles ();
 	atterm (P_DeinitParticles);
 }
 
 void P_DeinitParticles()
 {
-	if (Particles != NULL)
-	{
-		delete[] Particles;
-		Particles = NULL;
-	}
+	auto &store = ParticleStore;
+	store.Clear();
+	for (auto arr : { &store.PosX, &store.PosY, &store.PosZ, &store.VelX, &store.VelY, &store.VelZ, &store.AccX, &store.AccY, &store.AccZ, &store.Size, &store.SizeStep })
+		arr->Reset();
+	store.Alpha.Reset();
+	store.FadeStep.Reset();
+	store.TTL.Reset();
+	store.Color.Reset();
+	store.Flags.Reset();
+	store.Dead.Reset();
+	store.Subsector.Reset();
+	store.Spawned.Reset();
+	Particles.Reset();
 }
 
 void P_ClearParticles ()
 {
-	int i;
-
-	memset (Particles, 0, NumParticles * sizeof(particle_t));
-	ActiveParticles = NO_PARTICLE;
-	InactiveParticles = 0;
-	for (i = 0; i < NumParticles-1; i++)
-		Particles[i].tnext = i + 1;
-	Particles[i].tnext = NO_PARTICLE;
+	ParticleStore.Clear();
 }
 
 // Group particles by subsectors. Because particles are always
 // in motion, there is little benefit to caching this information
-// from one frame to the next.
+// from one tic to the next. Within a tic it only has to be done once,
+// no matter how many views get rendered.
 
 void P_FindParticleSubsectors ()
 {
-	if (ParticlesInSubsec.Size() < level.subsectors.Size())
+	auto &store = ParticleStore;
+	unsigned numsubsectors = level.subsectors.Size();
+
+	store.Flush();
+	if (ParticlesInSubsec.Size() != numsubsectors)
 	{
-		ParticlesInSubsec.Reserve (level.subsectors.Size() - ParticlesInSubsec.Size());
+		ParticlesInSubsec.Resize(numsubsectors);
+		store.Moved = true;
 	}
-
-	fillshort (&ParticlesInSubsec[0], level.subsectors.Size(), NO_PARTICLE);
-
 	if (!r_particles)
+	{
+		memset(&ParticlesInSubsec[0], 0, numsubsectors * sizeof(FParticleSpan));
+		Particles.Clear();
+		store.Moved = true;
+		return;
+	}
+	if (!store.Moved)
 	{
 		return;
 	}
-	for (uint16_t i = ActiveParticles; i != NO_PARTICLE; i = Particles[i].tnext)
+	store.Moved = false;
+
+	// Count the particles in every subsector and turn the counts into offsets.
+	memset(&ParticlesInSubsec[0], 0, numsubsectors * sizeof(FParticleSpan));
+	for (uint32_t i = 0; i < store.Count; i++)
+	{
+		// Try to reuse the subsector from the last portal check, if still valid.
+		if (store.Subsector[i] == NULL) store.Subsector[i] = R_PointInSubsector(DVector2(store.PosX[i], store.PosY[i]));
+		ParticlesInSubsec[store.Subsector[i]->Index()].Count++;
+	}
+	uint32_t first = 0;
+	for (auto &span : ParticlesInSubsec)
 	{
-		 // Try to reuse the subsector from the last portal check, if still valid.
-		if (Particles[i].subsector == NULL) Particles[i].subsector = R_PointInSubsector(Particles[i].Pos);
-		int ssnum = Particles[i].subsector->Index();
-		Particles[i].snext = ParticlesInSubsec[ssnum];
-		ParticlesInSubsec[ssnum] = i;
+		span.First = first;
+		first += span.Count;
+		span.Count = 0;
+	}
+
+	Particles.Resize(store.Count);
+	for (uint32_t i = 0; i < store.Count; i++)
+	{
+		auto &span = ParticlesInSubsec[store.Subsector[i]->Index()];
+		particle_t &p = Particles[span.First + span.Count++];
+		p.Pos = { store.PosX[i], store.PosY[i], store.PosZ[i] };
+		p.Vel = { store.VelX[i], store.VelY[i], store.VelZ[i] };
+		p.Acc = { store.AccX[i], store.AccY[i], store.AccZ[i] };
+		p.size = store.Size[i];
+		p.sizestep = store.SizeStep[i];
+		p.subsector = store.Subsector[i];
+		p.ttl = store.TTL[i];
+		p.bright = !!(store.Flags[i] & PF_BRIGHT);
+		p.notimefreeze = !!(store.Flags[i] & PF_NOTIMEFREEZE);
+		p.fadestep = store.FadeStep[i];
+		p.alpha = store.Alpha[i];
+		p.color = store.Color[i];
 	}
 }
 
@@ -246,64 +412,165 @@ void P_InitEffects ()
 	blood2 = ParticleColor(RPART(kind)/3, GPART(kind)/3, BPART(kind)/3);
 }
 
-void P_ThinkParticles ()
+//==========================================================================
+//
+// Ages the particles in [start, end) and flags the ones that expired.
+// The vector part covers everything that is plain arithmetic.
+//
+//==========================================================================
+
+static void AgeParticles(FParticleStore &store, uint32_t start, uint32_t end)
 {
-	int i;
-	particle_t *particle, *prev;
+	uint32_t i = start;
+#ifndef NO_SSE
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 oldalpha = _mm_loadu_ps(&store.Alpha[i]);
+		__m128 alpha = _mm_sub_ps(oldalpha, _mm_loadu_ps(&store.FadeStep[i]));
+		_mm_storeu_ps(&store.Alpha[i], alpha);
+		int faded = _mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(alpha, _mm_setzero_ps()), _mm_cmplt_ps(oldalpha, alpha)));
+
+		__m128i ttl = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&store.TTL[i]), _mm_set1_epi32(1));
+		_mm_storeu_si128((__m128i*)&store.TTL[i], ttl);
+		int expired = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(ttl, _mm_set1_epi32(1))));
+
+		__m128d size0 = _mm_add_pd(_mm_loadu_pd(&store.Size[i]), _mm_loadu_pd(&store.SizeStep[i]));
+		__m128d size1 = _mm_add_pd(_mm_loadu_pd(&store.Size[i + 2]), _mm_loadu_pd(&store.SizeStep[i + 2]));
+		_mm_storeu_pd(&store.Size[i], size0);
+		_mm_storeu_pd(&store.Size[i + 2], size1);
+		int shrunk = _mm_movemask_pd(_mm_cmple_pd(size0, _mm_setzero_pd())) | (_mm_movemask_pd(_mm_cmple_pd(size1, _mm_setzero_pd())) << 2);
+
+		int dead = faded | expired | shrunk;
+		for (int j = 0; j < 4; j++)
+			store.Dead[i + j] = (dead >> j) & 1;
+	}
+#endif
+	for (; i < end; i++)
+	{
+		auto oldtrans = store.Alpha[i];
+		store.Alpha[i] -= store.FadeStep[i];
+		store.Size[i] += store.SizeStep[i];
+		store.Dead[i] = store.Alpha[i] <= 0 || oldtrans < store.Alpha[i] || --store.TTL[i] <= 0 || store.Size[i] <= 0;
+	}
+}
+
+//==========================================================================
+//
+// Moves the particles in [start, end) and finds their new subsectors.
+// Expired particles get moved, too, which doesn't matter because they
+// are removed right after.
+//
+//==========================================================================
 
-	i = ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
+static void MoveParticles(FParticleStore &store, uint32_t start, uint32_t end, bool lineportals)
+{
+	uint32_t i = start;
+#ifndef NO_SSE
+	if (!lineportals)
 	{
-		particle = Particles + i;
-		i = particle->tnext;
-		if (!particle->notimefreeze && ((bglobal.freeze) || (level.flags2 & LEVEL2_FROZEN)))
+		for (; i + 2 <= end; i += 2)
 		{
-			prev = particle;
-			continue;
+			__m128d velx = _mm_loadu_pd(&store.VelX[i]);
+			__m128d vely = _mm_loadu_pd(&store.VelY[i]);
+			__m128d velz = _mm_loadu_pd(&store.VelZ[i]);
+			_mm_storeu_pd(&store.PosX[i], _mm_add_pd(_mm_loadu_pd(&store.PosX[i]), velx));
+			_mm_storeu_pd(&store.PosY[i], _mm_add_pd(_mm_loadu_pd(&store.PosY[i]), vely));
+			_mm_storeu_pd(&store.PosZ[i], _mm_add_pd(_mm_loadu_pd(&store.PosZ[i]), velz));
+			_mm_storeu_pd(&store.VelX[i], _mm_add_pd(velx, _mm_loadu_pd(&store.AccX[i])));
+			_mm_storeu_pd(&store.VelY[i], _mm_add_pd(vely, _mm_loadu_pd(&store.AccY[i])));
+			_mm_storeu_pd(&store.VelZ[i], _mm_add_pd(velz, _mm_loadu_pd(&store.AccZ[i])));
 		}
-		
-		auto oldtrans = particle->alpha;
-		particle->alpha -= particle->fadestep;
-		particle->size += particle->sizestep;
-		if (particle->alpha <= 0 || oldtrans < particle->alpha || --particle->ttl <= 0 || (particle->size <= 0))
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				ActiveParticles = i;
-			particle->tnext = InactiveParticles;
-			InactiveParticles = (int)(particle - Particles);
-			continue;
+	}
+#endif
+	for (; i < end; i++)
+	{
+		if (lineportals)
+		{
+			// Handle crossing a line portal
+			DVector2 newxy = P_GetOffsetPosition(store.PosX[i], store.PosY[i], store.VelX[i], store.VelY[i]);
+			store.PosX[i] = newxy.X;
+			store.PosY[i] = newxy.Y;
 		}
+		else
+		{
+			store.PosX[i] += store.VelX[i];
+			store.PosY[i] += store.VelY[i];
+		}
+		store.PosZ[i] += store.VelZ[i];
+		store.VelX[i] += store.AccX[i];
+		store.VelY[i] += store.AccY[i];
+		store.VelZ[i] += store.AccZ[i];
+	}
+
+	for (i = start; i < end; i++)
+	{
+		if (store.Dead[i])
+			continue;
 
-		// Handle crossing a line portal
-		DVector2 newxy = P_GetOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
-		particle->Pos.X = newxy.X;
-		particle->Pos.Y = newxy.Y;
-		particle->Pos.Z += particle->Vel.Z;
-		particle->Vel += particle->Acc;
-		particle->subsector = R_PointInSubsector(particle->Pos);
-		sector_t *s = particle->subsector->sector;
+		DVector3 pos(store.PosX[i], store.PosY[i], store.PosZ[i]);
+		subsector_t *subsector = R_PointInSubsector(pos);
+		sector_t *s = subsector->sector;
 		// Handle crossing a sector portal.
 		if (!s->PortalBlocksMovement(sector_t::ceiling))
 		{
-			if (particle->Pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
+			if (pos.Z > s->GetPortalPlaneZ(sector_t::ceiling))
 			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::ceiling);
-				particle->subsector = NULL;
+				pos += s->GetPortalDisplacement(sector_t::ceiling);
+				subsector = NULL;
 			}
 		}
 		else if (!s->PortalBlocksMovement(sector_t::floor))
 		{
-			if (particle->Pos.Z < s->GetPortalPlaneZ(sector_t::floor))
+			if (pos.Z < s->GetPortalPlaneZ(sector_t::floor))
 			{
-				particle->Pos += s->GetPortalDisplacement(sector_t::floor);
-				particle->subsector = NULL;
+				pos += s->GetPortalDisplacement(sector_t::floor);
+				subsector = NULL;
 			}
 		}
-		prev = particle;
+		store.PosX[i] = pos.X;
+		store.PosY[i] = pos.Y;
+		store.PosZ[i] = pos.Z;
+		store.Subsector[i] = subsector;
+	}
+}
+
+void P_ThinkParticles ()
+{
+	auto &store = ParticleStore;
+
+	store.Flush();
+	if (store.Count == 0)
+		return;
+	store.Moved = true;
+
+	if ((bglobal.freeze) || (level.flags2 & LEVEL2_FROZEN))
+	{
+		// Only a few particles ignore the freeze, so this doesn't need to be fast.
+		for (uint32_t i = store.Count; i-- > 0; )
+		{
+			if (!(store.Flags[i] & PF_NOTIMEFREEZE))
+				continue;
+			AgeParticles(store, i, i + 1);
+			if (store.Dead[i])
+				store.Remove(i);
+			else
+				MoveParticles(store, i, i + 1, level.PortalBlockmap.containsLines);
+		}
+		return;
+	}
+
+	bool lineportals = level.PortalBlockmap.containsLines;
+	FPlayWorkers::Instance()->Run(store.Count, 1024, [&](int start, int end)
+	{
+		AgeParticles(store, start, end);
+		MoveParticles(store, start, end, lineportals);
+	});
+
+	// The particle moved into a removed slot comes from the end, which has been checked already
+	for (uint32_t i = store.Count; i-- > 0; )
+	{
+		if (store.Dead[i])
+			store.Remove(i);
 	}
 }
 
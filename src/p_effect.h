@@ -44,6 +44,9 @@ struct subsector_t;
 
 // [RH] Particle details
 
+// The simulation keeps particles in a structure of arrays. This record is
+// used to set up newly spawned particles and is what the renderers get
+// to see.
 struct particle_t
 {
 	DVector3 Pos;
@@ -58,14 +61,18 @@ struct particle_t
 	float	fadestep;
 	float	alpha;
 	int		color;
-	uint16_t	tnext;
-	uint16_t	snext;
 };
 
-extern particle_t *Particles;
-extern TArray<uint16_t>		ParticlesInSubsec;
+// Range of the particles in one subsector
+struct FParticleSpan
+{
+	uint32_t First;
+	uint32_t Count;
+};
 
-const uint16_t NO_PARTICLE = 0xffff;
+// Filled by P_FindParticleSubsectors and grouped by subsector
+extern TArray<particle_t>		Particles;
+extern TArray<FParticleSpan>	ParticlesInSubsec;
 
 void P_ClearParticles ();
 void P_FindParticleSubsectors ();
@@ -49,6 +49,7 @@
 #include "g_levellocals.h"
 #include "vm.h"
 #include "actorinlines.h"
+#include "p_simprofile.h"
 
 #include "gi.h"
 
@@ -80,6 +81,10 @@ static FRandom pr_enemystrafe("EnemyStrafe");
 // so this CVAR allows to switch it off.
 CVAR(Bool, nomonsterinterpolation, false, CVAR_GLOBALCONFIG|CVAR_ARCHIVE)
 
+static FSimProfileZone NoiseAlertZone("P_NoiseAlert");
+static FSimProfileZone LookForPlayersZone("P_LookForPlayers");
+static FSimProfileZone ChaseZone("A_DoChase");
+
 //
 // P_NewChaseDir related LUT.
 //
@@ -113,29 +118,14 @@ void P_RandomChaseDir (AActor *actor);
 
 //----------------------------------------------------------------------------
 //
-// PROC P_RecursiveSound
+// PROC NoiseMarkSector
 //
-// Called by P_NoiseAlert.
-// Traverses adjacent sectors,
-// sound blocking lines cut off traversal.
+// Called by P_NoiseAlert for each sector the noise reaches.
+// The sectors themselves are found by level.soundgraph.
 //----------------------------------------------------------------------------
 
-struct NoiseTarget
-{
-	sector_t *sec;
-	int soundblocks;
-};
-static TArray<NoiseTarget> NoiseList(128);
-
 static void NoiseMarkSector(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
 {
-	// wake up all monsters in this sector
-	if (sec->validcount == validcount
-		&& sec->soundtraversed <= soundblocks + 1)
-	{
-		return; 		// already flooded
-	}
-
 	sec->validcount = validcount;
 	sec->soundtraversed = soundblocks + 1;
 	sec->SoundTarget = soundtarget;
@@ -149,88 +139,10 @@ static void NoiseMarkSector(sector_t *sec, AActor *soundtarget, bool splash, AAc
 			actor->LastHeard = soundtarget;
 		}
 	}
-	NoiseList.Push({ sec, soundblocks });
-}
-
-
-static void P_RecursiveSound(sector_t *sec, AActor *soundtarget, bool splash, AActor *emitter, int soundblocks, double maxdist)
-{
-	bool checkabove = !sec->PortalBlocksSound(sector_t::ceiling);
-	bool checkbelow = !sec->PortalBlocksSound(sector_t::floor);
-
-	for (auto check : sec->Lines)
-	{
-		// check sector portals
-		// I wish there was a better method to do this than randomly looking through the portal at a few places...
-		if (checkabove)
-		{
-			sector_t *upper = P_PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling));
-			NoiseMarkSector(upper, soundtarget, splash, emitter, soundblocks, maxdist);
-		}
-		if (checkbelow)
-		{
-			sector_t *lower = P_PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor));
-			NoiseMarkSector(lower, soundtarget, splash, emitter, soundblocks, maxdist);
-		}
-
-		// ... and line portals;
-		FLinePortal *port = check->getPortal();
-		if (port && (port->mFlags & PORTF_SOUNDTRAVERSE))
-		{
-			if (port->mDestination)
-			{
-				NoiseMarkSector(port->mDestination->frontsector, soundtarget, splash, emitter, soundblocks, maxdist);
-			}
-		}
-
-
-		if (check->sidedef[1] == NULL ||
-			!(check->flags & ML_TWOSIDED))
-		{
-			continue;
-		}
-
-		// Early out for intra-sector lines
-		if (check->sidedef[0]->sector == check->sidedef[1]->sector) continue;
-
-		sector_t *other;
-		if (check->sidedef[0]->sector == sec)
-			other = check->sidedef[1]->sector;
-		else
-			other = check->sidedef[0]->sector;
-
-		// check for closed door
-		if ((sec->floorplane.ZatPoint(check->v1->fPos()) >=
-			other->ceilingplane.ZatPoint(check->v1->fPos()) &&
-			sec->floorplane.ZatPoint(check->v2->fPos()) >=
-			other->ceilingplane.ZatPoint(check->v2->fPos()))
-			|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
-				sec->ceilingplane.ZatPoint(check->v1->fPos()) &&
-				other->floorplane.ZatPoint(check->v2->fPos()) >=
-				sec->ceilingplane.ZatPoint(check->v2->fPos()))
-			|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
-				other->ceilingplane.ZatPoint(check->v1->fPos()) &&
-				other->floorplane.ZatPoint(check->v2->fPos()) >=
-				other->ceilingplane.ZatPoint(check->v2->fPos())))
-		{
-			continue;
-		}
-
-		if (check->flags & ML_SOUNDBLOCK)
-		{
-			if (!soundblocks)
-				NoiseMarkSector(other, soundtarget, splash, emitter, 1, maxdist);
-		}
-		else
-		{
-			NoiseMarkSector(other, soundtarget, splash, emitter, soundblocks, maxdist);
-		}
-	}
 }
 
 
 
-
 //----------------------------------------------------------------------------
 //
 // PROC P_NoiseAlert
@@ -248,12 +160,14 @@ void P_NoiseAlert (AActor *target, AActor *emitter, bool splash, double maxdist)
 	if (target != NULL && target->player && (target->player->cheats & CF_NOTARGET))
 		return;
 
+	FSimProfileScope profile(NoiseAlertZone, emitter->GetClass());
+
 	validcount++;
-	NoiseList.Clear();
-	NoiseMarkSector(emitter->Sector, target, splash, emitter, 0, maxdist);
-	for (unsigned i = 0; i < NoiseList.Size(); i++)
+	unsigned count;
+	const FSoundFloodSector *reached = level.soundgraph.Flood(emitter->Sector, count);
+	for (unsigned i = 0; i < count; i++)
 	{
-		P_RecursiveSound(NoiseList[i].sec, target, splash, emitter, NoiseList[i].soundblocks, maxdist);
+		NoiseMarkSector(reached[i].Sector, target, splash, emitter, reached[i].SoundBlocks, maxdist);
 	}
 }
 
@@ -1426,13 +1340,14 @@ DEFINE_ACTION_FUNCTION(AActor, LookForMonsters)
 AActor *LookForTIDInBlock (AActor *lookee, int index, void *extparams)
 {
 	FLookExParams *params = (FLookExParams *)extparams;
-	FBlockNode *block;
 	AActor *link;
 	AActor *other;
+	int bx = index % level.blockmap.bmapwidth;
+	int by = index / level.blockmap.bmapwidth;
+	FBlockThingsIterator it(bx, by, bx, by);
 	
-	for (block = level.blockmap.blocklinks[index]; block != NULL; block = block->NextActor)
+	while ((link = it.Next()) != NULL)
 	{
-		link = block->Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1604,14 +1519,15 @@ DEFINE_ACTION_FUNCTION(AActor, LookForTID)
 
 AActor *LookForEnemiesInBlock (AActor *lookee, int index, void *extparam)
 {
-	FBlockNode *block;
 	AActor *link;
 	AActor *other;
 	FLookExParams *params = (FLookExParams *)extparam;
+	int bx = index % level.blockmap.bmapwidth;
+	int by = index / level.blockmap.bmapwidth;
+	FBlockThingsIterator it(bx, by, bx, by);
 	
-	for (block = level.blockmap.blocklinks[index]; block != NULL; block = block->NextActor)
+	while ((link = it.Next()) != NULL)
 	{
-		link = block->Me;
 
         if (!(link->flags & MF_SHOOTABLE))
 			continue;			// not shootable (observer or dead)
@@ -1753,6 +1669,7 @@ DEFINE_ACTION_FUNCTION(AActor, LookForEnemies)
 
 bool P_LookForPlayers (AActor *actor, INTBOOL allaround, FLookExParams *params)
 {
+	FSimProfileScope profile(LookForPlayersZone, actor->GetClass());
 	int 		c;
 	int			pnum;
 	player_t*	player;
@@ -2403,6 +2320,7 @@ nosee:
 
 void A_DoChase (AActor *actor, bool fastchase, FState *meleestate, FState *missilestate, bool playactive, bool nightmarefast, bool dontmove, int flags)
 {
+	FSimProfileScope profile(ChaseZone, actor->GetClass());
 
 	if (actor->flags5 & MF5_INCONVERSATION)
 		return;
@@ -56,6 +56,7 @@
 #include "p_spec.h"
 #include "g_levellocals.h"
 #include "vm.h"
+#include "p_sightbatch.h"
 
 // Remaps EE sector change types to Generic_Floor values. According to the Eternity Wiki:
 /*
@@ -2762,6 +2763,14 @@ FUNC(LS_Line_SetBlocking)
 	{
 		level.lines[line].flags = (level.lines[line].flags & ~clearflags) | setflags;
 	}
+	if ((setflags | clearflags) & ML_SOUNDBLOCK)
+	{
+		level.soundgraph.Invalidate();
+	}
+	if ((setflags | clearflags) & (ML_BLOCKSIGHT | ML_BLOCKEVERYTHING))
+	{
+		FSightBatch::GeometryChanged();
+	}
 	return true;
 }
 
@@ -3203,6 +3212,7 @@ FUNC(LS_GlassBreak)
 	bool quest1, quest2;
 
 	ln->flags &= ~(ML_BLOCKING|ML_BLOCKEVERYTHING);
+	FSightBatch::GeometryChanged();
 	switched = P_ChangeSwitchTexture (ln->sidedef[0], false, 0, &quest1);
 	ln->special = 0;
 	if (ln->sidedef[1] != NULL)
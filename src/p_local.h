@@ -279,6 +279,7 @@ void	P_SlideMove (AActor* mo, const DVector2 &pos, int numsteps);
 bool	P_BounceWall (AActor *mo);
 bool	P_BounceActor (AActor *mo, AActor *BlockingMobj, bool ontop);
 bool	P_CheckSight (AActor *t1, AActor *t2, int flags=0);
+bool	P_CheckSightTrace (AActor *t1, AActor *t2, int flags);
 
 enum ESightFlags
 {
@@ -421,6 +422,8 @@ template<class nodetype, class linktype>
 nodetype* P_DelSecnode(nodetype *, nodetype *linktype::*head);
 
 msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead);
+msecnode_t *P_CreateSecNodeList(AActor *thing, const TArray<sector_t *> &sectors, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead);
+void	P_CollectTouchedSectors(AActor *thing, double radius, TArray<sector_t *> &sectors);
 double	P_GetMoveFactor(const AActor *mo, double *frictionp);	// phares  3/6/98
 double		P_GetFriction(const AActor *mo, double *frictionfactor);
 
@@ -92,11 +92,19 @@
 #include "r_sky.h"
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
+#include "p_simprofile.h"
 
 CVAR(Bool, cl_bloodsplats, true, CVAR_ARCHIVE)
 CVAR(Int, sv_smartaim, 0, CVAR_ARCHIVE | CVAR_SERVERINFO)
 CVAR(Bool, cl_doautoaim, false, CVAR_ARCHIVE)
 
+static FSimProfileZone CheckPositionZone("P_CheckPosition");
+static FSimProfileZone TryMoveZone("P_TryMove");
+static FSimProfileZone LineAttackZone("P_LineAttack");
+static FSimProfileZone RadiusAttackZone("P_RadiusAttack");
+static FSimProfileZone ChangeSectorZone("P_ChangeSector");
+
 static void CheckForPushSpecial(line_t *line, int side, AActor *mobj, DVector2 * posforwindowcheck = NULL);
 static void SpawnShootDecal(AActor *t1, const FTraceResults &trace);
 static void SpawnDeepSplash(AActor *t1, const FTraceResults &trace, AActor *puff);
@@ -1729,6 +1737,7 @@ MOVEMENT CLIPPING
 
 bool P_CheckPosition(AActor *thing, const DVector2 &pos, FCheckPosition &tm, bool actorsonly)
 {
+	FSimProfileScope profile(CheckPositionZone, thing->GetClass());
 	sector_t *newsec;
 	AActor *thingblocker;
 	double realHeight = thing->Height;
@@ -2246,6 +2255,7 @@ bool P_TryMove(AActor *thing, const DVector2 &pos,
 	FCheckPosition &tm,
 	bool missileCheck)	// [GZ] Fired missiles ignore the drop-off test
 {
+	FSimProfileScope profile(TryMoveZone, thing->GetClass());
 	sector_t	*oldsector;
 	double		oldz;
 	int 		side;
@@ -4436,6 +4446,7 @@ AActor *P_LineAttack(AActor *t1, DAngle angle, double distance,
 	DAngle pitch, int damage, FName damageType, PClassActor *pufftype, int flags, FTranslatedLineTarget*victim, int *actualdamage, 
 	double sz, double offsetforward, double offsetside)
 {
+	FSimProfileScope profile(LineAttackZone, t1->GetClass());
 	bool nointeract = !!(flags & LAF_NOINTERACT);
 	DVector3 direction;
 	double shootz;
@@ -5942,7 +5953,7 @@ static int P_GetOldRadiusDamage(bool fromaction, AActor *bombspot, AActor *thing
 		return ret;  // out of range
 
 	// When called from the action function, ignore the sight check.
-	if (fromaction || P_CheckSight(thing, bombspot, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
+	if (fromaction || FExplosionSight::Instance()->Check(thing, bombspot))
 	{
 		dist = clamp<double>(dist - fulldamagedistance, 0, dist);
 		int damage = Scale(bombdamage, bombdistance - int(dist), bombdistance);
@@ -6012,6 +6023,8 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 		return 0;
 	fulldamagedistance = clamp<int>(fulldamagedistance, 0, bombdistance - 1);
 
+	FSimProfileScope profile(RadiusAttackZone, bombspot->GetClass());
+
 	FPortalGroupArray grouplist(FPortalGroupArray::PGA_Full3d);
 	FMultiBlockThingsIterator it(grouplist, bombspot->X(), bombspot->Y(), bombspot->Z() - bombdistance, bombspot->Height + bombdistance*2, bombdistance, false, bombspot->Sector);
 	FMultiBlockThingsIterator::CheckResult cres;
@@ -6021,10 +6034,12 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 		bombsource = bombspot;
 	}
 
+	FExplosionSight::Attacks++;
 	int count = 0;
 	while ((it.Next(&cres)))
 	{
 		AActor *thing = cres.thing;
+		FExplosionSight::Candidates++;
 		// Vulnerable actors can be damaged by radius attacks even if not shootable
 		// Used to emulate MBF's vulnerability of non-missile bouncers to explosions.
 		if (!((thing->flags & MF_SHOOTABLE) || (thing->flags6 & MF6_VULNERABLE)))
@@ -6060,7 +6075,7 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 			double points = P_GetRadiusDamage(false, bombspot, thing, bombdamage, bombdistance, fulldamagedistance, bombsource == thing);
 			double check = int(points) * bombdamage;
 			// points and bombdamage should be the same sign (the double cast of 'points' is needed to prevent overflows and incorrect values slipping through.)
-			if ((check > 0 || (check == 0 && bombspot->flags7 & MF7_FORCEZERORADIUSDMG)) && P_CheckSight(thing, bombspot, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
+			if ((check > 0 || (check == 0 && bombspot->flags7 & MF7_FORCEZERORADIUSDMG)) && FExplosionSight::Instance()->Check(thing, bombspot))
 			{ // OK to damage; target is in direct path
 				double vz;
 				double thrust;
@@ -6738,6 +6753,55 @@ void PIT_CeilingRaise(AActor *thing, FChangePosition *cpos)
 	}
 }
 
+//=============================================================================
+//
+// ChangeSectorThings
+//
+// killough 4/4/98: scan list front-to-back until empty or exhausted,
+// restarting from beginning after each thing is processed. Avoids
+// crashes, and is sure to examine all things in the sector, and only
+// the things which are in the sector, until a steady-state is reached.
+// Things can arbitrarily be inserted and removed and it won't mess up.
+//
+// Starting over is only needed when processing a thing changed the list,
+// though. If it didn't, every thing in front of the next node has already
+// been processed, so the scan can go on from there. This visits the things
+// in exactly the same order without being quadratic in their number.
+//
+//=============================================================================
+
+template<class Func>
+static void ChangeSectorThings(sector_t *sec, Func process)
+{
+	msecnode_t *n;
+
+	// Mark all things invalid
+	for (n = sec->touching_thinglist; n; n = n->m_snext)
+		n->visited = false;
+
+	// A scan of this sector that is still running further up must start over.
+	sec->touching_changes++;
+
+	n = sec->touching_thinglist;
+	while (n != nullptr)
+	{
+		if (n->visited)
+		{
+			n = n->m_snext;
+			continue;
+		}
+		n->visited = true; 							// mark thing as processed
+
+		unsigned changes = sec->touching_changes;
+		if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
+			(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
+		{
+			process(n->m_thing);
+		}
+		n = sec->touching_changes == changes ? n->m_snext : sec->touching_thinglist;
+	}
+}
+
 //=============================================================================
 //
 // P_ChangeSector	[RH] Was P_CheckSector in BOOM
@@ -6750,10 +6814,19 @@ void PIT_CeilingRaise(AActor *thing, FChangePosition *cpos)
 
 bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, bool isreset, bool instant)
 {
+	FSimProfileScope profile(ChangeSectorZone);
 	FChangePosition cpos;
 	void(*iterator)(AActor *, FChangePosition *);
 	void(*iterator2)(AActor *, FChangePosition *) = NULL;
 	msecnode_t *n;
+	auto process = [&](AActor *thing)
+	{
+		iterator(thing, &cpos);
+		if (iterator2 != NULL) iterator2(thing, &cpos);
+	};
+
+	FSightBatch::GeometryChanged();
+	level.soundgraph.SectorMoved(sector);
 
 	cpos.nofit = false;
 	cpos.crushchange = crunch;
@@ -6789,23 +6862,7 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 			// no thing checks for attached sectors because of heightsec
 			if (sec->heightsec == sector) continue;
 
-			for (n = sec->touching_thinglist; n; n = n->m_snext) n->visited = false;
-			do
-			{
-				for (n = sec->touching_thinglist; n; n = n->m_snext)
-				{
-					if (!n->visited)
-					{
-						n->visited = true;
-						if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-							(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-						{
-							iterator(n->m_thing, &cpos);
-						}
-						break;
-					}
-				}
-			} while (n);
+			ChangeSectorThings(sec, process);
 			sec->CheckPortalPlane(!floorOrCeil);
 		}
 	}
@@ -6839,36 +6896,7 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 		return false;
 	}
 
-	// killough 4/4/98: scan list front-to-back until empty or exhausted,
-	// restarting from beginning after each thing is processed. Avoids
-	// crashes, and is sure to examine all things in the sector, and only
-	// the things which are in the sector, until a steady-state is reached.
-	// Things can arbitrarily be inserted and removed and it won't mess up.
-	//
-	// killough 4/7/98: simplified to avoid using complicated counter
-
-	// Mark all things invalid
-
-	for (n = sector->touching_thinglist; n; n = n->m_snext)
-		n->visited = false;
-
-	do
-	{
-		for (n = sector->touching_thinglist; n; n = n->m_snext)	// go through list
-		{
-			if (!n->visited)								// unprocessed thing found
-			{
-				n->visited = true; 							// mark thing as processed
-				if (!(n->m_thing->flags & MF_NOBLOCKMAP) ||	//jff 4/7/98 don't do these
-					(n->m_thing->flags5 & MF5_MOVEWITHSECTOR))
-				{
-					iterator(n->m_thing, &cpos);		 			// process it
-					if (iterator2 != NULL) iterator2(n->m_thing, &cpos);
-				}
-				break;										// exit and start over
-			}
-		}
-	} while (n);	// repeat from scratch until all things left are marked valid
+	ChangeSectorThings(sector, process);
 
 	if (floorOrCeil != 2) sector->CheckPortalPlane(floorOrCeil);	// check for portal obstructions after everything is done.
 
@@ -6885,6 +6913,7 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 
 			for (n = s->touching_thinglist; n; n = n->m_snext)
 				n->visited = false;
+			s->touching_changes++;
 
 			do
 			{
@@ -61,6 +61,7 @@
 
 
 #include <stdlib.h>
+#include <thread>
 
 
 #include "m_bbox.h"
@@ -83,6 +84,8 @@
 sector_t *P_PointInSectorBuggy(double x, double y);
 int P_VanillaPointOnDivlineSide(double x, double y, const divline_t* line);
 
+EXTERN_CVAR(Bool, sim_secnodediff)
+
 
 //==========================================================================
 //
@@ -325,23 +328,16 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 	if (!(flags & MF_NOBLOCKMAP))
 	{
 		// [RH] Unlink from all blocks this actor uses
-		FBlockNode *block = this->BlockNode;
-
-		while (block != NULL)
-		{
-			if (block->NextActor != NULL)
-			{
-				block->NextActor->PrevActor = block->PrevActor;
-			}
-			*(block->PrevActor) = block->NextActor;
-			FBlockNode *next = block->NextBlock;
-			block->Release ();
-			block = next;
-		}
-		BlockNode = NULL;
+		level.thinggrid.Unlink(this);
+	}
+	if (ctx == nullptr || !sim_secnodediff)
+	{
+		ClearRenderSectorList();
+		ClearRenderLineList();
 	}
-	ClearRenderSectorList();
-	ClearRenderLineList();
+	// Otherwise the portal render lists stay on the actor, so that
+	// UpdateRenderSectorList in LinkToWorld can keep the nodes that still apply.
+	// They are not part of FLinkContext because scripts allocate that.
 }
 
 DEFINE_ACTION_FUNCTION(AActor, UnlinkFromWorld)
@@ -496,8 +492,16 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 		// When a node is deleted, its sector links (the links starting
 		// at sector_t->touching_thinglist) are broken. When a node is
 		// added, new sector links are created.
-		touching_sectorlist = P_CreateSecNodeList(this, radius, ctx != nullptr? ctx->sector_list : nullptr, &sector_t::touching_thinglist);	// Attach to thing
-		if (renderradius >= 0) touching_rendersectors = P_CreateSecNodeList(this, MAX(radius, renderradius), ctx != nullptr ? ctx->render_list : nullptr, &sector_t::touching_renderthings);
+		static TArray<sector_t *> touched;
+		P_CollectTouchedSectors(this, radius, touched);
+		touching_sectorlist = P_CreateSecNodeList(this, touched, ctx != nullptr? ctx->sector_list : nullptr, &sector_t::touching_thinglist);	// Attach to thing
+		if (renderradius >= 0)
+		{
+			// Most actors have no render radius of their own, so they get rendered in the sectors they touch.
+			// Without sim_secnodediff the lines are scanned again for this list, as they used to be.
+			if (renderradius > radius || !sim_secnodediff) P_CollectTouchedSectors(this, MAX(radius, renderradius), touched);
+			touching_rendersectors = P_CreateSecNodeList(this, touched, ctx != nullptr ? ctx->render_list : nullptr, &sector_t::touching_renderthings);
+		}
 		else
 		{
 			touching_rendersectors = nullptr;
@@ -509,57 +513,15 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 	// link into blockmap (inert things don't need to be in the blockmap)
 	if (!(flags & MF_NOBLOCKMAP))
 	{
-		FPortalGroupArray check;
-
-		P_CollectConnectedGroups(Sector->PortalGroup, Pos(), Top(), radius, check);
-
-		BlockNode = NULL;
-		FBlockNode **alink = &this->BlockNode;
-		for (int i = -1; i < (int)check.Size(); i++)
-		{
-			DVector3 pos = i==-1? Pos() : PosRelative(check[i] & ~FPortalGroupArray::FLAT);
-
-			int x1 = level.blockmap.GetBlockX(pos.X - radius);
-			int x2 = level.blockmap.GetBlockX(pos.X + radius);
-			int y1 = level.blockmap.GetBlockY(pos.Y - radius);
-			int y2 = level.blockmap.GetBlockY(pos.Y + radius);
-
-			if (x1 >= level.blockmap.bmapwidth || x2 < 0 || y1 >= level.blockmap.bmapheight || y2 < 0)
-			{ // thing is off the map
-			}
-			else
-			{ // [RH] Link into every block this actor touches, not just the center one
-				x1 = MAX(0, x1);
-				y1 = MAX(0, y1);
-				x2 = MIN(level.blockmap.bmapwidth - 1, x2);
-				y2 = MIN(level.blockmap.bmapheight - 1, y2);
-				for (int y = y1; y <= y2; ++y)
-				{
-					for (int x = x1; x <= x2; ++x)
-					{
-						FBlockNode **link = &level.blockmap.blocklinks[y*level.blockmap.bmapwidth + x];
-						FBlockNode *node = FBlockNode::Create(this, x, y, this->Sector->PortalGroup);
-
-						// Link in to block
-						if ((node->NextActor = *link) != NULL)
-						{
-							(*link)->PrevActor = &node->NextActor;
-						}
-						node->PrevActor = link;
-						*link = node;
-
-						// Link in to actor
-						node->PrevBlock = alink;
-						node->NextBlock = NULL;
-						(*alink) = node;
-						alink = &node->NextBlock;
-					}
-				}
-			}
-		}
+		level.thinggrid.Link(this);
 	}
 	// Portal links cannot be done unless the level is fully initialized.
-	if (!spawningmapthing) UpdateRenderSectorList();
+	if (!spawningmapthing && !(flags & MF_NOSECTOR)) UpdateRenderSectorList();
+	else
+	{
+		ClearRenderSectorList();
+		ClearRenderLineList();
+	}
 }
 
 DEFINE_ACTION_FUNCTION(AActor, LinkToWorld)
@@ -591,50 +553,92 @@ DEFINE_ACTION_FUNCTION(AActor, SetOrigin)
 	return 0;
 }
 
+//
+// BLOCK MAP ITERATORS
+// For each line/thing in the given mapblock,
+// call the passed PIT_* function.
+// If the function returns false,
+// exit with false without checking anything else.
+//
+
+
 //===========================================================================
 //
-// FBlockNode - allows to link actors into multiple blocks in the blockmap
+// FQueryContext
 //
 //===========================================================================
 
-FBlockNode *FBlockNode::FreeBlocks = NULL;
+FQueryContext FQueryContext::MainContext;
+thread_local FQueryContext *FQueryContext::CurrentContext;
 
-FBlockNode *FBlockNode::Create (AActor *who, int x, int y, int group)
+// Static initialization runs on the main thread
+static const std::thread::id QueryMainThread = std::this_thread::get_id();
+
+void FQueryContext::Bind(FQueryContext *context)
 {
-	FBlockNode *block;
+	assert(std::this_thread::get_id() != QueryMainThread);
+	CurrentContext = context;
+}
 
-	if (FreeBlocks != NULL)
+FQueryContext &FQueryContext::BindMain()
+{
+	if (std::this_thread::get_id() != QueryMainThread)
 	{
-		block = FreeBlocks;
-		FreeBlocks = block->NextBlock;
+		// Sharing validcount and the scratch arrays with the main thread would be a data race
+		I_FatalError("Blockmap query on a thread without a query context");
 	}
-	else
+	CurrentContext = &MainContext;
+	return MainContext;
+}
+
+bool FQueryContext::VisitPrivate(line_t *ld)
+{
+	unsigned index = ld->Index();
+	if (index >= LineStamps.Size())
 	{
-		block = new FBlockNode;
+		// Stamps left over from a previous level are all older than the current one
+		unsigned old = LineStamps.Size();
+		LineStamps.Resize(level.lines.Size());
+		memset(&LineStamps[old], 0, (LineStamps.Size() - old) * sizeof(int));
 	}
-	block->BlockIndex = x + y*level.blockmap.bmapwidth;
-	block->Me = who;
-	block->NextActor = NULL;
-	block->PrevActor = NULL;
-	block->PrevBlock = NULL;
-	block->NextBlock = NULL;
-	return block;
+	if (LineStamps[index] == Stamp) return false;
+	LineStamps[index] = Stamp;
+	return true;
 }
 
-void FBlockNode::Release ()
+bool FQueryContext::IsVisited(line_t *ld)
 {
-	NextBlock = FreeBlocks;
-	FreeBlocks = this;
+	if (IsMain()) return ld->validcount == validcount;
+	unsigned index = ld->Index();
+	return index < LineStamps.Size() && LineStamps[index] == Stamp;
 }
 
-//
-// BLOCK MAP ITERATORS
-// For each line/thing in the given mapblock,
-// call the passed PIT_* function.
-// If the function returns false,
-// exit with false without checking anything else.
-//
+bool FQueryContext::Visit(FPolyObj *poly)
+{
+	if (IsMain())
+	{
+		if (poly->validcount == validcount) return false;
+		poly->validcount = validcount;
+		return true;
+	}
+	unsigned index = unsigned(poly - polyobjs);
+	if (index >= PolyStamps.Size())
+	{
+		unsigned old = PolyStamps.Size();
+		PolyStamps.Resize(po_NumPolyobjs);
+		memset(&PolyStamps[old], 0, (PolyStamps.Size() - old) * sizeof(int));
+	}
+	if (PolyStamps[index] == Stamp) return false;
+	PolyStamps[index] = Stamp;
+	return true;
+}
 
+void FQueryContext::ResetStamps()
+{
+	LineStamps.Clear();
+	PolyStamps.Clear();
+	Stamp = 1;
+}
 
 //===========================================================================
 //
@@ -645,7 +649,8 @@ extern polyblock_t **PolyBlockMap;
 
 FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _maxy, bool keepvalidcount)
 {
-	if (!keepvalidcount) validcount++;
+	context = &FQueryContext::Current();
+	if (!keepvalidcount) context->NewPass();
 	minx = _minx;
 	maxx = _maxx;
 	miny = _miny;
@@ -655,7 +660,8 @@ FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _m
 
 void FBlockLinesIterator::init(const FBoundingBox &box)
 {
-	validcount++;
+	context = &FQueryContext::Current();
+	context->NewPass();
 	maxy = level.blockmap.GetBlockY(box.Top());
 	miny = level.blockmap.GetBlockY(box.Bottom());
 	maxx = level.blockmap.GetBlockX(box.Right());
@@ -710,12 +716,11 @@ line_t *FBlockLinesIterator::Next()
 			{
 				if (polyIndex == 0)
 				{
-					if (polyLink->polyobj->validcount == validcount)
+					if (!context->Visit(polyLink->polyobj))
 					{
 						polyLink = polyLink->next;
 						continue;
 					}
-					polyLink->polyobj->validcount = validcount;
 				}
 
 				line_t *ld = polyLink->polyobj->Linedefs[polyIndex];
@@ -726,13 +731,8 @@ line_t *FBlockLinesIterator::Next()
 					polyIndex = 0;
 				}
 
-				if (ld->validcount == validcount)
-				{
-					continue;
-				}
-				else
+				if (context->Visit(ld))
 				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -746,9 +746,8 @@ line_t *FBlockLinesIterator::Next()
 				line_t *ld = &level.lines[*list];
 
 				list++;
-				if (ld->validcount != validcount)
+				if (context->Visit(ld))
 				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -1008,34 +1007,76 @@ DEFINE_FIELD_NAMED(DBlockLinesIterator, cres.portalflags, portalflags);
 //
 // FBlockThingsIterator :: FBlockThingsIterator
 //
+// With the default grid the fine cells are the blockmap's blocks. The
+// iterator then goes block by block and merges the coarse entries of each
+// block in by their link order, so actors come in exactly the order the
+// old per block lists had them: newest first, an actor that covers several
+// blocks in the first of them, and the hash weeds out the repeats.
+//
+// With smaller cells the iterator walks the cells of both levels that
+// cover its area instead. Actors that cover several cells are returned in
+// the first of them that lies inside the area. Only when the area is
+// switched to another block, or an actor is linked through portals, the
+// hash is needed to find those that were returned before.
+//
 //===========================================================================
 
 FBlockThingsIterator::FBlockThingsIterator()
 : DynHash(0)
 {
-	minx = maxx = 0;
-	miny = maxy = 0;
+	for (auto &area : cells)
+	{
+		area[0] = area[1] = 0;
+		area[2] = area[3] = -1;
+	}
+	blocks[0] = blocks[1] = 0;
+	blocks[2] = blocks[3] = -1;
+	switched = false;
+	blockorder = level.thinggrid.IsBlockOrder();
 	ClearHash();
-	block = NULL;
+	Reset();
 }
 
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
 : DynHash(0)
 {
-	minx = _minx;
-	maxx = _maxx;
-	miny = _miny;
-	maxy = _maxy;
+	for (int lvl = 0; lvl < FThingGrid::NumLevels; lvl++)
+	{
+		if (!level.thinggrid.BlocksToCells(lvl, _minx, _miny, _maxx, _maxy, cells[lvl]))
+		{
+			cells[lvl][0] = cells[lvl][1] = 0;
+			cells[lvl][2] = cells[lvl][3] = -1;
+		}
+	}
+	blocks[0] = _minx;
+	blocks[1] = _miny;
+	blocks[2] = _maxx;
+	blocks[3] = _maxy;
+	switched = false;
+	blockorder = level.thinggrid.IsBlockOrder();
 	ClearHash();
 	Reset();
 }
 
 void FBlockThingsIterator::init(const FBoundingBox &box)
 {
-	maxy = level.blockmap.GetBlockY(box.Top());
-	miny = level.blockmap.GetBlockY(box.Bottom());
-	maxx = level.blockmap.GetBlockX(box.Right());
-	minx = level.blockmap.GetBlockX(box.Left());
+	blocks[0] = level.blockmap.GetBlockX(box.Left());
+	blocks[1] = level.blockmap.GetBlockY(box.Bottom());
+	blocks[2] = level.blockmap.GetBlockX(box.Right());
+	blocks[3] = level.blockmap.GetBlockY(box.Top());
+	blockorder = level.thinggrid.IsBlockOrder();
+	for (int lvl = 0; lvl < FThingGrid::NumLevels; lvl++)
+	{
+		// Finer cells only look at the part of the blocks the box covers, which finds fewer actors than the blockmap did.
+		bool inside = blockorder ? level.thinggrid.BlocksToCells(lvl, blocks[0], blocks[1], blocks[2], blocks[3], cells[lvl]) :
+			level.thinggrid.BoxToCells(lvl, box.Left(), box.Bottom(), box.Right(), box.Top(), cells[lvl]);
+		if (!inside)
+		{
+			cells[lvl][0] = cells[lvl][1] = 0;
+			cells[lvl][2] = cells[lvl][3] = -1;
+		}
+	}
+	switched = false;
 	ClearHash();
 	Reset();
 }
@@ -1055,23 +1096,159 @@ void FBlockThingsIterator::ClearHash()
 
 //===========================================================================
 //
-// FBlockThingsIterator :: StartBlock
+// FBlockThingsIterator :: AddToHash
+//
+// Returns false if the actor was already in the hash.
 //
 //===========================================================================
 
-void FBlockThingsIterator::StartBlock(int x, int y)
+bool FBlockThingsIterator::AddToHash(AActor *me)
 {
-	curx = x;
-	cury = y;
-	if (level.blockmap.isValidBlock(x, y))
+	HashEntry *entry;
+	int i;
+
+	size_t hash = ((size_t)me >> 3) % countof(Buckets);
+	for (i = Buckets[hash]; i >= 0; )
+	{
+		entry = GetHashEntry(i);
+		if (entry->Actor == me)
+		{ // I've already been checked.
+			return false;
+		}
+		i = entry->Next;
+	}
+	if (NumFixedHash < (int)countof(FixedHash))
 	{
-		block = level.blockmap.blocklinks[y*level.blockmap.bmapwidth + x];
+		entry = &FixedHash[NumFixedHash];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = NumFixedHash++;
 	}
 	else
 	{
-		// invalid block
-		block = NULL;
+		if (DynHash.Size() == 0)
+		{
+			DynHash.Grow(50);
+		}
+		i = DynHash.Reserve(1);
+		entry = &DynHash[i];
+		entry->Next = Buckets[hash];
+		Buckets[hash] = i + countof(FixedHash);
+	}
+	entry->Actor = me;
+	return true;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: Reset
+//
+//===========================================================================
+
+void FBlockThingsIterator::Reset()
+{
+	cell = nullptr;
+	coarse = nullptr;
+	last = coarselast = nullptr;
+	if (blockorder)
+	{
+		// The fine level's cells are the blocks, clamped to the blockmap
+		if (cells[FThingGrid::FineLevel][0] <= cells[FThingGrid::FineLevel][2])
+		{
+			curx = cells[FThingGrid::FineLevel][0];
+			cury = cells[FThingGrid::FineLevel][1];
+			StartBlock();
+		}
+		return;
+	}
+	for (curlevel = 0; curlevel < FThingGrid::NumLevels; curlevel++)
+	{
+		if (cells[curlevel][0] <= cells[curlevel][2])
+		{
+			curx = cells[curlevel][0];
+			cury = cells[curlevel][1];
+			StartCell();
+			return;
+		}
+	}
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: StartCell
+//
+//===========================================================================
+
+void FBlockThingsIterator::StartCell()
+{
+	cell = &level.thinggrid.GetCell(curlevel, curx, cury);
+	index = cell->Size();
+	last = nullptr;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: NextCell
+//
+//===========================================================================
+
+void FBlockThingsIterator::NextCell()
+{
+	if (++curx > cells[curlevel][2])
+	{
+		curx = cells[curlevel][0];
+		if (++cury > cells[curlevel][3])
+		{
+			do
+			{
+				if (++curlevel >= FThingGrid::NumLevels)
+				{
+					cell = nullptr;
+					return;
+				}
+			} while (cells[curlevel][0] > cells[curlevel][2]);
+			curx = cells[curlevel][0];
+			cury = cells[curlevel][1];
+		}
 	}
+	StartCell();
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: StartBlock
+//
+//===========================================================================
+
+void FBlockThingsIterator::StartBlock()
+{
+	auto &grid = level.thinggrid;
+	int shift = FThingGrid::CoarseShift;
+	cell = &grid.GetCell(FThingGrid::FineLevel, curx, cury);
+	coarse = &grid.GetCell(FThingGrid::CoarseLevel, curx >> shift, cury >> shift);
+	index = cell->Size();
+	coarseindex = coarse->Size();
+	last = coarselast = nullptr;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: NextBlock
+//
+//===========================================================================
+
+void FBlockThingsIterator::NextBlock()
+{
+	const int *area = cells[FThingGrid::FineLevel];
+	if (++curx > area[2])
+	{
+		curx = area[0];
+		if (++cury > area[3])
+		{
+			cell = coarse = nullptr;
+			return;
+		}
+	}
+	StartBlock();
 }
 
 //===========================================================================
@@ -1082,31 +1259,157 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 
 void FBlockThingsIterator::SwitchBlock(int x, int y)
 {
-	minx = maxx = x;
-	miny = maxy = y;
-	StartBlock(x, y);
+	for (int lvl = 0; lvl < FThingGrid::NumLevels; lvl++)
+	{
+		if (!level.thinggrid.BlocksToCells(lvl, x, y, x, y, cells[lvl]))
+		{
+			cells[lvl][0] = cells[lvl][1] = 0;
+			cells[lvl][2] = cells[lvl][3] = -1;
+		}
+	}
+	blocks[0] = blocks[2] = x;
+	blocks[1] = blocks[3] = y;
+	switched = true;
+	Reset();
 }
 
 //===========================================================================
 //
 // FBlockThingsIterator :: Next
 //
+// Cells are arrays, so unlinking an actor the caller was given, or one
+// before it, moves the entries the iterator still has to read. The last
+// actor read from the cell tells where to go on.
+//
 //===========================================================================
 
+static void ResyncCell(const TArray<FThingGridEntry> *cell, unsigned &index, AActor *last)
+{
+	if (last == nullptr || (index < cell->Size() && (*cell)[index].Actor == last))
+	{
+		return;
+	}
+	for (unsigned i = MIN(index, cell->Size()); i-- > 0; )
+	{
+		if ((*cell)[i].Actor == last)
+		{
+			index = i;
+			return;
+		}
+	}
+}
+
 AActor *FBlockThingsIterator::Next(bool centeronly)
 {
-	for (;;)
+	if (blockorder)
+	{
+		return NextInBlockOrder(centeronly);
+	}
+	if (cell != nullptr)
+	{
+		ResyncCell(cell, index, last);
+	}
+	last = nullptr;
+
+	while (cell != nullptr)
+	{
+		// Actors that got linked into this cell after it was started are at the end,
+		// so they are left out, just like the old block lists did.
+		index = MIN(index, cell->Size());
+		while (index > 0)
+		{
+			const FThingGridEntry &entry = (*cell)[--index];
+			const FThingGrid::FLink &link = level.thinggrid.GetLink(entry.Link);
+			AActor *me = entry.Actor;
+			const int *area = cells[curlevel];
+
+			if (curx != MAX(link.X1, area[0]) || cury != MAX(link.Y1, area[1]))
+			{ // This link already went through an earlier cell of the area.
+				continue;
+			}
+			if (curlevel == FThingGrid::CoarseLevel && (link.BX1 > blocks[2] || link.BX2 < blocks[0] || link.BY1 > blocks[3] || link.BY2 < blocks[1]))
+			{ // Coarse cells cover many blocks. The old block lists only had the actor in those its box touches.
+				continue;
+			}
+			if (centeronly)
+			{
+				// Block boundaries for compatibility mode
+				double blockleft = (blocks[0] * FBlockmap::MAPBLOCKUNITS) + level.blockmap.bmaporgx;
+				double blockright = blockleft + FBlockmap::MAPBLOCKUNITS;
+				double blockbottom = (blocks[1] * FBlockmap::MAPBLOCKUNITS) + level.blockmap.bmaporgy;
+				double blocktop = blockbottom + FBlockmap::MAPBLOCKUNITS;
+
+				// only return actors with the center in this block
+				if (me->X() >= blockleft && me->X() < blockright &&
+					me->Y() >= blockbottom && me->Y() < blocktop)
+				{
+					return last = me;
+				}
+			}
+			else if ((link.Flags & FThingGrid::LINK_SINGLE) || (!switched && !(link.Flags & FThingGrid::LINK_PORTAL)))
+			{ // This actor can only ever be checked once.
+				return last = me;
+			}
+			else if (AddToHash(me))
+			{
+				return last = me;
+			}
+		}
+		NextCell();
+	}
+	return nullptr;
+}
+
+//===========================================================================
+//
+// FBlockThingsIterator :: NextInBlockOrder
+//
+// The old block lists had the newest actor first. Here each block is its
+// own fine cell and both the cell and the coarse cell around it are in
+// link order, so reading both from the end and taking the newer entry
+// each time gives the same sequence.
+//
+//===========================================================================
+
+AActor *FBlockThingsIterator::NextInBlockOrder(bool centeronly)
+{
+	auto &grid = level.thinggrid;
+
+	if (cell != nullptr)
 	{
-		while (block != NULL)
+		ResyncCell(cell, index, last);
+		ResyncCell(coarse, coarseindex, coarselast);
+	}
+
+	while (cell != nullptr)
+	{
+		// Actors that got linked into this block after it was started are at the end,
+		// so they are left out, just like the old block lists did.
+		index = MIN(index, cell->Size());
+		coarseindex = MIN(coarseindex, coarse->Size());
+		while (index > 0 || coarseindex > 0)
 		{
-			AActor *me = block->Me;
-			FBlockNode *mynode = block;
-			HashEntry *entry;
-			int i;
-
-			block = block->NextActor;
-			// Don't recheck things that were already checked
-			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
+			FThingGridEntry entry;
+			if (coarseindex == 0 || (index > 0 &&
+				grid.GetLink((*cell)[index - 1].Link).Seq > grid.GetLink((*coarse)[coarseindex - 1].Link).Seq))
+			{
+				entry = (*cell)[--index];
+				last = entry.Actor;
+			}
+			else
+			{
+				entry = (*coarse)[--coarseindex];
+				coarselast = entry.Actor;
+			}
+
+			AActor *me = entry.Actor;
+			const FThingGrid::FLink &link = grid.GetLink(entry.Link);
+
+			if (curx < link.BX1 || curx > link.BX2 || cury < link.BY1 || cury > link.BY2)
+			{ // Coarse cells cover many blocks. The old block lists only had the actor in those its box touches.
+				continue;
+			}
+			if (link.Flags & FThingGrid::LINK_SINGLE)
 			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
 				return me;
 			}
@@ -1125,54 +1428,16 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 					return me;
 				}
 			}
-			else
+			else if (AddToHash(me))
 			{
-				size_t hash = ((size_t)me >> 3) % countof(Buckets);
-				for (i = Buckets[hash]; i >= 0; )
-				{
-					entry = GetHashEntry(i);
-					if (entry->Actor == me)
-					{ // I've already been checked. Skip to the next actor.
-						break;
-					}
-					i = entry->Next;
-				}
-				if (i < 0)
-				{ // Add me to the hash table and return me.
-					if (NumFixedHash < (int)countof(FixedHash))
-					{
-						entry = &FixedHash[NumFixedHash];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = NumFixedHash++;
-					}
-					else
-					{
-						if (DynHash.Size() == 0)
-						{
-							DynHash.Grow(50);
-						}
-						i = DynHash.Reserve(1);
-						entry = &DynHash[i];
-						entry->Next = Buckets[hash];
-						Buckets[hash] = i + countof(FixedHash);
-					}
-					entry->Actor = me;
-					return me;
-				}
+				return me;
 			}
 		}
-
-		if (++curx > maxx)
-		{
-			curx = minx;
-			if (++cury > maxy) return NULL;
-		}
-		StartBlock(curx, cury);
+		NextBlock();
 	}
+	return nullptr;
 }
 
-
-
 //===========================================================================
 //
 // FMultiBlockThingsIterator :: FMultiBlockThingsIterator
@@ -1344,14 +1609,6 @@ DEFINE_FIELD_NAMED(DBlockThingsIterator, cres.thing, thing);
 DEFINE_FIELD_NAMED(DBlockThingsIterator, cres.Position, position);
 DEFINE_FIELD_NAMED(DBlockThingsIterator, cres.portalflags, portalflags);
 
-//===========================================================================
-//
-// FPathTraverse :: Intercepts
-//
-//===========================================================================
-
-TArray<intercept_t> FPathTraverse::intercepts(128);
-
 
 //===========================================================================
 //
@@ -1412,163 +1669,174 @@ void FPathTraverse::AddThingIntercepts (int bx, int by, FBlockThingsIterator &it
 	it.SwitchBlock(bx, by);
 	while ((thing = it.Next(compatible)))
 	{
-		int numfronts = 0;
-		divline_t line;
-		int i;
+		AddThingIntercept(thing, compatible);
+	}
+}
 
+//===========================================================================
+//
+// FPathTraverse :: AddThingIntercept
+//
+//===========================================================================
 
-		if (!compatible)
-		{
-			// [RH] Don't check a corner to corner crossection for hit.
-			// Instead, check against the actual bounding box (but not if compatibility optioned.)
+void FPathTraverse::AddThingIntercept(AActor *thing, bool compatible)
+{
+	int numfronts = 0;
+	divline_t line;
+	int i;
 
-			// There's probably a smarter way to determine which two sides
-			// of the thing face the trace than by trying all four sides...
-			for (i = 0; i < 4; ++i)
+
+	if (!compatible)
+	{
+		// [RH] Don't check a corner to corner crossection for hit.
+		// Instead, check against the actual bounding box (but not if compatibility optioned.)
+
+		// There's probably a smarter way to determine which two sides
+		// of the thing face the trace than by trying all four sides...
+		for (i = 0; i < 4; ++i)
+		{
+			switch (i)
 			{
-				switch (i)
-				{
-				case 0:		// Top edge
-					line.y = thing->Y() + thing->radius;
-					if (trace.y < line.y) continue;
-					line.x = thing->X() + thing->radius;
-					line.dx = -thing->radius * 2;
-					line.dy = 0;
-					break;
-
-				case 1:		// Right edge
-					line.x = thing->X() + thing->radius;
-					if (trace.x < line.x) continue;
-					line.y = thing->Y() - thing->radius;
-					line.dx = 0;
-					line.dy = thing->radius * 2;
-					break;
-
-				case 2:		// Bottom edge
-					line.y = thing->Y() - thing->radius;
-					if (trace.y > line.y) continue;
-					line.x = thing->X() - thing->radius;
-					line.dx = thing->radius * 2;
-					line.dy = 0;
-					break;
-
-				case 3:		// Left edge
-					line.x = thing->X() - thing->radius;
-					if (trace.x > line.x) continue;
-					line.y = thing->Y() + thing->radius;
-					line.dx = 0;
-					line.dy = thing->radius * -2;
-					break;
-				}
-				// Check if this side is facing the trace origin
-				numfronts++;
+			case 0:		// Top edge
+				line.y = thing->Y() + thing->radius;
+				if (trace.y < line.y) continue;
+				line.x = thing->X() + thing->radius;
+				line.dx = -thing->radius * 2;
+				line.dy = 0;
+				break;
+
+			case 1:		// Right edge
+				line.x = thing->X() + thing->radius;
+				if (trace.x < line.x) continue;
+				line.y = thing->Y() - thing->radius;
+				line.dx = 0;
+				line.dy = thing->radius * 2;
+				break;
+
+			case 2:		// Bottom edge
+				line.y = thing->Y() - thing->radius;
+				if (trace.y > line.y) continue;
+				line.x = thing->X() - thing->radius;
+				line.dx = thing->radius * 2;
+				line.dy = 0;
+				break;
+
+			case 3:		// Left edge
+				line.x = thing->X() - thing->radius;
+				if (trace.x > line.x) continue;
+				line.y = thing->Y() + thing->radius;
+				line.dx = 0;
+				line.dy = thing->radius * -2;
+				break;
+			}
+			// Check if this side is facing the trace origin
+			numfronts++;
 
-				// If it is, see if the trace crosses it
-				if (P_PointOnDivlineSide (line.x, line.y, &trace) !=
-					P_PointOnDivlineSide (line.x + line.dx, line.y + line.dy, &trace))
-				{
-					// It's a hit
-					double frac = P_InterceptVector (&trace, &line);
-					if (frac < Startfrac)
-					{ // behind source
-						if (Startfrac > 0)
+			// If it is, see if the trace crosses it
+			if (P_PointOnDivlineSide (line.x, line.y, &trace) !=
+				P_PointOnDivlineSide (line.x + line.dx, line.y + line.dy, &trace))
+			{
+				// It's a hit
+				double frac = P_InterceptVector (&trace, &line);
+				if (frac < Startfrac)
+				{ // behind source
+					if (Startfrac > 0)
+					{
+						// check if the trace starts within this actor
+						switch (i)
 						{
-							// check if the trace starts within this actor
-							switch (i)
-							{
-							case 0:
-								line.y -= 2 * thing->radius;
-								break;
-
-							case 1:
-								line.x -= 2 * thing->radius;
-								break;
-
-							case 2:
-								line.y += 2 * thing->radius;
-								break;
-
-							case 3:
-								line.x += 2 * thing->radius;
-								break;
-							}
-							double frac2 = P_InterceptVector(&trace, &line);
-							if (frac2 >= Startfrac) goto addit;
+						case 0:
+							line.y -= 2 * thing->radius;
+							break;
+
+						case 1:
+							line.x -= 2 * thing->radius;
+							break;
+
+						case 2:
+							line.y += 2 * thing->radius;
+							break;
+
+						case 3:
+							line.x += 2 * thing->radius;
+							break;
 						}
-						continue;
+						double frac2 = P_InterceptVector(&trace, &line);
+						if (frac2 >= Startfrac) goto addit;
 					}
-				addit:
-					intercept_t newintercept;
-					newintercept.frac = frac;
-					newintercept.isaline = false;
-					newintercept.done = false;
-					newintercept.d.thing = thing;
-					intercepts.Push (newintercept);
-					break;
+					continue;
 				}
-			}
-
-			// If none of the sides was facing the trace, then the trace
-			// must have started inside the box, so add it as an intercept.
-			if (numfronts == 0)
-			{
+			addit:
 				intercept_t newintercept;
-				newintercept.frac = 0;
+				newintercept.frac = frac;
 				newintercept.isaline = false;
 				newintercept.done = false;
 				newintercept.d.thing = thing;
 				intercepts.Push (newintercept);
+				break;
 			}
 		}
+
+		// If none of the sides was facing the trace, then the trace
+		// must have started inside the box, so add it as an intercept.
+		if (numfronts == 0)
+		{
+			intercept_t newintercept;
+			newintercept.frac = 0;
+			newintercept.isaline = false;
+			newintercept.done = false;
+			newintercept.d.thing = thing;
+			intercepts.Push (newintercept);
+		}
+	}
+	else
+	{
+		// Old code for compatibility purposes
+		double 		x1, y1, x2, y2;
+		int 			s1, s2;
+		divline_t		dl;
+		double 		frac;
+			
+		bool tracepositive = (trace.dx * trace.dy)>0;
+					
+		// check a corner to corner crossection for hit
+		if (tracepositive)
+		{
+			x1 = thing->X() - thing->radius;
+			y1 = thing->Y() + thing->radius;
+					
+			x2 = thing->X() + thing->radius;
+			y2 = thing->Y() - thing->radius;					
+		}
 		else
 		{
-			// Old code for compatibility purposes
-			double 		x1, y1, x2, y2;
-			int 			s1, s2;
-			divline_t		dl;
-			double 		frac;
-				
-			bool tracepositive = (trace.dx * trace.dy)>0;
-						
-			// check a corner to corner crossection for hit
-			if (tracepositive)
-			{
-				x1 = thing->X() - thing->radius;
-				y1 = thing->Y() + thing->radius;
-						
-				x2 = thing->X() + thing->radius;
-				y2 = thing->Y() - thing->radius;					
-			}
-			else
-			{
-				x1 = thing->X() - thing->radius;
-				y1 = thing->Y() - thing->radius;
-						
-				x2 = thing->X() + thing->radius;
-				y2 = thing->Y() + thing->radius;					
-			}
+			x1 = thing->X() - thing->radius;
+			y1 = thing->Y() - thing->radius;
+					
+			x2 = thing->X() + thing->radius;
+			y2 = thing->Y() + thing->radius;					
+		}
+		
+		s1 = P_PointOnDivlineSide (x1, y1, &trace);
+		s2 = P_PointOnDivlineSide (x2, y2, &trace);
+
+		if (s1 != s2)
+		{
+			dl.x = x1;
+			dl.y = y1;
+			dl.dx = x2-x1;
+			dl.dy = y2-y1;
 			
-			s1 = P_PointOnDivlineSide (x1, y1, &trace);
-			s2 = P_PointOnDivlineSide (x2, y2, &trace);
+			frac = P_InterceptVector (&trace, &dl);
 
-			if (s1 != s2)
+			if (frac >= Startfrac)
 			{
-				dl.x = x1;
-				dl.y = y1;
-				dl.dx = x2-x1;
-				dl.dy = y2-y1;
-				
-				frac = P_InterceptVector (&trace, &dl);
-
-				if (frac >= Startfrac)
-				{
-					intercept_t newintercept;
-					newintercept.frac = frac;
-					newintercept.isaline = false;
-					newintercept.done = false;
-					newintercept.d.thing = thing;
-					intercepts.Push (newintercept);
-				}
+				intercept_t newintercept;
+				newintercept.frac = frac;
+				newintercept.isaline = false;
+				newintercept.done = false;
+				newintercept.d.thing = thing;
+				intercepts.Push (newintercept);
 			}
 		}
 	}
@@ -1647,7 +1915,8 @@ void FPathTraverse::init(double x1, double y1, double x2, double y2, int flags,
 		flags |= PT_DELTA;
 	}
 
-	validcount++;
+	context.NewPass();
+	passcount++;
 	intercept_index = intercepts.Size();
 	Startfrac = startfrac;
 
@@ -1983,24 +2252,26 @@ struct BlockCheckInfo
 static AActor *RoughBlockCheck (AActor *mo, int index, void *param)
 {
 	BlockCheckInfo *info = (BlockCheckInfo *)param;
+	int bx = index % level.blockmap.bmapwidth;
+	int by = index / level.blockmap.bmapwidth;
+	FBlockThingsIterator it(bx, by, bx, by);
+	AActor *link;
 
-	FBlockNode *link;
-
-	for (link = level.blockmap.blocklinks[index]; link != NULL; link = link->NextActor)
+	while ((link = it.Next()) != NULL)
 	{
-		if (link->Me != mo)
+		if (link != mo)
 		{
-			if (info->onlyseekable && !mo->CanSeek(link->Me))
+			if (info->onlyseekable && !mo->CanSeek(link))
 			{
 				continue;
 			}
-			if (info->frontonly && P_PointOnDivlineSide(link->Me->X(), link->Me->Y(), &info->frontline) != 0)
+			if (info->frontonly && P_PointOnDivlineSide(link->X(), link->Y(), &info->frontline) != 0)
 			{
 				continue;
 			}
-			if (mo->IsOkayToAttack (link->Me))
+			if (mo->IsOkayToAttack (link))
 			{
-				return link->Me;
+				return link;
 			}
 		}
 	}
@@ -5,9 +5,10 @@
 #include "r_defs.h"
 #include "doomstat.h"
 #include "m_bbox.h"
+#include "p_thinggrid.h"
 
 extern int validcount;
-struct FBlockNode;
+struct FPolyObj;
 
 struct divline_t
 {
@@ -28,6 +29,81 @@ struct intercept_t
 	} d;
 };
 
+struct SightTask
+{
+	double Frac;
+	double topslope;
+	double bottomslope;
+	int direction;
+	int portalgroup;
+};
+
+//==========================================================================
+//
+// Scratch state for blockmap, path traversal and sight queries
+//
+// Each thread that runs such queries has its own context. The main thread's
+// context marks lines and polyobjects through their validcount fields as
+// before, so code that looks at those directly keeps working. Other
+// contexts keep private visit stamps and never write to the level.
+//
+//==========================================================================
+
+class FQueryContext
+{
+public:
+	FQueryContext() {}
+
+	// The context of the calling thread. Threads other than the main thread
+	// must have bound their own, as they would share the main thread's marks.
+	static FQueryContext &Current()
+	{
+		if (CurrentContext == nullptr) return BindMain();
+		return *CurrentContext;
+	}
+
+	// Makes context the calling thread's context. Pass nullptr to unbind it.
+	// Must not be used on the main thread.
+	static void Bind(FQueryContext *context);
+
+	bool IsMain() const { return this == &MainContext; }
+
+	// Starts a new pass over the blockmap. Replaces validcount++.
+	void NewPass()
+	{
+		if (IsMain()) validcount++;
+		else if (++Stamp == 0) ResetStamps();
+	}
+
+	// Returns true the first time a line is visited in the current pass
+	bool Visit(line_t *ld)
+	{
+		if (!IsMain()) return VisitPrivate(ld);
+		if (ld->validcount == validcount) return false;
+		ld->validcount = validcount;
+		return true;
+	}
+
+	bool IsVisited(line_t *ld);
+	bool Visit(FPolyObj *poly);
+
+	TArray<intercept_t> Intercepts;			// for FPathTraverse
+	TArray<intercept_t> SightIntercepts;	// for P_CheckSight
+	TArray<SightTask> SightPortals;
+
+private:
+	bool VisitPrivate(line_t *ld);
+	void ResetStamps();
+	static FQueryContext &BindMain();
+
+	int Stamp = 0;
+	TArray<int> LineStamps;
+	TArray<int> PolyStamps;
+
+	static FQueryContext MainContext;
+	static thread_local FQueryContext *CurrentContext;
+};
+
 //==========================================================================
 //
 // P_PointOnLineSide
@@ -211,6 +287,7 @@ class FBlockLinesIterator
 	polyblock_t *polyLink;
 	int polyIndex;
 	int *list;
+	FQueryContext *context;
 
 	void StartBlock(int x, int y);
 
@@ -274,12 +351,19 @@ public:
 
 class FBlockThingsIterator
 {
-	int minx, maxx;
-	int miny, maxy;
+	int cells[FThingGrid::NumLevels][4];	// cells to check on each level: left, bottom, right, top
+	int blocks[4];			// blockmap blocks of the area: left, bottom, right, top
+	bool switched;			// the area was changed by SwitchBlock
+	bool blockorder;		// the fine cells are the blocks, so the old order can be kept
 
+	int curlevel;
 	int curx, cury;
-
-	FBlockNode *block;
+	const TArray<FThingGridEntry> *cell;
+	unsigned index;			// cells are read from the end, like the old block lists
+	AActor *last;
+	const TArray<FThingGridEntry> *coarse;	// in block order, the coarse cell around the current block
+	unsigned coarseindex;
+	AActor *coarselast;
 
 	int Buckets[32];
 
@@ -294,9 +378,14 @@ class FBlockThingsIterator
 
 	HashEntry *GetHashEntry(int i) { return i < (int)countof(FixedHash) ? &FixedHash[i] : &DynHash[i - countof(FixedHash)]; }
 
-	void StartBlock(int x, int y);
+	void StartCell();
+	void NextCell();
+	void StartBlock();
+	void NextBlock();
+	AActor *NextInBlockOrder(bool centeronly);
 	void SwitchBlock(int x, int y);
 	void ClearHash();
+	bool AddToHash(AActor *me);
 
 	// The following is only for use in the path traverser 
 	// and therefore declared private.
@@ -313,7 +402,7 @@ public:
 	}
 	void init(const FBoundingBox &box);
 	AActor *Next(bool centeronly = false);
-	void Reset() { StartBlock(minx, miny); }
+	void Reset();
 };
 
 class FMultiBlockThingsIterator
@@ -354,16 +443,19 @@ public:
 class FPathTraverse
 {
 protected:
-	static TArray<intercept_t> intercepts;
+	FQueryContext &context = FQueryContext::Current();
+	TArray<intercept_t> &intercepts = context.Intercepts;
 
 	divline_t trace;
 	double Startfrac;
 	unsigned int intercept_index;
 	unsigned int intercept_count;
 	unsigned int count;
+	unsigned int passcount = 0;			// number of init calls, including portal relocations
 
 	virtual void AddLineIntercepts(int bx, int by);
 	virtual void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible);
+	void AddThingIntercept(AActor *thing, bool compatible);
 	FPathTraverse() {}
 public:
 
@@ -97,6 +97,8 @@
 #include "a_morph.h"
 #include "events.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
+#include "p_simprofile.h"
 #include "a_dynlight.h"
 
 // MACROS ------------------------------------------------------------------
@@ -155,6 +157,10 @@ CVAR (Bool, addrocketexplosion, false, CVAR_ARCHIVE)
 CVAR (Int, cl_pufftype, 0, CVAR_ARCHIVE);
 CVAR (Int, cl_bloodtype, 0, CVAR_ARCHIVE);
 
+static FSimProfileZone XYMovementZone("P_XYMovement");
+static FSimProfileZone ZMovementZone("P_ZMovement");
+static FSimProfileZone SpawnZone("AActor::StaticSpawn");
+
 // CODE --------------------------------------------------------------------
 
 IMPLEMENT_CLASS(AActor, false, true)
@@ -2347,6 +2353,7 @@ bool P_SeekerMissile (AActor *actor, double thresh, double turnMax, bool precise
 
 double P_XYMovement (AActor *mo, DVector2 scroll) 
 {
+	FSimProfileScope profile(XYMovementZone, mo->GetClass());
 	static int pushtime = 0;
 	bool bForceSlide = !scroll.isZero();
 	DAngle Angle;
@@ -2902,6 +2909,7 @@ void P_MonsterFallingDamage (AActor *mo)
 
 void P_ZMovement (AActor *mo, double oldfloorz)
 {
+	FSimProfileScope profile(ZMovementZone, mo->GetClass());
 	double dist;
 	double delta;
 	double oldz = mo->Z();
@@ -4924,6 +4932,8 @@ AActor *AActor::StaticSpawn (PClassActor *type, const DVector3 &pos, replace_t a
 		I_Error ("Tried to spawn a class-less actor\n");
 	}
 
+	FSimProfileScope profile(SpawnZone, type);
+
 	if (allowreplacement)
 	{
 		type = type->GetReplacement();
@@ -5390,6 +5400,9 @@ void AActor::OnDestroy ()
 	// Transform any playing sound into positioned, non-actor sounds.
 	S_RelinkSound (this, NULL);
 
+	FSightBatch::ActorDestroyed(this);
+	FExplosionSight::ActorDestroyed(this);
+
 	Super::OnDestroy();
 }
 
@@ -986,7 +986,11 @@ void G_SerializeLevel(FSerializer &arc, bool hubload)
 	arc("zones", level.Zones);
 	arc("lineportals", level.linePortals);
 	arc("sectorportals", level.sectorPortals);
-	if (arc.isReading()) P_FinalizePortals();
+	if (arc.isReading())
+	{
+		P_FinalizePortals();
+		level.soundgraph.Clear();
+	}
 
 	// [ZZ] serialize events
 	E_SerializeEvents(arc);
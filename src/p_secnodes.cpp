@@ -27,6 +27,13 @@
 #include "g_levellocals.h"
 #include "p_maputl.h"
 #include "actor.h"
+#include "p_local.h"
+#include "stats.h"
+#include "c_cvars.h"
+
+// Keep the sector and portal nodes that a moving actor still touches instead of rebuilding its lists.
+// Only a speed switch, the resulting lists are the same. crowdbench compares both.
+CVAR(Bool, sim_secnodediff, true, 0)
 
 //=============================================================================
 // phares 3/21/98
@@ -37,6 +44,15 @@
 msecnode_t *headsecnode = nullptr;
 FMemArena secnodearena;
 
+static int NodesAdded, NodesKept, NodesDeleted;
+
+ADD_STAT(secnodes)
+{
+	FString out;
+	out.Format("added=%d  kept=%d  deleted=%d", NodesAdded, NodesKept, NodesDeleted);
+	return out;
+}
+
 //=============================================================================
 //
 // P_GetSecnode
@@ -76,6 +92,22 @@ void P_PutSecnode(msecnode_t *node)
 	headsecnode = node;
 }
 
+//=============================================================================
+//
+// Only changes to a sector's touching_thinglist are of interest to
+// P_ChangeSector.
+//
+//=============================================================================
+
+static inline void ThingListChanged(sector_t *sec, msecnode_t **list)
+{
+	if (list == &sec->touching_thinglist) sec->touching_changes++;
+}
+
+static inline void ThingListChanged(FLinePortal *, portnode_t **)
+{
+}
+
 //=============================================================================
 // phares 3/16/98
 //
@@ -104,6 +136,7 @@ nodetype *P_AddSecnode(linktype *s, AActor *thing, nodetype *nextnode, nodetype
 		if (node->m_sector == s)	// Already have a node for this sector?
 		{
 			node->m_thing = thing;	// Yes. Setting m_thing says 'keep it'.
+			NodesKept++;
 			return nextnode;
 		}
 		node = node->m_tnext;
@@ -113,6 +146,7 @@ nodetype *P_AddSecnode(linktype *s, AActor *thing, nodetype *nextnode, nodetype
 	// of the list.
 
 	node = (nodetype*)P_GetSecnode();
+	NodesAdded++;
 
 	// killough 4/4/98, 4/7/98: mark new nodes unvisited.
 	node->visited = 0;
@@ -131,6 +165,7 @@ nodetype *P_AddSecnode(linktype *s, AActor *thing, nodetype *nextnode, nodetype
 	if (sec_thinglist)
 		node->m_snext->m_sprev = node;
 	sec_thinglist = node;
+	ThingListChanged(s, &sec_thinglist);
 	return node;
 }
 
@@ -178,6 +213,7 @@ nodetype *P_DelSecnode(nodetype *node, nodetype *linktype::*listhead)
 			node->m_sector->*listhead = sn;
 		if (sn)
 			sn->m_sprev = sp;
+		ThingListChanged(node->m_sector, &(node->m_sector->*listhead));
 
 		// Return this node to the freelist
 
@@ -210,6 +246,36 @@ void P_DelSeclist(portnode_t *node, portnode_t *FLinePortal::*sechead)
 		node = P_DelSecnode(node, sechead);
 }
 
+//=============================================================================
+//
+// P_DelUnclaimedNodes
+//
+// Deletes the nodes of a thing's list whose m_thing was cleared and not
+// set again, i.e. those for sectors or portals it does not touch anymore.
+//
+//=============================================================================
+
+template<class nodetype, class linktype>
+static nodetype *P_DelUnclaimedNodes(nodetype *list, nodetype *linktype::*listhead)
+{
+	nodetype *node = list;
+	while (node)
+	{
+		if (node->m_thing == nullptr)
+		{
+			if (node == list)
+				list = node->m_tnext;
+			node = P_DelSecnode(node, listhead);
+			NodesDeleted++;
+		}
+		else
+		{
+			node = node->m_tnext;
+		}
+	}
+	return list;
+}
+
 
 //=============================================================================
 // phares 3/14/98
@@ -221,6 +287,14 @@ void P_DelSeclist(portnode_t *node, portnode_t *FLinePortal::*sechead)
 //=============================================================================
 
 msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead)
+{
+	static TArray<sector_t *> sectors;
+
+	P_CollectTouchedSectors(thing, radius, sectors);
+	return P_CreateSecNodeList(thing, sectors, sector_list, seclisthead);
+}
+
+msecnode_t *P_CreateSecNodeList(AActor *thing, const TArray<sector_t *> &sectors, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead)
 {
 	msecnode_t *node;
 
@@ -236,6 +310,32 @@ msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector
 		node = node->m_tnext;
 	}
 
+	for (auto sec : sectors)
+	{
+		sector_list = P_AddSecnode(sec, thing, sector_list, sec->*seclisthead);
+	}
+
+	// Now delete any nodes that won't be used. These are the ones where
+	// m_thing is still nullptr.
+
+	return P_DelUnclaimedNodes(sector_list, seclisthead);
+}
+
+//=============================================================================
+//
+// P_CollectTouchedSectors
+//
+// Finds the sectors an object of the given radius touches at its position,
+// in the order P_CreateSecNodeList links them. The same list serves both
+// for the sectors an actor is in and for those it gets rendered in, unless
+// its render radius is larger than its radius.
+//
+//=============================================================================
+
+void P_CollectTouchedSectors(AActor *thing, double radius, TArray<sector_t *> &sectors)
+{
+	sectors.Clear();
+
 	FBoundingBox box(thing->X(), thing->Y(), radius);
 	FBlockLinesIterator it(box);
 	line_t *ld;
@@ -252,7 +352,7 @@ msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector
 		// allowed to move to this position, then the sector_list
 		// will be attached to the Thing's AActor at touching_sectorlist.
 
-		sector_list = P_AddSecnode(ld->frontsector, thing, sector_list, ld->frontsector->*seclisthead);
+		sectors.Push(ld->frontsector);
 
 		// Don't assume all lines are 2-sided, since some Things
 		// like MT_TFOG are allowed regardless of whether their radius takes
@@ -262,31 +362,12 @@ msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector
 		// Use sidedefs instead of 2s flag to determine two-sidedness.
 
 		if (ld->backsector)
-			sector_list = P_AddSecnode(ld->backsector, thing, sector_list, ld->backsector->*seclisthead);
+			sectors.Push(ld->backsector);
 	}
 
 	// Add the sector of the (x,y) point to sector_list.
 
-	sector_list = P_AddSecnode(thing->Sector, thing, sector_list, thing->Sector->*seclisthead);
-
-	// Now delete any nodes that won't be used. These are the ones where
-	// m_thing is still nullptr.
-
-	node = sector_list;
-	while (node)
-	{
-		if (node->m_thing == nullptr)
-		{
-			if (node == sector_list)
-				sector_list = node->m_tnext;
-			node = P_DelSecnode(node, seclisthead);
-		}
-		else
-		{
-			node = node->m_tnext;
-		}
-	}
-	return sector_list;
+	sectors.Push(thing->Sector);
 }
 
 //=============================================================================
@@ -351,7 +432,18 @@ portnode_t *P_AddPortalnode(FLinePortal *s, AActor *thing, portnode_t *nextnode)
 		I_FatalError("AddSecnode of 0 for %s\n", thing->GetClass()->TypeName.GetChars());
 	}
 
+	for (node = nextnode; node; node = node->m_tnext)
+	{
+		if (node->m_sector == s)	// Already have a node for this portal?
+		{
+			node->m_thing = thing;
+			NodesKept++;
+			return nextnode;
+		}
+	}
+
 	node = reinterpret_cast<portnode_t*>(P_GetSecnode());
+	NodesAdded++;
 
 	// killough 4/4/98, 4/7/98: mark new nodes unvisited.
 	node->visited = 0;
@@ -384,8 +476,19 @@ void AActor::UpdateRenderSectorList()
 	static const double SPRITE_SPACE = 64.;
 	if (Pos() != OldRenderPos && !(flags & MF_NOSECTOR))
 	{
+		if (sim_secnodediff)
+		{
+			// Keep the nodes that are still valid. Those that are not claimed again get deleted at the end.
+			for (auto node = touching_lineportallist; node; node = node->m_tnext) node->m_thing = nullptr;
+			for (auto node = touching_sectorportallist; node; node = node->m_tnext) node->m_thing = nullptr;
+		}
+		else
+		{
+			ClearRenderLineList();
+			ClearRenderSectorList();
+		}
+
 		// Only check if the map contains line portals
-		ClearRenderLineList();
 		if (level.PortalBlockmap.containsLines && Pos().XY() != OldRenderPos.XY())
 		{
 			int bx = level.blockmap.GetBlockX(X());
@@ -407,7 +510,6 @@ void AActor::UpdateRenderSectorList()
 		}
 		sector_t *sec = Sector;
 		double lasth = -FLT_MAX;
-		ClearRenderSectorList();
 		while (!sec->PortalBlocksMovement(sector_t::ceiling))
 		{
 			double planeh = sec->GetPortalPlaneZ(sector_t::ceiling);
@@ -430,6 +532,8 @@ void AActor::UpdateRenderSectorList()
 			sec = P_PointInSector(newpos);
 			touching_sectorportallist = P_AddSecnode(sec, this, touching_sectorportallist, sec->sectorportal_thinglist);
 		}
+		touching_lineportallist = P_DelUnclaimedNodes(touching_lineportallist, &FLinePortal::lineportal_thinglist);
+		touching_sectorportallist = P_DelUnclaimedNodes(touching_sectorportallist, &sector_t::sectorportal_thinglist);
 	}
 }
 
@@ -69,6 +69,7 @@
 #include "p_local.h"
 #include "r_sky.h"
 #include "g_levellocals.h"
+#include "p_sightbatch.h"
 #include "vm.h"
 
 
@@ -1957,6 +1958,7 @@ DEFINE_ACTION_FUNCTION(_Sector, NextLowestFloorAt)
 	 PARAM_SELF_STRUCT_PROLOGUE(sector_t);
 	 PARAM_INT(pos);
 	 self->ClearPortal(pos);
+	 FSightBatch::GeometryChanged();
 	 return 0;
  }
 
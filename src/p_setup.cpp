@@ -1465,6 +1465,7 @@ void P_LoadSectors (MapData *map, FMissingTextureTracker &missingtex)
 		tagManager.AddSectorTag(i, LittleShort(ms->tag));
 		ss->thinglist = nullptr;
 		ss->touching_thinglist = nullptr;		// phares 3/14/98
+		ss->touching_changes = 0;
 		ss->sectorportal_thinglist = nullptr;
 		ss->touching_renderthings = nullptr;
 		ss->seqType = defSeqType;
@@ -3118,9 +3119,7 @@ void P_LoadBlockMap (MapData * map)
 	level.blockmap.bmapheight = level.blockmap.blockmaplump[3];
 
 	// clear out mobj chains
-	count = level.blockmap.bmapwidth*level.blockmap.bmapheight;
-	level.blockmap.blocklinks = new FBlockNode *[count];
-	memset (level.blockmap.blocklinks, 0, count*sizeof(*level.blockmap.blocklinks));
+	level.thinggrid.Init(level.blockmap.bmaporgx, level.blockmap.bmaporgy, level.blockmap.bmapwidth, level.blockmap.bmapheight);
 	level.blockmap.blockmap = level.blockmap.blockmaplump+4;
 }
 
@@ -3576,6 +3575,8 @@ void P_FreeLevelData ()
 	level.rejectmatrix.Clear();
 	level.Zones.Clear();
 	level.blockmap.Clear();
+	level.thinggrid.Clear();
+	level.soundgraph.Clear();
 
 	if (PolyBlockMap != NULL)
 	{
@@ -3619,19 +3620,9 @@ extern msecnode_t *headsecnode;
 
 void P_FreeExtraLevelData()
 {
-	// Free all blocknodes and msecnodes.
+	// Free all msecnodes.
 	// *NEVER* call this function without calling
 	// P_FreeLevelData() first, or they might not all be freed.
-	{
-		FBlockNode *node = FBlockNode::FreeBlocks;
-		while (node != NULL)
-		{
-			FBlockNode *next = node->NextBlock;
-			delete node;
-			node = next;
-		}
-		FBlockNode::FreeBlocks = NULL;
-	}
 	secnodearena.FreeAllBlocks();
 	headsecnode = nullptr;
 }
@@ -36,6 +36,8 @@
 
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
+#include "p_simprofile.h"
 
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
@@ -50,10 +52,11 @@ This uses specialized forms of the maputils routines for optimized performance
 ==============================================================================
 */
 
-// Performance meters
-static int sightcounts[6];
-static cycle_t SightCycles;
+// Performance meters. Only the main thread's are shown.
+static thread_local int sightcounts[6];
+static thread_local cycle_t SightCycles;
 static cycle_t MaxSightCycles;
+static FSimProfileZone SightZone("P_CheckSight");
 
 enum
 {
@@ -77,21 +80,12 @@ struct SightOpening
 	}
 };
 
-struct SightTask
-{
-	double Frac;
-	double topslope;
-	double bottomslope;
-	int direction;
-	int portalgroup;
-};
-
-
-static TArray<intercept_t> intercepts (128);
-static TArray<SightTask> portals(32);
-
 class SightCheck
 {
+	FQueryContext &context = FQueryContext::Current();
+	TArray<intercept_t> &intercepts = context.SightIntercepts;
+	TArray<SightTask> &portals = context.SightPortals;
+
 	DVector3 sightstart;
 	DVector2 sightend;
 	double Startfrac;
@@ -425,11 +419,10 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 {
 	divline_t dl;
 
-	if (ld->validcount == validcount)
+	if (!context.Visit(ld))
 	{
 		return true;
 	}
-	ld->validcount = validcount;
 	if (P_PointOnDivlineSide (ld->v1->fPos(), &Trace) ==
 		P_PointOnDivlineSide (ld->v2->fPos(), &Trace))
 	{
@@ -487,9 +480,8 @@ int SightCheck::P_SightBlockLinesIterator (int x, int y)
 	{
 		if (polyLink->polyobj)
 		{ // only check non-empty links
-			if (polyLink->polyobj->validcount != validcount)
+			if (context.Visit(polyLink->polyobj))
 			{
-				polyLink->polyobj->validcount = validcount;
 				for (i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
 				{
 					if (!P_SightCheckLine(polyLink->polyobj->Linedefs[i]))
@@ -619,7 +611,7 @@ bool SightCheck::P_SightPathTraverse ()
 	int mapx, mapy, mapxstep, mapystep;
 	int count;
 
-	validcount++;
+	context.NewPass();
 	intercepts.Clear ();
 	x1 = sightstart.X + Startfrac * Trace.dx;
 	y1 = sightstart.Y + Startfrac * Trace.dy;
@@ -817,6 +809,54 @@ sightcounts[2]++;
 	return traverseres;
 }
 
+/*
+=====================
+=
+= P_CheckSightTrace
+=
+= The part of P_CheckSight that follows the line of sight through the map.
+= It only reads the level, so it can run on any thread that has its own
+= query context.
+=
+=====================
+*/
+
+bool P_CheckSightTrace (AActor *t1, AActor *t2, int flags)
+{
+	FQueryContext &context = FQueryContext::Current();
+	TArray<SightTask> &portals = context.SightPortals;
+	context.NewPass();
+	portals.Clear();
+
+	sector_t *sec;
+	double lookheight = t1->Z() + t1->Height*0.75;
+	t1->GetPortalTransition(lookheight, &sec);
+
+	double bottomslope = t2->Z() - lookheight;
+	double topslope = bottomslope + t2->Height;
+	SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
+
+
+	SightCheck s;
+	s.init(t1, t2, sec, &task, flags);
+	if (s.P_SightPathTraverse ())
+	{
+		return true;
+	}
+
+	double dist = t1->Distance2D(t2);
+	for (unsigned i = 0; i < portals.Size(); i++)
+	{
+		portals[i].Frac += 1 / dist;
+		s.init(t1, t2, NULL, &portals[i], flags);
+		if (s.P_SightPathTraverse())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 /*
 =====================
 =
@@ -832,6 +872,7 @@ sightcounts[2]++;
 
 bool P_CheckSight (AActor *t1, AActor *t2, int flags)
 {
+	FSimProfileScope profile(SightZone, t1 != NULL ? t1->GetClass() : NULL);
 	SightCycles.Clock();
 
 	bool res;
@@ -895,36 +936,9 @@ sightcounts[0]++;
 
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
-
-	validcount++;
-	portals.Clear();
+	if (!FSightBatch::Lookup(t1, t2, flags, res))
 	{
-		sector_t *sec;
-		double lookheight = t1->Z() + t1->Height*0.75;
-		t1->GetPortalTransition(lookheight, &sec);
-
-		double bottomslope = t2->Z() - lookheight;
-		double topslope = bottomslope + t2->Height;
-		SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
-
-
-		SightCheck s;
-		s.init(t1, t2, sec, &task, flags);
-		res = s.P_SightPathTraverse ();
-		if (!res)
-		{
-			double dist = t1->Distance2D(t2);
-			for (unsigned i = 0; i < portals.Size(); i++)
-			{
-				portals[i].Frac += 1 / dist;
-				s.init(t1, t2, NULL, &portals[i], flags);
-				if (s.P_SightPathTraverse())
-				{
-					res = true;
-					break;
-				}
-			}
-		}
+		res = P_CheckSightTrace(t1, t2, flags);
 	}
 
 done:
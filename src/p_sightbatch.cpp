@@ -0,0 +1,297 @@
+/*
+** p_sightbatch.cpp
+**
+** Batched sight checks for idle monsters
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include "p_sightbatch.h"
+#include "p_local.h"
+#include "p_workers.h"
+#include "d_player.h"
+#include "actor.h"
+#include "actorinlines.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "g_levellocals.h"
+#include "vm.h"
+
+CVAR(Bool, sim_batchlook, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// The flags P_IsVisible uses
+static const int LookFlags = SF_SEEPASTSHOOTABLELINES;
+
+int FSightBatch::Generation;
+
+static int BatchLookers, BatchedChecks, BatchHits;
+
+ADD_STAT(sightbatch)
+{
+	FString out;
+	out.Format("lookers=%d  traced=%d  used=%d", BatchLookers, BatchedChecks, BatchHits);
+	return out;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FSightBatch *FSightBatch::Instance()
+{
+	static FSightBatch batch;
+	return &batch;
+}
+
+void FSightBatch::Clear()
+{
+	Lookers.Clear();
+	Targets.Clear();
+	Entries.Clear();
+	LookerIndex.Clear();
+	Done = false;
+}
+
+//==========================================================================
+//
+// An idle monster whose state runs out this tic will most likely enter
+// another state that calls A_Look. Guessing wrong only costs time.
+//
+//==========================================================================
+
+void FSightBatch::BeginTic()
+{
+	Clear();
+	BatchLookers = BatchedChecks = BatchHits = 0;
+	// Not depending on the number of threads keeps all machines in a netgame
+	// on the same path, even though the results are the same either way.
+	if (!sim_batchlook)
+		return;
+
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		if (playeringame[i] && players[i].mo != nullptr)
+			Targets.Push(players[i].mo);
+	}
+	if (Targets.Size() == 0)
+		return;
+
+	TThinkerIterator<AActor> it;
+	AActor *ac;
+	while ((ac = it.Next()))
+	{
+		if (ac->tics == 1 && ac->health > 0 && ac->target == nullptr &&
+			(ac->flags3 & MF3_ISMONSTER) && !(ac->flags & MF_FRIENDLY) && !(ac->flags2 & MF2_DORMANT))
+		{
+			LookerIndex[ac] = Lookers.Push(ac);
+		}
+	}
+	BatchLookers = Lookers.Size();
+}
+
+void FSightBatch::Forget(AActor *actor)
+{
+	unsigned *index = LookerIndex.CheckKey(actor);
+	if (index != nullptr)
+	{
+		Lookers[*index] = nullptr;
+		LookerIndex.Remove(actor);
+	}
+	unsigned target = Targets.Find(actor);
+	if (target < Targets.Size())
+		Targets[target] = nullptr;
+}
+
+//==========================================================================
+//
+// Traces all pairs. The actors may have moved since BeginTic, so this
+// waits until the first lookup to get positions that are as current as
+// possible.
+//
+//==========================================================================
+
+void FSightBatch::Run()
+{
+	Done = true;
+	DoneGeneration = Generation;
+
+	Entries.Resize(Lookers.Size() * Targets.Size());
+	for (unsigned i = 0; i < Lookers.Size(); i++)
+	{
+		for (unsigned j = 0; j < Targets.Size(); j++)
+		{
+			FEntry &entry = Entries[i * Targets.Size() + j];
+			AActor *looker = Lookers[i];
+			AActor *target = Targets[j];
+			if (looker == nullptr || target == nullptr)
+			{
+				entry.Looker = nullptr;
+				continue;
+			}
+			entry.Looker = looker;
+			entry.Target = target;
+			entry.LookerPos = looker->Pos();
+			entry.TargetPos = target->Pos();
+			entry.LookerHeight = looker->Height;
+			entry.TargetHeight = target->Height;
+			entry.LookerSector = looker->Sector;
+			entry.TargetSector = target->Sector;
+		}
+	}
+	BatchedChecks = Entries.Size();
+
+	FPlayWorkers::Instance()->Run(Entries.Size(), 16, [&](int start, int end)
+	{
+		for (int i = start; i < end; i++)
+		{
+			FEntry &entry = Entries[i];
+			if (entry.Looker != nullptr)
+				entry.Visible = P_CheckSightTrace(entry.Looker, entry.Target, LookFlags);
+		}
+	});
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FSightBatch::LookupPair(AActor *t1, AActor *t2, int flags, bool &result)
+{
+	if (flags != LookFlags)
+		return false;
+
+	unsigned *index = LookerIndex.CheckKey(t1);
+	if (index == nullptr)
+		return false;
+
+	unsigned target = Targets.Find(t2);
+	if (target == Targets.Size())
+		return false;
+
+	if (!Done)
+		Run();
+	if (Generation != DoneGeneration)
+		return false;
+
+	const FEntry &entry = Entries[*index * Targets.Size() + target];
+	if (entry.LookerPos != t1->Pos() || entry.TargetPos != t2->Pos() ||
+		entry.LookerHeight != t1->Height || entry.TargetHeight != t2->Height ||
+		entry.LookerSector != t1->Sector || entry.TargetSector != t2->Sector)
+	{
+		return false;
+	}
+	BatchHits++;
+	result = entry.Visible;
+	return true;
+}
+
+//==========================================================================
+//
+// For scripts that write line, sector or 3D floor fields that block sight
+//
+//==========================================================================
+
+DEFINE_ACTION_FUNCTION(FLevelLocals, SightBlockingChanged)
+{
+	FSightBatch::GeometryChanged();
+	return 0;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FExplosionSight::Attacks;
+int FExplosionSight::Candidates;
+int FExplosionSight::Checks;
+int FExplosionSight::Reused;
+
+ADD_STAT(explosions)
+{
+	FString out;
+	out.Format("radius attacks=%d  candidates=%d  sight checks=%d  reused=%d",
+		FExplosionSight::Attacks, FExplosionSight::Candidates, FExplosionSight::Checks, FExplosionSight::Reused);
+	return out;
+}
+
+FExplosionSight *FExplosionSight::Instance()
+{
+	static FExplosionSight sight;
+	return &sight;
+}
+
+void FExplosionSight::Clear()
+{
+	if (Entries.Size() > 0)
+	{
+		First.Clear();
+		Entries.Clear();
+	}
+	Attacks = Candidates = Checks = Reused = 0;
+}
+
+bool FExplosionSight::Check(AActor *thing, AActor *bombspot)
+{
+	if (EntriesGeneration != FSightBatch::GetGeneration())
+	{
+		if (Entries.Size() > 0)
+		{
+			First.Clear();
+			Entries.Clear();
+		}
+		EntriesGeneration = FSightBatch::GetGeneration();
+	}
+
+	unsigned *first = First.CheckKey(thing);
+	unsigned next = first != nullptr ? *first : ~0u;
+	for (unsigned i = next; i != ~0u; i = Entries[i].Next)
+	{
+		const FEntry &entry = Entries[i];
+		if (entry.ThingPos == thing->Pos() && entry.SpotPos == bombspot->Pos() &&
+			entry.ThingHeight == thing->Height && entry.SpotHeight == bombspot->Height &&
+			entry.ThingSector == thing->Sector && entry.SpotSector == bombspot->Sector)
+		{
+			Reused++;
+			return entry.Visible;
+		}
+	}
+
+	Checks++;
+	bool visible = P_CheckSight(thing, bombspot, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY);
+	First[thing] = Entries.Push({ thing->Pos(), bombspot->Pos(), thing->Height, bombspot->Height, thing->Sector, bombspot->Sector, visible, next });
+	return visible;
+}
@@ -0,0 +1,171 @@
+/*
+** p_sightbatch.h
+**
+** Batched sight checks for idle monsters
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __P_SIGHTBATCH_H
+#define __P_SIGHTBATCH_H
+
+#include "vectors.h"
+#include "tarray.h"
+
+class AActor;
+struct sector_t;
+
+//==========================================================================
+//
+// Idle monsters that are about to run their look function this tic
+// are collected before the thinkers run. When the first of them checks
+// its sight to a player, the line of sight from all of them to all
+// players is traced at once on the play workers.
+//
+// A stored result is only used if both actors are still where they were
+// and nothing that blocks sight has changed since it was traced, so the
+// game plays exactly as if every check had been done on the spot. Moving
+// sectors and polyobjects, and the line specials and ACS functions that
+// change line flags, specials or portals, report such changes. ZScript
+// that writes those fields directly must call
+// LevelLocals.SightBlockingChanged.
+//
+//==========================================================================
+
+class FSightBatch
+{
+public:
+	static FSightBatch *Instance();
+
+	// Collects the monsters that may look this tic
+	void BeginTic();
+	void Clear();
+
+	// Returns false if there is no usable result for this pair
+	static bool Lookup(AActor *t1, AActor *t2, int flags, bool &result)
+	{
+		if (Instance()->Lookers.Size() == 0)
+			return false;
+		return Instance()->LookupPair(t1, t2, flags, result);
+	}
+
+	// Must be called whenever level geometry that can block sight changes
+	static void GeometryChanged() { Generation++; }
+	static int GetGeneration() { return Generation; }
+
+	// Actors can be freed before the batch runs
+	static void ActorDestroyed(AActor *actor)
+	{
+		if (Instance()->Lookers.Size() > 0)
+			Instance()->Forget(actor);
+	}
+
+private:
+	struct FEntry
+	{
+		AActor *Looker;
+		AActor *Target;
+		DVector3 LookerPos;
+		DVector3 TargetPos;
+		double LookerHeight;
+		double TargetHeight;
+		sector_t *LookerSector;
+		sector_t *TargetSector;
+		bool Visible;
+	};
+
+	bool LookupPair(AActor *t1, AActor *t2, int flags, bool &result);
+	void Forget(AActor *actor);
+	void Run();
+
+	TArray<AActor *> Lookers;
+	TArray<AActor *> Targets;
+	TArray<FEntry> Entries;
+	TMap<AActor *, unsigned> LookerIndex;
+	bool Done = false;
+	int DoneGeneration = 0;
+
+	static int Generation;
+};
+
+//==========================================================================
+//
+// Radius attacks check the line of sight from every victim to the bomb
+// spot. Several explosions at the same spot in one tic, like an A_Explode
+// paired with an A_RadiusThrust or a missile that explodes more than once,
+// get the stored result instead of tracing the same line again.
+//
+// The stored result is keyed on the positions, heights and sectors of
+// both actors, and it is dropped together with the sight batch's results.
+//
+//==========================================================================
+
+class FExplosionSight
+{
+public:
+	static FExplosionSight *Instance();
+
+	bool Check(AActor *thing, AActor *bombspot);
+
+	// Called at the start of each tic
+	void Clear();
+
+	static void ActorDestroyed(AActor *actor)
+	{
+		if (Instance()->Entries.Size() > 0)
+			Instance()->First.Remove(actor);
+	}
+
+	// Per tic counters for the stat display
+	static int Attacks;
+	static int Candidates;
+	static int Checks;
+	static int Reused;
+
+private:
+	struct FEntry
+	{
+		DVector3 ThingPos;
+		DVector3 SpotPos;
+		double ThingHeight;
+		double SpotHeight;
+		sector_t *ThingSector;
+		sector_t *SpotSector;
+		bool Visible;
+		unsigned Next;
+	};
+
+	TMap<AActor *, unsigned> First;
+	TArray<FEntry> Entries;
+	int EntriesGeneration = 0;
+};
+
+#endif
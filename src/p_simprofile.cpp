@@ -0,0 +1,410 @@
+/*
+** p_simprofile.cpp
+**
+** Timing zones for the playsim
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <algorithm>
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/writer.h"
+#include "p_simprofile.h"
+#include "i_time.h"
+#include "files.h"
+#include "dobject.h"
+#include "doomdef.h"
+#include "doomstat.h"
+#include "c_dispatch.h"
+#include "v_text.h"
+#include "templates.h"
+#include "stats.h"
+
+// Events beyond this are only counted, so a runaway tic can't eat all memory
+static const unsigned MaxEventsPerTic = 1 << 17;
+static const int DefaultTics = TICRATE * 2;
+static const int MaxTics = TICRATE * 60;
+
+#ifndef NO_SIM_PROFILE
+bool FSimProfiler::Active;
+#endif
+TArray<FSimProfiler::FTic> FSimProfiler::Ring;
+unsigned FSimProfiler::Current;
+uint64_t FSimProfiler::Origin;
+thread_local bool FSimProfileScope::IsMainThread;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FSimProfileZone::FSimProfileZone(const char *name)
+	: Name(name)
+{
+	Index = List().Push(this);
+}
+
+TArray<FSimProfileZone *> &FSimProfileZone::List()
+{
+	static TArray<FSimProfileZone *> zones;
+	return zones;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+uint64_t FSimProfiler::Now()
+{
+	return I_nsTime() - Origin;
+}
+
+void FSimProfiler::Start(int tics)
+{
+#ifdef NO_SIM_PROFILE
+	Printf("Playsim profiling is not available in this build.\n");
+#else
+	if (tics <= 0) tics = DefaultTics;
+	tics = MIN(tics, MaxTics);
+
+	Ring.Resize(tics);
+	for (auto &tic : Ring)
+	{
+		tic.Tic = -1;
+		tic.Dropped = 0;
+		tic.Events.Clear();
+	}
+	Current = 0;
+	Origin = I_nsTime();
+
+	// The console runs on the main thread
+	FSimProfileScope::IsMainThread = true;
+	Active = true;
+#endif
+}
+
+void FSimProfiler::Stop()
+{
+#ifndef NO_SIM_PROFILE
+	if (Active)
+	{
+		EndTic(Ring[Current]);
+		Active = false;
+	}
+#endif
+}
+
+//==========================================================================
+//
+// Closes the running tic and reuses the oldest slot of the ring for the
+// next one. The event arrays keep their memory.
+//
+//==========================================================================
+
+void FSimProfiler::NextTic()
+{
+	EndTic(Ring[Current]);
+	Current = (Current + 1) % Ring.Size();
+
+	FTic &tic = Ring[Current];
+	tic.Tic = gametic;
+	tic.Start = Now();
+	tic.Duration = 0;
+	tic.Dropped = 0;
+	tic.Events.Clear();
+}
+
+void FSimProfiler::EndTic(FTic &tic)
+{
+	if (tic.Tic >= 0 && tic.Duration == 0)
+	{
+		tic.Duration = MAX<uint64_t>(Now() - tic.Start, 1);	// nonzero marks the tic as closed
+	}
+}
+
+void FSimProfiler::Record(int zone, PClass *cls, const char *detail, uint64_t start, uint64_t end)
+{
+	FTic &tic = Ring[Current];
+	if (tic.Tic < 0 || tic.Duration != 0)
+	{
+		// Outside of a tic, like the script calls of the status bar or of
+		// player prediction while rendering, or before the first full tic.
+		return;
+	}
+	if (tic.Events.Size() >= MaxEventsPerTic)
+	{
+		tic.Dropped++;
+		return;
+	}
+	tic.Events.Push({ zone, cls, detail, start, end - start });
+}
+
+//==========================================================================
+//
+// Sums up the recorded tics by zone and by actor class
+//
+//==========================================================================
+
+struct FSimProfileSum
+{
+	int Zone;
+	PClass *Class;
+	unsigned Calls;
+	uint64_t Time;
+};
+
+static void PrintSums(TArray<FSimProfileSum> &sums, int limit, bool byclass)
+{
+	std::sort(sums.begin(), sums.end(), [](const FSimProfileSum &left, const FSimProfileSum &right)
+	{
+		return left.Time > right.Time;
+	});
+
+	Printf(TEXTCOLOR_YELLOW "Total, ms   Averg, ms   Calls   %s\n", byclass ? "Zone / Class" : "Zone");
+	Printf(TEXTCOLOR_YELLOW "----------  ----------  ------  --------------------\n");
+
+	const unsigned count = MIN(limit > 0 ? (unsigned)limit : UINT_MAX, sums.Size());
+	for (unsigned i = 0; i < count; i++)
+	{
+		const FSimProfileSum &sum = sums[i];
+		const char *zone = FSimProfileZone::List()[sum.Zone]->Name;
+		Printf("%10.6f  %10.6f  %6u  %s%s%s\n", sum.Time / 1e6, sum.Time / 1e6 / sum.Calls, sum.Calls,
+			zone, byclass ? " / " : "", byclass ? sum.Class->TypeName.GetChars() : "");
+	}
+}
+
+void FSimProfiler::Report(int limit)
+{
+	auto &zones = FSimProfileZone::List();
+	TArray<FSimProfileSum> byzone;
+	TArray<FSimProfileSum> byclass;
+	TMap<PClass *, TArray<unsigned>> classindex;
+	unsigned tics = 0, dropped = 0;
+	uint64_t total = 0;
+
+	byzone.Resize(zones.Size());
+	for (unsigned i = 0; i < zones.Size(); i++)
+	{
+		byzone[i] = { (int)i, nullptr, 0, 0 };
+	}
+
+	for (auto &tic : Ring)
+	{
+		if (tic.Tic < 0 || tic.Duration == 0) continue;
+		tics++;
+		dropped += tic.Dropped;
+		total += tic.Duration;
+
+		for (auto &ev : tic.Events)
+		{
+			byzone[ev.Zone].Calls++;
+			byzone[ev.Zone].Time += ev.Duration;
+
+			if (ev.Class == nullptr) continue;
+
+			// One row per zone and class, so nested zones are never added together
+			TArray<unsigned> &rows = classindex[ev.Class];
+			if (rows.Size() == 0)
+			{
+				rows.Resize(zones.Size());
+				for (auto &row : rows) row = UINT_MAX;
+			}
+			if (rows[ev.Zone] == UINT_MAX)
+			{
+				rows[ev.Zone] = byclass.Push({ ev.Zone, ev.Class, 0, 0 });
+			}
+			byclass[rows[ev.Zone]].Calls++;
+			byclass[rows[ev.Zone]].Time += ev.Duration;
+		}
+	}
+
+	if (tics == 0)
+	{
+		Printf("No tics recorded.\n");
+		return;
+	}
+
+	Printf(TEXTCOLOR_YELLOW "%u tics, %.3f ms per tic", tics, total / 1e6 / tics);
+	if (dropped > 0) Printf(TEXTCOLOR_RED ", %u events dropped", dropped);
+	Printf("\n\n");
+
+	// Zones that never ran only clutter the table
+	unsigned used = 0;
+	for (auto &sum : byzone)
+	{
+		if (sum.Calls > 0) byzone[used++] = sum;
+	}
+	byzone.Resize(used);
+
+	PrintSums(byzone, limit, false);
+	if (byclass.Size() > 0)
+	{
+		Printf("\n");
+		PrintSums(byclass, limit, true);
+	}
+}
+
+//==========================================================================
+//
+// Saves the ring in Chrome's trace event format, oldest tic first, for
+// chrome://tracing or compatible viewers
+//
+//==========================================================================
+
+bool FSimProfiler::WriteTrace(const char *filename)
+{
+	auto &zones = FSimProfileZone::List();
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	unsigned count = 0;
+
+	auto writeEvent = [&](const char *name, const char *category, uint64_t start, uint64_t duration)
+	{
+		writer.Key("name"); writer.String(name);
+		writer.Key("cat"); writer.String(category);
+		writer.Key("ph"); writer.String("X");
+		writer.Key("ts"); writer.Double(start / 1e3);
+		writer.Key("dur"); writer.Double(duration / 1e3);
+		writer.Key("pid"); writer.Int(0);
+		writer.Key("tid"); writer.Int(0);
+	};
+
+	writer.StartObject();
+	writer.Key("displayTimeUnit"); writer.String("ms");
+	writer.Key("traceEvents");
+	writer.StartArray();
+
+	for (unsigned i = 1; i <= Ring.Size(); i++)
+	{
+		FTic &tic = Ring[(Current + i) % Ring.Size()];
+		if (tic.Tic < 0 || tic.Duration == 0) continue;
+
+		FString ticname;
+		ticname.Format("Tic %d", tic.Tic);
+		writer.StartObject();
+		writeEvent(ticname.GetChars(), "tic", tic.Start, tic.Duration);
+		if (tic.Dropped > 0)
+		{
+			writer.Key("args");
+			writer.StartObject();
+			writer.Key("dropped"); writer.Uint(tic.Dropped);
+			writer.EndObject();
+		}
+		writer.EndObject();
+
+		for (auto &ev : tic.Events)
+		{
+			writer.StartObject();
+			writeEvent(zones[ev.Zone]->Name, "playsim", ev.Start, ev.Duration);
+			if (ev.Class != nullptr || ev.Detail != nullptr)
+			{
+				writer.Key("args");
+				writer.StartObject();
+				if (ev.Class != nullptr) { writer.Key("class"); writer.String(ev.Class->TypeName.GetChars()); }
+				if (ev.Detail != nullptr) { writer.Key("function"); writer.String(ev.Detail); }
+				writer.EndObject();
+			}
+			writer.EndObject();
+			count++;
+		}
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	FileWriter *file = FileWriter::Open(filename);
+	if (file == nullptr)
+	{
+		Printf(TEXTCOLOR_RED "Could not open %s\n", filename);
+		return false;
+	}
+	bool ok = file->Write(buffer.GetString(), buffer.GetSize()) == buffer.GetSize();
+	delete file;
+
+	if (ok) Printf("Wrote %u events to %s\n", count, filename);
+	else Printf(TEXTCOLOR_RED "Could not write %s\n", filename);
+	return ok;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(simprofile)
+{
+	FString out;
+	if (!FSimProfiler::Active)
+	{
+		out = "off";
+	}
+	else
+	{
+		out.Format("on, %u zones", FSimProfileZone::List().Size());
+	}
+	return out;
+}
+
+CCMD(simprofile)
+{
+	const char *cmd = argv.argc() > 1 ? argv[1] : "";
+
+	if (!stricmp(cmd, "start"))
+	{
+		FSimProfiler::Start(argv.argc() > 2 ? (int)strtoll(argv[2], nullptr, 0) : 0);
+	}
+	else if (!stricmp(cmd, "stop"))
+	{
+		FSimProfiler::Stop();
+	}
+	else if (!stricmp(cmd, "report"))
+	{
+		FSimProfiler::Stop();
+		FSimProfiler::Report(argv.argc() > 2 ? (int)strtoll(argv[2], nullptr, 0) : 0);
+	}
+	else if (!stricmp(cmd, "dump") && argv.argc() > 2)
+	{
+		FSimProfiler::Stop();
+		FSimProfiler::WriteTrace(argv[2]);
+	}
+	else
+	{
+		Printf("Usage: simprofile start [tics]\n"
+			"       simprofile stop\n"
+			"       simprofile report [limit]\n"
+			"       simprofile dump <filename>\n"
+			"Records the last tics (default %d) and prints them by zone and actor class, or saves a Chrome trace.\n", DefaultTics);
+	}
+}
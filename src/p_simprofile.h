@@ -0,0 +1,172 @@
+/*
+** p_simprofile.h
+**
+** Timing zones for the playsim
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __P_SIMPROFILE_H
+#define __P_SIMPROFILE_H
+
+#include <stdint.h>
+#include "tarray.h"
+
+class PClass;
+
+//==========================================================================
+//
+// A named piece of playsim code that can be timed. Zones are defined as
+// file level statics next to the code they cover.
+//
+//==========================================================================
+
+class FSimProfileZone
+{
+public:
+	FSimProfileZone(const char *name);
+
+	const char *Name;
+	int Index;
+
+	static TArray<FSimProfileZone *> &List();
+};
+
+//==========================================================================
+//
+// Records how long zones take while profiling is on. The events of the
+// last few tics are kept in a ring buffer, so they can be summed up by
+// zone and by actor class, or saved in Chrome's trace event format.
+//
+// With profiling off a scope costs a single test. Building with
+// NO_SIM_PROFILE removes even that.
+//
+//==========================================================================
+
+class FSimProfiler
+{
+public:
+	struct FEvent
+	{
+		int Zone;
+		PClass *Class;		// the class of the thinker or actor the time was spent on
+		const char *Detail;	// function name for VM calls
+		uint64_t Start;		// ns since profiling was started
+		uint64_t Duration;
+	};
+
+	struct FTic
+	{
+		int Tic = -1;
+		uint64_t Start = 0;
+		uint64_t Duration = 0;
+		unsigned Dropped = 0;
+		TArray<FEvent> Events;
+	};
+
+#ifdef NO_SIM_PROFILE
+	static constexpr bool Active = false;
+#else
+	static bool Active;
+#endif
+
+	static void Start(int tics);
+	static void Stop();
+
+	// Called by P_Ticker around the tic, so the time between tics is left out
+	static void BeginTic()
+	{
+		if (Active) NextTic();
+	}
+
+	static void FinishTic()
+	{
+		if (Active) EndTic(Ring[Current]);
+	}
+
+	static void Record(int zone, PClass *cls, const char *detail, uint64_t start, uint64_t end);
+	static uint64_t Now();
+
+	static void Report(int limit);
+	static bool WriteTrace(const char *filename);
+
+private:
+	static void NextTic();
+	static void EndTic(FTic &tic);
+
+	static TArray<FTic> Ring;
+	static unsigned Current;
+	static uint64_t Origin;
+};
+
+//==========================================================================
+//
+// Times the enclosing block
+//
+//==========================================================================
+
+class FSimProfileScope
+{
+public:
+	FSimProfileScope(const FSimProfileZone &zone, PClass *cls = nullptr, const char *detail = nullptr)
+	{
+		if (FSimProfiler::Active && IsMainThread)
+		{
+			Zone = zone.Index;
+			Class = cls;
+			Detail = detail;
+			Start = FSimProfiler::Now();
+		}
+		else
+		{
+			Zone = -1;
+		}
+	}
+
+	~FSimProfileScope()
+	{
+		if (Zone >= 0)
+		{
+			FSimProfiler::Record(Zone, Class, Detail, Start, FSimProfiler::Now());
+		}
+	}
+
+	// Only the main thread records. Play workers run on their own.
+	static thread_local bool IsMainThread;
+
+private:
+	int Zone;
+	PClass *Class;
+	const char *Detail;
+	uint64_t Start;
+};
+
+#endif
@@ -0,0 +1,400 @@
+/*
+** p_soundgraph.cpp
+**
+** Sector graph for monster alerting noise
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <string.h>
+#include "p_soundgraph.h"
+#include "p_local.h"
+#include "p_maputl.h"
+#include "g_levellocals.h"
+#include "stats.h"
+
+// Upper limit for the number of sectors kept for all cached floods
+static const unsigned MaxCachedSectors = 1 << 20;
+
+int FSoundGraph::Floods;
+int FSoundGraph::CachedFloods;
+
+ADD_STAT(soundgraph)
+{
+	FString out;
+	out.Format("floods=%d  cached=%d", FSoundGraph::Floods, FSoundGraph::CachedFloods);
+	return out;
+}
+
+//==========================================================================
+//
+// A closed door or lift between two sectors stops the noise.
+//
+//==========================================================================
+
+static bool OpeningClosed(line_t *check, sector_t *sec, sector_t *other)
+{
+	return (sec->floorplane.ZatPoint(check->v1->fPos()) >=
+		other->ceilingplane.ZatPoint(check->v1->fPos()) &&
+		sec->floorplane.ZatPoint(check->v2->fPos()) >=
+		other->ceilingplane.ZatPoint(check->v2->fPos()))
+		|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
+			sec->ceilingplane.ZatPoint(check->v1->fPos()) &&
+			other->floorplane.ZatPoint(check->v2->fPos()) >=
+			sec->ceilingplane.ZatPoint(check->v2->fPos()))
+		|| (other->floorplane.ZatPoint(check->v1->fPos()) >=
+			other->ceilingplane.ZatPoint(check->v1->fPos()) &&
+			other->floorplane.ZatPoint(check->v2->fPos()) >=
+			other->ceilingplane.ZatPoint(check->v2->fPos()));
+}
+
+static bool IsSectorBoundary(line_t *line)
+{
+	return line->sidedef[1] != nullptr && line->sidedef[0]->sector != line->sidedef[1]->sector;
+}
+
+uint8_t FSoundGraph::GetClosed(line_t *line)
+{
+	sector_t *front = line->sidedef[0]->sector;
+	sector_t *back = line->sidedef[1]->sector;
+	return (OpeningClosed(line, front, back) ? CLOSED_TOBACK : 0) | (OpeningClosed(line, back, front) ? CLOSED_TOFRONT : 0);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FSoundGraph::Clear()
+{
+	Nodes.Reset();
+	Edges.Reset();
+	Closed.Reset();
+	Visited.Reset();
+	ResultIndex.Reset();
+	Result.Reset();
+	Queue.Reset();
+	VisitCount = 0;
+	NumLinePortals = 0;
+	Cache.Clear();
+	CachedSectors.Reset();
+}
+
+void FSoundGraph::Build()
+{
+	Clear();
+
+	unsigned numsectors = level.sectors.Size();
+	Nodes.Resize(numsectors);
+	for (unsigned i = 0; i < numsectors; i++)
+	{
+		sector_t *sec = &level.sectors[i];
+		FNode &node = Nodes[i];
+
+		node.FirstEdge = Edges.Size();
+		for (auto line : sec->Lines)
+		{
+			if (IsSectorBoundary(line))
+			{
+				sector_t *other = line->sidedef[0]->sector == sec ? line->sidedef[1]->sector : line->sidedef[0]->sector;
+				Edges.Push({ line, other });
+			}
+		}
+		node.NumEdges = Edges.Size() - node.FirstEdge;
+	}
+
+	Closed.Resize(level.lines.Size());
+	for (auto &line : level.lines)
+	{
+		Closed[line.Index()] = IsSectorBoundary(&line) ? GetClosed(&line) : 0;
+	}
+
+	// Each sector is queued at most twice, once for each number of sound
+	// blocking lines, so the flood never needs to allocate.
+	Visited.Resize(numsectors);
+	memset(&Visited[0], 0, numsectors * sizeof(Visited[0]));
+	ResultIndex.Resize(numsectors);
+	Result.Grow(numsectors);
+	Queue.Grow(numsectors * 2);
+
+	MarkLinePortals();
+}
+
+//==========================================================================
+//
+// Line portals can be created after the graph was built, but never
+// removed, so the count tells when the nodes must be marked again.
+//
+//==========================================================================
+
+void FSoundGraph::MarkLinePortals()
+{
+	for (auto &node : Nodes)
+	{
+		node.HasLinePortals = false;
+	}
+	for (auto &port : level.linePortals)
+	{
+		line_t *line = port.mOrigin;
+		for (int i = 0; i < 2 && line != nullptr; i++)
+		{
+			if (line->sidedef[i] != nullptr)
+			{
+				Nodes[line->sidedef[i]->sector->Index()].HasLinePortals = true;
+			}
+		}
+	}
+	NumLinePortals = level.linePortals.Size();
+}
+
+//==========================================================================
+//
+// Only changes between open and closed matter to the flood.
+//
+//==========================================================================
+
+void FSoundGraph::SectorMoved(sector_t *sector)
+{
+	if (Nodes.Size() == 0)
+		return;
+
+	bool changed = false;
+	for (auto line : sector->Lines)
+	{
+		if (IsSectorBoundary(line))
+		{
+			uint8_t closed = GetClosed(line);
+			if (closed != Closed[line->Index()])
+			{
+				Closed[line->Index()] = closed;
+				changed = true;
+			}
+		}
+	}
+	if (changed)
+	{
+		Invalidate();
+	}
+}
+
+void FSoundGraph::Invalidate()
+{
+	Cache.Clear();
+	CachedSectors.Clear();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FSoundGraph::Mark(sector_t *sec, int soundblocks)
+{
+	int index = sec->Index();
+	if (Visited[index] == VisitCount)
+	{
+		FSoundFloodSector &reached = Result[ResultIndex[index]];
+		if (reached.SoundBlocks <= soundblocks)
+			return false;		// already flooded
+		reached.SoundBlocks = soundblocks;
+	}
+	else
+	{
+		Visited[index] = VisitCount;
+		ResultIndex[index] = Result.Push({ sec, soundblocks });
+	}
+	Queue.Push({ sec, soundblocks });
+	return true;
+}
+
+//==========================================================================
+//
+// Traverses adjacent sectors,
+// sound blocking lines cut off traversal.
+//
+//==========================================================================
+
+void FSoundGraph::MarkThroughEdges(const FNode &node, sector_t *sec, int soundblocks)
+{
+	for (unsigned i = 0; i < node.NumEdges; i++)
+	{
+		const FEdge &edge = Edges[node.FirstEdge + i];
+		line_t *check = edge.Line;
+
+		if (!(check->flags & ML_TWOSIDED) || OpeningClosed(check, sec, edge.Other))
+		{
+			continue;
+		}
+
+		if (check->flags & ML_SOUNDBLOCK)
+		{
+			if (!soundblocks)
+				Mark(edge.Other, 1);
+		}
+		else
+		{
+			Mark(edge.Other, soundblocks);
+		}
+	}
+}
+
+void FSoundGraph::MarkThroughLines(sector_t *sec, int soundblocks)
+{
+	bool checkabove = !sec->PortalBlocksSound(sector_t::ceiling);
+	bool checkbelow = !sec->PortalBlocksSound(sector_t::floor);
+
+	for (auto check : sec->Lines)
+	{
+		// check sector portals
+		// I wish there was a better method to do this than randomly looking through the portal at a few places...
+		if (checkabove)
+		{
+			sector_t *upper = P_PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling));
+			Mark(upper, soundblocks);
+		}
+		if (checkbelow)
+		{
+			sector_t *lower = P_PointInSector(check->v1->fPos() + check->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor));
+			Mark(lower, soundblocks);
+		}
+
+		// ... and line portals;
+		FLinePortal *port = check->getPortal();
+		if (port && (port->mFlags & PORTF_SOUNDTRAVERSE))
+		{
+			if (port->mDestination)
+			{
+				Mark(port->mDestination->frontsector, soundblocks);
+			}
+		}
+
+		if (check->sidedef[1] == NULL ||
+			!(check->flags & ML_TWOSIDED))
+		{
+			continue;
+		}
+
+		// Early out for intra-sector lines
+		if (check->sidedef[0]->sector == check->sidedef[1]->sector) continue;
+
+		sector_t *other;
+		if (check->sidedef[0]->sector == sec)
+			other = check->sidedef[1]->sector;
+		else
+			other = check->sidedef[0]->sector;
+
+		// check for closed door
+		if (OpeningClosed(check, sec, other))
+		{
+			continue;
+		}
+
+		if (check->flags & ML_SOUNDBLOCK)
+		{
+			if (!soundblocks)
+				Mark(other, 1);
+		}
+		else
+		{
+			Mark(other, soundblocks);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Breadth first flood from the source sector
+//
+//==========================================================================
+
+const FSoundFloodSector *FSoundGraph::Flood(sector_t *source, unsigned &count)
+{
+	if (Nodes.Size() != level.sectors.Size())
+	{
+		Build();
+	}
+	else if (NumLinePortals != level.linePortals.Size())
+	{
+		MarkLinePortals();
+		Invalidate();
+	}
+
+	Floods++;
+	int sourcenum = source->Index();
+	FCacheEntry *cached = Cache.CheckKey(sourcenum);
+	if (cached != nullptr)
+	{
+		CachedFloods++;
+		count = cached->Count;
+		return &CachedSectors[cached->Start];
+	}
+
+	if (++VisitCount == 0)
+	{
+		memset(&Visited[0], 0, Visited.Size() * sizeof(Visited[0]));
+		VisitCount = 1;
+	}
+	Result.Clear();
+	Queue.Clear();
+	Cacheable = true;
+
+	Mark(source, 0);
+	for (unsigned i = 0; i < Queue.Size(); i++)
+	{
+		sector_t *sec = Queue[i].Sector;
+		int soundblocks = Queue[i].SoundBlocks;
+		const FNode &node = Nodes[sec->Index()];
+
+		// Whether a linked plane lets sound through changes every time the plane
+		// moves past the portal, without any opening changing, so those sectors
+		// are flooded through anew each time.
+		if (node.HasLinePortals || ((sec->planes[sector_t::ceiling].Flags | sec->planes[sector_t::floor].Flags) & PLANEF_LINKED))
+		{
+			Cacheable = false;
+			MarkThroughLines(sec, soundblocks);
+		}
+		else
+		{
+			MarkThroughEdges(node, sec, soundblocks);
+		}
+	}
+
+	if (Cacheable && CachedSectors.Size() + Result.Size() <= MaxCachedSectors)
+	{
+		Cache[sourcenum] = { CachedSectors.Size(), Result.Size() };
+		CachedSectors.Append(Result);
+	}
+
+	count = Result.Size();
+	return &Result[0];
+}
@@ -0,0 +1,131 @@
+/*
+** p_soundgraph.h
+**
+** Sector graph for monster alerting noise
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __P_SOUNDGRAPH_H
+#define __P_SOUNDGRAPH_H
+
+#include "tarray.h"
+
+struct sector_t;
+struct line_t;
+
+struct FSoundFloodSector
+{
+	sector_t *Sector;
+	int SoundBlocks;	// number of sound blocking lines crossed, 0 or 1
+};
+
+//==========================================================================
+//
+// Adjacency of sectors through two-sided lines, used by P_NoiseAlert.
+//
+// A flood only depends on the map geometry, not on who made the noise,
+// so the sectors reached from a source sector are kept until an opening
+// between two sectors closes or opens again. Floods that reach a sector
+// with a line portal or a linked portal plane are never kept, because
+// those are looked up by position and open and close as planes move.
+//
+//==========================================================================
+
+class FSoundGraph
+{
+public:
+	void Clear();
+
+	// Returns the sectors reached from the source in the order they were
+	// first reached. The result is valid until the next call.
+	const FSoundFloodSector *Flood(sector_t *source, unsigned &count);
+
+	// Must be called whenever a sector's floor or ceiling has moved
+	void SectorMoved(sector_t *sector);
+
+	// Must be called when a line's sound blocking flags have changed
+	void Invalidate();
+
+	static int Floods;
+	static int CachedFloods;
+
+private:
+	struct FEdge
+	{
+		line_t *Line;
+		sector_t *Other;
+	};
+
+	struct FNode
+	{
+		unsigned FirstEdge;
+		unsigned NumEdges;
+		bool HasLinePortals;
+	};
+
+	struct FCacheEntry
+	{
+		unsigned Start;
+		unsigned Count;
+	};
+
+	enum
+	{
+		CLOSED_TOBACK = 1,	// noise from the front sector can't pass
+		CLOSED_TOFRONT = 2,	// noise from the back sector can't pass
+	};
+
+	void Build();
+	void MarkLinePortals();
+	static uint8_t GetClosed(line_t *line);
+	bool Mark(sector_t *sec, int soundblocks);
+	void MarkThroughLines(sector_t *sec, int soundblocks);
+	void MarkThroughEdges(const FNode &node, sector_t *sec, int soundblocks);
+
+	TArray<FNode> Nodes;
+	TArray<FEdge> Edges;
+	TArray<uint8_t> Closed;
+	unsigned NumLinePortals = 0;
+
+	// Flood state, indexed by sector number
+	TArray<unsigned> Visited;
+	TArray<unsigned> ResultIndex;
+	unsigned VisitCount = 0;
+	TArray<FSoundFloodSector> Result;
+	TArray<FSoundFloodSector> Queue;
+	bool Cacheable = true;
+
+	TMap<int, FCacheEntry> Cache;
+	TArray<FSoundFloodSector> CachedSectors;
+};
+
+#endif
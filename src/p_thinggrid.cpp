@@ -0,0 +1,610 @@
+/*
+** p_thinggrid.cpp
+**
+** Grid of actors for collision and proximity queries
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <math.h>
+#include <utility>
+#include "p_thinggrid.h"
+#include "p_blockmap.h"
+#include "p_local.h"
+#include "p_maputl.h"
+#include "p_checkposition.h"
+#include "g_levellocals.h"
+#include "d_player.h"
+#include "actor.h"
+#include "actorinlines.h"
+#include "portal.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "templates.h"
+
+// Size of the fine cells in map units, rounded to a power of two between 16 and 128.
+// 0 uses the blockmap's blocks. Anything smaller changes the order actors are
+// checked in, so games play out differently and demos desync. It is ignored while
+// a demo is recorded or played back. Takes effect on the next map.
+CVAR(Int, sim_thinggrid, 0, CVAR_SERVERINFO)
+
+EXTERN_CVAR(Bool, sim_secnodediff)
+
+ADD_STAT(thinggrid)
+{
+	auto &grid = level.thinggrid;
+	int occupied = 0;
+	unsigned most = 0;
+	for (int lvl = 0; lvl < FThingGrid::NumLevels; lvl++)
+	{
+		for (int y = 0; y < grid.GetHeight(lvl); y++)
+		{
+			for (int x = 0; x < grid.GetWidth(lvl); x++)
+			{
+				unsigned count = grid.GetCell(lvl, x, y).Size();
+				if (count > 0) occupied++;
+				most = MAX(most, count);
+			}
+		}
+	}
+	FString out;
+	out.Format("cell=%g/%g  occupied=%d  most=%u  memory=%zuK", grid.GetCellSize(FThingGrid::FineLevel), grid.GetCellSize(FThingGrid::CoarseLevel),
+		occupied, most, grid.MemoryUsage() / 1024);
+	return out;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FThingGrid::Init(double orgx, double orgy, int bmapwidth, int bmapheight)
+{
+	OrgX = orgx;
+	OrgY = orgy;
+	BlockWidth = bmapwidth;
+	BlockHeight = bmapheight;
+	Setup(demorecording || demoplayback ? 0 : *sim_thinggrid);
+}
+
+void FThingGrid::Setup(int cellsize)
+{
+	double width = BlockWidth * double(FBlockmap::MAPBLOCKUNITS);
+	double height = BlockHeight * double(FBlockmap::MAPBLOCKUNITS);
+
+	if (cellsize <= 0)
+	{
+		cellsize = FBlockmap::MAPBLOCKUNITS;
+	}
+	else
+	{
+		int size = 16;
+		while (size < FBlockmap::MAPBLOCKUNITS && size * 2 <= cellsize) size *= 2;
+		cellsize = size;
+	}
+
+	Clear();
+	for (int lvl = 0; lvl < NumLevels; lvl++)
+	{
+		FLevel &l = Levels[lvl];
+		l.CellSize = double(cellsize << (lvl * CoarseShift));
+		l.Width = MAX(1, int(ceil(width / l.CellSize)));
+		l.Height = MAX(1, int(ceil(height / l.CellSize)));
+		l.Cells.Resize(l.Width * l.Height);
+	}
+	Links.Reserve(1);
+	Links[0] = {};
+}
+
+void FThingGrid::Clear()
+{
+	for (auto &l : Levels)
+	{
+		l.Cells.Reset();
+		l.CellSize = 0;
+		l.Width = l.Height = 0;
+	}
+	Links.Reset();
+	FreeLinks = 0;
+	NextSeq = 0;
+	Generation++;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FThingGrid::Rebuild(int cellsize)
+{
+	TThinkerIterator<AActor> it;
+	TArray<AActor *> linked;
+	AActor *mo;
+
+	while ((mo = it.Next()) != nullptr)
+	{
+		if (mo->BlockLinks != 0)
+		{
+			linked.Push(mo);
+			mo->BlockLinks = 0;
+		}
+	}
+	Setup(cellsize);
+	for (auto mo : linked)
+	{
+		Link(mo);
+	}
+}
+
+void FThingGrid::Restore(const FThingGrid &saved)
+{
+	unsigned generation = Generation;
+	*this = saved;
+	// Results cached against the grid in between must not look current
+	Generation = MAX(generation, saved.Generation) + 1;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FThingGrid::BoxToCells(int lvl, double left, double bottom, double right, double top, int *cells) const
+{
+	const FLevel &l = Levels[lvl];
+	int x1 = GetCellX(lvl, left);
+	int x2 = GetCellX(lvl, right);
+	int y1 = GetCellY(lvl, bottom);
+	int y2 = GetCellY(lvl, top);
+
+	if (x1 >= l.Width || x2 < 0 || y1 >= l.Height || y2 < 0)
+	{
+		return false;
+	}
+	cells[0] = MAX(0, x1);
+	cells[1] = MAX(0, y1);
+	cells[2] = MIN(l.Width - 1, x2);
+	cells[3] = MIN(l.Height - 1, y2);
+	return true;
+}
+
+bool FThingGrid::BlocksToCells(int lvl, int bx1, int by1, int bx2, int by2, int *cells) const
+{
+	const FLevel &l = Levels[lvl];
+	bx1 = MAX(0, bx1);
+	by1 = MAX(0, by1);
+	bx2 = MIN(BlockWidth - 1, bx2);
+	by2 = MIN(BlockHeight - 1, by2);
+
+	if (bx1 > bx2 || by1 > by2 || l.Width == 0)
+	{
+		return false;
+	}
+	cells[0] = int(bx1 * FBlockmap::MAPBLOCKUNITS / l.CellSize);
+	cells[1] = int(by1 * FBlockmap::MAPBLOCKUNITS / l.CellSize);
+	cells[2] = MIN(l.Width - 1, int(ceil((bx2 + 1) * FBlockmap::MAPBLOCKUNITS / l.CellSize)) - 1);
+	cells[3] = MIN(l.Height - 1, int(ceil((by2 + 1) * FBlockmap::MAPBLOCKUNITS / l.CellSize)) - 1);
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+unsigned FThingGrid::NewLink()
+{
+	if (FreeLinks != 0)
+	{
+		unsigned index = FreeLinks;
+		FreeLinks = Links[index].Next;
+		return index;
+	}
+	return Links.Reserve(1);
+}
+
+void FThingGrid::Link(AActor *actor)
+{
+	FPortalGroupArray check;
+
+	P_CollectConnectedGroups(actor->Sector->PortalGroup, actor->Pos(), actor->Top(), actor->radius, check);
+
+	LinkAt(actor, actor->Pos());
+	for (unsigned i = 0; i < check.Size(); i++)
+	{
+		LinkAt(actor, actor->PosRelative(check[i] & ~FPortalGroupArray::FLAT));
+	}
+
+	unsigned index = actor->BlockLinks;
+	if (index != 0)
+	{
+		FLink &link = Links[index];
+		if (link.Next != 0)
+		{
+			for (; index != 0; index = Links[index].Next)
+			{
+				Links[index].Flags = LINK_PORTAL;
+			}
+		}
+		else if (link.BX1 == link.BX2 && link.BY1 == link.BY2)
+		{
+			link.Flags = LINK_SINGLE;
+		}
+	}
+}
+
+void FThingGrid::LinkAt(AActor *actor, const DVector2 &pos)
+{
+	int lvl = GetLevel(actor->radius);
+	int cells[4];
+
+	// Positions off the map are left out the same way the old block lists did
+	int bx1 = level.blockmap.GetBlockX(pos.X - actor->radius);
+	int bx2 = level.blockmap.GetBlockX(pos.X + actor->radius);
+	int by1 = level.blockmap.GetBlockY(pos.Y - actor->radius);
+	int by2 = level.blockmap.GetBlockY(pos.Y + actor->radius);
+
+	if (bx1 >= BlockWidth || bx2 < 0 || by1 >= BlockHeight || by2 < 0 ||
+		!BoxToCells(lvl, pos.X - actor->radius, pos.Y - actor->radius, pos.X + actor->radius, pos.Y + actor->radius, cells))
+	{ // thing is off the map
+		return;
+	}
+
+	unsigned index = NewLink();
+	FLink &link = Links[index];
+	link.Level = lvl;
+	link.X1 = cells[0];
+	link.Y1 = cells[1];
+	link.X2 = cells[2];
+	link.Y2 = cells[3];
+	link.BX1 = MAX(0, bx1);
+	link.BY1 = MAX(0, by1);
+	link.BX2 = MIN(BlockWidth - 1, bx2);
+	link.BY2 = MIN(BlockHeight - 1, by2);
+	link.Seq = NextSeq++;
+	link.Flags = 0;
+	link.Next = actor->BlockLinks;
+	actor->BlockLinks = index;
+
+	FThingGridEntry entry = { actor, index };
+
+	FLevel &l = Levels[lvl];
+	for (int y = link.Y1; y <= link.Y2; y++)
+	{
+		for (int x = link.X1; x <= link.X2; x++)
+		{
+			l.Cells[x + y * l.Width].Push(entry);
+		}
+	}
+	Generation++;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FThingGrid::RemoveEntries(unsigned index, TArray<FSavedEntry> *saved)
+{
+	const FLink &link = Links[index];
+	FLevel &l = Levels[link.Level];
+	Generation++;
+	for (int y = link.Y1; y <= link.Y2; y++)
+	{
+		for (int x = link.X1; x <= link.X2; x++)
+		{
+			int cellindex = x + y * l.Width;
+			auto &cell = l.Cells[cellindex];
+
+			// Actors that move a lot were linked last, so look from the end.
+			for (unsigned i = cell.Size(); i-- > 0; )
+			{
+				if (cell[i].Link == index)
+				{
+					if (saved != nullptr)
+					{
+						saved->Push({ link.Level, cellindex, i, cell[i] });
+					}
+					cell.Delete(i);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void FThingGrid::Unlink(AActor *actor)
+{
+	unsigned index = actor->BlockLinks;
+	while (index != 0)
+	{
+		FLink &link = Links[index];
+		unsigned next = link.Next;
+		RemoveEntries(index, nullptr);
+		link.Next = FreeLinks;
+		FreeLinks = index;
+		index = next;
+	}
+	actor->BlockLinks = 0;
+}
+
+// The links stay allocated, as the backup of the actor still refers to them.
+void FThingGrid::Detach(AActor *actor, TArray<FSavedEntry> &saved)
+{
+	saved.Clear();
+	for (unsigned index = actor->BlockLinks; index != 0; index = Links[index].Next)
+	{
+		RemoveEntries(index, &saved);
+	}
+	actor->BlockLinks = 0;
+}
+
+void FThingGrid::Reattach(const TArray<FSavedEntry> &saved)
+{
+	for (unsigned i = saved.Size(); i-- > 0; )
+	{
+		auto &s = saved[i];
+		Levels[s.Level].Cells[s.Cell].Insert(s.Index, s.Entry);
+	}
+	Generation++;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+size_t FThingGrid::MemoryUsage() const
+{
+	size_t size = Links.Max() * sizeof(FLink);
+	for (auto &l : Levels)
+	{
+		size += l.Cells.Max() * sizeof(l.Cells[0]);
+		for (auto &cell : l.Cells)
+		{
+			size += cell.Max() * sizeof(FThingGridEntry);
+		}
+	}
+	return size;
+}
+
+//==========================================================================
+//
+// CCMD crowdbench
+//
+// Spawns a crowd of actors around the player and times P_TryMove for all
+// of them with the blockmap's block size and with finer cells. In secnodes
+// mode it instead times the blockmap's block size with sim_secnodediff on
+// and off. The crowd can't trigger lines, and the grid is restored exactly
+// afterward. Spawning still changes the game, so this counts as a cheat.
+//
+//==========================================================================
+
+CCMD(crowdbench)
+{
+	if (gamestate != GS_LEVEL || players[consoleplayer].mo == nullptr)
+	{
+		Printf("You must be in a level to run this.\n");
+		return;
+	}
+	if (netgame || demorecording || demoplayback)
+	{
+		Printf("crowdbench is only available in single player games.\n");
+		return;
+	}
+	if (CheckCheatmode())
+	{
+		return;
+	}
+
+	FName classname = argv.argc() > 1 ? FName(argv[1]) : FName("DoomImp");
+	int count = argv.argc() > 2 ? clamp(atoi(argv[2]), 1, 10000) : 500;
+	int rounds = argv.argc() > 3 ? clamp(atoi(argv[3]), 1, 10000) : 35;
+	bool secnodes = argv.argc() > 4 && !stricmp(argv[4], "secnodes");
+
+	PClassActor *cls = PClass::FindActor(classname);
+	if (cls == nullptr || (argv.argc() > 4 && !secnodes && stricmp(argv[4], "grid")))
+	{
+		Printf("Usage: crowdbench [class] [count] [rounds] [grid|secnodes]\n");
+		if (cls == nullptr) Printf("Unknown actor class '%s'\n", classname.GetChars());
+		return;
+	}
+
+	// Pack the crowd into a square in front of the player that leaves each actor a little room to move.
+	AActor *pmo = players[consoleplayer].mo;
+	double spacing = GetDefaultByType(cls)->radius * 1.5 + 1;
+	int side = int(ceil(sqrt(double(count))));
+	DVector2 start = pmo->Pos().XY() + pmo->Angles.Yaw.ToVector(pmo->radius + side * spacing * 0.75) - DVector2(side * spacing / 2, side * spacing / 2);
+
+	// The grid is put back as it was, so that the order things are checked in does not change.
+	struct FSavedActor
+	{
+		AActor *Actor;
+		unsigned BlockLinks;
+		DVector3 Pos;
+		double Radius;
+		double Height;
+		bool Alive;
+	};
+	TArray<FSavedActor> before;
+	TMap<AActor *, unsigned> beforeindex;
+	{
+		TThinkerIterator<AActor> it;
+		AActor *mo;
+		while ((mo = it.Next()) != nullptr)
+		{
+			beforeindex[mo] = before.Push({ mo, mo->BlockLinks, mo->Pos(), mo->radius, mo->Height, false });
+		}
+	}
+	FThingGrid saved = level.thinggrid;
+
+	TArray<AActor *> crowd;
+	TArray<DVector3> positions;
+	for (int i = 0; i < count; i++)
+	{
+		DVector3 pos(start.X + (i % side) * spacing, start.Y + (i / side) * spacing, pmo->Z());
+		AActor *mo = Spawn(cls, pos, NO_REPLACE);
+		if (mo != nullptr)
+		{
+			mo->ClearCounters();
+			// Nothing in the crowd may hurt or pick up what it bumps into, or activate the lines it crosses
+			mo->flags &= ~(MF_MISSILE | MF_PICKUP | MF_SKULLFLY);
+			mo->flags2 &= ~(MF2_PUSHWALL | MF2_MCROSS | MF2_PCROSS | MF2_BLASTED);
+			mo->flags6 |= MF6_NOTRIGGER;
+			crowd.Push(mo);
+			positions.Push(mo->Pos());
+		}
+	}
+
+	auto run = [&](cycle_t &timer)
+	{
+		for (unsigned i = 0; i < crowd.Size(); i++)
+		{
+			crowd[i]->SetOrigin(positions[i], false);
+		}
+
+		int moved = 0;
+		timer.Clock();
+		for (int r = 0; r < rounds; r++)
+		{
+			// Everybody steps the same way and back so that the crowd stays in place.
+			double step = (r & 1) ? -4 : 4;
+			for (auto mo : crowd)
+			{
+				FCheckPosition tm;
+				if (P_TryMove(mo, mo->Pos().XY() + DVector2(step, step * 0.5), true, nullptr, tm))
+				{
+					moved++;
+				}
+			}
+		}
+		timer.Unclock();
+		return moved;
+	};
+
+	if (secnodes)
+	{
+		// Alternate the two settings so that both get the same share of warm caches.
+		bool diff = sim_secnodediff;
+		cycle_t timers[2];
+		int moved[2] = { 0, 0 };
+		timers[0].Reset();
+		timers[1].Reset();
+		level.thinggrid.Rebuild(FBlockmap::MAPBLOCKUNITS);
+		for (int pass = 0; pass < 4; pass++)
+		{
+			int on = pass & 1;
+			sim_secnodediff = !!on;
+			moved[on] += run(timers[on]);
+		}
+		sim_secnodediff = diff;
+
+		for (int on = 1; on >= 0; on--)
+		{
+			Printf("secnode diff %s: %8.3f ms, %d of %d moves succeeded\n", on ? "on " : "off", timers[on].TimeMS(), moved[on], 2 * rounds * crowd.Size());
+		}
+		if (timers[1].TimeMS() > 0)
+		{
+			Printf("P_TryMove throughput with the diff: %.2fx\n", timers[0].TimeMS() / timers[1].TimeMS());
+		}
+	}
+	else
+	{
+		static const int sizes[] = { FBlockmap::MAPBLOCKUNITS, 64, 32 };
+
+		for (int size : sizes)
+		{
+			level.thinggrid.Rebuild(size);
+
+			cycle_t timer;
+			timer.Reset();
+			int moved = run(timer);
+			Printf("cell %3d: %8.3f ms, %d of %d moves succeeded\n", size, timer.TimeMS(), moved, rounds * crowd.Size());
+		}
+	}
+
+	for (auto mo : crowd)
+	{
+		mo->Destroy();
+	}
+
+	// Spawning runs scripts, which may have spawned, moved or destroyed other actors, too.
+	TArray<std::pair<AActor *, bool>> live;
+	{
+		TThinkerIterator<AActor> it;
+		AActor *mo;
+		while ((mo = it.Next()) != nullptr)
+		{
+			live.Push(std::make_pair(mo, mo->BlockLinks != 0));
+		}
+	}
+
+	level.thinggrid.Restore(saved);
+	for (auto &s : before)
+	{
+		s.Actor->BlockLinks = s.BlockLinks;
+	}
+
+	// Whatever changed since the grid was saved gets linked again, so that no actor keeps links into the grid that was thrown away.
+	for (auto &l : live)
+	{
+		AActor *mo = l.first;
+		unsigned *index = beforeindex.CheckKey(mo);
+		if (index == nullptr)
+		{
+			mo->BlockLinks = 0;
+			if (l.second) level.thinggrid.Link(mo);
+			continue;
+		}
+		auto &s = before[*index];
+		s.Alive = true;
+		if (l.second != (s.BlockLinks != 0) || mo->Pos() != s.Pos || mo->radius != s.Radius || mo->Height != s.Height)
+		{
+			level.thinggrid.Unlink(mo);
+			if (l.second) level.thinggrid.Link(mo);
+		}
+	}
+	for (auto &s : before)
+	{
+		if (!s.Alive)
+		{
+			// Destroyed, but not collected before the next tic
+			level.thinggrid.Unlink(s.Actor);
+		}
+	}
+}
@@ -0,0 +1,200 @@
+/*
+** p_thinggrid.h
+**
+** Grid of actors for collision and proximity queries
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __P_THINGGRID_H
+#define __P_THINGGRID_H
+
+#include <stdint.h>
+#include "tarray.h"
+#include "vectors.h"
+#include "p_blockmap.h"
+
+class AActor;
+
+struct FThingGridEntry
+{
+	AActor *Actor;
+	unsigned Link;			// the link of the actor this entry belongs to
+};
+
+//==========================================================================
+//
+// The grid actors are linked into, kept apart from the line blockmap.
+//
+// There are two levels. Actors whose radius fits the fine cells go there
+// and cover at most 3x3 cells, bigger ones go into the coarse level whose
+// cells are 8 times as large, so a huge actor does not need hundreds of
+// links. Each cell is a plain array of entries. Removal keeps the order of
+// the remaining entries, as the order things are checked in must not depend
+// on anything a client does locally, like player prediction.
+//
+// By default the fine cells are the blockmap's blocks, and every link gets
+// a sequence number, so FBlockThingsIterator can return the actors of each
+// block newest first, exactly like the old per block lists. Smaller cells
+// change that order and are only for testing.
+//
+//==========================================================================
+
+class FThingGrid
+{
+public:
+	enum
+	{
+		FineLevel,
+		CoarseLevel,
+		NumLevels,
+
+		CoarseShift = 3,
+	};
+
+	enum
+	{
+		LINK_SINGLE = 1,	// this is the only block the actor is linked into
+		LINK_PORTAL = 2,	// the actor is linked at more than one position
+	};
+
+	// One for each position an actor is linked at
+	struct FLink
+	{
+		int Level;
+		int X1, Y1, X2, Y2;		// cells of the level
+		int BX1, BY1, BX2, BY2;	// blockmap blocks
+		uint64_t Seq;			// order of linking, the old block lists had the newest first
+		unsigned Flags;
+		unsigned Next;			// next link of the same actor, 0 ends the chain
+	};
+
+	struct FSavedEntry
+	{
+		int Level;
+		int Cell;
+		unsigned Index;
+		FThingGridEntry Entry;
+	};
+
+	// Sets the grid up to cover the blockmap's area. The cell size comes from sim_thinggrid,
+	// unless a demo is recorded or played back.
+	void Init(double orgx, double orgy, int bmapwidth, int bmapheight);
+	void Clear();
+
+	// Changes the cell size and links all actors again. Their order changes,
+	// so this must not be used in a netgame. 0 uses the blockmap's block size.
+	void Rebuild(int cellsize);
+
+	// Puts back a copy taken earlier. The actors' BlockLinks must be restored by the caller.
+	void Restore(const FThingGrid &saved);
+
+	// Links the actor at its position and at every portal group it reaches into
+	void Link(AActor *actor);
+	void Unlink(AActor *actor);
+
+	// Player prediction takes its actor out of the grid and puts it back at the same positions afterward.
+	void Detach(AActor *actor, TArray<FSavedEntry> &saved);
+	void Reattach(const TArray<FSavedEntry> &saved);
+
+	int GetLevel(double radius) const
+	{
+		return radius <= Levels[FineLevel].CellSize ? FineLevel : CoarseLevel;
+	}
+
+	int GetCellX(int lvl, double x) const
+	{
+		return int((x - OrgX) / Levels[lvl].CellSize);
+	}
+
+	int GetCellY(int lvl, double y) const
+	{
+		return int((y - OrgY) / Levels[lvl].CellSize);
+	}
+
+	double GetCellSize(int lvl) const { return Levels[lvl].CellSize; }
+	int GetWidth(int lvl) const { return Levels[lvl].Width; }
+	int GetHeight(int lvl) const { return Levels[lvl].Height; }
+
+	const TArray<FThingGridEntry> &GetCell(int lvl, int x, int y) const
+	{
+		return Levels[lvl].Cells[x + y * Levels[lvl].Width];
+	}
+
+	const FLink &GetLink(unsigned index) const
+	{
+		return Links[index];
+	}
+
+	// True if the fine cells are the blockmap's blocks, so that iterating them gives the old order
+	bool IsBlockOrder() const
+	{
+		return Levels[FineLevel].CellSize == FBlockmap::MAPBLOCKUNITS;
+	}
+
+	// Converts a range of blockmap blocks to the cells of a level that cover them.
+	// Returns false if the range does not touch the grid.
+	bool BlocksToCells(int lvl, int bx1, int by1, int bx2, int by2, int *cells) const;
+
+	// Clamps the cells that cover a box to the grid. Returns false if the box is outside.
+	bool BoxToCells(int lvl, double left, double bottom, double right, double top, int *cells) const;
+
+	size_t MemoryUsage() const;
+
+	// Changes whenever an entry is added to or removed from a cell
+	unsigned GetGeneration() const { return Generation; }
+
+private:
+	struct FLevel
+	{
+		double CellSize = 0;
+		int Width = 0;
+		int Height = 0;
+		TArray<TArray<FThingGridEntry>> Cells;
+	};
+
+	void Setup(int cellsize);
+	void LinkAt(AActor *actor, const DVector2 &pos);
+	unsigned NewLink();
+	void RemoveEntries(unsigned index, TArray<FSavedEntry> *saved);
+
+	FLevel Levels[NumLevels];
+	double OrgX = 0;
+	double OrgY = 0;
+	int BlockWidth = 0;
+	int BlockHeight = 0;
+	TArray<FLink> Links;	// entry 0 is not used so that 0 can mean no link
+	unsigned FreeLinks = 0;
+	uint64_t NextSeq = 0;
+	unsigned Generation = 0;
+};
+
+#endif
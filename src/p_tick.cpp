@@ -37,6 +37,8 @@
 #include "g_levellocals.h"
 #include "events.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
+#include "p_simprofile.h"
 
 extern gamestate_t wipegamestate;
 
@@ -89,6 +91,7 @@ void P_Ticker (void)
 	if (paused || P_CheckTickerPaused())
 		return;
 
+	FSimProfiler::BeginTic();
 	DPSprite::NewTick();
 
 	// [RH] Frozen mode is only changed every 4 tics, to make it work with A_Tracer().
@@ -139,6 +142,8 @@ void P_Ticker (void)
 	E_WorldTick();
 	StatusBar->CallTick ();		// [RH] moved this here
 	level.Tick ();			// [RH] let the level tick
+	FSightBatch::Instance()->BeginTic();
+	FExplosionSight::Instance()->Clear();
 	DThinker::RunThinkers ();
 
 	//if added by MC: Freeze mode.
@@ -152,4 +157,6 @@ void P_Ticker (void)
 	level.time++;
 	level.maptime++;
 	level.totaltime++;
+
+	FSimProfiler::FinishTic();
 }
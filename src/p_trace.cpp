@@ -41,6 +41,7 @@
 #include "g_levellocals.h"
 #include "p_terrain.h"
 #include "vm.h"
+#include "stats.h"
 
 //==========================================================================
 //
@@ -142,6 +143,207 @@ static bool isLiquid(F3DFloor *ff)
 	return Terrains[terrain].IsLiquid && Terrains[terrain].Splash != -1;
 }
 
+//==========================================================================
+//
+// Things along the paths of a burst of traces
+//
+// Shotguns and similar weapons fire several traces from the same actor in
+// one go. All of them look through mostly the same blockmap blocks, so the
+// things found in each block are kept for the following traces of the
+// burst for as long as no actor gets linked or unlinked. The traces are
+// still resolved one after the other, because each pellet's damage,
+// puffs and line activations must happen before the next one is traced.
+//
+//==========================================================================
+
+class FTraceThingCache
+{
+public:
+	// Returns the cache if the trace continues a burst. The first trace of
+	// a burst does not use it, so single traces don't pay for filling it.
+	static FTraceThingCache *Join(AActor *shooter);
+
+	// Things in a block in the order FBlockThingsIterator returns them
+	const unsigned *GetBlock(int bx, int by, bool centeronly, unsigned &count);
+	AActor *GetThing(unsigned index) const { return Things[index]; }
+
+	// False once an actor was linked or unlinked, for instance by a line the trace activated
+	bool IsCurrent() const { return Generation == level.thinggrid.GetGeneration(); }
+
+	unsigned NewStamp()
+	{
+		if (++Stamp == 0)
+		{
+			memset(&Stamps[0], 0, Stamps.Size() * sizeof(Stamps[0]));
+			Stamp = 1;
+		}
+		return Stamp;
+	}
+
+	// Returns true the first time a thing is visited with this stamp
+	bool Visit(unsigned index, unsigned stamp)
+	{
+		if (Stamps[index] == stamp) return false;
+		Stamps[index] = stamp;
+		return true;
+	}
+
+	static int CachedTraces;
+	static int BlocksFilled;
+	static int BlocksReused;
+
+private:
+	struct FBlock
+	{
+		unsigned Start;
+		unsigned Count;
+	};
+
+	void Reset();
+
+	AActor *Shooter = nullptr;
+	int Time = -1;
+	unsigned Generation = 0;
+	bool Used = false;
+
+	TMap<int, FBlock> Blocks;
+	TArray<unsigned> BlockThings;
+	TMap<AActor *, unsigned> ThingIndex;
+	TArray<AActor *> Things;
+	TArray<unsigned> Stamps;
+	unsigned Stamp = 0;
+};
+
+int FTraceThingCache::CachedTraces;
+int FTraceThingCache::BlocksFilled;
+int FTraceThingCache::BlocksReused;
+
+ADD_STAT(tracebatch)
+{
+	FString out;
+	out.Format("cached traces=%d  blocks filled=%d  reused=%d", FTraceThingCache::CachedTraces, FTraceThingCache::BlocksFilled, FTraceThingCache::BlocksReused);
+	return out;
+}
+
+FTraceThingCache *FTraceThingCache::Join(AActor *shooter)
+{
+	static FTraceThingCache cache;
+
+	if (shooter == nullptr || !FQueryContext::Current().IsMain())
+		return nullptr;
+
+	unsigned generation = level.thinggrid.GetGeneration();
+	if (shooter != cache.Shooter || level.maptime != cache.Time || generation != cache.Generation)
+	{
+		cache.Shooter = shooter;
+		cache.Time = level.maptime;
+		cache.Generation = generation;
+		cache.Reset();
+		return nullptr;
+	}
+	CachedTraces++;
+	return &cache;
+}
+
+void FTraceThingCache::Reset()
+{
+	if (Used)
+	{
+		Used = false;
+		Blocks.Clear();
+		BlockThings.Clear();
+		ThingIndex.Clear();
+		Things.Clear();
+		Stamps.Clear();
+	}
+}
+
+const unsigned *FTraceThingCache::GetBlock(int bx, int by, bool centeronly, unsigned &count)
+{
+	if (!level.blockmap.isValidBlock(bx, by))
+	{
+		count = 0;
+		return nullptr;
+	}
+
+	int key = (by * level.blockmap.bmapwidth + bx) * 2 + centeronly;
+	FBlock *block = Blocks.CheckKey(key);
+	if (block == nullptr)
+	{
+		FBlockThingsIterator it(bx, by, bx, by);
+		AActor *thing;
+		unsigned start = BlockThings.Size();
+
+		while ((thing = it.Next(centeronly)))
+		{
+			unsigned *index = ThingIndex.CheckKey(thing);
+			if (index == nullptr)
+			{
+				index = &ThingIndex.Insert(thing, Things.Push(thing));
+				Stamps.Push(0);
+			}
+			BlockThings.Push(*index);
+		}
+		block = &Blocks.Insert(key, { start, BlockThings.Size() - start });
+		BlocksFilled++;
+		Used = true;
+	}
+	else
+	{
+		BlocksReused++;
+	}
+	count = block->Count;
+	return count > 0 ? &BlockThings[block->Start] : nullptr;
+}
+
+//==========================================================================
+//
+// Gets the things of each block from the cache. A thing that covers more
+// than one block is only added the first time, like FBlockThingsIterator
+// does for the normal traverser.
+//
+//==========================================================================
+
+class FTracePathTraverse : public FPathTraverse
+{
+	FTraceThingCache *Cache;
+	unsigned LastPass = 0;
+	unsigned Stamp = 0;
+
+	void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible) override
+	{
+		if (Cache != nullptr && passcount != LastPass)
+		{
+			// Things are only gathered during init, so this holds for the entire pass.
+			LastPass = passcount;
+			if (Cache->IsCurrent()) Stamp = Cache->NewStamp();
+			else Cache = nullptr;
+		}
+		if (Cache == nullptr)
+		{
+			FPathTraverse::AddThingIntercepts(bx, by, it, compatible);
+			return;
+		}
+
+		unsigned count;
+		const unsigned *things = Cache->GetBlock(bx, by, compatible, count);
+		for (unsigned i = 0; i < count; i++)
+		{
+			// Compatible traces only get things whose center is in the block, and they get them every time.
+			if (compatible || Cache->Visit(things[i], Stamp))
+			{
+				AddThingIntercept(Cache->GetThing(things[i]), compatible);
+			}
+		}
+	}
+
+public:
+	FTracePathTraverse(FTraceThingCache *cache)
+		: Cache(cache)
+	{
+	}
+};
+
 //==========================================================================
 //
 // Trace entry point
@@ -777,7 +979,8 @@ bool FTraceInfo::TraceTraverse (int ptflags)
 	// Do a 3D floor check in the starting sector
 	Setup3DFloors();
 
-	FPathTraverse it(Start.X, Start.Y, Vec.X * MaxDist, Vec.Y * MaxDist, ptflags | PT_DELTA, startfrac);
+	FTracePathTraverse it((ptflags & PT_ADDTHINGS) ? FTraceThingCache::Join(IgnoreThis) : nullptr);
+	it.init(Start.X, Start.Y, Vec.X * MaxDist, Vec.Y * MaxDist, ptflags | PT_DELTA, startfrac);
 	intercept_t *in;
 	int lastsplashsector = -1;
 
@@ -1366,6 +1366,7 @@ public:
 		sec->SetAlpha(sector_t::ceiling, 1.);
 		sec->thinglist = nullptr;
 		sec->touching_thinglist = nullptr;		// phares 3/14/98
+		sec->touching_changes = 0;
 		sec->sectorportal_thinglist = nullptr;
 		sec->touching_renderthings = nullptr;
 		sec->seqType = (level.flags & LEVEL_SNDSEQTOTALCTRL) ? 0 : -1;
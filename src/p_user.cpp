@@ -131,6 +131,7 @@ static int PredictionLerptics;
 static player_t PredictionPlayerBackup;
 static uint8_t PredictionActorBackup[sizeof(APlayerPawn)];
 static TArray<AActor *> PredictionSectorListBackup;
+static TArray<FThingGrid::FSavedEntry> PredictionBlockBackup;
 
 static TArray<sector_t *> PredictionTouchingSectorsBackup;
 static TArray<msecnode_t *> PredictionTouchingSectors_sprev_Backup;
@@ -2501,20 +2502,9 @@ void P_PredictPlayer (player_t *player)
 		}
 	}
 
-	// Blockmap ordering also needs to stay the same, so unlink the block nodes
-	// without releasing them. (They will be used again in P_UnpredictPlayer).
-	FBlockNode *block = act->BlockNode;
-
-	while (block != NULL)
-	{
-		if (block->NextActor != NULL)
-		{
-			block->NextActor->PrevActor = block->PrevActor;
-		}
-		*(block->PrevActor) = block->NextActor;
-		block = block->NextBlock;
-	}
-	act->BlockNode = NULL;
+	// Blockmap ordering also needs to stay the same, so take the actor out of the
+	// thing grid without releasing its links. (They will be used again in P_UnpredictPlayer).
+	level.thinggrid.Detach(act, PredictionBlockBackup);
 
 	// Values too small to be usable for lerping can be considered "off".
 	bool CanLerp = (!(cl_predict_lerpscale < 0.01f) && (ticdup == 1)), DoLerp = false, NoInterpolateOld = R_GetViewInterpolationStatus();
@@ -2636,18 +2626,8 @@ void P_UnPredictPlayer ()
 			act->touching_lineportallist = RestoreNodeList(act, lineportal_list, &FLinePortal::lineportal_thinglist, PredictionPortalLines_sprev_Backup, PredictionPortalLinesBackup);
 		}
 
-		// Now fix the pointers in the blocknode chain
-		FBlockNode *block = act->BlockNode;
-
-		while (block != NULL)
-		{
-			*(block->PrevActor) = block;
-			if (block->NextActor != NULL)
-			{
-				block->NextActor->PrevActor = &block->NextActor;
-			}
-			block = block->NextBlock;
-		}
+		// Now put the actor back where it was in the thing grid
+		level.thinggrid.Reattach(PredictionBlockBackup);
 
 		act->InvSel = InvSel;
 		player->inventorytics = inventorytics;
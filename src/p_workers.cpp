@@ -0,0 +1,86 @@
+/*
+** p_workers.cpp
+**
+** Worker threads for the play simulation
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include "p_workers.h"
+#include "p_maputl.h"
+#include "templates.h"
+#include "c_cvars.h"
+
+// Number of threads for parallel playsim loops. 0 = one less than the number of cores.
+CVAR(Int, sim_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FPlayWorkers *FPlayWorkers::Instance()
+{
+	static FPlayWorkers workers;
+	return &workers;
+}
+
+// Blockmap and sight queries on a worker must not touch the shared validcount marks
+FPlayWorkers::FPlayWorkers()
+	: mPool([]()
+	{
+		static thread_local FQueryContext context;
+		FQueryContext::Bind(&context);
+	})
+{
+}
+
+int FPlayWorkers::ThreadCount() const
+{
+	int count = sim_threads;
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency() - 1;
+	return clamp(count, 1, 16);
+}
+
+//==========================================================================
+//
+// Each thread gets a few ranges so that uneven ones even out
+//
+//==========================================================================
+
+void FPlayWorkers::Run(int count, int minbatch, const std::function<void(int, int)> &work)
+{
+	int threads = ThreadCount();
+	int batch = MAX(minbatch, (count + threads * 4 - 1) / (threads * 4));
+	mPool.Run(threads, count, batch, work);
+}
@@ -0,0 +1,71 @@
+/*
+** p_workers.h
+**
+** Worker threads for the play simulation
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __P_WORKERS_H
+#define __P_WORKERS_H
+
+#include "workerpool.h"
+
+//==========================================================================
+//
+// Splits loops of the play simulation over a pool of worker threads.
+//
+// The work function must only touch data that belongs to its own range,
+// so the result never depends on how the range was split. The calling
+// thread takes part in the work and Run returns when all of it is done.
+// Every worker has its own FQueryContext, so blockmap iterators, path
+// traversals and sight checks can be used from the work function.
+//
+//==========================================================================
+
+class FPlayWorkers
+{
+public:
+	static FPlayWorkers *Instance();
+
+	// Number of threads Run uses, including the caller
+	int ThreadCount() const;
+
+	// Calls work for ranges of at least minbatch items that cover [0, count)
+	void Run(int count, int minbatch, const std::function<void(int start, int end)> &work);
+
+private:
+	FPlayWorkers();
+
+	FWorkerPool mPool;
+};
+
+#endif
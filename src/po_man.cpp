@@ -38,6 +38,7 @@
 #include "r_utility.h"
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "p_sightbatch.h"
 #include "v_text.h"
 
 // MACROS ------------------------------------------------------------------
@@ -936,6 +937,7 @@ void FPolyObj::CalcCenter()
 bool FPolyObj::MovePolyobj (const DVector2 &pos, bool force)
 {
 	FBoundingBox oldbounds = Bounds;
+	FSightBatch::GeometryChanged();
 	UnLinkPolyobj ();
 	DoMovePolyobj (pos);
 
@@ -1016,6 +1018,7 @@ bool FPolyObj::RotatePolyobj (DAngle angle, bool fromsave)
 	bool blocked;
 	FBoundingBox oldbounds = Bounds;
 
+	FSightBatch::GeometryChanged();
 	an = Angle + angle;
 
 	UnLinkPolyobj();
@@ -1103,9 +1106,8 @@ void FPolyObj::UnLinkPolyobj ()
 bool FPolyObj::CheckMobjBlocking (side_t *sd)
 {
 	static TArray<AActor *> checker;
-	FBlockNode *block;
 	AActor *mobj;
-	int i, j, k;
+	int k;
 	int left, right, top, bottom;
 	line_t *ld;
 	bool blocked;
@@ -1132,96 +1134,92 @@ bool FPolyObj::CheckMobjBlocking (side_t *sd)
 	right = right < 0 ? 0 : right;
 	right = right >= bmapwidth ?  bmapwidth-1 : right;
 
-	for (j = bottom*bmapwidth; j <= top*bmapwidth; j += bmapwidth)
+	FBlockThingsIterator it(left, bottom, right, top);
+	while ((mobj = it.Next()) != NULL)
 	{
-		for (i = left; i <= right; i++)
+		// Actors that got pushed may show up again in another cell.
+		for (k = (int)checker.Size()-1; k >= 0; --k)
 		{
-			for (block = level.blockmap.blocklinks[j+i]; block != NULL; block = block->NextActor)
+			if (checker[k] == mobj)
 			{
-				mobj = block->Me;
-				for (k = (int)checker.Size()-1; k >= 0; --k)
+				break;
+			}
+		}
+		if (k >= 0)
+		{
+			continue;
+		}
+		checker.Push (mobj);
+		if ((mobj->flags&MF_SOLID) && !(mobj->flags&MF_NOCLIP))
+		{
+			FLineOpening open;
+			open.top = LINEOPEN_MAX;
+			open.bottom = LINEOPEN_MIN;
+			// [TN] Check wether this actor gets blocked by the line.
+			if (ld->backsector != NULL &&
+				!(ld->flags & (ML_BLOCKING|ML_BLOCKEVERYTHING))
+				&& !(ld->flags & ML_BLOCK_PLAYERS && mobj->player) 
+				&& !(ld->flags & ML_BLOCKMONSTERS && mobj->flags3 & MF3_ISMONSTER)
+				&& !((mobj->flags & MF_FLOAT) && (ld->flags & ML_BLOCK_FLOATERS))
+				&& (!(ld->flags & ML_3DMIDTEX) ||
+					(!P_LineOpening_3dMidtex(mobj, ld, open) &&
+						(mobj->Top() < open.top)
+					) || (open.abovemidtex && mobj->Z() > mobj->floorz))
+				)
+			{
+				// [BL] We can't just continue here since we must
+				// determine if the line's backsector is going to
+				// be blocked.
+				performBlockingThrust = false;
+			}
+			else
+			{
+				performBlockingThrust = true;
+			}
+
+			DVector2 pos = mobj->PosRelative(ld);
+			FBoundingBox box(pos.X, pos.Y, mobj->radius);
+
+			if (!box.inRange(ld) || box.BoxOnLineSide(ld) != -1)
+			{
+				continue;
+			}
+
+			if (ld->isLinePortal())
+			{
+				// Fixme: this still needs to figure out if the polyobject move made the player cross the portal line.
+				if (P_TryMove(mobj, mobj->Pos(), false))
 				{
-					if (checker[k] == mobj)
-					{
-						break;
-					}
+					continue;
 				}
-				if (k < 0)
+			}
+			// We have a two-sided linedef so we should only check one side
+			// so that the thrust from both sides doesn't cancel each other out.
+			// Best use the one facing the player and ignore the back side.
+			if (ld->sidedef[1] != NULL)
+			{
+				int side = P_PointOnLineSidePrecise(mobj->Pos(), ld);
+				if (ld->sidedef[side] != sd)
 				{
-					checker.Push (mobj);
-					if ((mobj->flags&MF_SOLID) && !(mobj->flags&MF_NOCLIP))
-					{
-						FLineOpening open;
-						open.top = LINEOPEN_MAX;
-						open.bottom = LINEOPEN_MIN;
-						// [TN] Check wether this actor gets blocked by the line.
-						if (ld->backsector != NULL &&
-							!(ld->flags & (ML_BLOCKING|ML_BLOCKEVERYTHING))
-							&& !(ld->flags & ML_BLOCK_PLAYERS && mobj->player) 
-							&& !(ld->flags & ML_BLOCKMONSTERS && mobj->flags3 & MF3_ISMONSTER)
-							&& !((mobj->flags & MF_FLOAT) && (ld->flags & ML_BLOCK_FLOATERS))
-							&& (!(ld->flags & ML_3DMIDTEX) ||
-								(!P_LineOpening_3dMidtex(mobj, ld, open) &&
-									(mobj->Top() < open.top)
-								) || (open.abovemidtex && mobj->Z() > mobj->floorz))
-							)
-						{
-							// [BL] We can't just continue here since we must
-							// determine if the line's backsector is going to
-							// be blocked.
-							performBlockingThrust = false;
-						}
-						else
-						{
-							performBlockingThrust = true;
-						}
-
-						DVector2 pos = mobj->PosRelative(ld);
-						FBoundingBox box(pos.X, pos.Y, mobj->radius);
-
-						if (!box.inRange(ld) || box.BoxOnLineSide(ld) != -1)
-						{
-							continue;
-						}
-
-						if (ld->isLinePortal())
-						{
-							// Fixme: this still needs to figure out if the polyobject move made the player cross the portal line.
-							if (P_TryMove(mobj, mobj->Pos(), false))
-							{
-								continue;
-							}
-						}
-						// We have a two-sided linedef so we should only check one side
-						// so that the thrust from both sides doesn't cancel each other out.
-						// Best use the one facing the player and ignore the back side.
-						if (ld->sidedef[1] != NULL)
-						{
-							int side = P_PointOnLineSidePrecise(mobj->Pos(), ld);
-							if (ld->sidedef[side] != sd)
-							{
-								continue;
-							}
-							// [BL] See if we hit below the floor/ceiling of the poly.
-							else if(!performBlockingThrust && (
-									mobj->Z() < ld->sidedef[!side]->sector->GetSecPlane(sector_t::floor).ZatPoint(mobj) ||
-									mobj->Top() > ld->sidedef[!side]->sector->GetSecPlane(sector_t::ceiling).ZatPoint(mobj)
-								))
-							{
-								performBlockingThrust = true;
-							}
-						}
-
-						if(performBlockingThrust)
-						{
-							ThrustMobj (mobj, sd);
-							blocked = true;
-						}
-						else
-							continue;
-					}
+					continue;
+				}
+				// [BL] See if we hit below the floor/ceiling of the poly.
+				else if(!performBlockingThrust && (
+						mobj->Z() < ld->sidedef[!side]->sector->GetSecPlane(sector_t::floor).ZatPoint(mobj) ||
+						mobj->Top() > ld->sidedef[!side]->sector->GetSecPlane(sector_t::ceiling).ZatPoint(mobj)
+					))
+				{
+					performBlockingThrust = true;
 				}
 			}
+
+			if(performBlockingThrust)
+			{
+				ThrustMobj (mobj, sd);
+				blocked = true;
+			}
+			else
+				continue;
 		}
 	}
 	return blocked;
@@ -21,6 +21,7 @@
 */
 
 #include <stddef.h>
+#include <float.h>
 #include "templates.h"
 #include "doomdef.h"
 #include "i_system.h"
@@ -34,6 +35,7 @@
 #include "v_palette.h"
 #include "r_data/colormaps.h"
 #include "poly_buffer.h"
+#include "poly_draw_args.h"
 #include "screen_triangle.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -52,6 +54,164 @@ void PolyZBuffer::Resize(int newwidth, int newheight)
 	values.resize(count * 64);
 }
 
+void PolyZBuffer::Clear(float value)
+{
+	std::fill(values.begin(), values.end(), value);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+PolyHiZBuffer *PolyHiZBuffer::Instance()
+{
+	static PolyHiZBuffer buffer;
+	return &buffer;
+}
+
+void PolyHiZBuffer::Update(int x, int y, int width, int height, DCanvas *canvas)
+{
+	// Same viewport mapping as PolyTriangleDrawer::SetViewport
+	int dest_width = canvas->GetWidth();
+	int dest_height = canvas->GetHeight();
+	int offsetx = clamp(x, 0, dest_width);
+	int offsety = clamp(y, 0, dest_height);
+	viewport_x = x - offsetx;
+	viewport_y = y - offsety;
+	viewport_width = width;
+	viewport_height = height;
+	clip_width = clamp(viewport_x + viewport_width, 0, dest_width - offsetx);
+	clip_height = clamp(viewport_y + viewport_height, 0, dest_height - offsety);
+
+	PolyZBuffer *zbuffer = PolyZBuffer::Instance();
+	int zbufferPitch = zbuffer->BlockWidth();
+	const float *zvalues = zbuffer->Values();
+
+	// Level 0 is one cell per 8x8 depth block
+	int blockwidth = MIN((clip_width + 7) / 8, zbufferPitch);
+	int blockheight = MIN((clip_height + 7) / 8, zbuffer->BlockHeight());
+
+	int numlevels = 1;
+	for (int w = blockwidth, h = blockheight; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2)
+		numlevels++;
+	levels.resize(numlevels);
+
+	Level &level0 = levels[0];
+	level0.width = blockwidth;
+	level0.height = blockheight;
+	level0.values.resize(blockwidth * blockheight);
+	for (int by = 0; by < blockheight; by++)
+	{
+		for (int bx = 0; bx < blockwidth; bx++)
+		{
+			const float *depth = zvalues + (bx + by * zbufferPitch) * 64;
+			float farthest = depth[0];
+			for (int i = 1; i < 64; i++)
+				farthest = MIN(farthest, depth[i]);
+			level0.values[bx + by * blockwidth] = farthest;
+		}
+	}
+
+	for (int i = 1; i < numlevels; i++)
+	{
+		const Level &src = levels[i - 1];
+		Level &dest = levels[i];
+		dest.width = (src.width + 1) / 2;
+		dest.height = (src.height + 1) / 2;
+		dest.values.resize(dest.width * dest.height);
+		for (int cy = 0; cy < dest.height; cy++)
+		{
+			int y0 = cy * 2;
+			int y1 = MIN(y0 + 1, src.height - 1);
+			for (int cx = 0; cx < dest.width; cx++)
+			{
+				int x0 = cx * 2;
+				int x1 = MIN(x0 + 1, src.width - 1);
+				float a = MIN(src.values[x0 + y0 * src.width], src.values[x1 + y0 * src.width]);
+				float b = MIN(src.values[x0 + y1 * src.width], src.values[x1 + y1 * src.width]);
+				dest.values[cx + cy * dest.width] = MIN(a, b);
+			}
+		}
+	}
+}
+
+bool PolyHiZBuffer::IsOccluded(const Mat4f &objectToClip, const TriVertex *vertices, int count) const
+{
+	Vec4f clippos[8];
+	if (count > 8)
+		return false;
+
+	for (int i = 0; i < count; i++)
+		clippos[i] = objectToClip * Vec4f(vertices[i].x, vertices[i].y, vertices[i].z, vertices[i].w);
+	return IsOccluded(clippos, count);
+}
+
+bool PolyHiZBuffer::IsOccluded(const Mat4f &objectToClip, const Vec3f &bboxMin, const Vec3f &bboxMax) const
+{
+	Vec4f clippos[8];
+	for (int i = 0; i < 8; i++)
+	{
+		Vec4f corner((i & 1) ? bboxMax.X : bboxMin.X, (i & 2) ? bboxMax.Y : bboxMin.Y, (i & 4) ? bboxMax.Z : bboxMin.Z, 1.0f);
+		clippos[i] = objectToClip * corner;
+	}
+	return IsOccluded(clippos, 8);
+}
+
+bool PolyHiZBuffer::IsOccluded(const Vec4f *clippos, int count) const
+{
+	if (levels.empty())
+		return false;
+
+	// Anything crossing the near plane (5.0 in Mat4f::Perspective) is treated as visible
+	const float nearW = 5.0f;
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearestW = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		const Vec4f &v = clippos[i];
+		if (v.W < nearW)
+			return false;
+
+		float rcpW = 1.0f / v.W;
+		float sx = viewport_x + viewport_width * (1.0f + v.X * rcpW) * 0.5f;
+		float sy = viewport_y + viewport_height * (1.0f - v.Y * rcpW) * 0.5f;
+		minX = MIN(minX, sx);
+		maxX = MAX(maxX, sx);
+		minY = MIN(minY, sy);
+		maxY = MAX(maxY, sy);
+		nearestW = MAX(nearestW, rcpW);
+	}
+
+	// Leave frustum culling to the clipper
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)clip_width || minY >= (float)clip_height)
+		return false;
+
+	int x0 = clamp((int)minX, 0, clip_width - 1) >> 3;
+	int x1 = clamp((int)maxX, 0, clip_width - 1) >> 3;
+	int y0 = clamp((int)minY, 0, clip_height - 1) >> 3;
+	int y1 = clamp((int)maxY, 0, clip_height - 1) >> 3;
+
+	// Pick the level where the rectangle covers at most 4x4 cells
+	int lvl = 0;
+	while (lvl + 1 < (int)levels.size() && ((x1 >> lvl) - (x0 >> lvl) > 3 || (y1 >> lvl) - (y0 >> lvl) > 3))
+		lvl++;
+
+	const Level &level = levels[lvl];
+	int cx0 = MIN(x0 >> lvl, level.width - 1);
+	int cx1 = MIN(x1 >> lvl, level.width - 1);
+	int cy0 = MIN(y0 >> lvl, level.height - 1);
+	int cy1 = MIN(y1 >> lvl, level.height - 1);
+	for (int cy = cy0; cy <= cy1; cy++)
+	{
+		for (int cx = cx0; cx <= cx1; cx++)
+		{
+			// Same comparison as the depth test in ScreenTriangle
+			if (level.values[cx + cy * level.width] <= nearestW)
+				return false;
+		}
+	}
+	return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolyStencilBuffer *PolyStencilBuffer::Instance()
@@ -23,8 +23,10 @@
 #pragma once
 
 #include <vector>
+#include "polyrenderer/math/gpu_types.h"
 
 struct TriVertex;
+class DCanvas;
 
 class PolyZBuffer
 {
@@ -36,6 +38,7 @@ public:
 	int BlockWidth() const { return (width + 7) / 8; }
 	int BlockHeight() const { return (height + 7) / 8; }
 	float *Values() { return values.data(); }
+	void Clear(float value);
 
 private:
 	int width;
@@ -43,6 +46,41 @@ private:
 	std::vector<float> values;
 };
 
+// Hierarchical min-depth pyramid built from the depth buffer after the opaque pass.
+// Each cell holds the farthest 1/w value of the pixels below it.
+class PolyHiZBuffer
+{
+public:
+	static PolyHiZBuffer *Instance();
+
+	// Builds the pyramid for the viewport. All drawer threads must be idle when this is called.
+	void Update(int x, int y, int width, int height, DCanvas *canvas);
+
+	// Returns true if the vertices are hidden behind everything already in the depth buffer
+	bool IsOccluded(const Mat4f &objectToClip, const TriVertex *vertices, int count) const;
+
+	// Returns true if the object space bounding box is hidden behind everything already in the depth buffer
+	bool IsOccluded(const Mat4f &objectToClip, const Vec3f &bboxMin, const Vec3f &bboxMax) const;
+
+private:
+	bool IsOccluded(const Vec4f *clippos, int count) const;
+
+	struct Level
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<float> values;
+	};
+
+	std::vector<Level> levels;
+	int viewport_x = 0;
+	int viewport_y = 0;
+	int viewport_width = 0;
+	int viewport_height = 0;
+	int clip_width = 0;
+	int clip_height = 0;
+};
+
 class PolyStencilBuffer
 {
 public:
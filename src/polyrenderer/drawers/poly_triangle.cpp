@@ -107,27 +107,19 @@ void PolyTriangleThreadData::SetTransform(const Mat4f *newObjectToClip)
 	objectToClip = newObjectToClip;
 }
 
-void PolyTriangleThreadData::DrawElements(const PolyDrawArgs &drawargs)
+void PolyTriangleThreadData::SetupTriangles(const PolyDrawArgs &drawargs, std::vector<PolySetupTriangle> &triangles)
 {
-	if (drawargs.VertexCount() < 3)
+	int vcount = drawargs.VertexCount();
+	if (vcount < 3)
 		return;
 
-	TriDrawTriangleArgs args;
-	args.dest = dest;
-	args.pitch = dest_pitch;
-	args.clipright = dest_width;
-	args.clipbottom = dest_height;
-	args.uniforms = &drawargs;
-	args.destBgra = dest_bgra;
-	args.stencilPitch = PolyStencilBuffer::Instance()->BlockWidth();
-	args.stencilValues = PolyStencilBuffer::Instance()->Values();
-	args.stencilMasks = PolyStencilBuffer::Instance()->Masks();
-	args.zbuffer = PolyZBuffer::Instance()->Values();
-	args.depthOffset = weaponScene ? 1.0f : 0.0f;
-
 	const TriVertex *vinput = drawargs.Vertices();
 	const unsigned int *elements = drawargs.Elements();
-	int vcount = drawargs.VertexCount();
+
+	triangles.reserve(vcount);
+
+	// Fetch the vertex through the element list, if there is one
+	auto fetch = [&](int index) -> const TriVertex & { return elements ? vinput[elements[index]] : vinput[index]; };
 
 	ShadedTriVertex vert[3];
 	if (drawargs.DrawMode() == PolyDrawMode::Triangles)
@@ -135,30 +127,30 @@ void PolyTriangleThreadData::DrawElements(const PolyDrawArgs &drawargs)
 		for (int i = 0; i < vcount / 3; i++)
 		{
 			for (int j = 0; j < 3; j++)
-				vert[j] = ShadeVertex(drawargs, vinput[*(elements++)]);
-			DrawShadedTriangle(vert, ccw, &args);
+				vert[j] = ShadeVertex(drawargs, fetch(i * 3 + j));
+			SetupShadedTriangle(vert, ccw, drawargs, triangles);
 		}
 	}
 	else if (drawargs.DrawMode() == PolyDrawMode::TriangleFan)
 	{
-		vert[0] = ShadeVertex(drawargs, vinput[*(elements++)]);
-		vert[1] = ShadeVertex(drawargs, vinput[*(elements++)]);
+		vert[0] = ShadeVertex(drawargs, fetch(0));
+		vert[1] = ShadeVertex(drawargs, fetch(1));
 		for (int i = 2; i < vcount; i++)
 		{
-			vert[2] = ShadeVertex(drawargs, vinput[*(elements++)]);
-			DrawShadedTriangle(vert, ccw, &args);
+			vert[2] = ShadeVertex(drawargs, fetch(i));
+			SetupShadedTriangle(vert, ccw, drawargs, triangles);
 			vert[1] = vert[2];
 		}
 	}
 	else // TriangleDrawMode::TriangleStrip
 	{
 		bool toggleccw = ccw;
-		vert[0] = ShadeVertex(drawargs, vinput[*(elements++)]);
-		vert[1] = ShadeVertex(drawargs, vinput[*(elements++)]);
+		vert[0] = ShadeVertex(drawargs, fetch(0));
+		vert[1] = ShadeVertex(drawargs, fetch(1));
 		for (int i = 2; i < vcount; i++)
 		{
-			vert[2] = ShadeVertex(drawargs, vinput[*(elements++)]);
-			DrawShadedTriangle(vert, toggleccw, &args);
+			vert[2] = ShadeVertex(drawargs, fetch(i));
+			SetupShadedTriangle(vert, toggleccw, drawargs, triangles);
 			vert[0] = vert[1];
 			vert[1] = vert[2];
 			toggleccw = !toggleccw;
@@ -166,11 +158,8 @@ void PolyTriangleThreadData::DrawElements(const PolyDrawArgs &drawargs)
 	}
 }
 
-void PolyTriangleThreadData::DrawArrays(const PolyDrawArgs &drawargs)
+void PolyTriangleThreadData::DrawTriangles(const PolyDrawArgs &drawargs, std::vector<PolySetupTriangle> &triangles)
 {
-	if (drawargs.VertexCount() < 3)
-		return;
-
 	TriDrawTriangleArgs args;
 	args.dest = dest;
 	args.pitch = dest_pitch;
@@ -184,46 +173,45 @@ void PolyTriangleThreadData::DrawArrays(const PolyDrawArgs &drawargs)
 	args.zbuffer = PolyZBuffer::Instance()->Values();
 	args.depthOffset = weaponScene ? 1.0f : 0.0f;
 
-	const TriVertex *vinput = drawargs.Vertices();
-	int vcount = drawargs.VertexCount();
+	uint64_t coreBit = (num_cores > 64) ? ~(uint64_t)0 : (uint64_t)1 << core;
 
-	ShadedTriVertex vert[3];
-	if (drawargs.DrawMode() == PolyDrawMode::Triangles)
-	{
-		for (int i = 0; i < vcount / 3; i++)
-		{
-			for (int j = 0; j < 3; j++)
-				vert[j] = ShadeVertex(drawargs, *(vinput++));
-			DrawShadedTriangle(vert, ccw, &args);
-		}
-	}
-	else if (drawargs.DrawMode() == PolyDrawMode::TriangleFan)
+	for (auto &triangle : triangles)
 	{
-		vert[0] = ShadeVertex(drawargs, *(vinput++));
-		vert[1] = ShadeVertex(drawargs, *(vinput++));
-		for (int i = 2; i < vcount; i++)
-		{
-			vert[2] = ShadeVertex(drawargs, *(vinput++));
-			DrawShadedTriangle(vert, ccw, &args);
-			vert[1] = vert[2];
-		}
-	}
-	else // TriangleDrawMode::TriangleStrip
-	{
-		bool toggleccw = ccw;
-		vert[0] = ShadeVertex(drawargs, *(vinput++));
-		vert[1] = ShadeVertex(drawargs, *(vinput++));
-		for (int i = 2; i < vcount; i++)
-		{
-			vert[2] = ShadeVertex(drawargs, *(vinput++));
-			DrawShadedTriangle(vert, toggleccw, &args);
-			vert[0] = vert[1];
-			vert[1] = vert[2];
-			toggleccw = !toggleccw;
-		}
+		// Skip triangles not touching any of the lines this thread renders
+		if (!(triangle.coreMask & coreBit))
+			continue;
+
+		args.v1 = &triangle.vertices[0];
+		args.v2 = &triangle.vertices[1];
+		args.v3 = &triangle.vertices[2];
+		args.gradientX = triangle.gradientX;
+		args.gradientY = triangle.gradientY;
+
+		if (!span_drawers)
+			ScreenTriangle::Draw(&args, this);
+		else
+			ScreenTriangle::DrawSWRender(&args, this);
 	}
 }
 
+uint64_t PolyTriangleThreadData::GetCoreMask(float miny, float maxy) const
+{
+	if (num_cores > 64)
+		return ~(uint64_t)0;
+
+	// Poly drawers split the work in 8 line blocks, the span drawers in single lines
+	int shift = span_drawers ? 0 : 3;
+	int y0 = clamp((int)miny, 0, MAX(dest_height - 1, 0)) >> shift;
+	int y1 = clamp((int)maxy + 1, 0, MAX(dest_height - 1, 0)) >> shift;
+	if (y1 - y0 + 1 >= num_cores)
+		return num_cores == 64 ? ~(uint64_t)0 : ((uint64_t)1 << num_cores) - 1;
+
+	uint64_t mask = 0;
+	for (int y = y0; y <= y1; y++)
+		mask |= (uint64_t)1 << (y % num_cores);
+	return mask;
+}
+
 ShadedTriVertex PolyTriangleThreadData::ShadeVertex(const PolyDrawArgs &drawargs, const TriVertex &v)
 {
 	// Apply transform to get clip coordinates:
@@ -275,7 +263,7 @@ bool PolyTriangleThreadData::IsFrontfacing(TriDrawTriangleArgs *args)
 	return a <= 0.0f;
 }
 
-void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, bool ccw, TriDrawTriangleArgs *args)
+void PolyTriangleThreadData::SetupShadedTriangle(const ShadedTriVertex *vert, bool ccw, const PolyDrawArgs &drawargs, std::vector<PolySetupTriangle> &triangles)
 {
 	// Reject triangle if degenerate
 	if (IsDegenerate(vert))
@@ -337,7 +325,7 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 
 	// Keep varyings in -128 to 128 range if possible
 	// But don't do this for the skycap mode since the V texture coordinate is used for blending
-	if (numclipvert > 0 && args->uniforms->BlendMode() != TriBlendMode::Skycap)
+	if (numclipvert > 0 && drawargs.BlendMode() != TriBlendMode::Skycap)
 	{
 		float newOriginU = floorf(clippedvert[0].u * 0.1f) * 10.0f;
 		float newOriginV = floorf(clippedvert[0].v * 0.1f) * 10.0f;
@@ -348,41 +336,56 @@ void PolyTriangleThreadData::DrawShadedTriangle(const ShadedTriVertex *vert, boo
 		}
 	}
 
-	// Draw screen triangles
+	// Bin the screen triangles
+	if (numclipvert < 3)
+		return;
+
+	float miny = clippedvert[0].y;
+	float maxy = clippedvert[0].y;
+	for (int i = 1; i < numclipvert; i++)
+	{
+		miny = MIN(miny, clippedvert[i].y);
+		maxy = MAX(maxy, clippedvert[i].y);
+	}
+	uint64_t coreMask = GetCoreMask(miny, maxy);
+
+	TriDrawTriangleArgs args;
 	if (ccw)
 	{
 		for (int i = numclipvert - 1; i > 1; i--)
 		{
-			args->v1 = &clippedvert[numclipvert - 1];
-			args->v2 = &clippedvert[i - 1];
-			args->v3 = &clippedvert[i - 2];
-			if (IsFrontfacing(args) == ccw && args->CalculateGradients())
-			{
-				if (!span_drawers)
-					ScreenTriangle::Draw(args, this);
-				else
-					ScreenTriangle::DrawSWRender(args, this);
-			}
+			args.v1 = &clippedvert[numclipvert - 1];
+			args.v2 = &clippedvert[i - 1];
+			args.v3 = &clippedvert[i - 2];
+			if (IsFrontfacing(&args) == ccw && args.CalculateGradients())
+				AddSetupTriangle(&args, coreMask, triangles);
 		}
 	}
 	else
 	{
 		for (int i = 2; i < numclipvert; i++)
 		{
-			args->v1 = &clippedvert[0];
-			args->v2 = &clippedvert[i - 1];
-			args->v3 = &clippedvert[i];
-			if (IsFrontfacing(args) != ccw && args->CalculateGradients())
-			{
-				if (!span_drawers)
-					ScreenTriangle::Draw(args, this);
-				else
-					ScreenTriangle::DrawSWRender(args, this);
-			}
+			args.v1 = &clippedvert[0];
+			args.v2 = &clippedvert[i - 1];
+			args.v3 = &clippedvert[i];
+			if (IsFrontfacing(&args) != ccw && args.CalculateGradients())
+				AddSetupTriangle(&args, coreMask, triangles);
 		}
 	}
 }
 
+void PolyTriangleThreadData::AddSetupTriangle(const TriDrawTriangleArgs *args, uint64_t coreMask, std::vector<PolySetupTriangle> &triangles)
+{
+	triangles.emplace_back();
+	PolySetupTriangle &triangle = triangles.back();
+	triangle.vertices[0] = *args->v1;
+	triangle.vertices[1] = *args->v2;
+	triangle.vertices[2] = *args->v3;
+	triangle.gradientX = args->gradientX;
+	triangle.gradientY = args->gradientY;
+	triangle.coreMask = coreMask;
+}
+
 int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *verts, ShadedTriVertex *clippedvert)
 {
 	// Clip and cull so that the following is true for all vertices:
@@ -557,6 +560,27 @@ int PolyTriangleThreadData::ClipEdge(const ShadedTriVertex *verts, ShadedTriVert
 	return inputverts;
 }
 
+PolySetupBuffer *PolyTriangleThreadData::AllocSetupBuffer()
+{
+	PolySetupBuffer *buffer = nullptr;
+	for (auto &b : setupBuffers)
+	{
+		if (b->readers.load(std::memory_order_acquire) == 0)
+		{
+			buffer = b.get();
+			break;
+		}
+	}
+	if (buffer == nullptr)
+	{
+		setupBuffers.push_back(std::unique_ptr<PolySetupBuffer>(new PolySetupBuffer()));
+		buffer = setupBuffers.back().get();
+	}
+	buffer->triangles.clear();
+	buffer->readers.store(num_cores, std::memory_order_relaxed);
+	return buffer;
+}
+
 PolyTriangleThreadData *PolyTriangleThreadData::Get(DrawerThread *thread)
 {
 	if (!thread->poly)
@@ -615,12 +639,38 @@ DrawPolyTrianglesCommand::DrawPolyTrianglesCommand(const PolyDrawArgs &args) : a
 {
 }
 
+DrawPolyTrianglesCommand::~DrawPolyTrianglesCommand()
+{
+	// All threads are done with the queue by now, including those r_debug_draw made skip this command
+	if (setup)
+		setup->readers.store(0, std::memory_order_release);
+}
+
 void DrawPolyTrianglesCommand::Execute(DrawerThread *thread)
 {
-	if (!args.Elements())
-		PolyTriangleThreadData::Get(thread)->DrawArrays(args);
-	else
-		PolyTriangleThreadData::Get(thread)->DrawElements(args);
+	PolyTriangleThreadData *poly = PolyTriangleThreadData::Get(thread);
+
+	// The first thread to reach the command transforms, clips and bins the triangles for all threads.
+	// Every thread sees the same viewport, transform and cull state at this point in the queue.
+	int expected = SetupPending;
+	if (setupState.compare_exchange_strong(expected, SetupRunning, std::memory_order_acquire))
+	{
+		setup = poly->AllocSetupBuffer();
+		poly->SetupTriangles(args, setup->triangles);
+
+		std::unique_lock<std::mutex> lock(setupMutex);
+		setupState.store(SetupDone, std::memory_order_release);
+		lock.unlock();
+		setupCondition.notify_all();
+	}
+	else if (setupState.load(std::memory_order_acquire) != SetupDone)
+	{
+		std::unique_lock<std::mutex> lock(setupMutex);
+		setupCondition.wait(lock, [&]() { return setupState.load(std::memory_order_acquire) == SetupDone; });
+	}
+
+	poly->DrawTriangles(args, setup->triangles);
+	setup->readers.fetch_sub(1, std::memory_order_release);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
 #include "swrenderer/drawers/r_draw.h"
 #include "swrenderer/drawers/r_thread.h"
 #include "polyrenderer/drawers/screen_triangle.h"
@@ -29,6 +35,28 @@
 #include "polyrenderer/drawers/poly_buffer.h"
 #include "polyrenderer/drawers/poly_draw_args.h"
 
+// Triangle transformed, clipped and mapped to the viewport, ready to be rasterized
+struct PolySetupTriangle
+{
+	ShadedTriVertex vertices[3];
+	ScreenTriangleStepVariables gradientX;
+	ScreenTriangleStepVariables gradientY;
+
+	// Bit N is set if thread N renders any of the lines covered by the triangle
+	uint64_t coreMask;
+};
+
+// The set up triangles of one draw call, shared by all drawer threads
+struct PolySetupBuffer
+{
+	std::vector<PolySetupTriangle> triangles;
+
+	// Threads that still have to draw from the buffer. It can be reused at 0.
+	// Threads that skip the command never count down, so the command also
+	// releases the buffer when it is destroyed after the queue has finished.
+	std::atomic<int> readers { 0 };
+};
+
 class PolyTriangleDrawer
 {
 public:
@@ -49,8 +77,14 @@ public:
 	void SetCullCCW(bool value) { ccw = value; }
 	void SetWeaponScene(bool value) { weaponScene = value; }
 
-	void DrawElements(const PolyDrawArgs &args);
-	void DrawArrays(const PolyDrawArgs &args);
+	// Front end: transform, clip and bin the triangles of a draw call
+	void SetupTriangles(const PolyDrawArgs &args, std::vector<PolySetupTriangle> &triangles);
+
+	// Back end: rasterize the binned triangles that cover lines rendered by this thread
+	void DrawTriangles(const PolyDrawArgs &args, std::vector<PolySetupTriangle> &triangles);
+
+	// Returns an empty setup buffer owned by this thread that no thread is drawing from anymore
+	PolySetupBuffer *AllocSetupBuffer();
 
 	int32_t core;
 	int32_t num_cores;
@@ -66,7 +100,9 @@ public:
 
 private:
 	ShadedTriVertex ShadeVertex(const PolyDrawArgs &drawargs, const TriVertex &v);
-	void DrawShadedTriangle(const ShadedTriVertex *vertices, bool ccw, TriDrawTriangleArgs *args);
+	void SetupShadedTriangle(const ShadedTriVertex *vertices, bool ccw, const PolyDrawArgs &drawargs, std::vector<PolySetupTriangle> &triangles);
+	void AddSetupTriangle(const TriDrawTriangleArgs *args, uint64_t coreMask, std::vector<PolySetupTriangle> &triangles);
+	uint64_t GetCoreMask(float miny, float maxy) const;
 	static bool IsDegenerate(const ShadedTriVertex *vertices);
 	static bool IsFrontfacing(TriDrawTriangleArgs *args);
 	static int ClipEdge(const ShadedTriVertex *verts, ShadedTriVertex *clippedvert);
@@ -85,6 +121,9 @@ private:
 	const Mat4f *objectToClip = nullptr;
 	bool span_drawers = false;
 
+	// Kept from frame to frame. A new one is only needed when the other threads fall far behind.
+	std::vector<std::unique_ptr<PolySetupBuffer>> setupBuffers;
+
 	enum { max_additional_vertices = 16 };
 };
 
@@ -149,12 +188,21 @@ class DrawPolyTrianglesCommand : public DrawerCommand
 {
 public:
 	DrawPolyTrianglesCommand(const PolyDrawArgs &args);
+	~DrawPolyTrianglesCommand();
 
 	void Execute(DrawerThread *thread) override;
 	FString DebugInfo() override { return "DrawPolyTriangles"; }
 
 private:
+	enum { SetupPending, SetupRunning, SetupDone };
+
 	PolyDrawArgs args;
+	PolySetupBuffer *setup = nullptr;
+	std::atomic<int> setupState { SetupPending };
+
+	// Only the threads waiting for this command's setup are woken
+	std::mutex setupMutex;
+	std::condition_variable setupCondition;
 };
 
 class DrawRectCommand : public DrawerCommand
@@ -42,6 +42,8 @@
 EXTERN_CVAR(Int, screenblocks)
 EXTERN_CVAR(Float, r_visibility)
 
+CVAR(Bool, r_poly_hiz, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 /////////////////////////////////////////////////////////////////////////////
 
 PolyRenderer *PolyRenderer::Instance()
@@ -114,6 +116,7 @@ void PolyRenderer::RenderActorView(AActor *actor, bool dontmaplines)
 	PolyTotalBatches = 0;
 	PolyTotalTriangles = 0;
 	PolyTotalDrawCalls = 0;
+	PolyTotalOccluded = 0;
 	PolyCullCycles.Reset();
 	PolyOpaqueCycles.Reset();
 	PolyMaskedCycles.Reset();
@@ -182,6 +185,8 @@ void PolyRenderer::ClearBuffers()
 {
 	Threads.Clear();
 	PolyTriangleDrawer::ClearBuffers(RenderTarget);
+	if (r_poly_hiz) // The hi-Z buffer needs untouched pixels to be at the far plane
+		PolyZBuffer::Instance()->Clear(0.0f);
 	NextStencilValue = 0;
 	Threads.MainThread()->SectorPortals.clear();
 	Threads.MainThread()->LinePortals.clear();
@@ -201,12 +206,30 @@ void PolyRenderer::SetSceneViewport()
 			height = (screenblocks*SCREENHEIGHT / 10) & ~7;
 
 		int bottom = SCREENHEIGHT - (height + viewwindowy - ((height - viewheight) / 2));
-		PolyTriangleDrawer::SetViewport(Threads.MainThread()->DrawQueue, viewwindowx, SCREENHEIGHT - bottom - height, viewwidth, height, RenderTarget, false);
+		SceneViewportX = viewwindowx;
+		SceneViewportY = SCREENHEIGHT - bottom - height;
+		SceneViewportWidth = viewwidth;
+		SceneViewportHeight = height;
 	}
 	else // Rendering to camera texture
 	{
-		PolyTriangleDrawer::SetViewport(Threads.MainThread()->DrawQueue, 0, 0, RenderTarget->GetWidth(), RenderTarget->GetHeight(), RenderTarget, false);
+		SceneViewportX = 0;
+		SceneViewportY = 0;
+		SceneViewportWidth = RenderTarget->GetWidth();
+		SceneViewportHeight = RenderTarget->GetHeight();
 	}
+
+	PolyTriangleDrawer::SetViewport(Threads.MainThread()->DrawQueue, SceneViewportX, SceneViewportY, SceneViewportWidth, SceneViewportHeight, RenderTarget, false);
+}
+
+void PolyRenderer::UpdateHiZBuffer()
+{
+	Threads.MainThread()->FlushDrawQueue();
+	PolyDrawerWaitCycles.Clock();
+	DrawerThreads::WaitForWorkers();
+	PolyDrawerWaitCycles.Unclock();
+
+	PolyHiZBuffer::Instance()->Update(SceneViewportX, SceneViewportY, SceneViewportWidth, SceneViewportHeight, RenderTarget);
 }
 
 PolyPortalViewpoint PolyRenderer::SetupPerspectiveMatrix(bool mirror)
@@ -245,13 +268,13 @@ PolyPortalViewpoint PolyRenderer::SetupPerspectiveMatrix(bool mirror)
 }
 
 cycle_t PolyCullCycles, PolyOpaqueCycles, PolyMaskedCycles, PolyDrawerWaitCycles;
-int PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls;
+int PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls, PolyTotalOccluded;
 
 ADD_STAT(polyfps)
 {
 	FString out;
 	out.Format("frame=%04.1f ms  cull=%04.1f ms  opaque=%04.1f ms  masked=%04.1f ms  drawers=%04.1f ms",
 		FrameCycles.TimeMS(), PolyCullCycles.TimeMS(), PolyOpaqueCycles.TimeMS(), PolyMaskedCycles.TimeMS(), PolyDrawerWaitCycles.TimeMS());
-	out.AppendFormat("\nbatches drawn: %d  triangles drawn: %d  drawcalls: %d", PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls);
+	out.AppendFormat("\nbatches drawn: %d  triangles drawn: %d  drawcalls: %d  occluded: %d", PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls, PolyTotalOccluded);
 	return out;
 }
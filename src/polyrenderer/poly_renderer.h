@@ -42,7 +42,7 @@ class DrawerCommandQueue;
 typedef std::shared_ptr<DrawerCommandQueue> DrawerCommandQueuePtr;
 
 extern cycle_t PolyCullCycles, PolyOpaqueCycles, PolyMaskedCycles, PolyDrawerWaitCycles;
-extern int PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls;
+extern int PolyTotalBatches, PolyTotalTriangles, PolyTotalDrawCalls, PolyTotalOccluded;
 
 class PolyRenderer
 {
@@ -59,6 +59,9 @@ public:
 
 	uint32_t GetNextStencilValue() { uint32_t value = NextStencilValue; NextStencilValue += 2; return value; }
 
+	// Waits for the drawers to finish the queued commands and builds the hi-Z buffer from the depth buffer
+	void UpdateHiZBuffer();
+
 	bool DontMapLines = false;
 	
 	PolyRenderThreads Threads;
@@ -76,4 +79,9 @@ private:
 
 	RenderPolyPlayerSprites PlayerSprites;
 	uint32_t NextStencilValue = 0;
+
+	int SceneViewportX = 0;
+	int SceneViewportY = 0;
+	int SceneViewportWidth = 0;
+	int SceneViewportHeight = 0;
 };
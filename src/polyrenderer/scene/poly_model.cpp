@@ -21,6 +21,7 @@
 */
 
 #include <stdlib.h>
+#include <float.h>
 #include "templates.h"
 #include "doomdef.h"
 #include "sbar.h"
@@ -64,11 +65,13 @@ void PolyModelRenderer::BeginDrawModel(AActor *actor, FSpriteModelFrame *smf, co
 	ModelActor = actor;
 	const_cast<VSMatrix &>(objectToWorldMatrix).copy(ObjectToWorld.Matrix);
 	SetTransform();
+	HiZCulling = PolyRenderer::Instance()->Scene.CurrentViewpoint->HiZCulling;
 }
 
 void PolyModelRenderer::EndDrawModel(AActor *actor, FSpriteModelFrame *smf)
 {
 	ModelActor = nullptr;
+	HiZCulling = false;
 }
 
 IModelVertexBuffer *PolyModelRenderer::CreateVertexBuffer(bool needindex, bool singleframe)
@@ -135,8 +138,29 @@ void PolyModelRenderer::SetTransform()
 	PolyTriangleDrawer::SetTransform(Thread->DrawQueue, Thread->FrameMemory->NewObject<Mat4f>(WorldToClip * swapYZ * ObjectToWorld));
 }
 
+bool PolyModelRenderer::IsOccluded()
+{
+	if (!HiZCulling)
+		return false;
+
+	Mat4f swapYZ = Mat4f::Null();
+	swapYZ.Matrix[0 + 0 * 4] = 1.0f;
+	swapYZ.Matrix[1 + 2 * 4] = 1.0f;
+	swapYZ.Matrix[2 + 1 * 4] = 1.0f;
+	swapYZ.Matrix[3 + 3 * 4] = 1.0f;
+
+	if (!PolyHiZBuffer::Instance()->IsOccluded(WorldToClip * swapYZ * ObjectToWorld, BBoxMin, BBoxMax))
+		return false;
+
+	PolyTotalOccluded++;
+	return true;
+}
+
 void PolyModelRenderer::DrawArrays(int start, int count)
 {
+	if (IsOccluded())
+		return;
+
 	const auto &viewpoint = PolyRenderer::Instance()->Viewpoint;
 
 	bool foggy = false;
@@ -160,6 +184,9 @@ void PolyModelRenderer::DrawArrays(int start, int count)
 
 void PolyModelRenderer::DrawElements(int numIndices, size_t offset)
 {
+	if (IsOccluded())
+		return;
+
 	const auto &viewpoint = PolyRenderer::Instance()->Viewpoint;
 
 	bool foggy = false;
@@ -215,6 +242,9 @@ void PolyModelVertexBuffer::SetupFrame(FModelRenderer *renderer, unsigned int fr
 {
 	PolyModelRenderer *polyrenderer = (PolyModelRenderer *)renderer;
 
+	Vec3f bboxMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3f bboxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
 	if (frame1 == frame2 || size == 0 || polyrenderer->InterpolationFactor == 0.f)
 	{
 		TriVertex *vertices = polyrenderer->Thread->FrameMemory->AllocMemory<TriVertex>(size);
@@ -230,6 +260,8 @@ void PolyModelVertexBuffer::SetupFrame(FModelRenderer *renderer, unsigned int fr
 				mVertexBuffer[frame1 + i].u,
 				mVertexBuffer[frame1 + i].v
 			};
+			bboxMin = { MIN(bboxMin.X, vertices[i].x), MIN(bboxMin.Y, vertices[i].y), MIN(bboxMin.Z, vertices[i].z) };
+			bboxMax = { MAX(bboxMax.X, vertices[i].x), MAX(bboxMax.Y, vertices[i].y), MAX(bboxMax.Z, vertices[i].z) };
 		}
 
 		polyrenderer->VertexBuffer = vertices;
@@ -249,9 +281,14 @@ void PolyModelVertexBuffer::SetupFrame(FModelRenderer *renderer, unsigned int fr
 			vertices[i].w = 1.0f;
 			vertices[i].u = mVertexBuffer[frame1 + i].u;
 			vertices[i].v = mVertexBuffer[frame1 + i].v;
+			bboxMin = { MIN(bboxMin.X, vertices[i].x), MIN(bboxMin.Y, vertices[i].y), MIN(bboxMin.Z, vertices[i].z) };
+			bboxMax = { MAX(bboxMax.X, vertices[i].x), MAX(bboxMax.Y, vertices[i].y), MAX(bboxMax.Z, vertices[i].z) };
 		}
 
 		polyrenderer->VertexBuffer = vertices;
 		polyrenderer->IndexBuffer = &mIndexBuffer[0];
 	}
+
+	polyrenderer->BBoxMin = bboxMin;
+	polyrenderer->BBoxMax = bboxMax;
 }
@@ -48,6 +48,7 @@ public:
 	void DrawElements(int numIndices, size_t offset) override;
 
 	void SetTransform();
+	bool IsOccluded();
 
 	PolyRenderThread *Thread = nullptr;
 	const Mat4f &WorldToClip;
@@ -59,6 +60,11 @@ public:
 	unsigned int *IndexBuffer = nullptr;
 	TriVertex *VertexBuffer = nullptr;
 	float InterpolationFactor = 0.0;
+
+	// Object space bounds of VertexBuffer
+	Vec3f BBoxMin;
+	Vec3f BBoxMax;
+	bool HiZCulling = false;
 };
 
 class PolyModelVertexBuffer : public IModelVertexBuffer
@@ -36,6 +36,7 @@
 #include "polyrenderer/scene/poly_sprite.h"
 
 EXTERN_CVAR(Int, r_portal_recursions)
+EXTERN_CVAR(Bool, r_poly_hiz)
 
 /////////////////////////////////////////////////////////////////////////////
 
@@ -64,6 +65,13 @@ void RenderPolyScene::Render(PolyPortalViewpoint *viewpoint)
 
 	RenderSectors();
 
+	// Only the main view builds a hi-Z buffer. Portal views are drawn later with their own transforms.
+	if (r_poly_hiz && CurrentViewpoint->PortalDepth == 0)
+	{
+		PolyRenderer::Instance()->UpdateHiZBuffer();
+		CurrentViewpoint->HiZCulling = true;
+	}
+
 	PolyMaskedCycles.Clock();
 	const auto &rviewpoint = PolyRenderer::Instance()->Viewpoint;
 	for (uint32_t sectorIndex : Cull.SeenSectors)
@@ -180,10 +188,10 @@ void RenderPolyScene::RenderSubsector(PolyRenderThread *thread, subsector_t *sub
 
 	if (mainBSP)
 	{
-		int subsectorIndex = sub->Index();
-		for (int i = ParticlesInSubsec[subsectorIndex]; i != NO_PARTICLE; i = Particles[i].snext)
+		const FParticleSpan &span = ParticlesInSubsec[sub->Index()];
+		for (uint32_t i = span.First; i < span.First + span.Count; i++)
 		{
-			particle_t *particle = Particles + i;
+			particle_t *particle = &Particles[i];
 			thread->TranslucentObjects.push_back(thread->FrameMemory->NewObject<PolyTranslucentParticle>(particle, sub, subsectorDepth, CurrentViewpoint->StencilValue));
 		}
 	}
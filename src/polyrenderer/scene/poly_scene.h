@@ -63,6 +63,7 @@ public:
 	uint32_t StencilValue = 0;
 	int PortalDepth = 0;
 	bool Mirror = false;
+	bool HiZCulling = false;
 
 	line_t *PortalEnterLine = nullptr;
 	sector_t *PortalEnterSector = nullptr;
@@ -168,6 +168,14 @@ void RenderPolySprite::Render(PolyRenderThread *thread, AActor *thing, subsector
 	args.SetDepthTest(true);
 	args.SetWriteDepth(false);
 	args.SetWriteStencil(false);
+
+	const PolyPortalViewpoint *portalViewpoint = PolyRenderer::Instance()->Scene.CurrentViewpoint;
+	if (portalViewpoint->HiZCulling && PolyHiZBuffer::Instance()->IsOccluded(portalViewpoint->WorldToClip, vertices, 4))
+	{
+		PolyTotalOccluded++;
+		return;
+	}
+
 	args.DrawArray(thread->DrawQueue, vertices, 4, PolyDrawMode::TriangleFan);
 }
 
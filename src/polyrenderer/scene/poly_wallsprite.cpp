@@ -108,5 +108,13 @@ void RenderPolyWallSprite::Render(PolyRenderThread *thread, AActor *thing, subse
 	args.SetWriteDepth(false);
 	args.SetWriteStencil(false);
 	args.SetStyle(TriBlendMode::TextureMasked);
+
+	const PolyPortalViewpoint *portalViewpoint = PolyRenderer::Instance()->Scene.CurrentViewpoint;
+	if (portalViewpoint->HiZCulling && PolyHiZBuffer::Instance()->IsOccluded(portalViewpoint->WorldToClip, vertices, 4))
+	{
+		PolyTotalOccluded++;
+		return;
+	}
+
 	args.DrawArray(thread->DrawQueue, vertices, 4, PolyDrawMode::TriangleFan);
 }
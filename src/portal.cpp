@@ -49,6 +49,7 @@
 #include "p_maputl.h"
 #include "p_spec.h"
 #include "g_levellocals.h"
+#include "p_sightbatch.h"
 #include "vm.h"
 
 // simulation recurions maximum
@@ -168,7 +169,7 @@ void FLinePortalTraverse::AddLineIntercepts(int bx, int by)
 		double frac;
 		divline_t dl;
 
-		if (ld->validcount == validcount) continue;	// already processed
+		if (context.IsVisited(ld)) continue;	// already processed
 
 		if (P_PointOnDivlineSide (ld->v1->fPos(), &trace) ==
 			P_PointOnDivlineSide (ld->v2->fPos(), &trace))
@@ -468,6 +469,7 @@ static bool ChangePortalLine(line_t *line, int destid)
 		port->mFlags = port->mDefFlags;
 	}
 	SetRotation(port);
+	FSightBatch::GeometryChanged();
 	return true;
 }
 
@@ -1061,6 +1061,7 @@ public:
 	struct msecnode_t *touching_thinglist;				// phares 3/14/98
 	struct msecnode_t *sectorportal_thinglist;				// for cross-portal rendering.
 	struct msecnode_t *touching_renderthings; // this is used to allow wide things to be rendered not only from their main sector.
+	unsigned touching_changes;	// counts changes to touching_thinglist so that P_ChangeSector knows when to rescan it
 
 	double gravity;			// [RH] Sector gravity (1.0 is normal)
 	FNameNoInit damagetype;		// [RH] Means-of-death for applied damage
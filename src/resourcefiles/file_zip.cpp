@@ -50,7 +50,7 @@
 //
 //==========================================================================
 
-static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int LumpSize, int CompressedSize, int GPFlags)
+static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int LumpSize, int CompressedSize, int GPFlags, bool quiet = false)
 {
 	try
 	{
@@ -95,17 +95,17 @@ static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int L
 	}
 	catch (CRecoverableError &err)
 	{
-		Printf("%s\n", err.GetMessage());
+		if (!quiet) Printf("%s\n", err.GetMessage());
 		return false;
 	}
 	return true;
 }
 
-bool FCompressedBuffer::Decompress(char *destbuffer)
+bool FCompressedBuffer::Decompress(char *destbuffer, bool quiet)
 {
 	FileReader mr;
 	mr.OpenMemory(mBuffer, mCompressedSize);
-	return UncompressZipLump(destbuffer, mr, mMethod, mSize, mCompressedSize, mZipFlags);
+	return UncompressZipLump(destbuffer, mr, mMethod, mSize, mCompressedSize, mZipFlags, quiet);
 }
 
 //-----------------------------------------------------------------------
@@ -471,6 +471,17 @@ int FZipLump::GetFileOffset()
 	return Position;
 }
 
+//==========================================================================
+//
+// Only compressed lumps are worth decompressing ahead of time
+//
+//==========================================================================
+
+bool FZipLump::CanPrefetch()
+{
+	return Method != METHOD_STORED;
+}
+
 //==========================================================================
 //
 // File open
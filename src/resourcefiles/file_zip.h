@@ -24,6 +24,7 @@ struct FZipLump : public FResourceLump
 
 	virtual FileReader *GetReader();
 	virtual int FillCache();
+	virtual bool CanPrefetch();
 
 private:
 	void SetLumpAddress();
@@ -0,0 +1,387 @@
+/*
+** lumploader.cpp
+**
+** Background decompression of archive lumps
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <algorithm>
+#include "lumploader.h"
+#include "w_wad.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "stats.h"
+
+// Number of worker threads. 0 = one less than the number of cores.
+CVAR(Int, lump_decompress_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Limit for the decompressed size of all lumps that are queued or waiting to be claimed
+static const size_t MaxPendingBytes = 256 << 20;
+
+int FLumpLoader::Requested;
+int FLumpLoader::Claimed;
+int FLumpLoader::Dropped;
+std::atomic<int> FLumpLoader::ActiveRequests;
+
+ADD_STAT(lumploader)
+{
+	FString out;
+	out.Format("requested=%d  claimed=%d  dropped=%d  pending=%d", FLumpLoader::Requested, FLumpLoader::Claimed, FLumpLoader::Dropped, FLumpLoader::Requested - FLumpLoader::Claimed - FLumpLoader::Dropped);
+	return out;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FLumpRequest::~FLumpRequest()
+{
+	if (Result != nullptr) delete[] Result;
+	Raw.Clean();
+}
+
+void FLumpRequest::Wait()
+{
+	FLumpLoader::Instance()->WaitRequest(this);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FLumpLoader *FLumpLoader::Instance()
+{
+	static FLumpLoader loader;
+	return &loader;
+}
+
+FLumpLoader::~FLumpLoader()
+{
+	StopWorkers();
+
+	// Lumps can outlive the loader during shutdown
+	ActiveRequests = 0;
+	mRequests.clear();
+}
+
+//==========================================================================
+//
+// Registers a lump for decompression
+//
+//==========================================================================
+
+FLumpHandle FLumpLoader::Prefetch(int lumpnum, int priority)
+{
+	return Prefetch(Wads.GetLumpRecord(lumpnum), priority);
+}
+
+FLumpHandle FLumpLoader::Prefetch(FResourceLump *lump, int priority)
+{
+	if (lump == nullptr || lump->LumpSize <= 0 || lump->Cache != nullptr || !lump->CanPrefetch())
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mRequests.find(lump);
+	if (it != mRequests.end())
+		return it->second;
+
+	if (mPendingBytes + lump->LumpSize > MaxPendingBytes)
+		return nullptr;
+
+	FLumpHandle request = std::make_shared<FLumpRequest>();
+	request->Lump = lump;
+	request->Size = lump->LumpSize;
+	request->Priority = priority;
+	request->Sequence = mSequence++;
+	mRequests[lump] = request;
+	mPendingBytes += lump->LumpSize;
+	ActiveRequests++;
+	Requested++;
+
+	if (mBatchDepth > 0)
+	{
+		mBatch.push_back(request);
+	}
+	else
+	{
+		lock.unlock();
+		Submit(request);
+	}
+	return request;
+}
+
+//==========================================================================
+//
+// Reads the compressed data and hands the request to the workers
+//
+//==========================================================================
+
+void FLumpLoader::Submit(const FLumpHandle &request)
+{
+	FCompressedBuffer raw = request->Lump->GetRawData();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (request->State != FLumpRequest::Unread)
+	{
+		raw.Clean();
+		return;
+	}
+	request->Raw = raw;
+	request->State = FLumpRequest::Queued;
+	mQueue.push(request);
+	StartWorkers();
+	lock.unlock();
+	mWorkCondition.notify_one();
+}
+
+//==========================================================================
+//
+// Batches defer reading until all lumps are known so that each archive
+// can be read front to back.
+//
+//==========================================================================
+
+void FLumpLoader::BeginBatch()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mBatchDepth++;
+}
+
+void FLumpLoader::EndBatch()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (--mBatchDepth > 0)
+		return;
+
+	std::vector<FLumpHandle> batch;
+	batch.swap(mBatch);
+	lock.unlock();
+
+	// Lumps are stored in directory order, which usually is the order of their data
+	std::sort(batch.begin(), batch.end(), [](const FLumpHandle &a, const FLumpHandle &b)
+	{
+		return a->Lump->Owner != b->Lump->Owner ? a->Lump->Owner < b->Lump->Owner : a->Lump < b->Lump;
+	});
+
+	for (auto &request : batch)
+	{
+		if (request->State == FLumpRequest::Unread)
+			Submit(request);
+	}
+}
+
+//==========================================================================
+//
+// Returns the decompressed data for a prefetched lump. Ownership passes
+// to the caller.
+//
+//==========================================================================
+
+char *FLumpLoader::Claim(FResourceLump *lump)
+{
+	if (ActiveRequests.load(std::memory_order_relaxed) == 0)
+		return nullptr;
+	return Instance()->ClaimRequest(lump);
+}
+
+char *FLumpLoader::ClaimRequest(FResourceLump *lump)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mRequests.find(lump);
+	if (it == mRequests.end())
+		return nullptr;
+
+	FLumpHandle request = it->second;
+	Release(request);
+
+	if (request->State == FLumpRequest::Unread)
+	{
+		// Still inside a batch. Let the caller load it the normal way.
+		request->State = FLumpRequest::Cancelled;
+		Dropped++;
+		return nullptr;
+	}
+
+	if (request->State == FLumpRequest::Queued)
+	{
+		// Don't wait for the rest of the queue
+		request->State = FLumpRequest::Running;
+		lock.unlock();
+		request->Result = new char[request->Size];
+		request->Succeeded = request->Raw.Decompress(request->Result, true);
+		request->Raw.Clean();
+		lock.lock();
+		request->State = FLumpRequest::Done;
+		mDoneCondition.notify_all();
+	}
+	else
+	{
+		mDoneCondition.wait(lock, [&]() { return request->State == FLumpRequest::Done; });
+	}
+
+	if (!request->Succeeded)
+	{
+		// Let FillCache report the error
+		Dropped++;
+		return nullptr;
+	}
+
+	Claimed++;
+	char *result = request->Result;
+	request->Result = nullptr;
+	return result;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FLumpLoader::Cancel(FResourceLump *lump)
+{
+	if (ActiveRequests.load(std::memory_order_relaxed) == 0)
+		return;
+	Instance()->CancelRequest(lump);
+}
+
+void FLumpLoader::CancelRequest(FResourceLump *lump)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mRequests.find(lump);
+	if (it == mRequests.end())
+		return;
+
+	FLumpHandle request = it->second;
+	Release(request);
+	if (request->State == FLumpRequest::Unread || request->State == FLumpRequest::Queued)
+		request->State = FLumpRequest::Cancelled;
+	Dropped++;
+}
+
+void FLumpLoader::Flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	for (auto &it : mRequests)
+	{
+		auto &request = it.second;
+		if (request->State == FLumpRequest::Unread || request->State == FLumpRequest::Queued)
+			request->State = FLumpRequest::Cancelled;
+		Dropped++;
+	}
+	ActiveRequests -= (int)mRequests.size();
+	mRequests.clear();
+	mPendingBytes = 0;
+	mDoneCondition.notify_all();
+}
+
+// Removes a request from the lump map. The caller must hold the lock.
+void FLumpLoader::Release(const FLumpHandle &request)
+{
+	mRequests.erase(request->Lump);
+	mPendingBytes -= request->Size;
+	ActiveRequests--;
+}
+
+void FLumpLoader::WaitRequest(FLumpRequest *request)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [&]() { return request->State == FLumpRequest::Done || request->State == FLumpRequest::Cancelled; });
+}
+
+//==========================================================================
+//
+// Worker threads
+//
+//==========================================================================
+
+void FLumpLoader::StartWorkers()
+{
+	if (!mWorkers.empty())
+		return;
+
+	int count = lump_decompress_threads;
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency() - 1;
+	count = clamp(count, 1, 8);
+
+	mStopWorkers = false;
+	for (int i = 0; i < count; i++)
+		mWorkers.push_back(std::thread([=]() { WorkerMain(); }));
+}
+
+void FLumpLoader::StopWorkers()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStopWorkers = true;
+	lock.unlock();
+	mWorkCondition.notify_all();
+
+	for (auto &worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+void FLumpLoader::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWorkCondition.wait(lock, [&]() { return mStopWorkers || !mQueue.empty(); });
+		if (mStopWorkers)
+			break;
+
+		FLumpHandle request = mQueue.top();
+		mQueue.pop();
+		if (request->State != FLumpRequest::Queued)
+			continue;
+
+		request->State = FLumpRequest::Running;
+		lock.unlock();
+
+		request->Result = new char[request->Size];
+		request->Succeeded = request->Raw.Decompress(request->Result, true);
+		request->Raw.Clean();
+
+		lock.lock();
+		request->State = FLumpRequest::Done;
+		mDoneCondition.notify_all();
+	}
+}
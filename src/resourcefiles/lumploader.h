@@ -0,0 +1,166 @@
+/*
+** lumploader.h
+**
+** Background decompression of archive lumps
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __LUMPLOADER_H
+#define __LUMPLOADER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include "resourcefile.h"
+
+//==========================================================================
+//
+// Handle to a lump that is being decompressed in the background
+//
+//==========================================================================
+
+class FLumpRequest
+{
+public:
+	~FLumpRequest();
+
+	FResourceLump *GetLump() const { return Lump; }
+
+	// True once the worker is done with the lump
+	bool IsReady() const { return State == Done; }
+
+	// Blocks until the worker is done with the lump. Must not be called inside a batch.
+	void Wait();
+
+private:
+	enum
+	{
+		Unread,		// waiting for EndBatch to read the compressed data
+		Queued,
+		Running,
+		Done,
+		Cancelled
+	};
+
+	FResourceLump *Lump = nullptr;
+	int Size = 0;
+	int Priority = 0;
+	unsigned Sequence = 0;
+	std::atomic<int> State { Unread };
+	FCompressedBuffer Raw = { };
+	char *Result = nullptr;
+	bool Succeeded = false;
+
+	friend class FLumpLoader;
+};
+
+typedef std::shared_ptr<FLumpRequest> FLumpHandle;
+
+//==========================================================================
+//
+// Decompresses archive lumps on a pool of worker threads.
+//
+// Prefetch reads the compressed data on the calling thread, as the archive's
+// FileReader is not thread safe, and queues the decompression. The next
+// CacheLump call for the lump picks up the result instead of decompressing
+// it again. Inside a BeginBatch/EndBatch pair the reads are deferred and done
+// in archive order when the batch ends.
+//
+//==========================================================================
+
+class FLumpLoader
+{
+public:
+	static FLumpLoader *Instance();
+	~FLumpLoader();
+
+	// Returns nullptr if the lump does not need decompression or too much data is pending
+	FLumpHandle Prefetch(FResourceLump *lump, int priority = 0);
+	FLumpHandle Prefetch(int lumpnum, int priority = 0);
+
+	void BeginBatch();
+	void EndBatch();
+
+	// Drops all results nobody asked for
+	void Flush();
+
+	// Called by FResourceLump. Both are cheap if nothing is pending.
+	static char *Claim(FResourceLump *lump);
+	static void Cancel(FResourceLump *lump);
+
+	static int Requested;
+	static int Claimed;
+	static int Dropped;
+
+private:
+	struct RequestOrder
+	{
+		bool operator()(const FLumpHandle &a, const FLumpHandle &b) const
+		{
+			return a->Priority != b->Priority ? a->Priority < b->Priority : a->Sequence > b->Sequence;
+		}
+	};
+
+	void Submit(const FLumpHandle &request);
+	char *ClaimRequest(FResourceLump *lump);
+	void CancelRequest(FResourceLump *lump);
+	void Release(const FLumpHandle &request);
+	void WaitRequest(FLumpRequest *request);
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerMain();
+
+	std::unordered_map<FResourceLump *, FLumpHandle> mRequests;
+	std::priority_queue<FLumpHandle, std::vector<FLumpHandle>, RequestOrder> mQueue;
+	std::vector<FLumpHandle> mBatch;
+	int mBatchDepth = 0;
+	size_t mPendingBytes = 0;
+	unsigned mSequence = 0;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkCondition;
+	std::condition_variable mDoneCondition;
+	std::vector<std::thread> mWorkers;
+	bool mStopWorkers = false;
+
+	// Number of registered requests. Lets Claim and Cancel skip the lock.
+	static std::atomic<int> ActiveRequests;
+
+	friend class FLumpRequest;
+};
+
+#endif
@@ -36,6 +36,7 @@
 
 #include <zlib.h>
 #include "resourcefile.h"
+#include "lumploader.h"
 #include "cmdlib.h"
 #include "w_wad.h"
 #include "gi.h"
@@ -75,6 +76,7 @@ public:
 
 FResourceLump::~FResourceLump()
 {
+	FLumpLoader::Cancel(this);
 	if (Cache != NULL && RefCount >= 0)
 	{
 		delete [] Cache;
@@ -245,7 +247,10 @@ void *FResourceLump::CacheLump()
 	}
 	else if (LumpSize > 0)
 	{
-		FillCache();
+		// Use the result of a background decompression if there is one
+		Cache = FLumpLoader::Claim(this);
+		if (Cache != NULL) RefCount = 1;
+		else FillCache();
 	}
 	return Cache;
 }
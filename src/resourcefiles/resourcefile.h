@@ -18,7 +18,7 @@ struct FCompressedBuffer
 	unsigned mCRC32;
 	char *mBuffer;
 
-	bool Decompress(char *destbuffer);
+	bool Decompress(char *destbuffer, bool quiet = false);
 	void Clean()
 	{
 		mSize = mCompressedSize = 0;
@@ -69,6 +69,7 @@ struct FResourceLump
 	void LumpNameSetup(FString iname);
 	void CheckEmbedded();
 	virtual FCompressedBuffer GetRawData();
+	virtual bool CanPrefetch() { return false; }	// true if GetRawData returns compressed data that can be decompressed on another thread
 
 	void *CacheLump();
 	int ReleaseCache();
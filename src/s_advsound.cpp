@@ -40,6 +40,7 @@
 #include "w_wad.h"
 #include "gi.h"
 #include "i_sound.h"
+#include "s_sfxcache.h"
 #include "d_netinf.h"
 #include "d_player.h"
 #include "serializer.h"
@@ -612,12 +613,15 @@ int S_AddSoundLump (const char *logicalname, int lump)
 	newsfx.bSingular = false;
 	newsfx.bTentative = false;
 	newsfx.bPlayerSilent = false;
+	newsfx.bTransient = false;
 	newsfx.RawRate = 0;
 	newsfx.link = sfxinfo_t::NO_LINK;
 	newsfx.Rolloff.RolloffType = ROLLOFF_Doom;
 	newsfx.Rolloff.MinDistance = 0;
 	newsfx.Rolloff.MaxDistance = 0;
 	newsfx.LoopStart = -1;
+	newsfx.CacheBytes = 0;
+	newsfx.CacheStamp = 0;
 
 	return (int)S_sfx.Push (newsfx);
 }
@@ -959,6 +963,7 @@ static void S_ClearSoundData()
 	unsigned int i;
 
 	S_StopAllChannels();
+	FSfxCache::Instance()->Flush();
 	for (i = 0; i < S_sfx.Size(); ++i)
 	{
 		S_UnloadSound(&S_sfx[i]);
@@ -0,0 +1,480 @@
+/*
+** s_sfxcache.cpp
+**
+** Sound effect decoding and memory budget
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <algorithm>
+#include "s_sfxcache.h"
+#include "s_sound.h"
+#include "i_sound.h"
+#include "files.h"
+#include "w_wad.h"
+#include "m_fixed.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "stats.h"
+
+// Memory budget for loaded sound effects in megabytes. 0 = unlimited.
+CVAR(Int, snd_cachesize, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Sounds larger than this many kilobytes are unloaded once they stop playing. 0 = never.
+CVAR(Int, snd_transientsize, 4096, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Number of worker threads. 0 = one less than the number of cores.
+CVAR(Int, snd_decode_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Limit for the size of all sounds that are queued or waiting to be taken
+static const size_t MaxPendingBytes = 256 << 20;
+
+int FSfxCache::Hits;
+int FSfxCache::Misses;
+int FSfxCache::Evicted;
+int FSfxCache::Queued;
+int FSfxCache::Taken;
+int FSfxCache::Dropped;
+int FSfxCache::Failed;
+std::atomic<int> FSfxCache::ActiveJobs;
+
+ADD_STAT(sfxcache)
+{
+	auto cache = FSfxCache::Instance();
+	FString out;
+	out.Format("loaded=%u (%zu KB)  hits=%d  misses=%d  evicted=%d\nqueued=%d  taken=%d  dropped=%d  failed=%d",
+		cache->GetLoadedCount(), cache->GetLoadedBytes() >> 10, FSfxCache::Hits, FSfxCache::Misses, FSfxCache::Evicted,
+		FSfxCache::Queued, FSfxCache::Taken, FSfxCache::Dropped, FSfxCache::Failed);
+	return out;
+}
+
+static bool IsTransientSize(size_t bytes)
+{
+	return snd_transientsize > 0 && bytes > (size_t)snd_transientsize << 10;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FSfxCache *FSfxCache::Instance()
+{
+	static FSfxCache cache;
+	return &cache;
+}
+
+FSfxCache::~FSfxCache()
+{
+	StopWorkers();
+	ActiveJobs = 0;
+	mJobs.clear();
+	mQueue.clear();
+}
+
+//==========================================================================
+//
+// Reads the sound lump and hands it to the workers. Formats the sound
+// renderer converts directly are left alone.
+//
+//==========================================================================
+
+bool FSfxCache::Queue(sfxinfo_t *sfx)
+{
+	if (GSnd == nullptr || GSnd->IsNull() || sfx->data.isValid() || sfx->bLoadRAW || sfx->lumpnum < 0)
+		return false;
+
+	int soundid = int(sfx - &S_sfx[0]);
+	int lump = sfx->lumpnum;
+	int size = Wads.LumpLength(lump);
+	if (size <= 8)
+		return false;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (mJobs.find(soundid) != mJobs.end())
+		return true;
+	if (mPendingBytes + size > MaxPendingBytes)
+		return false;
+	lock.unlock();
+
+	auto reader = Wads.OpenLumpReader(lump);
+	uint8_t header[19];
+	if (reader.Read(header, sizeof(header)) != (long)sizeof(header))
+		return false;
+
+	int32_t dmxlen = header[4] | (header[5] << 8) | (header[6] << 16) | (header[7] << 24);
+	if (memcmp(header, "Creative Voice File", 19) == 0 || (header[0] == 3 && header[1] == 0 && dmxlen <= size - 8))
+		return false;
+
+	JobHandle job = std::make_shared<Job>();
+	job->SoundID = soundid;
+	job->LumpNum = lump;
+	job->Size = size;
+	job->Data.resize(size);
+	memcpy(job->Data.data(), header, sizeof(header));
+	if (reader.Read(job->Data.data() + sizeof(header), size - sizeof(header)) != long(size - sizeof(header)))
+		return false;
+
+	lock.lock();
+	if (mJobs.find(soundid) != mJobs.end())
+		return true;
+	if (mPendingBytes + size > MaxPendingBytes)
+		return false;
+	mJobs[soundid] = job;
+	mPendingBytes += size;
+	ActiveJobs++;
+	Queued++;
+	mQueue.push_back(job);
+	StartWorkers();
+	lock.unlock();
+	mWorkCondition.notify_one();
+	return true;
+}
+
+//==========================================================================
+//
+// Moves the decoded samples of a queued sound into the buffer.
+// Returns false if the caller has to decode the sound itself.
+//
+//==========================================================================
+
+bool FSfxCache::Take(sfxinfo_t *sfx, FSoundLoadBuffer *buffer)
+{
+	if (ActiveJobs.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	auto cache = Instance();
+	JobHandle job = cache->FinishJob(int(sfx - &S_sfx[0]));
+	if (job == nullptr)
+		return false;
+
+	std::unique_lock<std::mutex> lock(cache->mMutex);
+	cache->Release(job);
+	lock.unlock();
+
+	if (!job->Succeeded || job->LumpNum != sfx->lumpnum)
+	{
+		// Let the sound renderer report the error
+		Failed++;
+		return false;
+	}
+
+	Taken++;
+	*buffer = std::move(job->Buffer);
+	return true;
+}
+
+bool FSfxCache::IsTransient(sfxinfo_t *sfx)
+{
+	if (ActiveJobs.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	JobHandle job = FinishJob(int(sfx - &S_sfx[0]));
+	if (job == nullptr || !job->Succeeded || !IsTransientSize(job->Buffer.mBuffer.Size()))
+		return false;
+
+	// It gets decoded again when it's played
+	std::unique_lock<std::mutex> lock(mMutex);
+	Release(job);
+	Dropped++;
+	return true;
+}
+
+// Runs the sound's job if no worker picked it up yet, or waits for it
+FSfxCache::JobHandle FSfxCache::FinishJob(int soundid)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mJobs.find(soundid);
+	if (it == mJobs.end())
+		return nullptr;
+
+	JobHandle job = it->second;
+	if (job->State == Job::Waiting)
+	{
+		// Don't wait for the rest of the queue
+		job->State = Job::Running;
+		lock.unlock();
+		RunJob(job.get());
+		lock.lock();
+		job->State = Job::Done;
+		mDoneCondition.notify_all();
+	}
+	else
+	{
+		mDoneCondition.wait(lock, [&]() { return job->State == Job::Done; });
+	}
+	return job;
+}
+
+void FSfxCache::Flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	for (auto &it : mJobs)
+	{
+		auto &job = it.second;
+		if (job->State == Job::Waiting)
+			job->State = Job::Cancelled;
+		Dropped++;
+	}
+	ActiveJobs -= (int)mJobs.size();
+	mJobs.clear();
+	mPendingBytes = 0;
+}
+
+// Removes a job from the sound map. The caller must hold the lock.
+void FSfxCache::Release(const JobHandle &job)
+{
+	auto it = mJobs.find(job->SoundID);
+	if (it == mJobs.end() || it->second != job)
+		return;
+	mJobs.erase(it);
+	mPendingBytes -= job->Size;
+	ActiveJobs--;
+}
+
+//==========================================================================
+//
+// Decodes the sound the same way OpenALSoundRenderer::LoadSound does,
+// so that LoadSoundBuffered can upload the samples as they are.
+//
+//==========================================================================
+
+void FSfxCache::RunJob(Job *job)
+{
+	try
+	{
+		FileReader reader;
+		reader.OpenMemory(job->Data.data(), job->Data.size());
+
+		uint32_t loop_start = 0, loop_end = ~0u;
+		bool startass = false, endass = false;
+		FindLoopTags(reader, &loop_start, &startass, &loop_end, &endass);
+		reader.Seek(0, FileReader::SeekSet);
+
+		std::unique_ptr<SoundDecoder> decoder(SoundRenderer::CreateDecoder(reader));
+		if (decoder != nullptr)
+		{
+			FSoundLoadBuffer &buffer = job->Buffer;
+			decoder->getInfo(&buffer.srate, &buffer.chans, &buffer.type);
+
+			int samplesize = 0;
+			if (buffer.type == SampleType_UInt8 || buffer.type == SampleType_Int16)
+			{
+				samplesize = buffer.type == SampleType_Int16 ? 2 : 1;
+				if (buffer.chans == ChannelConfig_Stereo) samplesize *= 2;
+				else if (buffer.chans != ChannelConfig_Mono) samplesize = 0;
+			}
+
+			if (samplesize > 0)
+			{
+				buffer.mBuffer = decoder->readAll();
+
+				if (!startass) loop_start = Scale(loop_start, buffer.srate, 1000);
+				if (!endass && loop_end != ~0u) loop_end = Scale(loop_end, buffer.srate, 1000);
+				const uint32_t samples = buffer.mBuffer.Size() / samplesize;
+				if (loop_start > samples) loop_start = 0;
+				if (loop_end > samples) loop_end = samples;
+				buffer.loop_start = loop_start;
+				buffer.loop_end = loop_end;
+				job->Succeeded = buffer.mBuffer.Size() > 0;
+			}
+		}
+	}
+	catch (...)
+	{
+		job->Succeeded = false;
+	}
+	std::vector<uint8_t>().swap(job->Data);
+	if (!job->Succeeded)
+		job->Buffer.mBuffer.Reset();
+}
+
+//==========================================================================
+//
+// Worker threads
+//
+//==========================================================================
+
+void FSfxCache::StartWorkers()
+{
+	if (!mWorkers.empty())
+		return;
+
+	int count = snd_decode_threads;
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency() - 1;
+	count = clamp(count, 1, 8);
+
+	mStopWorkers = false;
+	for (int i = 0; i < count; i++)
+		mWorkers.push_back(std::thread([=]() { WorkerMain(); }));
+}
+
+void FSfxCache::StopWorkers()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStopWorkers = true;
+	lock.unlock();
+	mWorkCondition.notify_all();
+
+	for (auto &worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+void FSfxCache::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWorkCondition.wait(lock, [&]() { return mStopWorkers || !mQueue.empty(); });
+		if (mStopWorkers)
+			break;
+
+		JobHandle job = mQueue.front();
+		mQueue.pop_front();
+		if (job->State != Job::Waiting)
+			continue;
+
+		job->State = Job::Running;
+		lock.unlock();
+
+		RunJob(job.get());
+
+		lock.lock();
+		job->State = Job::Done;
+		mDoneCondition.notify_all();
+	}
+}
+
+//==========================================================================
+//
+// Memory budget
+//
+//==========================================================================
+
+void FSfxCache::Update(sfxinfo_t *sfx)
+{
+	unsigned int bytes = 0;
+	if (GSnd != nullptr)
+	{
+		if (sfx->data.isValid())
+			bytes += GSnd->GetMemoryUsage(sfx->data);
+		if (sfx->data3d.isValid() && sfx->data3d != sfx->data)
+			bytes += GSnd->GetMemoryUsage(sfx->data3d);
+	}
+
+	if (sfx->CacheBytes > 0)
+	{
+		mLoadedBytes -= sfx->CacheBytes;
+		mLoadedCount--;
+		if (sfx->bTransient) mTransientCount--;
+	}
+
+	sfx->CacheBytes = bytes;
+	sfx->bTransient = IsTransientSize(bytes);
+
+	if (bytes > 0)
+	{
+		mLoadedBytes += bytes;
+		mLoadedCount++;
+		if (sfx->bTransient) mTransientCount++;
+		sfx->CacheStamp = ++mClock;
+	}
+}
+
+void FSfxCache::Touch(sfxinfo_t *sfx)
+{
+	Hits++;
+	sfx->CacheStamp = ++mClock;
+}
+
+void FSfxCache::Trim()
+{
+	size_t budget = snd_cachesize > 0 ? (size_t)snd_cachesize << 20 : 0;
+	bool overbudget = budget > 0 && mLoadedBytes > budget;
+	if (!overbudget && mTransientCount == 0)
+		return;
+
+	// Sounds on a channel must stay, including the ones waiting to be restarted
+	TArray<uint8_t> &playing = mPlaying;
+	playing.Resize(S_sfx.Size());
+	memset(&playing[0], 0, playing.Size());
+	for (FSoundChan *chan = Channels; chan != nullptr; chan = chan->NextChan)
+	{
+		for (int id : { (int)chan->SoundID, (int)chan->OrgID })
+		{
+			while (id > 0 && (unsigned)id < S_sfx.Size() && !playing[id])
+			{
+				playing[id] = true;
+				if (S_sfx[id].link == sfxinfo_t::NO_LINK)
+					break;
+				id = S_sfx[id].link;
+			}
+		}
+	}
+
+	TArray<int> &candidates = mCandidates;
+	candidates.Clear();
+	for (unsigned i = 1; i < S_sfx.Size(); i++)
+	{
+		sfxinfo_t *sfx = &S_sfx[i];
+		if (sfx->CacheBytes == 0 || playing[i])
+			continue;
+
+		if (sfx->bTransient)
+		{
+			S_UnloadSound(sfx);
+			Evicted++;
+		}
+		else if (overbudget)
+		{
+			candidates.Push(i);
+		}
+	}
+
+	if (!overbudget || mLoadedBytes <= budget)
+		return;
+
+	// Least recently used first, down to 7/8 of the budget so that this doesn't run every frame
+	std::sort(candidates.begin(), candidates.end(), [](int a, int b) { return S_sfx[a].CacheStamp < S_sfx[b].CacheStamp; });
+	size_t target = budget / 8 * 7;
+	for (int id : candidates)
+	{
+		if (mLoadedBytes <= target)
+			break;
+		S_UnloadSound(&S_sfx[id]);
+		Evicted++;
+	}
+}
@@ -0,0 +1,156 @@
+/*
+** s_sfxcache.h
+**
+** Sound effect decoding and memory budget
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __S_SFXCACHE_H
+#define __S_SFXCACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include "i_sound.h"
+
+struct sfxinfo_t;
+
+//==========================================================================
+//
+// Keeps the decoded sound effects within a memory budget.
+//
+// Queue reads a compressed sound lump on the calling thread and lets a
+// worker decode it, so that precaching doesn't decode one sound after the
+// other. S_LoadSound picks up the samples instead of decoding the lump again.
+//
+// Loaded sounds are unloaded least recently used first once the budget is
+// exceeded. Sounds above snd_transientsize are not precached and are
+// unloaded as soon as they stop playing. Playing sounds are never unloaded.
+//
+//==========================================================================
+
+class FSfxCache
+{
+public:
+	static FSfxCache *Instance();
+	~FSfxCache();
+
+	// Returns false if the sound doesn't need decoding or too much data is pending
+	bool Queue(sfxinfo_t *sfx);
+
+	// Drops all results nobody asked for
+	void Flush();
+
+	// Called by S_LoadSound. Cheap if nothing is pending.
+	static bool Take(sfxinfo_t *sfx, FSoundLoadBuffer *buffer);
+
+	// True if the sound shouldn't be precached. Waits for the sound's job.
+	bool IsTransient(sfxinfo_t *sfx);
+
+	// Recounts the sound's size after it was loaded or unloaded
+	void Update(sfxinfo_t *sfx);
+
+	// Marks the sound as used
+	void Touch(sfxinfo_t *sfx);
+
+	// Unloads sounds that are over the budget
+	void Trim();
+
+	static int Hits;
+	static int Misses;
+	static int Evicted;
+	static int Queued;
+	static int Taken;
+	static int Dropped;
+	static int Failed;
+
+	size_t GetLoadedBytes() const { return mLoadedBytes; }
+	unsigned GetLoadedCount() const { return mLoadedCount; }
+
+private:
+	struct Job
+	{
+		enum
+		{
+			Waiting,
+			Running,
+			Done,
+			Cancelled
+		};
+
+		int SoundID = 0;
+		int LumpNum = -1;
+		std::vector<uint8_t> Data;
+		FSoundLoadBuffer Buffer = { };
+		size_t Size = 0;
+		std::atomic<int> State { Waiting };
+		bool Succeeded = false;
+	};
+
+	typedef std::shared_ptr<Job> JobHandle;
+
+	JobHandle FinishJob(int soundid);
+	void Release(const JobHandle &job);
+	void RunJob(Job *job);
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerMain();
+
+	std::unordered_map<int, JobHandle> mJobs;
+	std::deque<JobHandle> mQueue;
+	size_t mPendingBytes = 0;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkCondition;
+	std::condition_variable mDoneCondition;
+	std::vector<std::thread> mWorkers;
+	bool mStopWorkers = false;
+
+	// Number of registered jobs. Lets Take skip the lock.
+	static std::atomic<int> ActiveJobs;
+
+	size_t mLoadedBytes = 0;
+	unsigned mLoadedCount = 0;
+	unsigned mTransientCount = 0;
+	unsigned mClock = 0;
+
+	// Scratch space for Trim, which runs every frame while transient sounds are loaded
+	TArray<uint8_t> mPlaying;
+	TArray<int> mCandidates;
+};
+
+#endif
@@ -82,6 +82,8 @@
 #include "d_player.h"
 #include "g_levellocals.h"
 #include "vm.h"
+#include "resourcefiles/lumploader.h"
+#include "s_sfxcache.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -528,6 +530,28 @@ void S_PrecacheLevel ()
 			chan->SoundID.MarkUsed();
 		}
 
+		// Let the sounds that still need loading decompress in the background
+		FLumpLoader::Instance()->BeginBatch();
+		for (i = 1; i < S_sfx.Size(); ++i)
+		{
+			sfxinfo_t *sfx = &S_sfx[i];
+			if (sfx->bUsed && !sfx->bRandomHeader && sfx->link == sfxinfo_t::NO_LINK && !sfx->data.isValid())
+			{
+				FLumpLoader::Instance()->Prefetch(sfx->lumpnum);
+			}
+		}
+		FLumpLoader::Instance()->EndBatch();
+
+		// Decode compressed sounds in parallel
+		for (i = 1; i < S_sfx.Size(); ++i)
+		{
+			sfxinfo_t *sfx = &S_sfx[i];
+			if (sfx->bUsed && !sfx->bRandomHeader && sfx->link == sfxinfo_t::NO_LINK)
+			{
+				FSfxCache::Instance()->Queue(sfx);
+			}
+		}
+
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (S_sfx[i].bUsed)
@@ -535,6 +559,8 @@ void S_PrecacheLevel ()
 				S_CacheSound (&S_sfx[i]);
 			}
 		}
+		FSfxCache::Instance()->Flush();
+		FLumpLoader::Instance()->Flush();
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (!S_sfx[i].bUsed && S_sfx[i].link == sfxinfo_t::NO_LINK)
@@ -568,6 +594,11 @@ void S_CacheSound (sfxinfo_t *sfx)
 		{
 			S_CacheRandomSound(sfx);
 		}
+		else if (FSfxCache::Instance()->IsTransient(sfx))
+		{
+			// Too large to keep around. It gets loaded when it is played.
+			sfx->bUsed = true;
+		}
 		else
 		{
 			// Since we do not know in what format the sound will be used, we have to cache both.
@@ -595,6 +626,7 @@ void S_UnloadSound (sfxinfo_t *sfx)
 		DPrintf(DMSG_NOTIFY, "Unloaded sound \"%s\" (%td)\n", sfx->name.GetChars(), sfx - &S_sfx[0]);
 	sfx->data.Clear();
 	sfx->data3d.Clear();
+	FSfxCache::Instance()->Update(sfx);
 }
 
 //==========================================================================
@@ -1455,6 +1487,12 @@ sfxinfo_t *S_LoadSound(sfxinfo_t *sfx, FSoundLoadBuffer *pBuffer)
 {
 	if (GSnd->IsNull()) return sfx;
 
+	if (sfx->data.isValid())
+	{
+		FSfxCache::Instance()->Touch(sfx);
+		return sfx;
+	}
+
 	while (!sfx->data.isValid())
 	{
 		unsigned int i;
@@ -1476,6 +1514,7 @@ sfxinfo_t *S_LoadSound(sfxinfo_t *sfx, FSoundLoadBuffer *pBuffer)
 				// This is necessary to avoid using the rolloff settings of the linked sound if its
 				// settings are different.
 				if (sfx->Rolloff.MinDistance == 0) sfx->Rolloff = S_Rolloff;
+				FSfxCache::Instance()->Touch(&S_sfx[i]);
 				return &S_sfx[i];
 			}
 		}
@@ -1485,35 +1524,46 @@ sfxinfo_t *S_LoadSound(sfxinfo_t *sfx, FSoundLoadBuffer *pBuffer)
 		int size = Wads.LumpLength(sfx->lumpnum);
 		if (size > 0)
 		{
-			auto wlump = Wads.OpenLumpReader(sfx->lumpnum);
-			uint8_t *sfxdata = new uint8_t[size];
-			wlump.Read(sfxdata, size);
-			int32_t dmxlen = LittleLong(((int32_t *)sfxdata)[1]);
             std::pair<SoundHandle,bool> snd;
+			FSoundLoadBuffer decoded;
+			FSoundLoadBuffer *buffer = pBuffer != nullptr ? pBuffer : &decoded;
 
-			// If the sound is voc, use the custom loader.
-			if (strncmp ((const char *)sfxdata, "Creative Voice File", 19) == 0)
+			// Compressed sounds may have been decoded in the background.
+			if (FSfxCache::Take(sfx, buffer))
 			{
-				snd = GSnd->LoadSoundVoc(sfxdata, size);
+				snd = GSnd->LoadSoundBuffered(buffer, false);
 			}
-			// If the sound is raw, just load it as such.
-			else if (sfx->bLoadRAW)
-			{
-				snd = GSnd->LoadSoundRaw(sfxdata, size, sfx->RawRate, 1, 8, sfx->LoopStart);
-			}
-			// Otherwise, try the sound as DMX format.
-			else if (((uint8_t *)sfxdata)[0] == 3 && ((uint8_t *)sfxdata)[1] == 0 && dmxlen <= size - 8)
-			{
-				int frequency = LittleShort(((uint16_t *)sfxdata)[1]);
-				if (frequency == 0) frequency = 11025;
-				snd = GSnd->LoadSoundRaw(sfxdata+8, dmxlen, frequency, 1, 8, sfx->LoopStart);
-			}
-			// If that fails, let the sound system try and figure it out.
 			else
 			{
-				snd = GSnd->LoadSound(sfxdata, size, false, pBuffer);
+				auto wlump = Wads.OpenLumpReader(sfx->lumpnum);
+				uint8_t *sfxdata = new uint8_t[size];
+				wlump.Read(sfxdata, size);
+				int32_t dmxlen = LittleLong(((int32_t *)sfxdata)[1]);
+
+				// If the sound is voc, use the custom loader.
+				if (strncmp ((const char *)sfxdata, "Creative Voice File", 19) == 0)
+				{
+					snd = GSnd->LoadSoundVoc(sfxdata, size);
+				}
+				// If the sound is raw, just load it as such.
+				else if (sfx->bLoadRAW)
+				{
+					snd = GSnd->LoadSoundRaw(sfxdata, size, sfx->RawRate, 1, 8, sfx->LoopStart);
+				}
+				// Otherwise, try the sound as DMX format.
+				else if (((uint8_t *)sfxdata)[0] == 3 && ((uint8_t *)sfxdata)[1] == 0 && dmxlen <= size - 8)
+				{
+					int frequency = LittleShort(((uint16_t *)sfxdata)[1]);
+					if (frequency == 0) frequency = 11025;
+					snd = GSnd->LoadSoundRaw(sfxdata+8, dmxlen, frequency, 1, 8, sfx->LoopStart);
+				}
+				// If that fails, let the sound system try and figure it out.
+				else
+				{
+					snd = GSnd->LoadSound(sfxdata, size, false, pBuffer);
+				}
+				delete[] sfxdata;
 			}
-			delete[] sfxdata;
 
             sfx->data = snd.first;
             if(snd.second)
@@ -1530,6 +1580,8 @@ sfxinfo_t *S_LoadSound(sfxinfo_t *sfx, FSoundLoadBuffer *pBuffer)
 		}
 		break;
 	}
+	FSfxCache::Misses++;
+	FSfxCache::Instance()->Update(sfx);
 	return sfx;
 }
 
@@ -1584,6 +1636,7 @@ static void S_LoadSound3D(sfxinfo_t *sfx, FSoundLoadBuffer *pBuffer)
 	}
 
 	sfx->data3d = snd.first;
+	FSfxCache::Instance()->Update(sfx);
 }
 
 //==========================================================================
@@ -2191,6 +2244,8 @@ void S_UpdateSounds (AActor *listenactor)
 		RestartEvictionsAt = 0;
 		S_RestoreEvictedChannels();
 	}
+
+	FSfxCache::Instance()->Trim();
 }
 
 //==========================================================================
@@ -66,6 +66,7 @@ struct sfxinfo_t
 	unsigned		bSingular:1;
 	unsigned		bTentative:1;
 	unsigned		bPlayerSilent:1;		// This player sound is intentionally silent.
+	unsigned		bTransient:1;			// Too large to stay loaded when it isn't playing.
 
 	int		RawRate;				// Sample rate to use when bLoadRAW is true
 
@@ -77,6 +78,9 @@ struct sfxinfo_t
 	FRolloffInfo	Rolloff;
 	float		Attenuation;			// Multiplies the attenuation passed to S_Sound.
 
+	unsigned int	CacheBytes;				// Size of the loaded sample data, for FSfxCache
+	unsigned int	CacheStamp;				// When the sound was last used
+
 	void		MarkUsed();				// Marks this sound as used.
 };
 
@@ -40,9 +40,11 @@
 #include "templates.h"
 #include "vmintern.h"
 #include "types.h"
+#include "p_simprofile.h"
 
 cycle_t VMCycles[10];
 int VMCalls[10];
+static FSimProfileZone VMCallZone("VMCall");
 
 #if 0
 IMPLEMENT_CLASS(VMException, false, false)
@@ -430,6 +432,7 @@ VMFrame *VMFrameStack::PopFrame()
 
 int VMCall(VMFunction *func, VMValue *params, int numparams, VMReturn *results, int numresults/*, VMException **trap*/)
 {
+	FSimProfileScope profile(VMCallZone, nullptr, func->PrintableName.GetChars());
 	bool allocated = false;
 	try
 	{	
@@ -80,6 +80,16 @@ ADLMIDI_EXPORT int adl_setNumChips(ADL_MIDIPlayer *device, int numCards)
     return adlRefreshNumCards(device);
 }
 
+ADLMIDI_EXPORT int adl_setChipThreads(struct ADL_MIDIPlayer *device, int threads)
+{
+    if(device == NULL)
+        return -2;
+
+    MIDIplay *play = reinterpret_cast<MIDIplay *>(device->adl_midiPlayer);
+    play->chipPool.SetThreads(threads);
+    return 0;
+}
+
 ADLMIDI_EXPORT int adl_getNumChips(struct ADL_MIDIPlayer *device)
 {
     if(device == NULL)
@@ -586,6 +596,36 @@ inline static void SendStereoAudio(int      &samples_requested,
 }
 
 
+/* Renders every chip into its own buffer, on worker threads if enabled, and mixes them in chip order */
+static void GenerateChips(MIDIplay *player, int16_t *out_buf, ssize_t in_generatedStereo)
+{
+    unsigned int chips = player->opl.NumCards;
+    size_t count = static_cast<size_t>(in_generatedStereo) * 2;
+    if(player->chipBuf.size() < chips * 1024)
+        player->chipBuf.resize(chips * 1024);
+
+    player->chipPool.Run(static_cast<int>(chips), [&](int card)
+    {
+        int16_t *buf = &player->chipBuf[static_cast<size_t>(card) * 1024];
+        #ifdef ADLMIDI_USE_DOSBOX_OPL
+        ssize_t samples = in_generatedStereo;
+        player->opl.cards[static_cast<size_t>(card)].GenerateArr(buf, &samples);
+        #else
+        OPL3_GenerateStream(&player->opl.cards[static_cast<size_t>(card)], buf, static_cast<Bit32u>(in_generatedStereo));
+        #endif
+    });
+
+    std::memcpy(out_buf, &player->chipBuf[0], count * sizeof(int16_t));
+    for(unsigned card = 1; card < chips; ++card)
+    {
+        #ifdef ADLMIDI_USE_DOSBOX_OPL
+        ChipMixWrap(out_buf, &player->chipBuf[card * 1024], count);
+        #else
+        ChipMixSaturate(out_buf, &player->chipBuf[card * 1024], count);
+        #endif
+    }
+}
+
 ADLMIDI_EXPORT int adl_play(ADL_MIDIPlayer *device, int sampleCount, short *out)
 {
     #ifndef ADLMIDI_DISABLE_MIDI_SEQUENCER
@@ -661,15 +701,7 @@ ADLMIDI_EXPORT int adl_play(ADL_MIDIPlayer *device, int sampleCount, short *out)
                 else if(n_periodCountStereo > 0)
                 {
                     /* Generate data from every chip and mix result */
-                    for(unsigned card = 0; card < chips; ++card)
-                    {
-                        #ifdef ADLMIDI_USE_DOSBOX_OPL
-                        player->opl.cards[card].GenerateArrMix(out_buf, &in_generatedStereo);
-                        in_generatedPhys = in_generatedStereo * 2;
-                        #else
-                        OPL3_GenerateStreamMix(&player->opl.cards[card], out_buf, static_cast<Bit32u>(in_generatedStereo));
-                        #endif
-                    }
+                    GenerateChips(player, out_buf, in_generatedStereo);
                 }
                 /* Process it */
                 SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out);
@@ -754,15 +786,7 @@ ADLMIDI_EXPORT int adl_generate(struct ADL_MIDIPlayer *device, int sampleCount,
                 else if(n_periodCountStereo > 0)
                 {
                     /* Generate data from every chip and mix result */
-                    for(unsigned card = 0; card < chips; ++card)
-                    {
-                        #ifdef ADLMIDI_USE_DOSBOX_OPL
-                        player->opl.cards[card].GenerateArrMix(out_buf, &in_generatedStereo);
-                        in_generatedPhys = in_generatedStereo * 2;
-                        #else
-                        OPL3_GenerateStreamMix(&player->opl.cards[card], out_buf, static_cast<Bit32u>(in_generatedStereo));
-                        #endif
-                    }
+                    GenerateChips(player, out_buf, in_generatedStereo);
                 }
                 /* Process it */
                 SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out);
@@ -75,6 +75,9 @@ struct ADL_MIDIPlayer
 /* Sets number of emulated chips (from 1 to 100). Emulation of multiple chips exchanges polyphony limits*/
 extern int adl_setNumChips(struct ADL_MIDIPlayer *device, int numCards);
 
+/* Sets the number of threads that render the chips. 0 = automatic, 1 = render serially */
+extern int adl_setChipThreads(struct ADL_MIDIPlayer *device, int threads);
+
 /* Get current number of emulated chips */
 extern int adl_getNumChips(struct ADL_MIDIPlayer *device);
 
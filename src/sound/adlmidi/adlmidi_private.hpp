@@ -123,6 +123,7 @@ typedef int32_t ssize_t;
 #endif
 
 #include "adldata.hh"
+#include "chipthreads.h"
 #include "adlmidi.h"    //Main API
 #ifndef ADLMIDI_DISABLE_CPP_EXTRAS
 #include "adlmidi.hpp"  //Extra C++ API
@@ -834,6 +835,10 @@ public:
 
     int16_t outBuf[1024];
 
+    //! Per chip output for rendering several chips in parallel
+    std::vector<int16_t> chipBuf;
+    FChipRenderPool chipPool;
+
     Setup m_setup;
 
     static uint64_t ReadBEint(const void *buffer, size_t nbytes);
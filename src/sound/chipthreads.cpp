@@ -0,0 +1,104 @@
+/*
+** chipthreads.cpp
+**
+** Renders emulated sound chips on worker threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+#include "chipthreads.h"
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FChipRenderPool::SetThreads(int threads)
+{
+	if (threads <= 0)
+		threads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	mThreads = std::min(threads, 16);
+}
+
+void FChipRenderPool::Run(int chips, const std::function<void(int)> &render)
+{
+	mPool.Run(std::min(mThreads, chips), chips, 1, [&](int start, int end)
+	{
+		for (int i = start; i < end; i++)
+			render(i);
+	});
+}
+
+//==========================================================================
+//
+// Mixing
+//
+//==========================================================================
+
+void ChipMixSaturate(int16_t *dest, const int16_t *src, size_t count)
+{
+	size_t i = 0;
+#ifndef NO_SSE
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dest + i), _mm_adds_epi16(d, s));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		int mix = dest[i] + src[i];
+		dest[i] = (int16_t)std::min(std::max(mix, -32768), 32767);
+	}
+}
+
+void ChipMixWrap(int16_t *dest, const int16_t *src, size_t count)
+{
+	size_t i = 0;
+#ifndef NO_SSE
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi16(d, s));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		dest[i] = (int16_t)(dest[i] + src[i]);
+	}
+}
@@ -0,0 +1,74 @@
+/*
+** chipthreads.h
+**
+** Renders emulated sound chips on worker threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __CHIPTHREADS_H
+#define __CHIPTHREADS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "workerpool.h"
+
+//==========================================================================
+//
+// Runs the per chip rendering of the ADLMIDI and OPNMIDI players in
+// parallel. Every chip renders into its own buffer and the caller mixes
+// them in chip order afterwards, so the output doesn't depend on the
+// thread count.
+//
+//==========================================================================
+
+class FChipRenderPool
+{
+public:
+	// Total number of threads including the caller, at most 16. 0 uses one less than the
+	// number of hardware threads. Run never uses more threads than there are chips.
+	void SetThreads(int threads);
+
+	// Calls render for every chip and returns when all of them are done
+	void Run(int chips, const std::function<void(int)> &render);
+
+private:
+	int mThreads = 1;
+	FWorkerPool mPool;
+};
+
+// Mixes chip buffers into dest, in chip order. Saturating matches
+// OPL3_GenerateStreamMix, wrapping matches the emulators that add to the
+// output buffer directly.
+void ChipMixSaturate(int16_t *dest, const int16_t *src, size_t count);
+void ChipMixWrap(int16_t *dest, const int16_t *src, size_t count);
+
+#endif
@@ -46,6 +46,8 @@
 #include "c_dispatch.h"
 #include "templates.h"
 #include "stats.h"
+#include "sc_man.h"
+#include "musicbench.h"
 #include "timidity/timidity.h"
 #include "vm.h"
 
@@ -288,6 +290,11 @@ MusInfo *MusInfo::GetWaveDumper(const char *filename, int rate)
 	return nullptr;
 }
 
+bool MusInfo::Benchmark(FMusicBenchmark &bench, int subsong)
+{
+	return false;
+}
+
 //==========================================================================
 //
 // create a source based on MIDI file type
@@ -795,6 +802,173 @@ UNSAFE_CCMD (writewave)
 	}
 }
 
+//==========================================================================
+//
+// CCMD musicbench
+//
+// Renders songs through every backend that can play them, as fast as
+// possible and without a sound device, and prints the realtime factor,
+// the slowest buffer and a checksum of the output for each. MIDI-based
+// songs go through all software synths, everything else through the
+// stream decoder that handles it.
+//
+// Arguments are music lumps or files, or @file to read a list of songs
+// from a text file. Without arguments every music lump is rendered.
+// Run it with +musicbench ... +quit for a command line benchmark.
+//
+//==========================================================================
+
+static const struct
+{
+	const char *Name;
+	EMidiDevice Device;
+} BenchSynths[] =
+{
+	{ "OPL", MDEV_OPL },
+	{ "ADLMIDI", MDEV_ADL },
+	{ "OPNMIDI", MDEV_OPN },
+	{ "Timidity", MDEV_GUS },
+	{ "Timidity++", MDEV_TIMIDITY },
+	{ "WildMidi", MDEV_WILDMIDI },
+};
+
+static bool OpenBenchSong(const char *name, int lump, FileReader &reader)
+{
+	if (lump < 0)
+	{
+		lump = Wads.CheckNumForName(name, ns_music);
+		if (lump < 0) lump = Wads.CheckNumForFullName(name);
+	}
+	if (lump >= 0)
+	{
+		reader = Wads.OpenLumpReader(lump);
+		return true;
+	}
+	return reader.OpenFile(name);
+}
+
+static void BenchmarkSong(const char *name, int lump, int &runs, int &failed)
+{
+	FileReader reader;
+	uint32_t id[32 / 4];
+
+	if (!OpenBenchSong(name, lump, reader))
+	{
+		Printf("Cannot find %s.\n", name);
+		failed++;
+		return;
+	}
+	if (reader.Read(id, 32) != 32 || reader.Seek(-32, FileReader::SeekCur) != 0)
+	{
+		Printf("Unable to read %s\n", name);
+		failed++;
+		return;
+	}
+
+	auto type = IdentifyMIDIType(id, 32);
+	if (type != MIDI_NOTMIDI)
+	{
+		for (auto &synth : BenchSynths)
+		{
+			// The streamer owns the source, so every synth needs a new one.
+			FileReader songreader;
+			OpenBenchSong(name, lump, songreader);
+			auto source = CreateMIDISource(songreader, type);
+			if (source == nullptr || !source->isValid())
+			{
+				Printf("%s is not a valid MIDI song.\n", name);
+				delete source;
+				failed++;
+				return;
+			}
+
+			FMusicBenchmark bench(name, synth.Name);
+			auto streamer = new MIDIStreamer(synth.Device, nullptr);
+			streamer->SetMIDISource(source);
+			bool success = streamer->Benchmark(bench, 0, 0);
+			delete streamer;
+
+			runs++;
+			if (success)
+			{
+				bench.Report();
+			}
+			else
+			{
+				Printf("%-12s %-12s not available\n", name, synth.Name);
+				failed++;
+			}
+		}
+	}
+	else
+	{
+		auto song = I_RegisterSong(reader, nullptr);
+		if (song == nullptr)
+		{
+			// Stream songs cannot be created without a sound device.
+			Printf("%s cannot be played\n", name);
+			failed++;
+			return;
+		}
+
+		FMusicBenchmark bench(name, "-");
+		runs++;
+		if (song->Benchmark(bench, 0))
+		{
+			bench.Report();
+		}
+		else
+		{
+			Printf("%-12s cannot be benchmarked\n", name);
+			failed++;
+		}
+		delete song;
+	}
+}
+
+UNSAFE_CCMD(musicbench)
+{
+	int runs = 0, failed = 0;
+
+	// We must stop the currently playing music to avoid interference between two synths. 
+	auto savedsong = mus_playing;
+	S_StopMusic(true);
+
+	if (argv.argc() < 2)
+	{
+		for (int i = 0; i < Wads.GetNumLumps(); i++)
+		{
+			if (Wads.GetLumpNamespace(i) == ns_music)
+			{
+				BenchmarkSong(Wads.GetLumpFullName(i), i, runs, failed);
+			}
+		}
+	}
+	for (int i = 1; i < argv.argc(); i++)
+	{
+		if (argv[i][0] == '@')
+		{
+			FScanner sc;
+			if (!sc.OpenFile(argv[i] + 1))
+			{
+				Printf("Could not open %s.\n", argv[i] + 1);
+				continue;
+			}
+			while (sc.GetString())
+			{
+				BenchmarkSong(sc.String, -1, runs, failed);
+			}
+		}
+		else
+		{
+			BenchmarkSong(argv[i], -1, runs, failed);
+		}
+	}
+	Printf("%d runs, %d failed\n", runs, failed);
+
+	S_ChangeMusic(savedsong.name, savedsong.baseorder, savedsong.loop, true);
+}
+
 //==========================================================================
 //
 // CCMD writemidi
@@ -54,6 +54,7 @@ void I_SetMusicVolume (float volume);
 
 // Registers a song handle to song data.
 class MusInfo;
+class FMusicBenchmark;
 struct MidiDeviceSetting;
 MusInfo *I_RegisterSong (FileReader &reader, MidiDeviceSetting *device);
 MusInfo *I_RegisterCDSong (int track, int cdid = 0);
@@ -80,6 +81,7 @@ public:
 	virtual FString GetStats();
 	virtual MusInfo *GetOPLDumper(const char *filename);
 	virtual MusInfo *GetWaveDumper(const char *filename, int rate);
+	virtual bool Benchmark(FMusicBenchmark &bench, int subsong);	// Renders the whole song as fast as possible
 	virtual void FluidSettingInt(const char *setting, int value);			// FluidSynth settings
 	virtual void FluidSettingNum(const char *setting, double value);		// "
 	virtual void FluidSettingStr(const char *setting, const char *value);	// "
@@ -199,6 +199,7 @@ class MIDIWaveWriter : public SoftSynthMIDIDevice
 {
 public:
 	MIDIWaveWriter(const char *filename, SoftSynthMIDIDevice *devtouse);
+	MIDIWaveWriter(FMusicBenchmark *bench, SoftSynthMIDIDevice *devtouse);
 	~MIDIWaveWriter();
 	int Resume();
 	int Open(MidiCallback cb, void *userdata)
@@ -221,6 +222,7 @@ public:
 
 protected:
 	FileWriter *File;
+	FMusicBenchmark *Bench = nullptr;
 	SoftSynthMIDIDevice *playDevice;
 };
 
@@ -394,6 +396,7 @@ public:
 
 	bool DumpWave(const char *filename, int subsong, int samplerate);
 	bool DumpOPL(const char *filename, int subsong);
+	bool Benchmark(FMusicBenchmark &bench, int subsong, int samplerate);
 
 
 protected:
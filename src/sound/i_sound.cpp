@@ -563,6 +563,11 @@ std::pair<SoundHandle, bool> SoundRenderer::LoadSoundBuffered(FSoundLoadBuffer *
 	return std::make_pair(retval, true);
 }
 
+unsigned int SoundRenderer::GetMemoryUsage(SoundHandle sfx)
+{
+	return 0;
+}
+
 SoundDecoder *SoundRenderer::CreateDecoder(FileReader &reader)
 {
     SoundDecoder *decoder = NULL;
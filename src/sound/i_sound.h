@@ -114,6 +114,7 @@ public:
 	virtual void UnloadSound (SoundHandle sfx) = 0;	// unloads a sound from memory
 	virtual unsigned int GetMSLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
 	virtual unsigned int GetSampleLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
+	virtual unsigned int GetMemoryUsage(SoundHandle sfx);	// Gets the size of the sound's sample data in bytes
 	virtual float GetOutputRate() = 0;
 
 	// Streaming sounds.
@@ -56,6 +56,15 @@ CUSTOM_CVAR(Int, adl_chips_count, 6, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 	}
 }
 
+// Number of threads rendering the chips. 0 = one less than the number of cores.
+CUSTOM_CVAR(Int, adl_chip_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (currSong != nullptr && currSong->GetDeviceType() == MDEV_ADL)
+	{
+		MIDIDeviceChanged(-1, true);
+	}
+}
+
 CUSTOM_CVAR(Int, adl_bank, 14, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
 	if (currSong != nullptr && currSong->GetDeviceType() == MDEV_ADL)
@@ -86,6 +95,7 @@ ADLMIDIDevice::ADLMIDIDevice(const char *args)
 	{
 		adl_setBank(Renderer, (int)adl_bank);
 		adl_setNumChips(Renderer, (int)adl_chips_count);
+		adl_setChipThreads(Renderer, (int)adl_chip_threads);
 		adl_setVolumeRangeModel(Renderer, (int)adl_volume_model);
 	}
 }
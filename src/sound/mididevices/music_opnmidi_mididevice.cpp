@@ -58,6 +58,15 @@ CUSTOM_CVAR(Int, opn_chips_count, 8, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 	}
 }
 
+// Number of threads rendering the chips. 0 = one less than the number of cores.
+CUSTOM_CVAR(Int, opn_chip_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (currSong != nullptr && currSong->GetDeviceType() == MDEV_OPN)
+	{
+		MIDIDeviceChanged(-1, true);
+	}
+}
+
 //==========================================================================
 //
 // OPNMIDIDevice Constructor
@@ -78,6 +87,7 @@ OPNMIDIDevice::OPNMIDIDevice(const char *args)
 		FMemLump data = Wads.ReadLump(lump);
 		opn2_openBankData(Renderer, data.GetMem(), (long)data.GetSize());
 		opn2_setNumChips(Renderer, opn_chips_count);
+		opn2_setChipThreads(Renderer, opn_chip_threads);
 	}
 }
 
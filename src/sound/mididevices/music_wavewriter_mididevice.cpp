@@ -36,6 +36,7 @@
 // HEADER FILES ------------------------------------------------------------
 
 #include "i_musicinterns.h"
+#include "musicbench.h"
 #include <errno.h>
 
 // MACROS ------------------------------------------------------------------
@@ -134,6 +135,25 @@ fail:
 	}
 }
 
+//==========================================================================
+//
+// MIDIWaveWriter Constructor
+//
+// Renders the song without writing it anywhere and reports the timing of
+// every buffer to the benchmark.
+//
+//==========================================================================
+
+MIDIWaveWriter::MIDIWaveWriter(FMusicBenchmark *bench, SoftSynthMIDIDevice *playdevice)
+	: SoftSynthMIDIDevice(playdevice->GetSampleRate())
+{
+	File = nullptr;
+	Bench = bench;
+	playDevice = playdevice;
+	playDevice->CalcTickRate();
+	Bench->SetFormat(SampleRate, 2 * sizeof(float));
+}
+
 //==========================================================================
 //
 // TimidityWaveWriterMIDIDevice Destructor
@@ -179,9 +199,25 @@ int MIDIWaveWriter::Resume()
 {
 	float writebuffer[4096];
 
-	while (ServiceStream(writebuffer, sizeof(writebuffer)))
+	while (true)
 	{
-		if (File->Write(writebuffer, sizeof(writebuffer)) != sizeof(writebuffer))
+		if (Bench != nullptr)
+		{
+			Bench->BeginBuffer();
+		}
+		if (!ServiceStream(writebuffer, sizeof(writebuffer)))
+		{
+			if (Bench != nullptr)
+			{
+				Bench->AbortBuffer();
+			}
+			break;
+		}
+		if (Bench != nullptr && !Bench->EndBuffer(writebuffer, sizeof(writebuffer)))
+		{
+			break;
+		}
+		if (File != nullptr && File->Write(writebuffer, sizeof(writebuffer)) != sizeof(writebuffer))
 		{
 			Printf("Could not write entire wave file: %s\n", strerror(errno));
 			return 1;
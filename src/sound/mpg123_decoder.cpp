@@ -31,6 +31,8 @@
 **
 */
 
+#include <atomic>
+#include <mutex>
 #include "mpg123_decoder.h"
 #include "i_module.h"
 #include "cmdlib.h"
@@ -57,7 +59,10 @@ bool IsMPG123Present()
 #else
 	static bool cached_result = false;
 	static bool done = false;
+	static std::mutex lock;
 
+	// Sound effects may be decoded on worker threads
+	std::lock_guard<std::mutex> guard(lock);
 	if (!done)
 	{
 		done = true;
@@ -68,7 +73,8 @@ bool IsMPG123Present()
 }
 
 
-static bool inited = false;
+static std::atomic<bool> inited;
+static std::mutex initlock;
 
 
 off_t MPG123Decoder::file_lseek(void *handle, off_t offset, int whence)
@@ -112,9 +118,13 @@ bool MPG123Decoder::open(FileReader &reader)
 {
     if(!inited)
     {
-		if (!IsMPG123Present()) return false;
-		if(mpg123_init() != MPG123_OK) return false;
-		inited = true;
+		std::lock_guard<std::mutex> guard(initlock);
+		if (!inited)
+		{
+			if (!IsMPG123Present()) return false;
+			if(mpg123_init() != MPG123_OK) return false;
+			inited = true;
+		}
     }
 
 	Reader = std::move(reader);
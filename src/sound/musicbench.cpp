@@ -0,0 +1,136 @@
+/*
+** musicbench.cpp
+**
+** Offline render benchmark for the music backends
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <algorithm>
+#include "musicbench.h"
+#include "m_crc32.h"
+#include "doomtype.h"
+
+// Songs that don't end on their own are cut off after this many seconds of audio
+static const double MaxSongLength = 30 * 60;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FMusicBenchmark::FMusicBenchmark(const char *song, const char *synth)
+	: Song(song), Synth(synth)
+{
+	Total.Reset();
+	Buffer.Reset();
+}
+
+void FMusicBenchmark::SetFormat(int samplerate, int framesize)
+{
+	SampleRate = samplerate;
+	FrameSize = framesize;
+}
+
+//==========================================================================
+//
+// Times one buffer
+//
+//==========================================================================
+
+void FMusicBenchmark::BeginBuffer()
+{
+	Buffer.Reset();
+	Buffer.Clock();
+	Total.Clock();
+}
+
+bool FMusicBenchmark::EndBuffer(const void *buffer, int bytes)
+{
+	Total.Unclock();
+	Buffer.Unclock();
+
+	if (SampleRate <= 0 || FrameSize <= 0 || bytes <= 0)
+		return false;
+
+	int frames = bytes / FrameSize;
+	double ms = Buffer.TimeMS();
+	if (ms > PeakMS)
+	{
+		PeakMS = ms;
+		PeakBudgetMS = frames * 1000. / SampleRate;
+	}
+	Hash = AddCRC32(Hash, (const uint8_t *)buffer, bytes);
+	Frames += frames;
+	Buffers++;
+	return AudioSeconds() < MaxSongLength;
+}
+
+void FMusicBenchmark::AbortBuffer()
+{
+	Total.Unclock();
+	Buffer.Unclock();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+double FMusicBenchmark::AudioSeconds() const
+{
+	return SampleRate > 0 ? double(Frames) / SampleRate : 0;
+}
+
+double FMusicBenchmark::RenderSeconds()
+{
+	return Total.Time();
+}
+
+double FMusicBenchmark::RealtimeFactor()
+{
+	double time = RenderSeconds();
+	return time > 0 ? AudioSeconds() / time : 0;
+}
+
+void FMusicBenchmark::Report()
+{
+	if (!HasData())
+	{
+		Printf("%-12s %-12s no output\n", Song.GetChars(), Synth.GetChars());
+		return;
+	}
+	Printf("%-12s %-12s %7.1fs audio in %7.3fs  %7.1fx realtime  peak %6.2f of %.2f ms  %d Hz  crc %08x\n",
+		Song.GetChars(), Synth.GetChars(), AudioSeconds(), RenderSeconds(), RealtimeFactor(),
+		PeakMS, PeakBudgetMS, SampleRate, Hash);
+}
@@ -0,0 +1,92 @@
+/*
+** musicbench.h
+**
+** Offline render benchmark for the music backends
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __MUSICBENCH_H
+#define __MUSICBENCH_H
+
+#include <stdint.h>
+#include "zstring.h"
+#include "stats.h"
+
+//==========================================================================
+//
+// Collects timing and a checksum for one song rendered by one synth.
+//
+// The renderers call BeginBuffer and EndBuffer around every buffer they
+// produce, exactly as the sound system would request it from the stream
+// thread. The checksum covers the raw output so that changes in a synth's
+// output show up between builds.
+//
+//==========================================================================
+
+class FMusicBenchmark
+{
+public:
+	FMusicBenchmark(const char *song, const char *synth);
+
+	// Format of the rendered data. framesize is the size of one stereo sample in bytes.
+	void SetFormat(int samplerate, int framesize);
+
+	void BeginBuffer();
+	// Returns false once the song reached the length limit
+	bool EndBuffer(const void *buffer, int bytes);
+	// Stops the timers for a buffer that the synth could not fill
+	void AbortBuffer();
+
+	bool HasData() const { return Frames > 0; }
+	double AudioSeconds() const;
+	double RenderSeconds();
+	double RealtimeFactor();
+
+	// Prints the result to the console
+	void Report();
+
+	FString Song;
+	FString Synth;
+
+private:
+	int SampleRate = 0;
+	int FrameSize = 0;
+	uint64_t Frames = 0;
+	int Buffers = 0;
+	cycle_t Total;
+	cycle_t Buffer;
+	double PeakMS = 0;
+	double PeakBudgetMS = 0;
+	uint32_t Hash = 0;
+};
+
+#endif
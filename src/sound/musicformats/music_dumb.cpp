@@ -38,6 +38,7 @@
 #include <math.h>
 #include "i_musicinterns.h"
 #include "i_system.h"
+#include "musicbench.h"
 
 #undef CDECL	// w32api's windef.h defines this
 #include "../dumb/include/dumb.h"
@@ -56,6 +57,7 @@ public:
 	bool SetSubsong(int subsong);
 	void Play(bool looping, int subsong);
 	FString GetStats();
+	bool Benchmark(FMusicBenchmark &bench, int subsong);
 
 	FString Codec;
 	FString TrackerVersion;
@@ -1053,6 +1055,40 @@ void input_mod::Play(bool looping, int order)
 	}
 }
 
+//==========================================================================
+//
+// input_mod :: Benchmark
+//
+//==========================================================================
+
+bool input_mod::Benchmark(FMusicBenchmark &bench, int order)
+{
+	float buffer[8 * 1024];
+
+	m_Looping = false;
+	start_order = order;
+	if (!open2(0))
+	{
+		return false;
+	}
+	bench.Synth = "DUMB";
+	bench.SetFormat(srate, 2 * sizeof(float));
+	while (true)
+	{
+		bench.BeginBuffer();
+		if (!read(nullptr, buffer, sizeof(buffer), this))
+		{
+			bench.AbortBuffer();
+			break;
+		}
+		if (!bench.EndBuffer(buffer, sizeof(buffer)))
+		{
+			break;
+		}
+	}
+	return true;
+}
+
 //==========================================================================
 //
 // input_mod :: SetSubsong
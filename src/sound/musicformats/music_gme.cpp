@@ -41,6 +41,7 @@
 #include <gme/gme.h>
 #include "v_text.h"
 #include "templates.h"
+#include "musicbench.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -54,6 +55,7 @@ public:
 	bool SetSubsong(int subsong);
 	void Play(bool looping, int subsong);
 	FString GetStats();
+	bool Benchmark(FMusicBenchmark &bench, int subsong);
 
 protected:
 	FCriticalSection CritSec;
@@ -345,6 +347,42 @@ int GMESong::CalcSongLength()
 	return 150000;
 }
 
+//==========================================================================
+//
+// GMESong :: Benchmark
+//
+// Pulls the track through Read without a stream, as the stream thread
+// would.
+//
+//==========================================================================
+
+bool GMESong::Benchmark(FMusicBenchmark &bench, int track)
+{
+	short buffer[8 * 1024];
+
+	m_Looping = false;
+	if (!StartTrack(track))
+	{
+		return false;
+	}
+	bench.Synth = "GME";
+	bench.SetFormat(SampleRate, 2 * sizeof(short));
+	while (true)
+	{
+		bench.BeginBuffer();
+		if (!Read(nullptr, buffer, sizeof(buffer), this))
+		{
+			bench.AbortBuffer();
+			break;
+		}
+		if (!bench.EndBuffer(buffer, sizeof(buffer)))
+		{
+			break;
+		}
+	}
+	return true;
+}
+
 //==========================================================================
 //
 // GMESong :: Read													STATIC
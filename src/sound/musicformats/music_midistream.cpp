@@ -39,6 +39,7 @@
 #include "templates.h"
 #include "doomerrors.h"
 #include "v_text.h"
+#include "musicbench.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -338,6 +339,42 @@ bool MIDIStreamer::DumpWave(const char *filename, int subsong, int samplerate)
 	return InitPlayback();
 }
 
+//==========================================================================
+//
+// MIDIStreamer :: Benchmark
+//
+// Renders the song through the streamer's device without playing it.
+// Fails if the device could not be created and another one was picked.
+//
+//==========================================================================
+
+bool MIDIStreamer::Benchmark(FMusicBenchmark &bench, int subsong, int samplerate)
+{
+	m_Looping = false;
+	if (source == nullptr) return false;
+	source->SetMIDISubsong(subsong);
+
+	assert(MIDI == NULL);
+	auto devtype = SelectMIDIDevice(DeviceType);
+	if (devtype == MDEV_MMAPI)
+	{
+		return false;
+	}
+	MIDI = CreateMIDIDevice(devtype, samplerate);
+	if (MIDI == nullptr)
+	{
+		return false;
+	}
+	if (MIDI->GetDeviceType() != devtype)
+	{
+		delete MIDI;
+		MIDI = nullptr;
+		return false;
+	}
+	MIDI = new MIDIWaveWriter(&bench, reinterpret_cast<SoftSynthMIDIDevice *>(MIDI));
+	return InitPlayback();
+}
+
 //==========================================================================
 //
 // MIDIStreamer :: InitPlayback
@@ -52,6 +52,7 @@ FModule OpenALModule{"OpenAL"};
 CVAR (String, snd_aldevice, "Default", CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, snd_efx, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (String, snd_alresampler, "Default", CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR (Bool, snd_asyncupdates, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
 #ifdef _WIN32
 #define OPENALLIB "openal32.dll"
@@ -737,9 +738,10 @@ static void LoadALCFunc(ALCdevice *device, const char *name, T *x)
 #define LOAD_FUNC(x)  (LoadALFunc(#x, &x))
 #define LOAD_DEV_FUNC(d, x)  (LoadALCFunc(d, #x, &x))
 OpenALSoundRenderer::OpenALSoundRenderer()
-	: QuitThread(false), Device(NULL), Context(NULL), SFXPaused(0), PrevEnvironment(NULL), EnvSlot(0)
+	: QuitThread(false), QuitCommands(false), Device(NULL), Context(NULL), SFXPaused(0), PrevEnvironment(NULL), EnvSlot(0)
 {
 	EnvFilters[0] = EnvFilters[1] = 0;
+	PendingListener.Flags = 0;
 
 	Printf("I_InitSound: Initializing OpenAL\n");
 
@@ -1038,6 +1040,7 @@ OpenALSoundRenderer::~OpenALSoundRenderer()
 		StreamWake.notify_all();
 		StreamThread.join();
 	}
+	StopCommandThread();
 
 	while(Streams.Size() > 0)
 		delete Streams[0];
@@ -1093,6 +1096,169 @@ void OpenALSoundRenderer::BackgroundProc()
 	}
 }
 
+//==========================================================================
+//
+// Source updates
+//
+// UpdateSoundParams3D, ChannelVolume and UpdateListener run for every
+// playing sound each frame. Instead of making the AL calls right away they
+// only record the new values, keeping at most one entry per source. At the
+// end of the frame UpdateSounds passes the whole batch through a lock-free
+// ring to CommandProc, which applies it inside a single deferred update.
+//
+// Anything that needs the source state to be current (freeing a source,
+// reading its gain, changing the global volume) has to call
+// WaitForCommands first.
+//
+//==========================================================================
+
+OpenALSoundRenderer::SoundCommand *OpenALSoundRenderer::GetPendingCommand(ALuint source)
+{
+	unsigned *index = PendingIndex.CheckKey(source);
+	if(index != NULL)
+		return &PendingCommands[*index];
+
+	PendingIndex[source] = PendingCommands.Size();
+	SoundCommand &cmd = PendingCommands[PendingCommands.Reserve(1)];
+	cmd.Flags = 0;
+	cmd.Source = source;
+	return &cmd;
+}
+
+void OpenALSoundRenderer::DropPendingCommand(ALuint source)
+{
+	unsigned *index = PendingIndex.CheckKey(source);
+	if(index != NULL)
+		PendingCommands[*index].Flags = 0;
+}
+
+void OpenALSoundRenderer::ApplyCommand(const SoundCommand &cmd)
+{
+	if(cmd.Flags & SoundCommand::Listener)
+	{
+		alListenerfv(AL_ORIENTATION, cmd.Orientation);
+		alListenerfv(AL_POSITION, cmd.Position);
+		alListenerfv(AL_VELOCITY, cmd.Velocity);
+		return;
+	}
+	if(cmd.Flags & SoundCommand::SourceParams)
+	{
+		alSourcei(cmd.Source, AL_SOURCE_RELATIVE, cmd.Relative ? AL_TRUE : AL_FALSE);
+		alSourcefv(cmd.Source, AL_POSITION, cmd.Position);
+		alSourcefv(cmd.Source, AL_VELOCITY, cmd.Velocity);
+	}
+	if(cmd.Flags & SoundCommand::SourceGain)
+		alSourcef(cmd.Source, AL_GAIN, cmd.Gain);
+}
+
+void OpenALSoundRenderer::PublishCommands()
+{
+	bool async = snd_asyncupdates;
+
+	if(!async)
+	{
+		StopCommandThread();
+		alDeferUpdatesSOFT();
+	}
+	else if(CommandThread.get_id() == std::thread::id())
+	{
+		QuitCommands = false;
+		CommandThread = std::thread(std::mem_fn(&OpenALSoundRenderer::CommandProc), this);
+	}
+
+	unsigned written = 0;
+	auto add = [&](SoundCommand &cmd)
+	{
+		if(cmd.Flags == 0)
+			return;
+		if(cmd.Flags & SoundCommand::SourceGain)
+			cmd.Gain *= SfxVolume;
+
+		if(!async)
+		{
+			ApplyCommand(cmd);
+			return;
+		}
+		if(!Commands.Write(cmd))
+		{
+			// The ring is full. Let the thread catch up with what's there.
+			Commands.Publish();
+			CommandWake.notify_one();
+			WaitForCommands();
+			Commands.Write(cmd);
+		}
+		written++;
+	};
+
+	add(PendingListener);
+	for(unsigned i = 0;i < PendingCommands.Size();i++)
+		add(PendingCommands[i]);
+	if(!async)
+	{
+		alProcessUpdatesSOFT();
+		getALError();
+	}
+
+	PendingListener.Flags = 0;
+	PendingCommands.Clear();
+	PendingIndex.Clear();
+
+	if(written > 0)
+	{
+		Commands.Publish();
+		std::unique_lock<std::mutex> lock(CommandLock);
+		lock.unlock();
+		CommandWake.notify_one();
+	}
+}
+
+void OpenALSoundRenderer::WaitForCommands()
+{
+	while(!Commands.IsDrained())
+	{
+		CommandWake.notify_one();
+		std::this_thread::yield();
+	}
+}
+
+void OpenALSoundRenderer::StopCommandThread()
+{
+	if(!CommandThread.joinable())
+		return;
+
+	std::unique_lock<std::mutex> lock(CommandLock);
+	QuitCommands = true;
+	lock.unlock();
+	CommandWake.notify_all();
+	CommandThread.join();
+	CommandThread = std::thread();
+}
+
+void OpenALSoundRenderer::CommandProc()
+{
+	std::unique_lock<std::mutex> lock(CommandLock);
+	while(true)
+	{
+		CommandWake.wait(lock, [&]() { return QuitCommands || Commands.HasPending(); });
+
+		// Always finish what was published, so WaitForCommands can't hang
+		unsigned count = Commands.Count();
+		if(count > 0)
+		{
+			lock.unlock();
+			alDeferUpdatesSOFT();
+			for(unsigned i = 0;i < count;i++)
+				ApplyCommand(Commands[i]);
+			alProcessUpdatesSOFT();
+			getALError();
+			Commands.Pop(count);
+			lock.lock();
+		}
+		else if(QuitCommands)
+			break;
+	}
+}
+
 void OpenALSoundRenderer::AddStream(OpenALSoundStream *stream)
 {
 	std::unique_lock<std::mutex> lock(StreamLock);
@@ -1112,6 +1278,7 @@ void OpenALSoundRenderer::RemoveStream(OpenALSoundStream *stream)
 
 void OpenALSoundRenderer::SetSfxVolume(float volume)
 {
+	WaitForCommands();
 	SfxVolume = volume;
 
 	FSoundChan *schan = Channels;
@@ -1175,6 +1342,19 @@ unsigned int OpenALSoundRenderer::GetSampleLength(SoundHandle sfx)
 	return 0;
 }
 
+unsigned int OpenALSoundRenderer::GetMemoryUsage(SoundHandle sfx)
+{
+	if(sfx.data)
+	{
+		ALuint buffer = GET_PTRID(sfx.data);
+		ALint size;
+		alGetBufferi(buffer, AL_SIZE, &size);
+		if(getALError() == AL_NO_ERROR)
+			return (unsigned int)size;
+	}
+	return 0;
+}
+
 float OpenALSoundRenderer::GetOutputRate()
 {
 	ALCint rate = 44100; // Default, just in case
@@ -1863,14 +2043,17 @@ void OpenALSoundRenderer::ChannelVolume(FISoundChannel *chan, float volume)
 	if(chan == NULL || chan->SysChannel == NULL)
 		return;
 
-	alDeferUpdatesSOFT();
-
-	ALuint source = GET_PTRID(chan->SysChannel);
-	alSourcef(source, AL_GAIN, SfxVolume * volume);
+	SoundCommand *cmd = GetPendingCommand(GET_PTRID(chan->SysChannel));
+	cmd->Flags |= SoundCommand::SourceGain;
+	cmd->Gain = volume;
 }
 
 void OpenALSoundRenderer::FreeSource(ALuint source)
 {
+	// The source may get reused right away, so nothing queued for it may be applied later
+	DropPendingCommand(source);
+	WaitForCommands();
+
 	alSourceRewind(source);
 	alSourcei(source, AL_BUFFER, 0);
 	getALError();
@@ -1903,6 +2086,8 @@ void OpenALSoundRenderer::StopChannel(FISoundChannel *chan)
 	{
 		// The sound is being killed while playing, so set its gain to 0 and track it
 		// as it fades.
+		DropPendingCommand(source);
+		WaitForCommands();
 		alSourcef(source, AL_GAIN, 0.f);
 		getALError();
 
@@ -2056,21 +2241,24 @@ void OpenALSoundRenderer::UpdateSoundParams3D(SoundListener *listener, FISoundCh
 	}
 	dir += listener->position;
 
-	alDeferUpdatesSOFT();
-	ALuint source = GET_PTRID(chan->SysChannel);
+	SoundCommand *cmd = GetPendingCommand(GET_PTRID(chan->SysChannel));
+	cmd->Flags |= SoundCommand::SourceParams;
 
 	if(chan->DistanceSqr < (0.0004f*0.0004f))
 	{
-		alSourcei(source, AL_SOURCE_RELATIVE, AL_TRUE);
-		alSource3f(source, AL_POSITION, 0.f, 0.f, 0.f);
+		cmd->Relative = true;
+		cmd->Position[0] = cmd->Position[1] = cmd->Position[2] = 0.f;
 	}
 	else
 	{
-		alSourcei(source, AL_SOURCE_RELATIVE, AL_FALSE);
-		alSource3f(source, AL_POSITION, dir[0], dir[1], -dir[2]);
+		cmd->Relative = false;
+		cmd->Position[0] = dir[0];
+		cmd->Position[1] = dir[1];
+		cmd->Position[2] = -dir[2];
 	}
-	alSource3f(source, AL_VELOCITY, vel[0], vel[1], -vel[2]);
-	getALError();
+	cmd->Velocity[0] = vel[0];
+	cmd->Velocity[1] = vel[1];
+	cmd->Velocity[2] = -vel[2];
 }
 
 void OpenALSoundRenderer::UpdateListener(SoundListener *listener)
@@ -2078,10 +2266,11 @@ void OpenALSoundRenderer::UpdateListener(SoundListener *listener)
 	if(!listener->valid)
 		return;
 
-	alDeferUpdatesSOFT();
+	SoundCommand &cmd = PendingListener;
+	cmd.Flags = SoundCommand::Listener;
 
 	float angle = listener->angle;
-	ALfloat orient[6];
+	ALfloat *orient = cmd.Orientation;
 	// forward
 	orient[0] = cosf(angle);
 	orient[1] = 0.f;
@@ -2091,14 +2280,12 @@ void OpenALSoundRenderer::UpdateListener(SoundListener *listener)
 	orient[4] = 1.f;
 	orient[5] = 0.f;
 
-	alListenerfv(AL_ORIENTATION, orient);
-	alListener3f(AL_POSITION, listener->position.X,
-	                          listener->position.Y,
-	                         -listener->position.Z);
-	alListener3f(AL_VELOCITY, listener->velocity.X,
-	                          listener->velocity.Y,
-	                         -listener->velocity.Z);
-	getALError();
+	cmd.Position[0] =  listener->position.X;
+	cmd.Position[1] =  listener->position.Y;
+	cmd.Position[2] = -listener->position.Z;
+	cmd.Velocity[0] =  listener->velocity.X;
+	cmd.Velocity[1] =  listener->velocity.Y;
+	cmd.Velocity[2] = -listener->velocity.Z;
 
 	const ReverbContainer *env = ForcedEnvironment;
 	if(!env)
@@ -2176,6 +2363,8 @@ void OpenALSoundRenderer::UpdateListener(SoundListener *listener)
 
 void OpenALSoundRenderer::UpdateSounds()
 {
+	// Sources may get freed below, so the previous batch must be done
+	WaitForCommands();
 	alProcessUpdatesSOFT();
 
 	if(!FadingSources.empty())
@@ -2195,6 +2384,10 @@ void OpenALSoundRenderer::UpdateSounds()
 		}
 	}
 
+	// Free stopped sources before the new batch goes out so this doesn't have to wait for it
+	PurgeStoppedSources();
+	PublishCommands();
+
 	if(ALC.EXT_disconnect)
 	{
 		ALCint connected = ALC_TRUE;
@@ -2207,8 +2400,6 @@ void OpenALSoundRenderer::UpdateSounds()
 			return;
 		}
 	}
-
-	PurgeStoppedSources();
 }
 
 bool OpenALSoundRenderer::IsValid()
@@ -2231,8 +2422,15 @@ float OpenALSoundRenderer::GetAudibility(FISoundChannel *chan)
 	ALuint source = GET_PTRID(chan->SysChannel);
 	ALfloat volume = 0.f;
 
-	alGetSourcef(source, AL_GAIN, &volume);
-	getALError();
+	unsigned *index = PendingIndex.CheckKey(source);
+	if(index != NULL && (PendingCommands[*index].Flags & SoundCommand::SourceGain))
+		volume = SfxVolume * PendingCommands[*index].Gain;
+	else
+	{
+		WaitForCommands();
+		alGetSourcef(source, AL_GAIN, &volume);
+		getALError();
+	}
 
 	volume *= GetRolloff(&chan->Rolloff, sqrtf(chan->DistanceSqr) * chan->DistanceScale);
 	return volume;
@@ -10,6 +10,7 @@
 #include "i_sound.h"
 #include "s_sound.h"
 #include "menu/menu.h"
+#include "spscqueue.h"
 
 #ifndef NO_OPENAL
 
@@ -132,6 +133,7 @@ public:
 	virtual void UnloadSound(SoundHandle sfx);
 	virtual unsigned int GetMSLength(SoundHandle sfx);
 	virtual unsigned int GetSampleLength(SoundHandle sfx);
+	virtual unsigned int GetMemoryUsage(SoundHandle sfx);
 	virtual float GetOutputRate();
 
 	// Streaming sounds.
@@ -243,6 +245,34 @@ private:
     void AddStream(OpenALSoundStream *stream);
     void RemoveStream(OpenALSoundStream *stream);
 
+	// Per frame source and listener updates. These are collected during the
+	// frame, one per source, and handed to CommandProc by UpdateSounds.
+	struct SoundCommand
+	{
+		enum
+		{
+			SourceParams = 1,
+			SourceGain = 2,
+			Listener = 4
+		};
+
+		int Flags;
+		ALuint Source;
+		bool Relative;
+		ALfloat Gain;
+		ALfloat Position[3];
+		ALfloat Velocity[3];
+		ALfloat Orientation[6];
+	};
+
+	SoundCommand *GetPendingCommand(ALuint source);
+	void DropPendingCommand(ALuint source);
+	void PublishCommands();
+	void ApplyCommand(const SoundCommand &cmd);
+	void WaitForCommands();
+	void StopCommandThread();
+	void CommandProc();
+
 	void LoadReverb(const ReverbContainer *env);
 	void FreeSource(ALuint source);
 	void PurgeStoppedSources();
@@ -254,6 +284,15 @@ private:
     std::condition_variable StreamWake;
     std::atomic<bool> QuitThread;
 
+	TArray<SoundCommand> PendingCommands;
+	TMap<ALuint,unsigned> PendingIndex;
+	SoundCommand PendingListener;
+	TSPSCQueue<SoundCommand, 1024> Commands;
+	std::thread CommandThread;
+	std::mutex CommandLock;
+	std::condition_variable CommandWake;
+	bool QuitCommands;
+
 	ALCdevice *Device;
 	ALCcontext *Context;
 
@@ -75,6 +75,16 @@ OPNMIDI_EXPORT int opn2_setNumChips(OPN2_MIDIPlayer *device, int numCards)
     return opn2RefreshNumCards(device);
 }
 
+OPNMIDI_EXPORT int opn2_setChipThreads(struct OPN2_MIDIPlayer *device, int threads)
+{
+    if(device == NULL)
+        return -2;
+
+    OPNMIDIplay *play = reinterpret_cast<OPNMIDIplay *>(device->opn2_midiPlayer);
+    play->chipPool.SetThreads(threads);
+    return 0;
+}
+
 OPNMIDI_EXPORT int opn2_getNumChips(struct OPN2_MIDIPlayer *device)
 {
     if(device == NULL)
@@ -508,6 +518,34 @@ inline static void SendStereoAudio(int      &samples_requested,
 }
 
 
+/* Renders every chip into its own buffer, on worker threads if enabled, and mixes them in chip order */
+static void GenerateChips(OPNMIDIplay *player, int16_t *out_buf, ssize_t in_generatedStereo)
+{
+    unsigned int chips = player->opn.NumCards;
+    #ifdef OPNMIDI_USE_LEGACY_EMULATOR
+    if(in_generatedStereo <= 0)
+        return;
+
+    size_t count = static_cast<size_t>(in_generatedStereo) * 2;
+    if(player->chipBuf.size() < chips * 1024)
+        player->chipBuf.resize(chips * 1024);
+
+    player->chipPool.Run(static_cast<int>(chips), [&](int card)
+    {
+        int16_t *buf = &player->chipBuf[static_cast<size_t>(card) * 1024];
+        std::memset(buf, 0, count * sizeof(int16_t));
+        player->opn.cardsOP2[static_cast<size_t>(card)]->run(int(in_generatedStereo), buf);
+    });
+
+    /* The emulator adds to the buffer without clamping, so the order doesn't matter here */
+    for(unsigned card = 0; card < chips; ++card)
+        ChipMixWrap(out_buf, &player->chipBuf[card * 1024], count);
+    #else
+    for(unsigned card = 0; card < chips; ++card)
+        OPN2_GenerateStreamMix(player->opn.cardsOP2[card], out_buf, (Bit32u)in_generatedStereo);
+    #endif
+}
+
 OPNMIDI_EXPORT int opn2_play(OPN2_MIDIPlayer *device, int sampleCount, short *out)
 {
 #ifndef OPNMIDI_DISABLE_MIDI_SEQUENCER
@@ -576,14 +614,7 @@ OPNMIDI_EXPORT int opn2_play(OPN2_MIDIPlayer *device, int sampleCount, short *ou
                 else/* if(n_periodCountStereo > 0)*/
                 {
                     /* Generate data from every chip and mix result */
-                    for(unsigned card = 0; card < chips; ++card)
-                    {
-                        #ifdef OPNMIDI_USE_LEGACY_EMULATOR
-                        player->opn.cardsOP2[card]->run(int(in_generatedStereo), out_buf);
-                        #else
-                        OPN2_GenerateStreamMix(player->opn.cardsOP2[card], out_buf, (Bit32u)in_generatedStereo);
-                        #endif
-                    }
+                    GenerateChips(player, out_buf, in_generatedStereo);
                 }
                 /* Process it */
                 SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out);
@@ -658,14 +689,7 @@ OPNMIDI_EXPORT int opn2_generate(struct OPN2_MIDIPlayer *device, int sampleCount
                 else/* if(n_periodCountStereo > 0)*/
                 {
                     /* Generate data from every chip and mix result */
-                    for(unsigned card = 0; card < chips; ++card)
-                    {
-                        #ifdef OPNMIDI_USE_LEGACY_EMULATOR
-                        player->opn.cardsOP2[card]->run(int(in_generatedStereo), out_buf);
-                        #else
-                        OPN2_GenerateStreamMix(player->opn.cardsOP2[card], out_buf, (Bit32u)in_generatedStereo);
-                        #endif
-                    }
+                    GenerateChips(player, out_buf, in_generatedStereo);
                 }
                 /* Process it */
                 SendStereoAudio(sampleCount, in_generatedStereo, out_buf, gotten_len, out);
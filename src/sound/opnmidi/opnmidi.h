@@ -74,6 +74,9 @@ struct OPN2_MIDIPlayer
 /* Sets number of emulated sound cards (from 1 to 100). Emulation of multiple sound cards exchanges polyphony limits*/
 extern int  opn2_setNumChips(struct OPN2_MIDIPlayer *device, int numCards);
 
+/* Sets the number of threads that render the chips. 0 = automatic, 1 = render serially */
+extern int  opn2_setChipThreads(struct OPN2_MIDIPlayer *device, int threads);
+
 /* Get current number of emulated chips */
 extern int  opn2_getNumChips(struct OPN2_MIDIPlayer *device);
 
@@ -93,6 +93,7 @@ typedef __int32 ssize_t;
 #endif
 
 #include "opnbank.h"
+#include "chipthreads.h"
 #include "opnmidi.h"
 
 #define ADL_UNUSED(x) (void)x
@@ -762,6 +763,10 @@ public:
 
     int16_t outBuf[1024];
 
+    //! Per chip output for rendering several chips in parallel
+    std::vector<int16_t> chipBuf;
+    FChipRenderPool chipPool;
+
     Setup m_setup;
 
     static uint64_t ReadBEint(const void *buffer, size_t nbytes);
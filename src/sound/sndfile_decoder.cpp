@@ -30,6 +30,7 @@
 **---------------------------------------------------------------------------
 **
 */
+#include <mutex>
 #include "sndfile_decoder.h"
 #include "templates.h"
 #include "i_module.h"
@@ -57,7 +58,10 @@ bool IsSndFilePresent()
 #else
 	static bool cached_result = false;
 	static bool done = false;
+	static std::mutex lock;
 
+	// Sound effects may be decoded on worker threads
+	std::lock_guard<std::mutex> guard(lock);
 	if (!done)
 	{
 		done = true;
@@ -0,0 +1,110 @@
+/*
+** spscqueue.h
+**
+** Lock-free single producer, single consumer queue
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __SPSCQUEUE_H
+#define __SPSCQUEUE_H
+
+#include <atomic>
+
+//==========================================================================
+//
+// Fixed size ring buffer for passing items from exactly one producer thread
+// to exactly one consumer thread without locking.
+//
+// The producer writes any number of items and makes them visible together
+// with Publish. The consumer reads the published items by index and only
+// releases their slots with Pop once it is done with them, so IsDrained
+// tells the producer that everything it published has been fully handled.
+//
+//==========================================================================
+
+template<class T, unsigned N>
+class TSPSCQueue
+{
+	static_assert((N & (N - 1)) == 0, "Queue size must be a power of two");
+
+public:
+	// Producer side. Returns false if the queue is full.
+	bool Write(const T &item)
+	{
+		if (WritePos - Tail.load(std::memory_order_acquire) >= N)
+			return false;
+		Items[WritePos & (N - 1)] = item;
+		WritePos++;
+		return true;
+	}
+
+	void Publish()
+	{
+		Head.store(WritePos, std::memory_order_release);
+	}
+
+	bool IsDrained() const
+	{
+		return Tail.load(std::memory_order_acquire) == Head.load(std::memory_order_relaxed);
+	}
+
+	// Consumer side
+	// Index 0 is the oldest published item that has not been popped yet. Only valid for
+	// i < Count(), and the reference stays valid until Pop releases that slot.
+	T &operator[](unsigned i)
+	{
+		return Items[(Tail.load(std::memory_order_relaxed) + i) & (N - 1)];
+	}
+
+	unsigned Count() const
+	{
+		return Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_relaxed);
+	}
+
+	void Pop(unsigned count = 1)
+	{
+		Tail.store(Tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+	bool HasPending() const
+	{
+		return Tail.load(std::memory_order_acquire) != Head.load(std::memory_order_acquire);
+	}
+
+private:
+	T Items[N];
+	unsigned WritePos = 0;
+	alignas(64) std::atomic<unsigned> Head { 0 };
+	alignas(64) std::atomic<unsigned> Tail { 0 };
+};
+
+#endif
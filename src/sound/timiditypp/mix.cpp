@@ -23,6 +23,9 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 #include "timidity.h"
 #include "common.h"
@@ -57,6 +60,75 @@ typedef int32_t mix_t;
 	if (++pan_delay_wpt == PAN_DELAY_BUF_MAX) {pan_delay_wpt = 0;}
 
 
+/* Vectorized versions of the MIXATION loops for runs with constant volume.
+ * The integer math is the same as in the scalar loops, so the output does
+ * not change.
+ */
+#ifndef NO_SSE
+/* SSE2 has no 32 bit multiply. The low halves of the unsigned products are the same. */
+static inline __m128i mullo_epi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+/* lp[i] += sp[i] * vol */
+static inline void mix_run_mono(const mix_t *sp, int32_t *lp, int32_t vol, int count)
+{
+	int i = 0;
+#ifndef NO_SSE
+	__m128i v = _mm_set1_epi32(vol);
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(sp + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(lp + i));
+		_mm_storeu_si128((__m128i*)(lp + i), _mm_add_epi32(d, mullo_epi32(s, v)));
+	}
+#endif
+	for (; i < count; i++)
+		lp[i] += sp[i] * vol;
+}
+
+/* lp[i * 2] += sp[i] * left, lp[i * 2 + 1] += sp[i] * right */
+static inline void mix_run_stereo(const mix_t *sp, int32_t *lp, int32_t left, int32_t right, int count)
+{
+	int i = 0;
+#ifndef NO_SSE
+	__m128i v = _mm_setr_epi32(left, right, left, right);
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(sp + i));
+		__m128i d0 = _mm_loadu_si128((const __m128i*)(lp + i * 2));
+		__m128i d1 = _mm_loadu_si128((const __m128i*)(lp + i * 2 + 4));
+		_mm_storeu_si128((__m128i*)(lp + i * 2), _mm_add_epi32(d0, mullo_epi32(_mm_unpacklo_epi32(s, s), v)));
+		_mm_storeu_si128((__m128i*)(lp + i * 2 + 4), _mm_add_epi32(d1, mullo_epi32(_mm_unpackhi_epi32(s, s), v)));
+	}
+#endif
+	for (; i < count; i++) {
+		lp[i * 2] += sp[i] * left;
+		lp[i * 2 + 1] += sp[i] * right;
+	}
+}
+
+/* lp[i * 2] += sp[i] * vol, leaving the other channel alone */
+static inline void mix_run_single(const mix_t *sp, int32_t *lp, int32_t vol, int count)
+{
+	int i = 0;
+#ifndef NO_SSE
+	/* The odd lanes get 0 added. The last sample is left to the scalar
+	 * loop so that nothing past the end of the buffer is touched. */
+	__m128i v = _mm_setr_epi32(vol, 0, vol, 0);
+	for (; i + 4 < count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(sp + i));
+		__m128i d0 = _mm_loadu_si128((const __m128i*)(lp + i * 2));
+		__m128i d1 = _mm_loadu_si128((const __m128i*)(lp + i * 2 + 4));
+		_mm_storeu_si128((__m128i*)(lp + i * 2), _mm_add_epi32(d0, mullo_epi32(_mm_unpacklo_epi32(s, s), v)));
+		_mm_storeu_si128((__m128i*)(lp + i * 2 + 4), _mm_add_epi32(d1, mullo_epi32(_mm_unpackhi_epi32(s, s), v)));
+	}
+#endif
+	for (; i < count; i++)
+		lp[i * 2] += sp[i] * vol;
+}
 
 
 /**************** interface function ****************/
@@ -342,10 +414,9 @@ void Mixer::mix_mono_signal(
 			}
 			vp->old_left_mix = linear_left;
 			cc -= i;
-			for (i = 0; i < cc; i++) {
-				s = *sp++;
-				MIXATION(left);
-			}
+			mix_run_mono(sp, lp, left, cc);
+			sp += cc;
+			lp += cc;
 			cc = control_ratio;
 			if (update_signal(v))
 				/* Envelope ran out */
@@ -376,10 +447,9 @@ void Mixer::mix_mono_signal(
 			}
 			vp->old_left_mix = linear_left;
 			count -= i;
-			for (i = 0; i < count; i++) {
-				s = *sp++;
-				MIXATION(left);
-			}
+			mix_run_mono(sp, lp, left, count);
+			sp += count;
+			lp += count;
 			return;
 		}
 }
@@ -506,11 +576,9 @@ void Mixer::mix_mystery_signal(
 			vp->old_right_mix = linear_right;
 			cc -= i;
 			if(vp->pan_delay_rpt == 0) {
-				for (i = 0; i < cc; i++) {
-					s = *sp++;
-					MIXATION(left);
-					MIXATION(right);
-				}
+				mix_run_stereo(sp, lp, left, right, cc);
+				sp += cc;
+				lp += cc * 2;
 			} else if(vp->panning < 64) {
 				for (i = 0; i < cc; i++) {
 					s = *sp++;
@@ -633,11 +701,9 @@ void Mixer::mix_mystery_signal(
 			vp->old_right_mix = linear_right;
 			count -= i;
 			if(vp->pan_delay_rpt == 0) {
-				for (i = 0; i < count; i++) {
-					s = *sp++;
-					MIXATION(left);
-					MIXATION(right);
-				}
+				mix_run_stereo(sp, lp, left, right, count);
+				sp += count;
+				lp += count * 2;
 			} else if(vp->panning < 64) {
 				for (i = 0; i < count; i++) {
 					s = *sp++;
@@ -767,11 +833,9 @@ void Mixer::mix_mystery(mix_t *sp, int32_t *lp, int v, int count)
 	vp->old_right_mix = linear_right;
 	count -= i;
 	if(vp->pan_delay_rpt == 0) {
-		for (i = 0; i < count; i++) {
-			s = *sp++;
-			MIXATION(left);
-			MIXATION(right);
-		}
+		mix_run_stereo(sp, lp, left, right, count);
+		sp += count;
+		lp += count * 2;
 	} else if(vp->panning < 64) {
 		for (i = 0; i < count; i++) {
 			s = *sp++;
@@ -833,11 +897,9 @@ void Mixer::mix_center_signal(
 			}
 			vp->old_left_mix = vp->old_right_mix = linear_left;
 			cc -= i;
-			for (i = 0; i < cc; i++) {
-				s = *sp++;
-				MIXATION(left);
-				MIXATION(left);
-			}
+			mix_run_stereo(sp, lp, left, left, cc);
+			sp += cc;
+			lp += cc * 2;
 			cc = control_ratio;
 			if (update_signal(v))
 				/* Envelope ran out */
@@ -869,11 +931,9 @@ void Mixer::mix_center_signal(
 			}
 			vp->old_left_mix = vp->old_right_mix = linear_left;
 			count -= i;
-			for (i = 0; i < count; i++) {
-				s = *sp++;
-				MIXATION(left);
-				MIXATION(left);
-			}
+			mix_run_stereo(sp, lp, left, left, count);
+			sp += count;
+			lp += count * 2;
 			return;
 		}
 }
@@ -910,11 +970,9 @@ void Mixer::mix_center(mix_t *sp, int32_t *lp, int v, int count)
 	}
 	vp->old_left_mix = vp->old_right_mix = linear_left;
 	count -= i;
-	for (i = 0; i < count; i++) {
-		s = *sp++;
-		MIXATION(left);
-		MIXATION(left);
-	}
+	mix_run_stereo(sp, lp, left, left, count);
+	sp += count;
+	lp += count * 2;
 }
 
 void Mixer::mix_single_signal(mix_t *sp, int32_t *lp, int v, int count)
@@ -959,11 +1017,9 @@ void Mixer::mix_single_signal(mix_t *sp, int32_t *lp, int v, int count)
 			}
 			vp->old_left_mix = linear_left;
 			cc -= i;
-			for (i = 0; i < cc; i++) {
-				s = *sp++;
-				MIXATION(left);
-				lp++;
-			}
+			mix_run_single(sp, lp, left, cc);
+			sp += cc;
+			lp += cc * 2;
 			cc = control_ratio;
 			if (update_signal(v))
 				/* Envelope ran out */
@@ -995,11 +1051,9 @@ void Mixer::mix_single_signal(mix_t *sp, int32_t *lp, int v, int count)
 			}
 			vp->old_left_mix = linear_left;
 			count -= i;
-			for (i = 0; i < count; i++) {
-				s = *sp++;
-				MIXATION(left);
-				lp++;
-			}
+			mix_run_single(sp, lp, left, count);
+			sp += count;
+			lp += count * 2;
 			return;
 		}
 }
@@ -1036,11 +1090,9 @@ void Mixer::mix_single(mix_t *sp, int32_t *lp, int v, int count)
 	}
 	vp->old_left_mix = linear_left;
 	count -= i;
-	for (i = 0; i < count; i++) {
-		s = *sp++;
-		MIXATION(left);
-		lp++;
-	}
+	mix_run_single(sp, lp, left, count);
+	sp += count;
+	lp += count * 2;
 }
 
 /* Returns 1 if the note died */
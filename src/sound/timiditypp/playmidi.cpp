@@ -59,6 +59,7 @@ namespace TimidityPlus
 	float timidity_drum_power = 1.f;
 	int timidity_key_adjust = 0;
 	float timidity_tempo_adjust = 1.f;
+	int timidity_mix_threads = 1;
 
 	// The following options have no generic use and are only meaningful for some SYSEX events not normally found in common MIDIs.
 	// For now they are kept as unchanging global variables
@@ -189,6 +190,13 @@ CUSTOM_CVAR(Int, timidity_key_adjust, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 	else if (self > 24) self = 24;
 	ChangeVarSync(TimidityPlus::timidity_key_adjust, *self);
 }
+// Number of threads mixing the voices. 0 = one less than the number of cores, 1 = mix on the stream thread only.
+CUSTOM_CVAR(Int, timidity_mix_threads, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else ChangeVarSync(TimidityPlus::timidity_mix_threads, *self);
+}
+
 // For testing mainly.
 CUSTOM_CVAR(Float, timidity_tempo_adjust, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
@@ -304,6 +312,7 @@ Player::~Player()
 	if (reverb_buffer != nullptr) free(reverb_buffer);
 	for (int i = 0; i < MAX_CHANNELS; i++) free_drum_effect(i);
 	delete mixer;
+	for (int i = 0; i < MAX_CHANNELS; i++) delete mix_tasks[i].mixer;
 	delete recache;
 	delete effect;
 	delete reverb;
@@ -4873,6 +4882,124 @@ int Player::is_insertion_effect_xg(int ch)
 	return 0;
 }
 
+/* Returns the buffer a voice is mixed into */
+int32_t *Player::get_voice_buffer(int v, int32_t **vpblist, int channel_effect)
+{
+	int32_t *vpb = NULL;
+	int j, ch, note;
+	int8_t flag;
+
+	if (channel_effect) {
+		flag = 0;
+		ch = voice[v].channel;
+		if (timidity_drum_effect && ISDRUMCHANNEL(ch)) {
+			make_drum_effect(ch);
+			note = voice[v].note;
+			for (j = 0; j < channel[ch].drum_effect_num; j++) {
+				if (channel[ch].drum_effect[j].note == note) {
+					vpb = channel[ch].drum_effect[j].buf;
+					flag = 1;
+				}
+			}
+			if (flag == 0) {vpb = vpblist[ch];}
+		} else {
+			vpb = vpblist[ch];
+		}
+	} else {
+		vpb = buffer_pointer;
+	}
+	return vpb;
+}
+
+void Player::mix_one_voice(Mixer *m, int v, int32_t *vpb, int32_t count)
+{
+	if(!IS_SET_CHANNELMASK(channel_mute, voice[v].channel)) {
+		m->mix_voice(vpb, v, count);
+	} else {
+		free_voice(v);
+	}
+
+	if(voice[v].timeout == 1 && voice[v].timeout < current_sample) {
+		free_voice(v);
+	}
+}
+
+/* Mixes the voices on worker threads, one task per MIDI channel. Mixing a
+ * voice can change the state of its channel and of its chorus partner, which
+ * plays on the same channel, so each channel's voices are done in order by
+ * the same task. Voices that go into buffers shared between channels are
+ * mixed into a private copy first. All mixing is integer addition, so adding
+ * the copies afterwards gives exactly the same result as the serial loop.
+ * Returns false if the voices should be mixed serially instead.
+ */
+int Player::mix_voices_parallel(int32_t **vpblist, int channel_effect, int32_t count)
+{
+	int i, k, ntasks = 0, nvoices = 0;
+
+	if (timidity_mix_threads == 1)
+		return 0;
+	if (timidity_mix_threads != mix_threads) {
+		mix_threads = timidity_mix_threads;
+		mix_pool.SetThreads(mix_threads);
+	}
+
+	for (i = 0; i < upper_voices; i++) {
+		if (voice[i].status != VOICE_FREE) {
+			MixTask &task = mix_tasks[voice[i].channel];
+			if (task.voices.empty())
+				mix_task_channels[ntasks++] = voice[i].channel;
+			task.voices.push_back(i);
+			nvoices++;
+		}
+	}
+	if (ntasks < 2 || nvoices < MIN_PARALLEL_MIX_VOICES) {
+		for (i = 0; i < ntasks; i++)
+			mix_tasks[mix_task_channels[i]].voices.clear();
+		return 0;
+	}
+
+	int32_t *shared[2] = { buffer_pointer, insertion_effect_buffer };
+	mix_pool.Run(ntasks, [&](int t)
+	{
+		MixTask &task = mix_tasks[mix_task_channels[t]];
+		if (task.mixer == NULL)
+			task.mixer = new Mixer(this);
+		task.used[0] = task.used[1] = false;
+
+		for (int v : task.voices) {
+			if (voice[v].status == VOICE_FREE)
+				continue;
+			int32_t *vpb = get_voice_buffer(v, vpblist, channel_effect);
+			for (int b = 0; b < 2; b++) {
+				if (vpb == shared[b]) {
+					if (!task.used[b]) {
+						if (task.buffers[b].empty())
+							task.buffers[b].resize(AUDIO_BUFFER_SIZE * 2);
+						memset(&task.buffers[b][0], 0, count * 2 * sizeof(int32_t));
+						task.used[b] = true;
+					}
+					vpb = &task.buffers[b][0];
+					break;
+				}
+			}
+			mix_one_voice(task.mixer, v, vpb, count);
+		}
+	});
+
+	for (i = 0; i < ntasks; i++) {
+		MixTask &task = mix_tasks[mix_task_channels[i]];
+		for (int b = 0; b < 2; b++) {
+			if (task.used[b]) {
+				int32_t *src = &task.buffers[b][0];
+				for (k = 0; k < count * 2; k++)
+					shared[b][k] += src[k];
+			}
+		}
+		task.voices.clear();
+	}
+	return 1;
+}
+
 /* do_compute_data_midi() with DSP Effect */
 void Player::do_compute_data(int32_t count)
 {
@@ -4950,39 +5077,10 @@ void Player::do_compute_data(int32_t count)
 		if(buf_index) {memset(reverb_buffer, 0, buf_index);}
 	}
 
-	for (i = 0; i < uv; i++) {
-		if (voice[i].status != VOICE_FREE) {
-			int32_t *vpb = NULL;
-			int8_t flag;
-			
-			if (channel_effect) {
-				flag = 0;
-				ch = voice[i].channel;
-				if (timidity_drum_effect && ISDRUMCHANNEL(ch)) {
-					make_drum_effect(ch);
-					note = voice[i].note;
-					for (j = 0; j < channel[ch].drum_effect_num; j++) {
-						if (channel[ch].drum_effect[j].note == note) {
-							vpb = channel[ch].drum_effect[j].buf;
-							flag = 1;
-						}
-					}
-					if (flag == 0) {vpb = vpblist[ch];}
-				} else {
-					vpb = vpblist[ch];
-				}
-			} else {
-				vpb = buffer_pointer;
-			}
-
-			if(!IS_SET_CHANNELMASK(channel_mute, voice[i].channel)) {
-				mixer->mix_voice(vpb, i, count);
-			} else {
-				free_voice(i);
-			}
-
-			if(voice[i].timeout == 1 && voice[i].timeout < current_sample) {
-				free_voice(i);
+	if (!mix_voices_parallel(vpblist, channel_effect, count)) {
+		for (i = 0; i < uv; i++) {
+			if (voice[i].status != VOICE_FREE) {
+				mix_one_voice(mixer, i, get_voice_buffer(i, vpblist, channel_effect), count);
 			}
 		}
 	}
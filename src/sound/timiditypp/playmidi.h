@@ -23,6 +23,8 @@
 #ifndef ___PLAYMIDI_H_
 #define ___PLAYMIDI_H_
 #include <stdint.h>
+#include <vector>
+#include "chipthreads.h"
 
 namespace TimidityPlus
 {
@@ -572,6 +574,20 @@ private:
 
 	int32_t insertion_effect_buffer[AUDIO_BUFFER_SIZE * 2];
 
+	/* For mixing the voices on several threads */
+	enum { MIN_PARALLEL_MIX_VOICES = 16 };
+	struct MixTask
+	{
+		Mixer *mixer = nullptr;
+		std::vector<int> voices;
+		std::vector<int32_t> buffers[2];	/* private copies of buffer_pointer and insertion_effect_buffer */
+		bool used[2] = { false, false };
+	};
+	MixTask mix_tasks[MAX_CHANNELS];
+	int mix_task_channels[MAX_CHANNELS];
+	FChipRenderPool mix_pool;
+	int mix_threads = 1;
+
 
 	/* Ring voice id for each notes.  This ID enables duplicated note. */
 	uint8_t vidq_head[128 * MAX_CHANNELS], vidq_tail[128 * MAX_CHANNELS];
@@ -646,6 +662,9 @@ private:
 	void voice_decrement_conservative(int n);
 	void mix_signal(int32_t *dest, int32_t *src, int32_t count);
 	int is_insertion_effect_xg(int ch);
+	int32_t *get_voice_buffer(int v, int32_t **vpblist, int channel_effect);
+	void mix_one_voice(Mixer *m, int v, int32_t *vpb, int32_t count);
+	int mix_voices_parallel(int32_t **vpblist, int channel_effect, int32_t count);
 	void do_compute_data(int32_t count);
 	int check_midi_play_end(MidiEvent *e, int len);
 	int midi_play_end(void);
@@ -138,6 +138,7 @@ extern bool timidity_drum_effect;
 extern bool timidity_pan_delay;
 extern float timidity_drum_power;
 extern int timidity_key_adjust;
+extern int timidity_mix_threads;
 extern float timidity_tempo_adjust;
 
 extern int32_t playback_rate;
@@ -2039,6 +2039,10 @@ namespace swrenderer
 
 		for (int i = 0; i < num_lights; i++)
 		{
+			const LightShadowMap *shadowmap = lights[i].shadowmap;
+			if (shadowmap && !shadowmap->IsLit(lights[i].shadow_x + viewpos_x * lights[i].shadow_stepx, lights[i].shadow_y + viewpos_x * lights[i].shadow_stepy))
+				continue;
+
 			uint32_t light_color_r = RPART(lights[i].color);
 			uint32_t light_color_g = GPART(lights[i].color);
 			uint32_t light_color_b = BPART(lights[i].color);
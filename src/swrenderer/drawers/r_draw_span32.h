@@ -324,6 +324,10 @@ namespace swrenderer
 
 			for (int i = 0; i != num_lights; i++)
 			{
+				const LightShadowMap *shadowmap = lights[i].shadowmap;
+				if (shadowmap && !shadowmap->IsLit(lights[i].shadow_x + viewpos_x * lights[i].shadow_stepx, lights[i].shadow_y + viewpos_x * lights[i].shadow_stepy))
+					continue;
+
 				float light_x = lights[i].x;
 				float light_y = lights[i].y;
 				float light_z = lights[i].z;
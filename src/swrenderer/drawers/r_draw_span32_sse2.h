@@ -389,7 +389,22 @@ namespace swrenderer
 				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_z, rcp_dist), distance_attenuation);
 
 				__m128 is_attenuated = _mm_cmpeq_ps(light_z, _mm_setzero_ps());
-				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
+				__m128 attenuationf = _mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation));
+
+				// Shadow map test for the two pixels
+				const LightShadowMap *shadowmap = lights[i].shadowmap;
+				if (shadowmap)
+				{
+					float vpx[4];
+					_mm_storeu_ps(vpx, viewpos_x);
+					bool lit0 = shadowmap->IsLit(lights[i].shadow_x + vpx[0] * lights[i].shadow_stepx, lights[i].shadow_y + vpx[0] * lights[i].shadow_stepy);
+					bool lit1 = shadowmap->IsLit(lights[i].shadow_x + vpx[1] * lights[i].shadow_stepx, lights[i].shadow_y + vpx[1] * lights[i].shadow_stepy);
+					if (!lit0 && !lit1)
+						continue;
+					attenuationf = _mm_and_ps(attenuationf, _mm_castsi128_ps(_mm_setr_epi32(lit0 ? -1 : 0, lit1 ? -1 : 0, 0, 0)));
+				}
+
+				__m128i attenuation = _mm_cvtps_epi32(attenuationf);
 				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
 
 				__m128i light_color = _mm_cvtsi32_si128(lights[i].color);
@@ -207,6 +207,17 @@ namespace swrenderer
 			drawerargs.dc_num_lights = 0;
 			drawerargs.dc_lights = Thread->FrameMemory->AllocMemory<DrawerLight>(max_lights);
 
+			// World position of the column. 1D shadow maps only depend on XY, so they can be tested once per column.
+			auto shadowmaps = LightShadowMaps::Instance();
+			DVector2 columnpos;
+			if (shadowmaps->IsEnabled())
+			{
+				const auto &viewpoint = Thread->Viewport->viewpoint;
+				double depth = zcol / Thread->Viewport->viewwindow.FocalTangent;
+				columnpos.X = viewpoint.Pos.X + drawerargs.dc_viewpos.X * viewpoint.Sin + depth * viewpoint.Cos;
+				columnpos.Y = viewpoint.Pos.Y - drawerargs.dc_viewpos.X * viewpoint.Cos + depth * viewpoint.Sin;
+			}
+
 			// Setup lights for column
 			cur_node = light_list;
 			while (cur_node)
@@ -228,7 +239,15 @@ namespace swrenderer
 
 					// Include light only if it touches this column
 					float radius = cur_node->lightsource->GetRadius();
-					if (radius * radius >= lconstant && nlconstant >= 0.0f)
+					bool inrange = radius * radius >= lconstant && nlconstant >= 0.0f;
+					if (inrange)
+					{
+						const LightShadowMap *shadowmap = shadowmaps->Find(cur_node->lightsource);
+						if (shadowmap)
+							inrange = shadowmap->IsLit((float)(columnpos.X - cur_node->lightsource->X()), (float)(columnpos.Y - cur_node->lightsource->Y()));
+					}
+
+					if (inrange)
 					{
 						uint32_t red = cur_node->lightsource->GetRed();
 						uint32_t green = cur_node->lightsource->GetGreen();
@@ -240,6 +259,7 @@ namespace swrenderer
 						light.z = lz;
 						light.radius = 256.0f / cur_node->lightsource->GetRadius();
 						light.color = (red << 16) | (green << 8) | blue;
+						light.shadowmap = nullptr;
 					}
 				}
 
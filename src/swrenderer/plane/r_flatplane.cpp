@@ -230,6 +230,17 @@ namespace swrenderer
 			drawerargs.dc_num_lights = 0;
 			drawerargs.dc_lights = Thread->FrameMemory->AllocMemory<DrawerLight>(max_lights);
 
+			// World position of the row at viewpos.X = 0. Moving along the row steps by (sin, -cos) per view space unit.
+			auto shadowmaps = LightShadowMaps::Instance();
+			DVector2 rowpos;
+			if (shadowmaps->IsEnabled())
+			{
+				const auto &viewpoint = Thread->Viewport->viewpoint;
+				double depth = zspan / Thread->Viewport->viewwindow.FocalTangent;
+				rowpos.X = viewpoint.Pos.X + depth * viewpoint.Cos;
+				rowpos.Y = viewpoint.Pos.Y + depth * viewpoint.Sin;
+			}
+
 			// Setup lights for row
 			cur_node = light_list;
 			while (cur_node)
@@ -261,6 +272,14 @@ namespace swrenderer
 					light.z = nlconstant;
 					light.radius = 256.0f / radius;
 					light.color = (red << 16) | (green << 8) | blue;
+					light.shadowmap = shadowmaps->Find(cur_node->lightsource);
+					if (light.shadowmap)
+					{
+						light.shadow_x = (float)(rowpos.X - cur_node->lightsource->X());
+						light.shadow_y = (float)(rowpos.Y - cur_node->lightsource->Y());
+						light.shadow_stepx = (float)Thread->Viewport->viewpoint.Sin;
+						light.shadow_stepy = (float)-Thread->Viewport->viewpoint.Cos;
+					}
 				}
 
 				cur_node = cur_node->next;
@@ -23,6 +23,7 @@
 #include "scene/r_opaque_pass.cpp"
 #include "scene/r_portal.cpp"
 #include "scene/r_scene.cpp"
+#include "scene/r_shadowmap.cpp"
 #include "scene/r_translucent_pass.cpp"
 #include "segments/r_clipsegment.cpp"
 #include "segments/r_drawsegment.cpp"
@@ -46,6 +46,9 @@
 #include "scene/r_3dfloors.h"
 #include "scene/r_portal.h"
 #include "textures/textures.h"
+#include "textures/bgramipcache.h"
+#include "resourcefiles/lumploader.h"
+#include "textures/texturedecoder.h"
 #include "r_data/voxels.h"
 #include "drawers/r_draw_rgba.h"
 #include "polyrenderer/poly_renderer.h"
@@ -101,8 +104,9 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 			else
 				tex->GetPixels (DefaultRenderStyle());
 		}
-		else
+		else if (!isbgra || !FBgraMipCache::Instance()->IsCached(tex))
 		{
+			// BGRA mipmap chains are kept and released by the cache when over its budget
 			tex->Unload ();
 		}
 	}
@@ -151,14 +155,39 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	delete[] spritelist;
 
 	int cnt = TexMan.NumTextures();
+
+	// Let the image lumps decompress in the background while the textures are being set up
+	FLumpLoader::Instance()->BeginBatch();
+	for (int i = cnt - 1; i >= 0; i--)
+	{
+		FTexture *tex = TexMan.ByIndex(i);
+		if (tex != nullptr && texhitlist[i])
+			FLumpLoader::Instance()->Prefetch(tex->GetSourceLump());
+	}
+	FLumpLoader::Instance()->EndBatch();
+
+	// Decode the true color images on the worker threads as well
+	if (V_IsTrueColor())
+	{
+		for (int i = cnt - 1; i >= 0; i--)
+		{
+			if (texhitlist[i])
+				FTextureDecoder::Instance()->Queue(TexMan.ByIndex(i));
+		}
+	}
+
 	for (int i = cnt - 1; i >= 0; i--)
 	{
 		PrecacheTexture(TexMan.ByIndex(i), texhitlist[i]);
 	}
+	FTextureDecoder::Instance()->Flush();
+	FLumpLoader::Instance()->Flush();
 }
 
 void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target)
 {
+	FBgraMipCache::Instance()->Update();
+
 	if (V_IsPolyRenderer())
 	{
 		PolyRenderer::Instance()->Viewpoint = r_viewpoint;
@@ -46,6 +46,7 @@
 #include "swrenderer/scene/r_opaque_pass.h"
 #include "swrenderer/scene/r_translucent_pass.h"
 #include "swrenderer/scene/r_portal.h"
+#include "swrenderer/scene/r_shadowmap.h"
 #include "swrenderer/segments/r_clipsegment.h"
 #include "swrenderer/segments/r_drawsegment.h"
 #include "swrenderer/segments/r_portalsegment.h"
@@ -156,6 +157,9 @@ namespace swrenderer
 
 		R_UpdateFuzzPosFrameStart();
 
+		// Shadow maps must be up to date before the scene threads start reading them
+		LightShadowMaps::Instance()->Update();
+
 		if (r_models)
 			MainThread()->Viewport->SetupPolyViewport(MainThread());
 
@@ -0,0 +1,199 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2018 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+
+/*
+	CPU version of the 1D dynamic shadow maps used by the hardware renderer (see hw_shadowmap.cpp).
+
+	Each shadow mapped light gets a row of depth values split into four parts, one for each direction.
+	Texels 0-N/4 is Y positive, N/4-N/2 is X positive, N/2-3N/4 is Y negative and 3N/4-N is X negative.
+	Every texel holds the squared distance from the light to the closest one-sided line in that direction.
+
+	Generating a map shoots one ray per texel through the level AABB tree. The maps are cached between
+	frames and a map is only generated again if its light moved or changed radius. The AABB tree itself
+	only contains one-sided lines and is rebuilt, together with all maps, when the level changes.
+
+	The wall setup tests the map once per column, as a 1D map only depends on the XY position. Spans
+	pass the map to the drawers, which test it per pixel.
+*/
+
+#include <stdlib.h>
+#include "templates.h"
+#include "doomdef.h"
+#include "c_cvars.h"
+#include "g_levellocals.h"
+#include "a_dynlight.h"
+#include "swrenderer/scene/r_shadowmap.h"
+
+CVAR(Bool, r_light_shadowmap, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+CUSTOM_CVAR(Int, r_shadowmap_quality, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	switch (self)
+	{
+	case 128:
+	case 256:
+	case 512:
+	case 1024:
+		break;
+	default:
+		self = 128;
+		break;
+	}
+}
+
+ADD_STAT(swshadowmap)
+{
+	using namespace swrenderer;
+	FString out;
+	out.Format("update=%04.2f ms  lights=%d  regenerated=%d", LightShadowMaps::UpdateCycles.TimeMS(), LightShadowMaps::LightsProcessed, LightShadowMaps::LightsRegenerated);
+	return out;
+}
+
+namespace swrenderer
+{
+	cycle_t LightShadowMaps::UpdateCycles;
+	int LightShadowMaps::LightsProcessed;
+	int LightShadowMaps::LightsRegenerated;
+
+	LightShadowMaps *LightShadowMaps::Instance()
+	{
+		static LightShadowMaps instance;
+		return &instance;
+	}
+
+	void LightShadowMaps::Update()
+	{
+		UpdateCycles.Reset();
+		LightsProcessed = 0;
+		LightsRegenerated = 0;
+
+		mEnabled = r_light_shadowmap;
+		if (!mEnabled)
+		{
+			if (!mShadowMaps.empty())
+				Clear();
+			return;
+		}
+
+		UpdateCycles.Clock();
+
+		// A new tree or a new quality setting invalidates every map
+		if (!ValidateAABBTree() || mQuality != r_shadowmap_quality)
+		{
+			mShadowMaps.clear();
+			mQuality = r_shadowmap_quality;
+		}
+
+		mUpdateCount++;
+
+		TThinkerIterator<ADynamicLight> it(STAT_DLIGHT);
+		while (auto light = it.Next())
+		{
+			LightsProcessed++;
+			if (!light->shadowmapped || !light->IsActive())
+				continue;
+
+			auto &map = mShadowMaps[light];
+			if (!map)
+				map.reset(new LightShadowMap());
+
+			map->LastUpdate = mUpdateCount;
+
+			DVector3 pos = light->Pos();
+			float radius = light->GetRadius();
+			if (map->Depth.Size() != (unsigned)mQuality || map->Pos != pos || map->Radius != radius)
+			{
+				map->Pos = pos;
+				map->Radius = radius;
+				GenerateShadowMap(map.get(), mQuality);
+				LightsRegenerated++;
+			}
+		}
+
+		// Drop maps for lights that are gone or no longer shadow mapped
+		for (auto it = mShadowMaps.begin(); it != mShadowMaps.end();)
+		{
+			if (it->second->LastUpdate != mUpdateCount)
+				it = mShadowMaps.erase(it);
+			else
+				++it;
+		}
+
+		UpdateCycles.Unclock();
+	}
+
+	void LightShadowMaps::GenerateShadowMap(LightShadowMap *map, int quality)
+	{
+		map->Depth.Resize(quality);
+
+		float quarter = quality / 4.0f;
+		float eighth = quality / 8.0f;
+		DVector2 lightpos = map->Pos.XY();
+		double radius = map->Radius;
+
+		for (int i = 0; i < quality; i++)
+		{
+			float x = i + 0.5f;
+			DVector2 dir;
+			switch ((int)(x / quarter))
+			{
+			default:
+			case 0: dir = DVector2((x - eighth) / eighth, 1.0); break;
+			case 1: dir = DVector2(1.0, (x - (quarter + eighth)) / eighth); break;
+			case 2: dir = DVector2(-(x - (quarter * 2.0f + eighth)) / eighth, -1.0); break;
+			case 3: dir = DVector2(-1.0, -(x - (quarter * 3.0f + eighth)) / eighth); break;
+			}
+
+			DVector2 endpos = lightpos + dir * radius;
+			double t = mAABBTree->RayTest(DVector3(lightpos, map->Pos.Z), DVector3(endpos, map->Pos.Z));
+			DVector2 delta = (endpos - lightpos) * t;
+			map->Depth[i] = (float)(delta | delta);
+		}
+	}
+
+	void LightShadowMaps::Clear()
+	{
+		mShadowMaps.clear();
+		mAABBTree.reset();
+		mLastLevel = nullptr;
+		mLastNumNodes = 0;
+		mLastNumSegs = 0;
+	}
+
+	bool LightShadowMaps::ValidateAABBTree()
+	{
+		// Just comparing the level info is not enough. If two MAPINFO-less levels get played after each other,
+		// they can both refer to the same default level info.
+		if (level.info != mLastLevel && (level.nodes.Size() != mLastNumNodes || level.segs.Size() != mLastNumSegs))
+		{
+			mAABBTree.reset();
+
+			mLastLevel = level.info;
+			mLastNumNodes = level.nodes.Size();
+			mLastNumSegs = level.segs.Size();
+		}
+
+		if (mAABBTree)
+			return true;
+
+		mAABBTree.reset(new hwrenderer::LevelAABBTree());
+		return false;
+	}
+}
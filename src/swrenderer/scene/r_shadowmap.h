@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2018 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "hwrenderer/dynlights/hw_aabbtree.h"
+#include "stats.h"
+#include <memory>
+#include <unordered_map>
+
+class ADynamicLight;
+struct level_info_t;
+
+EXTERN_CVAR(Bool, r_light_shadowmap)
+
+namespace swrenderer
+{
+	// 1D shadow map for a single light, generated on the CPU by ray testing the level AABB tree
+	class LightShadowMap
+	{
+	public:
+		// Returns false if the world position (relative to the light) is occluded by a one-sided line
+		bool IsLit(float dx, float dy) const
+		{
+			float dist2 = dx * dx + dy * dy;
+			if (dist2 < 9.0f)
+				return true;
+
+			// Shadow acne margin
+			float length = sqrt(dist2);
+			float scale = MAX(length - 6.0f, 0.0f) / length;
+			dx *= scale;
+			dy *= scale;
+			dist2 = dx * dx + dy * dy;
+
+			int size = (int)Depth.Size();
+			int index = (int)(DirToU(dx, dy) * size);
+			if (index < 0) index += size;
+			else if (index >= size) index -= size;
+			return Depth[index] > dist2;
+		}
+
+		// Texel coordinate for a direction. Same layout as the hardware renderer's shadow map texture.
+		static float DirToU(float dx, float dy)
+		{
+			if (fabs(dx) > fabs(dy))
+			{
+				if (dx >= 0.0f)
+					return dy / dx * 0.125f + (0.25f + 0.125f);
+				else
+					return dy / dx * 0.125f + (0.75f + 0.125f);
+			}
+			else
+			{
+				if (dy >= 0.0f)
+					return dx / dy * 0.125f + 0.125f;
+				else
+					return dx / dy * 0.125f + (0.50f + 0.125f);
+			}
+		}
+
+		// Light position and radius the map was generated for
+		DVector3 Pos;
+		float Radius = 0.0f;
+
+		// Update() call that last saw the light
+		int LastUpdate = 0;
+
+		// Squared distance to the first blocking line for each texel
+		TArray<float> Depth;
+	};
+
+	// Cache of CPU shadow maps. Maps are only regenerated when their light moves or changes radius.
+	class LightShadowMaps
+	{
+	public:
+		static LightShadowMaps *Instance();
+
+		// Collects the shadow mapped lights and regenerates any map that is out of date.
+		// Must be called before the scene threads start as the maps are read without locking.
+		void Update();
+
+		// Returns the shadow map for a light or nullptr if the light is not shadow mapped
+		const LightShadowMap *Find(ADynamicLight *light) const
+		{
+			if (!mEnabled)
+				return nullptr;
+			auto it = mShadowMaps.find(light);
+			return it != mShadowMaps.end() ? it->second.get() : nullptr;
+		}
+
+		// Returns true if r_light_shadowmap is on and the maps are valid for the current frame
+		bool IsEnabled() const { return mEnabled; }
+
+		// Release all maps
+		void Clear();
+
+		static cycle_t UpdateCycles;
+		static int LightsProcessed;
+		static int LightsRegenerated;
+
+	private:
+		bool ValidateAABBTree();
+		void GenerateShadowMap(LightShadowMap *map, int quality);
+
+		std::unordered_map<ADynamicLight *, std::unique_ptr<LightShadowMap>> mShadowMaps;
+		int mUpdateCount = 0;
+		int mQuality = 0;
+		bool mEnabled = false;
+
+		// Used to detect when a level change requires the AABB tree to be regenerated
+		level_info_t *mLastLevel = nullptr;
+		unsigned mLastNumNodes = 0;
+		unsigned mLastNumSegs = 0;
+
+		// AABB-tree of the level, used for ray tests
+		std::unique_ptr<hwrenderer::LevelAABBTree> mAABBTree;
+	};
+}
@@ -10,6 +10,7 @@
 #include "r_data/colormaps.h"
 #include "r_data/r_translate.h"
 #include "swrenderer/scene/r_light.h"
+#include "swrenderer/scene/r_shadowmap.h"
 
 struct FSWColormap;
 struct FLightNode;
@@ -25,6 +26,11 @@ namespace swrenderer
 		uint32_t color;
 		float x, y, z;
 		float radius;
+
+		// Shadow map sampled by the span drawers. The light relative world position is shadow_pos + viewpos_x * shadow_step.
+		const LightShadowMap *shadowmap;
+		float shadow_x, shadow_y;
+		float shadow_stepx, shadow_stepy;
 	};
 
 	class DrawerArgs
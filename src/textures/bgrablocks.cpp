@@ -0,0 +1,422 @@
+/*
+** bgrablocks.cpp
+** Block compression for BGRA mipmap chains
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <math.h>
+#include <string.h>
+#include "doomtype.h"
+#include "templates.h"
+#include "v_palette.h"
+#include "textures/bgrablocks.h"
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	enum
+	{
+		ColorBlockSize = 8,
+		AlphaBlockSize = 8
+	};
+
+	// The 16 pixels of a block. Pixel i + j * 4 is row i of column j.
+	struct BlockPixels
+	{
+		uint32_t Pixels[16];
+
+		void Load(const uint32_t *level, int w, int h, int bx, int by)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				const uint32_t *column = level + MIN(bx * 4 + j, w - 1) * h;
+				for (int i = 0; i < 4; i++)
+					Pixels[i + j * 4] = column[MIN(by * 4 + i, h - 1)];
+			}
+		}
+	};
+
+	uint16_t To565(int r, int g, int b)
+	{
+		r = (clamp(r, 0, 255) * 31 + 127) / 255;
+		g = (clamp(g, 0, 255) * 63 + 127) / 255;
+		b = (clamp(b, 0, 255) * 31 + 127) / 255;
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	uint32_t From565(uint16_t c)
+	{
+		uint32_t r = (c >> 11) & 31;
+		uint32_t g = (c >> 5) & 63;
+		uint32_t b = c & 31;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		b = (b << 3) | (b >> 2);
+		return 0xff000000 | (r << 16) | (g << 8) | b;
+	}
+
+	// Builds the four color palette for a color block. Entries 2 and 3 are 2/3 and 1/3 of the way from c0 to c1.
+	void ColorPalette(uint16_t c0, uint16_t c1, uint32_t *palette)
+	{
+		palette[0] = From565(c0);
+		palette[1] = From565(c1);
+
+#ifndef NO_SSE
+		__m128i zero = _mm_setzero_si128();
+		__m128i ends = _mm_unpacklo_epi8(_mm_cvtsi32_si128(palette[0]), zero);
+		ends = _mm_unpacklo_epi64(ends, _mm_unpacklo_epi8(_mm_cvtsi32_si128(palette[1]), zero));
+		__m128i p0 = _mm_unpacklo_epi64(ends, ends);
+		__m128i p1 = _mm_unpackhi_epi64(ends, ends);
+		__m128i sum = _mm_add_epi16(_mm_add_epi16(p0, p1), ends);
+		__m128i third = _mm_mulhi_epu16(sum, _mm_set1_epi16(21846));
+		_mm_storel_epi64((__m128i*)(palette + 2), _mm_packus_epi16(third, third));
+#else
+		for (int i = 0; i < 2; i++)
+		{
+			uint32_t a = palette[i];
+			uint32_t b = palette[1 - i];
+			uint32_t c = 0;
+			for (int shift = 0; shift < 32; shift += 8)
+				c |= ((((a >> shift) & 0xff) * 2 + ((b >> shift) & 0xff)) / 3) << shift;
+			palette[2 + i] = c;
+		}
+#endif
+	}
+
+	// Builds the eight alpha values for an alpha block
+	void AlphaPalette(int a0, int a1, uint8_t *palette)
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int i = 1; i < 7; i++)
+			palette[1 + i] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+	}
+
+	int ColorDistance(uint32_t a, uint32_t b)
+	{
+		int dr = (int)RPART(a) - (int)RPART(b);
+		int dg = (int)GPART(a) - (int)GPART(b);
+		int db = (int)BPART(a) - (int)BPART(b);
+		return dr * dr + dg * dg + db * db;
+	}
+
+	void EncodeAlphaBlock(const BlockPixels &block, uint8_t *dest)
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			int a = APART(block.Pixels[i]);
+			a0 = MAX(a0, a);
+			a1 = MIN(a1, a);
+		}
+
+		uint8_t palette[8];
+		AlphaPalette(a0, a1, palette);
+
+		uint64_t indices = 0;
+		if (a0 != a1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int a = APART(block.Pixels[i]);
+				int best = 0, bestdist = 256;
+				for (int k = 0; k < 8; k++)
+				{
+					int dist = abs(palette[k] - a);
+					if (dist < bestdist)
+					{
+						best = k;
+						bestdist = dist;
+					}
+				}
+				indices |= (uint64_t)best << (i * 3);
+			}
+		}
+
+		dest[0] = a0;
+		dest[1] = a1;
+		for (int i = 0; i < 6; i++)
+			dest[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+
+	// Picks the endpoints along the principal axis of the block's colors.
+	// Fully transparent pixels are ignored if the chain has alpha.
+	void EncodeColorBlock(const BlockPixels &block, bool hasalpha, uint8_t *dest)
+	{
+		float colors[16][3];
+		int count = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t c = block.Pixels[i];
+			if (hasalpha && APART(c) == 0)
+				continue;
+			colors[count][0] = (float)RPART(c);
+			colors[count][1] = (float)GPART(c);
+			colors[count][2] = (float)BPART(c);
+			count++;
+		}
+
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < count; i++)
+		{
+			for (int k = 0; k < 3; k++)
+				mean[k] += colors[i][k];
+		}
+		if (count > 0)
+		{
+			for (int k = 0; k < 3; k++)
+				mean[k] /= count;
+		}
+
+		float cov[3][3] = { };
+		for (int i = 0; i < count; i++)
+		{
+			float d[3] = { colors[i][0] - mean[0], colors[i][1] - mean[1], colors[i][2] - mean[2] };
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+					cov[r][c] += d[r] * d[c];
+			}
+		}
+
+		// Power iteration, starting with the row of the channel with the largest variance
+		int start = 0;
+		if (cov[1][1] > cov[start][start]) start = 1;
+		if (cov[2][2] > cov[start][start]) start = 2;
+		float axis[3] = { cov[start][0], cov[start][1], cov[start][2] };
+		for (int iter = 0; iter < 4; iter++)
+		{
+			float v[3];
+			for (int r = 0; r < 3; r++)
+				v[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+			float m = MAX(MAX(fabsf(v[0]), fabsf(v[1])), fabsf(v[2]));
+			if (m < 1e-6f)
+				break;
+			for (int r = 0; r < 3; r++)
+				axis[r] = v[r] / m;
+		}
+
+		float e0[3] = { mean[0], mean[1], mean[2] };
+		float e1[3] = { mean[0], mean[1], mean[2] };
+		float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (count > 1 && length2 > 1e-6f)
+		{
+			float mind = 0.0f, maxd = 0.0f;
+			for (int i = 0; i < count; i++)
+			{
+				float d = (colors[i][0] - mean[0]) * axis[0] + (colors[i][1] - mean[1]) * axis[1] + (colors[i][2] - mean[2]) * axis[2];
+				mind = MIN(mind, d);
+				maxd = MAX(maxd, d);
+			}
+
+			// Inset the endpoints slightly as the extremes rarely need an exact match
+			float inset = (maxd - mind) / 16.0f;
+			mind = (mind + inset) / length2;
+			maxd = (maxd - inset) / length2;
+			for (int k = 0; k < 3; k++)
+			{
+				e0[k] = mean[k] + axis[k] * maxd;
+				e1[k] = mean[k] + axis[k] * mind;
+			}
+		}
+
+		uint16_t c0 = To565((int)(e0[0] + 0.5f), (int)(e0[1] + 0.5f), (int)(e0[2] + 0.5f));
+		uint16_t c1 = To565((int)(e1[0] + 0.5f), (int)(e1[1] + 0.5f), (int)(e1[2] + 0.5f));
+
+		uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			uint32_t palette[4];
+			ColorPalette(c0, c1, palette);
+			for (int i = 0; i < 16; i++)
+			{
+				uint32_t c = block.Pixels[i];
+				if (hasalpha && APART(c) == 0)
+					continue;
+
+				int best = 0, bestdist = ColorDistance(palette[0], c);
+				for (int k = 1; k < 4; k++)
+				{
+					int dist = ColorDistance(palette[k], c);
+					if (dist < bestdist)
+					{
+						best = k;
+						bestdist = dist;
+					}
+				}
+				indices |= (uint32_t)best << (i * 2);
+			}
+		}
+
+		dest[0] = (uint8_t)c0;
+		dest[1] = (uint8_t)(c0 >> 8);
+		dest[2] = (uint8_t)c1;
+		dest[3] = (uint8_t)(c1 >> 8);
+		dest[4] = (uint8_t)indices;
+		dest[5] = (uint8_t)(indices >> 8);
+		dest[6] = (uint8_t)(indices >> 16);
+		dest[7] = (uint8_t)(indices >> 24);
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FBgraBlockImage::Compress(const uint32_t *pixels, int width, int height, int levels)
+{
+	Width = width;
+	Height = height;
+	Levels = levels;
+
+	size_t count = PixelCount();
+	HasAlpha = false;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (APART(pixels[i]) != 255)
+		{
+			HasAlpha = true;
+			break;
+		}
+	}
+
+	size_t blocksize = HasAlpha ? AlphaBlockSize + ColorBlockSize : ColorBlockSize;
+	size_t numblocks = 0;
+	for (int i = 0; i < levels; i++)
+	{
+		int w = MAX(width >> i, 1);
+		int h = MAX(height >> i, 1);
+		numblocks += ((w + 3) / 4) * ((h + 3) / 4);
+	}
+	Blocks.resize(numblocks * blocksize);
+
+	uint8_t *dest = Blocks.data();
+	const uint32_t *level = pixels;
+	BlockPixels block;
+	for (int i = 0; i < levels; i++)
+	{
+		int w = MAX(width >> i, 1);
+		int h = MAX(height >> i, 1);
+		for (int bx = 0; bx < (w + 3) / 4; bx++)
+		{
+			for (int by = 0; by < (h + 3) / 4; by++)
+			{
+				block.Load(level, w, h, bx, by);
+				if (HasAlpha)
+				{
+					EncodeAlphaBlock(block, dest);
+					dest += AlphaBlockSize;
+				}
+				EncodeColorBlock(block, HasAlpha, dest);
+				dest += ColorBlockSize;
+			}
+		}
+		level += w * h;
+	}
+}
+
+void FBgraBlockImage::Decompress(uint32_t *pixels) const
+{
+	const uint8_t *src = Blocks.data();
+	uint32_t *level = pixels;
+	for (int i = 0; i < Levels; i++)
+	{
+		int w = MAX(Width >> i, 1);
+		int h = MAX(Height >> i, 1);
+		for (int bx = 0; bx < (w + 3) / 4; bx++)
+		{
+			int columns = MIN(w - bx * 4, 4);
+			for (int by = 0; by < (h + 3) / 4; by++)
+			{
+				int rows = MIN(h - by * 4, 4);
+
+				uint8_t alphas[8];
+				uint64_t alphaindices = 0;
+				if (HasAlpha)
+				{
+					AlphaPalette(src[0], src[1], alphas);
+					for (int k = 0; k < 6; k++)
+						alphaindices |= (uint64_t)src[2 + k] << (k * 8);
+					src += AlphaBlockSize;
+				}
+
+				uint32_t palette[4];
+				ColorPalette(src[0] | (src[1] << 8), src[2] | (src[3] << 8), palette);
+				uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((uint32_t)src[7] << 24);
+				src += ColorBlockSize;
+
+				for (int x = 0; x < columns; x++)
+				{
+					uint32_t *dest = level + (bx * 4 + x) * h + by * 4;
+					for (int y = 0; y < rows; y++)
+					{
+						int p = y + x * 4;
+						uint32_t c = palette[(indices >> (p * 2)) & 3];
+						if (HasAlpha)
+							c = (c & 0x00ffffff) | ((uint32_t)alphas[(alphaindices >> (p * 3)) & 7] << 24);
+						dest[y] = c;
+					}
+				}
+			}
+		}
+		level += w * h;
+	}
+}
+
+void FBgraBlockImage::Clear()
+{
+	Width = 0;
+	Height = 0;
+	Levels = 0;
+	HasAlpha = false;
+	Blocks = std::vector<uint8_t>();
+}
+
+size_t FBgraBlockImage::PixelCount() const
+{
+	size_t count = 0;
+	for (int i = 0; i < Levels; i++)
+		count += MAX(Width >> i, 1) * MAX(Height >> i, 1);
+	return count;
+}
+
+size_t FBgraBlockImage::MaxSize(int width, int height, int levels)
+{
+	size_t numblocks = 0;
+	for (int i = 0; i < levels; i++)
+		numblocks += ((MAX(width >> i, 1) + 3) / 4) * ((MAX(height >> i, 1) + 3) / 4);
+	return numblocks * (AlphaBlockSize + ColorBlockSize);
+}
@@ -0,0 +1,73 @@
+/*
+** bgrablocks.h
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __BGRABLOCKS_H
+#define __BGRABLOCKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Block compressed copy of a column major BGRA mipmap chain, as stored in FTexture::PixelsBgra.
+//
+// Every level is split into 4x4 blocks. A block is stored as a BC1 color block (two RGB565
+// endpoints and 2 bit indices), preceded by a BC4 style alpha block (two alpha endpoints and
+// 3 bit indices) if any pixel in the chain is not fully opaque. This gives 8:1 compression for
+// opaque textures and 4:1 for textures with alpha.
+class FBgraBlockImage
+{
+public:
+	void Compress(const uint32_t *pixels, int width, int height, int levels);
+	void Decompress(uint32_t *pixels) const;
+	void Clear();
+
+	bool IsEmpty() const { return Blocks.empty(); }
+
+	// Size of the compressed data in bytes
+	size_t Size() const { return Blocks.size(); }
+
+	// Number of pixels in the uncompressed mipmap chain
+	size_t PixelCount() const;
+
+	// Size in bytes of a compressed chain with alpha
+	static size_t MaxSize(int width, int height, int levels);
+
+private:
+	int Width = 0;
+	int Height = 0;
+	int Levels = 0;
+	bool HasAlpha = false;
+	std::vector<uint8_t> Blocks;
+};
+
+#endif
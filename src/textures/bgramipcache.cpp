@@ -0,0 +1,714 @@
+/*
+** bgramipcache.cpp
+** Background mipmap generation and LRU budget for BGRA textures
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include "doomtype.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "textures/textures.h"
+#include "textures/bgramipcache.h"
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+
+// Generate the high quality mipmaps on a worker thread
+CVAR(Bool, r_mipmap_background, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// 0 = gamma correct box filter with sharpening, 1 = Kaiser windowed sinc
+CUSTOM_CVAR(Int, r_mipmap_filter, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else if (self > 1) self = 1;
+}
+
+// Memory budget in megabytes for the BGRA mipmap chains
+CUSTOM_CVAR(Int, r_mipmap_budget, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 16) self = 16;
+}
+
+// Keep a block compressed copy of the mipmaps of idle textures when releasing them over budget.
+// Restored mipmaps are lossy. The base level is always rebuilt from the source image.
+CVAR(Bool, r_mipmap_compress, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+int FBgraMipCache::CurrentFrame;
+size_t FBgraMipCache::ResidentBytes;
+int FBgraMipCache::ResidentTextures;
+int FBgraMipCache::PendingTextures;
+int FBgraMipCache::EvictedTextures;
+int FBgraMipCache::CompressedTextures;
+
+ADD_STAT(bgramips)
+{
+	FString out;
+	out.Format("resident=%u KB  budget=%d KB  textures=%d  compressed=%d  pending=%d  evicted=%d",
+		(unsigned)(FBgraMipCache::ResidentBytes / 1024), *r_mipmap_budget * 1024, FBgraMipCache::ResidentTextures,
+		FBgraMipCache::CompressedTextures, FBgraMipCache::PendingTextures, FBgraMipCache::EvictedTextures);
+	return out;
+}
+
+//==========================================================================
+//
+// Filters
+//
+//==========================================================================
+
+namespace
+{
+	// Linear color with the channels in a, r, g, b order
+#ifndef NO_SSE
+	struct MipColor
+	{
+		__m128 v;
+
+		MipColor() { }
+		MipColor(__m128 v) : v(v) { }
+
+		static MipColor Zero() { return _mm_setzero_ps(); }
+		static MipColor Load(const float *c) { return _mm_loadu_ps(c); }
+		void Store(float *c) const { _mm_storeu_ps(c, v); }
+
+		MipColor operator+(const MipColor &c) const { return _mm_add_ps(v, c.v); }
+		MipColor operator-(const MipColor &c) const { return _mm_sub_ps(v, c.v); }
+		MipColor operator*(float s) const { return _mm_mul_ps(v, _mm_set1_ps(s)); }
+	};
+#else
+	struct MipColor
+	{
+		float a, r, g, b;
+
+		static MipColor Zero() { return MipColor{ 0.0f, 0.0f, 0.0f, 0.0f }; }
+		static MipColor Load(const float *c) { return MipColor{ c[0], c[1], c[2], c[3] }; }
+		void Store(float *c) const { c[0] = a; c[1] = r; c[2] = g; c[3] = b; }
+
+		MipColor operator+(const MipColor &c) const { return MipColor{ a + c.a, r + c.r, g + c.g, b + c.b }; }
+		MipColor operator-(const MipColor &c) const { return MipColor{ a - c.a, r - c.r, g - c.g, b - c.b }; }
+		MipColor operator*(float s) const { return MipColor{ a * s, r * s, g * s, b * s }; }
+	};
+#endif
+
+	// Image stored as four floats per pixel. Unaligned loads are used so that std::vector can be used for the storage.
+	class MipImage
+	{
+	public:
+		void Resize(size_t count) { values.resize(count * 4); }
+		MipColor Get(size_t i) const { return MipColor::Load(&values[i * 4]); }
+		void Set(size_t i, const MipColor &c) { c.Store(&values[i * 4]); }
+		float *Data(size_t i) { return &values[i * 4]; }
+		const float *Data(size_t i) const { return &values[i * 4]; }
+
+	private:
+		std::vector<float> values;
+	};
+
+	struct GammaTables
+	{
+		GammaTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				ToLinear[i] = powf(i * (1.0f / 255.0f), 2.2f);
+				// Smallest linear value that rounds to i in gamma space
+				Thresholds[i] = (i == 0) ? -FLT_MAX : powf((i - 0.5f) * (1.0f / 255.0f), 2.2f);
+			}
+		}
+
+		// Same result as round(pow(value, 1/2.2) * 255), clamped to 0-255
+		uint32_t ToGamma(float value) const
+		{
+			int i = 0;
+			for (int step = 128; step > 0; step >>= 1)
+			{
+				if (Thresholds[i + step] <= value)
+					i += step;
+			}
+			return i;
+		}
+
+		float ToLinear[256];
+		float Thresholds[256];
+	};
+
+	const GammaTables &GetGammaTables()
+	{
+		static GammaTables tables;
+		return tables;
+	}
+
+	// Weights for downscaling by two with a Kaiser windowed sinc. Taps are 0.5, 1.5 and 2.5 source pixels from the center.
+	struct KaiserKernel
+	{
+		KaiserKernel()
+		{
+			const double alpha = 4.0;
+			const double radius = 3.0;
+			double sum = 0.0;
+			for (int i = 0; i < 3; i++)
+			{
+				double x = i + 0.5;
+				double sinc = sin(M_PI * x * 0.5) / (M_PI * x * 0.5);
+				double t = x / radius;
+				double window = BesselI0(alpha * sqrt(1.0 - t * t)) / BesselI0(alpha);
+				Weights[i] = (float)(sinc * window);
+				sum += Weights[i] * 2.0;
+			}
+			for (int i = 0; i < 3; i++)
+				Weights[i] = (float)(Weights[i] / sum);
+		}
+
+		static double BesselI0(double x)
+		{
+			double sum = 1.0;
+			double term = 1.0;
+			for (int k = 1; k < 20; k++)
+			{
+				term *= (x * 0.5 / k) * (x * 0.5 / k);
+				sum += term;
+			}
+			return sum;
+		}
+
+		float Weights[3];
+	};
+
+	// Same sample positions as FTexture::GenerateBgraMipmapsFast
+	void DownscaleBox(const MipImage &src, MipImage &dest, int srcw, int srch, int w, int h)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			int sx0 = x * 2;
+			int sx1 = MIN((x + 1) * 2, srcw - 1);
+			for (int y = 0; y < h; y++)
+			{
+				int sy0 = y * 2;
+				int sy1 = MIN((y + 1) * 2, srch - 1);
+
+				MipColor src00 = src.Get(sy0 + sx0 * srch);
+				MipColor src01 = src.Get(sy1 + sx0 * srch);
+				MipColor src10 = src.Get(sy0 + sx1 * srch);
+				MipColor src11 = src.Get(sy1 + sx1 * srch);
+				dest.Set(y + x * h, (src00 + src01 + src10 + src11) * 0.25f);
+			}
+		}
+	}
+
+	// Sharpen filter with a 3x3 kernel
+	void Sharpen(MipImage &image, MipImage &smoothed, int w, int h)
+	{
+		smoothed.Resize(w * h);
+		for (int x = 0; x < w; x++)
+		{
+			int x0 = (x == 0) ? w - 1 : x - 1;
+			int x2 = (x == w - 1) ? 0 : x + 1;
+			for (int y = 0; y < h; y++)
+			{
+				int y0 = (y == 0) ? h - 1 : y - 1;
+				int y2 = (y == h - 1) ? 0 : y + 1;
+
+				MipColor c =
+					image.Get(y0 + x0 * h) + image.Get(y + x0 * h) + image.Get(y2 + x0 * h) +
+					image.Get(y0 + x * h) + image.Get(y + x * h) + image.Get(y2 + x * h) +
+					image.Get(y0 + x2 * h) + image.Get(y + x2 * h) + image.Get(y2 + x2 * h);
+				smoothed.Set(y + x * h, c * (1.0f / 9.0f));
+			}
+		}
+
+		float k = 0.08f;
+		for (int j = 0; j < w * h; j++)
+		{
+			MipColor c = image.Get(j);
+			image.Set(j, c + (c - smoothed.Get(j)) * k);
+		}
+	}
+
+	void DownscaleKaiser(const MipImage &src, MipImage &temp, MipImage &dest, int srcw, int srch, int w, int h)
+	{
+		static const KaiserKernel kernel;
+		const float *weights = kernel.Weights;
+
+		// Horizontal pass (src is column major, so each column is srch pixels)
+		temp.Resize(w * srch);
+		for (int x = 0; x < w; x++)
+		{
+			if (srcw == w)
+			{
+				memcpy(temp.Data(x * srch), src.Data(x * srch), srch * sizeof(float) * 4);
+				continue;
+			}
+
+			int columns[6];
+			for (int k = 0; k < 6; k++)
+			{
+				int sx = (x * 2 - 2 + k) % srcw;
+				columns[k] = (sx < 0 ? sx + srcw : sx) * srch;
+			}
+
+			for (int y = 0; y < srch; y++)
+			{
+				MipColor c =
+					(src.Get(y + columns[0]) + src.Get(y + columns[5])) * weights[2] +
+					(src.Get(y + columns[1]) + src.Get(y + columns[4])) * weights[1] +
+					(src.Get(y + columns[2]) + src.Get(y + columns[3])) * weights[0];
+				temp.Set(y + x * srch, c);
+			}
+		}
+
+		// Vertical pass
+		for (int x = 0; x < w; x++)
+		{
+			const size_t column = x * srch;
+			for (int y = 0; y < h; y++)
+			{
+				if (srch == h)
+				{
+					dest.Set(y + x * h, temp.Get(y + column));
+					continue;
+				}
+
+				int rows[6];
+				for (int k = 0; k < 6; k++)
+				{
+					int sy = (y * 2 - 2 + k) % srch;
+					rows[k] = sy < 0 ? sy + srch : sy;
+				}
+
+				MipColor c =
+					(temp.Get(rows[0] + column) + temp.Get(rows[5] + column)) * weights[2] +
+					(temp.Get(rows[1] + column) + temp.Get(rows[4] + column)) * weights[1] +
+					(temp.Get(rows[2] + column) + temp.Get(rows[3] + column)) * weights[0];
+				dest.Set(y + x * h, c);
+			}
+		}
+	}
+}
+
+void FBgraMipCache::FilterMipmaps(uint32_t *pixels, int width, int height, int levels)
+{
+	const GammaTables &gamma = GetGammaTables();
+	int filter = r_mipmap_filter;
+
+	// Convert to normalized linear colorspace
+	MipImage src, dest, temp;
+	src.Resize(width * height);
+	for (int i = 0; i < width * height; i++)
+	{
+		uint32_t c8 = pixels[i];
+		float *c = src.Data(i);
+		c[0] = gamma.ToLinear[APART(c8)];
+		c[1] = gamma.ToLinear[RPART(c8)];
+		c[2] = gamma.ToLinear[GPART(c8)];
+		c[3] = gamma.ToLinear[BPART(c8)];
+	}
+
+	uint32_t *output = pixels + width * height;
+	for (int i = 1; i < levels; i++)
+	{
+		int srcw = MAX(width >> (i - 1), 1);
+		int srch = MAX(height >> (i - 1), 1);
+		int w = MAX(width >> i, 1);
+		int h = MAX(height >> i, 1);
+
+		dest.Resize(w * h);
+		if (filter == 1)
+		{
+			DownscaleKaiser(src, temp, dest, srcw, srch, w, h);
+		}
+		else
+		{
+			DownscaleBox(src, dest, srcw, srch, w, h);
+			Sharpen(dest, temp, w, h);
+		}
+
+		// Convert to bgra8 sRGB colorspace
+		for (int j = 0; j < w * h; j++)
+		{
+			const float *c = dest.Data(j);
+			uint32_t a = gamma.ToGamma(c[0]);
+			uint32_t r = gamma.ToGamma(c[1]);
+			uint32_t g = gamma.ToGamma(c[2]);
+			uint32_t b = gamma.ToGamma(c[3]);
+			output[j] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+		output += w * h;
+
+		std::swap(src, dest);
+	}
+}
+
+//==========================================================================
+//
+// Cache
+//
+//==========================================================================
+
+FBgraMipCache *FBgraMipCache::Instance()
+{
+	static FBgraMipCache cache;
+	return &cache;
+}
+
+FBgraMipCache::~FBgraMipCache()
+{
+	StopWorker();
+
+	// Textures may outlive the cache during shutdown
+	for (auto &it : mEntries)
+		it.first->BgraMipEntry = nullptr;
+}
+
+bool FBgraMipCache::IsCached(FTexture *texture)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mEntries.find(texture) != mEntries.end();
+}
+
+void FBgraMipCache::GenerateMipmaps(FTexture *texture, bool reload)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto &entry = mEntries[texture];
+	if (!entry)
+	{
+		entry = std::make_shared<FBgraMipEntry>();
+		entry->Texture = texture;
+		texture->BgraMipEntry = entry.get();
+	}
+
+	// The mipmaps were filtered from this same base level before it was released
+	size_t base = texture->GetWidth() * texture->GetHeight();
+	if (reload && !entry->Compressed.IsEmpty() && base + entry->Compressed.PixelCount() == texture->PixelsBgra.size())
+	{
+		entry->Compressed.Decompress(texture->PixelsBgra.data() + base);
+		entry->LastUsed = CurrentFrame;
+		return;
+	}
+
+	entry->Generation++;
+	entry->LastUsed = CurrentFrame;
+	entry->Compressed.Clear();
+	entry->Compressing = false;
+
+	// Drop any job for an older version of the texture
+	mQueued.erase(std::remove_if(mQueued.begin(), mQueued.end(), [&](const std::unique_ptr<Job> &job) { return job->Entry == entry; }), mQueued.end());
+
+	if (!r_mipmap_background)
+	{
+		entry->Pending = false;
+		lock.unlock();
+		texture->GenerateBgraMipmaps();
+		return;
+	}
+
+	// Something to draw with until the worker is done
+	texture->GenerateBgraMipmapsFast();
+
+	std::unique_ptr<Job> job(new Job());
+	job->Entry = entry;
+	job->Generation = entry->Generation;
+	job->Width = texture->GetWidth();
+	job->Height = texture->GetHeight();
+	job->Levels = texture->MipmapLevels();
+	job->Pixels = texture->PixelsBgra;
+	mQueued.push_back(std::move(job));
+
+	entry->Demand = 0;
+	entry->Pending = true;
+
+	StartWorker();
+	lock.unlock();
+	mCondition.notify_one();
+}
+
+void FBgraMipCache::Remove(FTexture *texture)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mEntries.find(texture);
+	if (it == mEntries.end())
+		return;
+
+	std::shared_ptr<FBgraMipEntry> entry = it->second;
+	entry->Texture = nullptr;
+	mQueued.erase(std::remove_if(mQueued.begin(), mQueued.end(), [&](const std::unique_ptr<Job> &job) { return job->Entry == entry; }), mQueued.end());
+	mEntries.erase(it);
+	texture->BgraMipEntry = nullptr;
+}
+
+void FBgraMipCache::Update()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	CurrentFrame++;
+
+	// Replace the placeholder mipmaps with the finished ones
+	for (auto &job : mFinished)
+	{
+		FBgraMipEntry *entry = job->Entry.get();
+		FTexture *texture = entry->Texture;
+		if (!texture || entry->Generation != job->Generation)
+			continue;
+
+		if (job->Compress)
+		{
+			entry->Compressing = false;
+			entry->Compressed = std::move(job->Blocks);
+		}
+		else if (texture->PixelsBgra.size() == job->Pixels.size())
+		{
+			size_t base = job->Width * job->Height;
+			memcpy(texture->PixelsBgra.data() + base, job->Pixels.data() + base, (job->Pixels.size() - base) * sizeof(uint32_t));
+			entry->Pending = false;
+		}
+	}
+	mFinished.clear();
+
+	size_t budget = (size_t)*r_mipmap_budget * 1024 * 1024;
+	bool compress = r_mipmap_compress;
+
+	// Textures that got compressed are only released if they stayed idle
+	ResidentBytes = 0;
+	ResidentTextures = 0;
+	CompressedTextures = 0;
+	for (auto &it : mEntries)
+	{
+		FBgraMipEntry *entry = it.second.get();
+		if (!compress)
+			entry->Compressed.Clear();
+		if (!entry->Compressed.IsEmpty() && !it.first->PixelsBgra.empty() && entry->LastUsed < CurrentFrame - 1)
+			it.first->PixelsBgra = std::vector<uint32_t>();
+
+		ResidentBytes += it.first->PixelsBgra.size() * sizeof(uint32_t) + entry->Compressed.Size();
+		ResidentTextures++;
+		if (!entry->Compressed.IsEmpty())
+			CompressedTextures++;
+	}
+
+	// Compress, and then release, the least recently used textures that were not drawn in the last frame
+	TArray<FTexture *> evict;
+	if (ResidentBytes > budget)
+	{
+		std::vector<FBgraMipEntry *> candidates;
+		for (auto &it : mEntries)
+		{
+			if (it.second->LastUsed < CurrentFrame - 1)
+				candidates.push_back(it.second.get());
+		}
+		std::sort(candidates.begin(), candidates.end(), [](FBgraMipEntry *a, FBgraMipEntry *b) { return a->LastUsed < b->LastUsed; });
+
+		// Size once the queued compression jobs are done
+		size_t projected = ResidentBytes;
+
+		if (compress)
+		{
+			for (FBgraMipEntry *entry : candidates)
+			{
+				if (projected <= budget)
+					break;
+
+				FTexture *texture = entry->Texture;
+				int levels = texture->MipmapLevels();
+				if (entry->Pending || !entry->Compressed.IsEmpty() || texture->PixelsBgra.empty() || levels < 2)
+					continue;
+
+				// Only the mipmaps are kept. The base level is rebuilt from the source image.
+				int width = texture->GetWidth(), height = texture->GetHeight();
+				size_t savings = texture->PixelsBgra.size() * sizeof(uint32_t) - FBgraBlockImage::MaxSize(MAX(width >> 1, 1), MAX(height >> 1, 1), levels - 1);
+				projected -= MIN(savings, projected);
+				if (entry->Compressing)
+					continue;
+
+				std::unique_ptr<Job> job(new Job());
+				job->Entry = mEntries[texture];
+				job->Generation = entry->Generation;
+				job->Width = width;
+				job->Height = height;
+				job->Levels = levels;
+				job->Pixels = texture->PixelsBgra;
+				job->Compress = true;
+				mQueued.push_back(std::move(job));
+				entry->Compressing = true;
+			}
+		}
+
+		for (FBgraMipEntry *entry : candidates)
+		{
+			if (projected <= budget || ResidentBytes <= budget)
+				break;
+			size_t size = entry->Texture->PixelsBgra.size() * sizeof(uint32_t) + entry->Compressed.Size();
+			ResidentBytes -= size;
+			projected -= MIN(size, projected);
+			ResidentTextures--;
+			evict.Push(entry->Texture);
+		}
+	}
+
+	PendingTextures = (int)mQueued.size();
+	bool queued = !mQueued.empty();
+	if (queued)
+		StartWorker();
+	lock.unlock();
+	if (queued)
+		mCondition.notify_one();
+
+	for (FTexture *texture : evict)
+		texture->Unload();
+	EvictedTextures += evict.Size();
+}
+
+void FBgraMipCache::Benchmark()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	size_t rawbytes = 0, compressedbytes = 0, decodedbytes = 0, pixelcount = 0;
+	double squarederror = 0.0;
+	int count = 0;
+	cycle_t encodetime, decodetime;
+	encodetime.Reset();
+	decodetime.Reset();
+
+	std::vector<uint32_t> decoded;
+	for (auto &it : mEntries)
+	{
+		FTexture *texture = it.first;
+		int width = texture->GetWidth(), height = texture->GetHeight(), levels = texture->MipmapLevels();
+		if (texture->PixelsBgra.empty() || levels < 2)
+			continue;
+
+		// Same layout as the copies made by Update: the mipmaps without the base level
+		const uint32_t *mipmaps = texture->PixelsBgra.data() + width * height;
+		FBgraBlockImage image;
+		encodetime.Clock();
+		image.Compress(mipmaps, MAX(width >> 1, 1), MAX(height >> 1, 1), levels - 1);
+		encodetime.Unclock();
+
+		decoded.resize(image.PixelCount());
+		decodetime.Clock();
+		image.Decompress(decoded.data());
+		decodetime.Unclock();
+
+		for (size_t i = 0; i < decoded.size(); i++)
+		{
+			uint32_t a = mipmaps[i];
+			uint32_t b = decoded[i];
+			if (APART(a) == 0)
+				continue;
+			int dr = RPART(a) - RPART(b), dg = GPART(a) - GPART(b), db = BPART(a) - BPART(b), da = APART(a) - APART(b);
+			squarederror += dr * dr + dg * dg + db * db + da * da;
+			pixelcount++;
+		}
+
+		rawbytes += texture->PixelsBgra.size() * sizeof(uint32_t);
+		compressedbytes += image.Size();
+		decodedbytes += decoded.size() * sizeof(uint32_t);
+		count++;
+	}
+
+	if (count == 0 || compressedbytes == 0)
+	{
+		Printf("No BGRA textures resident\n");
+		return;
+	}
+
+	double mse = squarederror / MAX(pixelcount * 4, (size_t)1);
+	double psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+	double decodeseconds = MAX(decodetime.TimeMS() / 1000.0, 0.000001);
+	Printf("%d textures: %.2f MB -> %.2f MB (%.1f:1), mipmap PSNR %.2f dB\n", count, rawbytes / 1048576.0, compressedbytes / 1048576.0, (double)rawbytes / compressedbytes, psnr);
+	Printf("Encode %.2f ms, decode %.2f ms (%.0f MB/s output)\n", encodetime.TimeMS(), decodetime.TimeMS(), decodedbytes / 1048576.0 / decodeseconds);
+}
+
+void FBgraMipCache::StartWorker()
+{
+	if (!mWorker.joinable())
+	{
+		mStopWorker = false;
+		mWorker = std::thread([=]() { WorkerMain(); });
+	}
+}
+
+void FBgraMipCache::StopWorker()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!mWorker.joinable())
+		return;
+	mStopWorker = true;
+	lock.unlock();
+	mCondition.notify_all();
+	mWorker.join();
+}
+
+void FBgraMipCache::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mCondition.wait(lock, [&]() { return mStopWorker || !mQueued.empty(); });
+		if (mStopWorker)
+			break;
+
+		// Most requested texture first, compression last
+		auto priority = [](const std::unique_ptr<Job> &job) { return job->Compress ? -1 : job->Entry->Demand.load(std::memory_order_relaxed); };
+		auto next = std::max_element(mQueued.begin(), mQueued.end(), [&](const std::unique_ptr<Job> &a, const std::unique_ptr<Job> &b)
+		{
+			return priority(a) < priority(b);
+		});
+		std::unique_ptr<Job> job = std::move(*next);
+		mQueued.erase(next);
+		lock.unlock();
+
+		if (job->Compress)
+		{
+			job->Blocks.Compress(job->Pixels.data() + job->Width * job->Height, MAX(job->Width >> 1, 1), MAX(job->Height >> 1, 1), job->Levels - 1);
+			job->Pixels = std::vector<uint32_t>();
+		}
+		else
+		{
+			FilterMipmaps(job->Pixels.data(), job->Width, job->Height, job->Levels);
+		}
+
+		lock.lock();
+		if (job->Entry->Texture)
+			mFinished.push_back(std::move(job));
+	}
+}
+
+CCMD(bgrablockbench)
+{
+	FBgraMipCache::Instance()->Benchmark();
+}
@@ -0,0 +1,150 @@
+/*
+** bgramipcache.h
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __BGRAMIPCACHE_H
+#define __BGRAMIPCACHE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "textures/bgrablocks.h"
+
+class FTexture;
+
+// Bookkeeping for a texture with a BGRA mipmap chain
+struct FBgraMipEntry
+{
+	FTexture *Texture = nullptr;
+
+	// Frame the texture was last drawn in
+	std::atomic<int> LastUsed { 0 };
+
+	// Number of times the texture was requested while its high quality mipmaps were pending
+	std::atomic<int> Demand { 0 };
+
+	// True while the box filtered placeholder mipmaps are in use
+	std::atomic<bool> Pending { false };
+
+	// Incremented every time the base level is regenerated
+	int Generation = 0;
+
+	// Block compressed copy of the mipmap levels below the base level. Only made once the texture has gone idle while over budget.
+	FBgraBlockImage Compressed;
+
+	// True while a compression job is queued or running
+	bool Compressing = false;
+};
+
+// Owns the BGRA mipmap chains used by the true color software renderers.
+//
+// Mipmaps are first made with a fast box filter so that a texture can be drawn right away.
+// The gamma correct box or Kaiser filtered mipmaps are then generated on a worker thread,
+// most requested texture first, and copied into the texture at the start of the next frame.
+// Chains are kept across levels. When the resident size goes above r_mipmap_budget, the least
+// recently used chains are released. If r_mipmap_compress is on, a block compressed copy of their
+// mipmaps is kept first, so that only the base level has to be rebuilt from the source image the
+// next time they are drawn. The base level is never restored from the lossy copy.
+class FBgraMipCache
+{
+public:
+	static FBgraMipCache *Instance();
+	~FBgraMipCache();
+
+	// Generates the mipmaps for a texture whose base level was just filled in.
+	// If reload is set, the base level is unchanged since it was released and the mipmaps are taken from the compressed copy when there is one.
+	void GenerateMipmaps(FTexture *texture, bool reload = false);
+
+	// Fills in the mipmap levels of a BGRA mipmap chain from its base level
+	static void FilterMipmaps(uint32_t *pixels, int width, int height, int levels);
+
+	// Marks a texture as used in this frame. Safe to call from any render thread.
+	static void Touch(FBgraMipEntry *entry)
+	{
+		entry->LastUsed.store(CurrentFrame, std::memory_order_relaxed);
+		if (entry->Pending.load(std::memory_order_relaxed))
+			entry->Demand.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Measures compression ratio, mipmap quality and speed for all resident textures
+	void Benchmark();
+
+	// Forget a texture. Called when its BGRA pixels are released.
+	void Remove(FTexture *texture);
+
+	// Copies finished mipmaps into their textures and releases textures above the budget.
+	// Must be called while no render or drawer threads are running.
+	void Update();
+
+	// True if the texture has a BGRA mipmap chain managed by the cache
+	bool IsCached(FTexture *texture);
+
+	static int CurrentFrame;
+	static size_t ResidentBytes;
+	static int ResidentTextures;
+	static int PendingTextures;
+	static int EvictedTextures;
+	static int CompressedTextures;
+
+private:
+	struct Job
+	{
+		std::shared_ptr<FBgraMipEntry> Entry;
+		int Generation;
+		int Width;
+		int Height;
+		int Levels;
+		std::vector<uint32_t> Pixels;
+		bool Compress = false;
+		FBgraBlockImage Blocks;
+	};
+
+	void StartWorker();
+	void StopWorker();
+	void WorkerMain();
+
+	std::unordered_map<FTexture *, std::shared_ptr<FBgraMipEntry>> mEntries;
+	std::vector<std::unique_ptr<Job>> mQueued;
+	std::vector<std::unique_ptr<Job>> mFinished;
+
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::thread mWorker;
+	bool mStopWorker = false;
+};
+
+#endif
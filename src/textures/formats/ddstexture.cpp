@@ -181,8 +181,11 @@ protected:
 	void DecompressDXT1 (FileReader &lump, uint8_t *buffer, int pixelmode);
 	void DecompressDXT3 (FileReader &lump, bool premultiplied, uint8_t *buffer, int pixelmode);
 	void DecompressDXT5 (FileReader &lump, bool premultiplied, uint8_t *buffer, int pixelmode);
+	int ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf);
 
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL);
+	bool CanDecodeAsync() override;
+	bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) override;
 	bool UseBasePalette();
 
 	friend class FTexture;
@@ -810,8 +813,43 @@ void FDDSTexture::DecompressDXT5 (FileReader &lump, bool premultiplied, uint8_t
 
 int FDDSTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
 {
-	auto lump = Wads.OpenLumpReader (SourceLump);
+	int transpal;
+	if (CopyDecodedPixels(bmp, x, y, rotate, inf, transpal))
+	{
+		return transpal;
+	}
+
+	auto lump = Wads.OpenLumpReader(SourceLump);
+	return ReadTrueColorPixels(lump, bmp, x, y, rotate, inf);
+}
+
+//===========================================================================
+//
+// FDDSTexture::DecodeAsync
+//
+// Called on a texture decoder thread with a copy of the lump
+//
+//===========================================================================
 
+bool FDDSTexture::CanDecodeAsync()
+{
+	return true;
+}
+
+bool FDDSTexture::DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal)
+{
+	transpal = ReadTrueColorPixels(lump, bmp, 0, 0, 0, nullptr);
+	return true;
+}
+
+//===========================================================================
+//
+// FDDSTexture::ReadTrueColorPixels
+//
+//===========================================================================
+
+int FDDSTexture::ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
+{
 	uint8_t *TexBuffer = new uint8_t[4*Width*Height];
 
 	lump.Seek (sizeof(DDSURFACEDESC2) + 4, FileReader::SeekSet);
@@ -172,6 +172,17 @@ void JPEG_OutputMessage (j_common_ptr cinfo)
 	Printf (TEXTCOLOR_ORANGE "JPEG failure: %s\n", buffer);
 }
 
+//==========================================================================
+//
+// Used by the texture decoder threads, which must not print anything.
+// A failed decode is repeated on the main thread to report the error.
+//
+//==========================================================================
+
+static void JPEG_DiscardMessage (j_common_ptr cinfo)
+{
+}
+
 //==========================================================================
 //
 // A JPEG texture
@@ -187,6 +198,11 @@ public:
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL) override;
 	bool UseBasePalette() override;
 	uint8_t *MakeTexture (FRenderStyle style) override;
+	bool CanDecodeAsync() override;
+	bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) override;
+
+protected:
+	bool ReadTrueColorPixels(FileReader *lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, bool quiet);
 };
 
 //==========================================================================
@@ -397,20 +413,55 @@ uint8_t *FJPEGTexture::MakeTexture (FRenderStyle style)
 
 int FJPEGTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
 {
-	PalEntry pe[256];
+	int transpal;
+	if (!CopyDecodedPixels(bmp, x, y, rotate, inf, transpal))
+	{
+		auto lump = Wads.OpenLumpReader (SourceLump);
+		ReadTrueColorPixels(&lump, bmp, x, y, rotate, inf, false);
+	}
+	return 0;
+}
 
-	auto lump = Wads.OpenLumpReader (SourceLump);
+//===========================================================================
+//
+// FJPEGTexture::DecodeAsync
+//
+// Called on a texture decoder thread with a copy of the lump
+//
+//===========================================================================
+
+bool FJPEGTexture::CanDecodeAsync()
+{
+	return true;
+}
+
+bool FJPEGTexture::DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal)
+{
+	transpal = 0;
+	return ReadTrueColorPixels(&lump, bmp, 0, 0, 0, nullptr, true);
+}
+
+//===========================================================================
+//
+// FJPEGTexture::ReadTrueColorPixels
+//
+//===========================================================================
+
+bool FJPEGTexture::ReadTrueColorPixels(FileReader *lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, bool quiet)
+{
+	PalEntry pe[256];
 	JSAMPLE *buff = NULL;
+	bool result = false;
 
 	jpeg_decompress_struct cinfo;
 	jpeg_error_mgr jerr;
 
 	cinfo.err = jpeg_std_error(&jerr);
-	cinfo.err->output_message = JPEG_OutputMessage;
+	cinfo.err->output_message = quiet ? JPEG_DiscardMessage : JPEG_OutputMessage;
 	cinfo.err->error_exit = JPEG_ErrorExit;
 	jpeg_create_decompress(&cinfo);
 
-	FLumpSourceMgr sourcemgr(&lump, &cinfo);
+	FLumpSourceMgr sourcemgr(lump, &cinfo);
 	try
 	{
 		jpeg_read_header(&cinfo, TRUE);
@@ -420,7 +471,7 @@ int FJPEGTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FC
 			(cinfo.out_color_space == JCS_YCbCr && cinfo.num_components == 3) ||
 			(cinfo.out_color_space == JCS_GRAYSCALE && cinfo.num_components == 1)))
 		{
-			Printf(TEXTCOLOR_ORANGE "Unsupported color format in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+			if (!quiet) Printf(TEXTCOLOR_ORANGE "Unsupported color format in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
 		}
 		else
 		{
@@ -465,15 +516,16 @@ int FJPEGTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FC
 				break;
 			}
 			jpeg_finish_decompress(&cinfo);
+			result = true;
 		}
 	}
 	catch (int)
 	{
-		Printf(TEXTCOLOR_ORANGE "JPEG error in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
+		if (!quiet) Printf(TEXTCOLOR_ORANGE "JPEG error in %s\n", Wads.GetLumpFullPath(SourceLump).GetChars());
 	}
 	jpeg_destroy_decompress(&cinfo);
 	if (buff != NULL) delete [] buff;
-	return 0;
+	return result;
 }
 
 
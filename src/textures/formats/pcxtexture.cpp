@@ -86,6 +86,8 @@ public:
 	FTextureFormat GetFormat () override;
 
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL) override;
+	bool CanDecodeAsync() override;
+	bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) override;
 	bool UseBasePalette() override;
 
 protected:
@@ -93,6 +95,7 @@ protected:
 	void ReadPCX4bits (uint8_t *dst, FileReader & lump, PCXHeader *hdr);
 	void ReadPCX8bits (uint8_t *dst, FileReader & lump, PCXHeader *hdr);
 	void ReadPCX24bits (uint8_t *dst, FileReader & lump, PCXHeader *hdr, int planes);
+	int ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf);
 
 	uint8_t *MakeTexture (FRenderStyle style) override;
 };
@@ -463,13 +466,49 @@ uint8_t *FPCXTexture::MakeTexture(FRenderStyle style)
 //===========================================================================
 
 int FPCXTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
+{
+	int transpal;
+	if (CopyDecodedPixels(bmp, x, y, rotate, inf, transpal))
+	{
+		return transpal;
+	}
+
+	auto lump = Wads.OpenLumpReader(SourceLump);
+	return ReadTrueColorPixels(lump, bmp, x, y, rotate, inf);
+}
+
+//===========================================================================
+//
+// FPCXTexture::DecodeAsync
+//
+// Called on a texture decoder thread with a copy of the lump
+//
+//===========================================================================
+
+bool FPCXTexture::CanDecodeAsync()
+{
+	return true;
+}
+
+bool FPCXTexture::DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal)
+{
+	transpal = ReadTrueColorPixels(lump, bmp, 0, 0, 0, nullptr);
+	return true;
+}
+
+//===========================================================================
+//
+// FPCXTexture::ReadTrueColorPixels
+//
+//===========================================================================
+
+int FPCXTexture::ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
 {
 	PalEntry pe[256];
 	PCXHeader header;
 	int bitcount;
 	uint8_t * Pixels;
 
-	auto lump = Wads.OpenLumpReader(SourceLump);
 
 	lump.Read(&header, sizeof(header));
 
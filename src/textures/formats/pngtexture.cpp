@@ -56,9 +56,12 @@ public:
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL) override;
 	bool UseBasePalette() override;
 	uint8_t *MakeTexture(FRenderStyle style) override;
+	bool CanDecodeAsync() override;
+	bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) override;
 
 protected:
 	void ReadAlphaRemap(FileReader *lump, uint8_t *alpharemap);
+	int ReadTrueColorPixels(FileReader *lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf);
 
 	FString SourceFile;
 	FileReader fr;
@@ -539,25 +542,56 @@ uint8_t *FPNGTexture::MakeTexture (FRenderStyle style)
 
 int FPNGTexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
 {
-	// Parse pre-IDAT chunks. I skip the CRCs. Is that bad?
-	PalEntry pe[256];
-	uint32_t len, id;
-	static char bpp[] = {1, 0, 3, 1, 2, 0, 4};
-	int pixwidth = Width * bpp[ColorType];
-	int transpal = false;
-
-	FileReader *lump;
-	FileReader lfr;
+	int transpal;
+	if (CopyDecodedPixels(bmp, x, y, rotate, inf, transpal))
+	{
+		return transpal;
+	}
 
 	if (SourceLump >= 0)
 	{
-		lfr = Wads.OpenLumpReader(SourceLump);
-		lump = &lfr;
+		FileReader lfr = Wads.OpenLumpReader(SourceLump);
+		return ReadTrueColorPixels(&lfr, bmp, x, y, rotate, inf);
 	}
 	else
 	{
-		lump = &fr;
+		return ReadTrueColorPixels(&fr, bmp, x, y, rotate, inf);
 	}
+}
+
+//===========================================================================
+//
+// FPNGTexture::DecodeAsync
+//
+// Called on a texture decoder thread with a copy of the lump
+//
+//===========================================================================
+
+bool FPNGTexture::CanDecodeAsync()
+{
+	return SourceLump >= 0;
+}
+
+bool FPNGTexture::DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal)
+{
+	transpal = ReadTrueColorPixels(&lump, bmp, 0, 0, 0, nullptr);
+	return true;
+}
+
+//===========================================================================
+//
+// FPNGTexture::ReadTrueColorPixels
+//
+//===========================================================================
+
+int FPNGTexture::ReadTrueColorPixels(FileReader *lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
+{
+	// Parse pre-IDAT chunks. I skip the CRCs. Is that bad?
+	PalEntry pe[256];
+	uint32_t len, id;
+	static const char bpp[] = {1, 0, 3, 1, 2, 0, 4};
+	int pixwidth = Width * bpp[ColorType];
+	int transpal = false;
 
 	lump->Seek(33, FileReader::SeekSet);
 	for(int i = 0; i < 256; i++)	// default to a gray map
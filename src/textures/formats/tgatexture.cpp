@@ -81,10 +81,13 @@ public:
 
 	FTextureFormat GetFormat () override;
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL) override;
+	bool CanDecodeAsync() override;
+	bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) override;
 	bool UseBasePalette() override;
 
 protected:
 	void ReadCompressed(FileReader &lump, uint8_t * buffer, int bytesperpixel);
+	int ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf);
 	uint8_t *MakeTexture (FRenderStyle style) override;
 };
 
@@ -403,9 +406,45 @@ uint8_t *FTGATexture::MakeTexture (FRenderStyle style)
 //===========================================================================
 
 int FTGATexture::CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
+{
+	int transpal;
+	if (CopyDecodedPixels(bmp, x, y, rotate, inf, transpal))
+	{
+		return transpal;
+	}
+
+	auto lump = Wads.OpenLumpReader(SourceLump);
+	return ReadTrueColorPixels(lump, bmp, x, y, rotate, inf);
+}
+
+//===========================================================================
+//
+// FTGATexture::DecodeAsync
+//
+// Called on a texture decoder thread with a copy of the lump
+//
+//===========================================================================
+
+bool FTGATexture::CanDecodeAsync()
+{
+	return true;
+}
+
+bool FTGATexture::DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal)
+{
+	transpal = ReadTrueColorPixels(lump, bmp, 0, 0, 0, nullptr);
+	return true;
+}
+
+//===========================================================================
+//
+// FTGATexture::ReadTrueColorPixels
+//
+//===========================================================================
+
+int FTGATexture::ReadTrueColorPixels(FileReader &lump, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf)
 {
 	PalEntry pe[256];
-	auto lump = Wads.OpenLumpReader (SourceLump);
 	TGAHeader hdr;
 	uint16_t w;
 	uint8_t r,g,b,a;
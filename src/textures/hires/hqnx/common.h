@@ -58,6 +58,9 @@ static inline int Diff(uint32_t c1, uint32_t c2)
     return yuv_diff(rgb_to_yuv(c1), rgb_to_yuv(c2));
 }
 
+/* Computes the difference pattern of every pixel in a row */
+void hqx_patterns(const uint32_t *sp, int prevline, int nextline, int Xres, int *patterns);
+
 /* Interpolate functions */
 static inline uint32_t Interpolate_2(uint32_t c1, int w1, uint32_t c2, int w2, int s)
 {
@@ -70,16 +70,16 @@
 #define PIXEL11_90    *(dp+dpL+1) = Interp9(w[5], w[6], w[8]);
 #define PIXEL11_100   *(dp+dpL+1) = Interp10(w[5], w[6], w[8]);
 
-HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+static void hq2x_32_rows( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres, int yFirst, int yLast )
 {
-    int  i, j, k;
+    int  i, j;
     int  prevline, nextline;
     uint32_t  w[10];
     int dpL = (drb >> 2);
     int spL = (srb >> 2);
     uint8_t *sRowP = (uint8_t *) sp;
     uint8_t *dRowP = (uint8_t *) dp;
-    uint32_t yuv1, yuv2;
+    int *patterns = new int[Xres];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -92,11 +92,18 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    for (j=0; j<Yres; j++)
+    sRowP += yFirst * srb;
+    sp = (uint32_t *) sRowP;
+    dRowP += yFirst * drb * 2;
+    dp = (uint32_t *) dRowP;
+
+    for (j=yFirst; j<yLast; j++)
     {
         if (j>0)      prevline = -spL; else prevline = 0;
         if (j<Yres-1) nextline =  spL; else nextline = 0;
 
+        hqx_patterns(sp, prevline, nextline, Xres, patterns);
+
         for (i=0; i<Xres; i++)
         {
             w[2] = *(sp + prevline);
@@ -129,23 +136,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 w[9] = w[8];
             }
 
-            int pattern = 0;
-            int flag = 1;
-
-            yuv1 = rgb_to_yuv(w[5]);
-
-            for (k=1; k<=9; k++)
-            {
-                if (k==5) continue;
-
-                if ( w[k] != w[5] )
-                {
-                    yuv2 = rgb_to_yuv(w[k]);
-                    if (yuv_diff(yuv1, yuv2))
-                        pattern |= flag;
-                }
-                flag <<= 1;
-            }
+            int pattern = patterns[i];
 
             switch (pattern)
             {
@@ -2799,6 +2790,13 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
         dRowP += drb * 2;
         dp = (uint32_t *) dRowP;
     }
+
+    delete[] patterns;
+}
+
+HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+{
+    hq2x_32_rows(sp, srb, dp, drb, Xres, Yres, 0, Yres);
 }
 
 HQX_API void HQX_CALLCONV hq2x_32( uint32_t * sp, uint32_t * dp, int Xres, int Yres )
@@ -2806,3 +2804,9 @@ HQX_API void HQX_CALLCONV hq2x_32( uint32_t * sp, uint32_t * dp, int Xres, int Y
     uint32_t rowBytesL = Xres * 4;
     hq2x_32_rb(sp, rowBytesL, dp, rowBytesL * 2, Xres, Yres);
 }
+
+HQX_API void HQX_CALLCONV hq2x_32_slice( uint32_t * sp, uint32_t * dp, int Xres, int Yres, int yFirst, int yLast )
+{
+    uint32_t rowBytesL = Xres * 4;
+    hq2x_32_rows(sp, rowBytesL, dp, rowBytesL * 2, Xres, Yres, yFirst, yLast);
+}
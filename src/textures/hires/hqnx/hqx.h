@@ -48,6 +48,11 @@ HQX_API void HQX_CALLCONV hq2x_32( uint32_t * src, uint32_t * dest, int width, i
 HQX_API void HQX_CALLCONV hq3x_32( uint32_t * src, uint32_t * dest, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32( uint32_t * src, uint32_t * dest, int width, int height );
 
+/* Scales the source rows yFirst to yLast - 1. Slices can run in parallel. */
+HQX_API void HQX_CALLCONV hq2x_32_slice( uint32_t * src, uint32_t * dest, int width, int height, int yFirst, int yLast );
+HQX_API void HQX_CALLCONV hq3x_32_slice( uint32_t * src, uint32_t * dest, int width, int height, int yFirst, int yLast );
+HQX_API void HQX_CALLCONV hq4x_32_slice( uint32_t * src, uint32_t * dest, int width, int height, int yFirst, int yLast );
+
 HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
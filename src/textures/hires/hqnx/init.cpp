@@ -16,7 +16,13 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#include <vector>
 #include "hqx.h"
+#include "common.h"
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
 
 uint32_t   *RGBtoYUV;
 uint32_t   YUV1, YUV2;
@@ -26,7 +32,7 @@ HQX_API void HQX_CALLCONV hqxInit(void)
     /* Initalize RGB to YUV lookup table */
     uint32_t c, r, g, b, y, u, v;
 	RGBtoYUV = new uint32_t[16777216];
-    for (c = 0; c < 16777215; c++) {
+    for (c = 0; c < 16777216; c++) {
         r = (c & 0xFF0000) >> 16;
         g = (c & 0x00FF00) >> 8;
         b = c & 0x0000FF;
@@ -36,3 +42,71 @@ HQX_API void HQX_CALLCONV hqxInit(void)
         RGBtoYUV[c] = (y << 16) + (u << 8) + v;
     }
 }
+
+/*
+ * Bit k of a pixel's pattern is set if neighbour k differs from the pixel,
+ * with the neighbours numbered
+ *
+ *   0 1 2
+ *   3 . 4
+ *   5 6 7
+ *
+ * The YUV values of the three rows are looked up once, with the edge pixels
+ * repeated, so that every pixel can compare against the same offsets. The
+ * SSE2 path tests four pixels at a time: the Y, U and V bytes of the
+ * absolute difference are compared against the thresholds all at once.
+ */
+void hqx_patterns(const uint32_t *sp, int prevline, int nextline, int Xres, int *patterns)
+{
+    // Called for every row, and the texture decoders run on several threads
+    static thread_local std::vector<uint32_t> yuvbuffer;
+    if (yuvbuffer.size() < size_t(Xres + 2) * 3)
+        yuvbuffer.resize(size_t(Xres + 2) * 3);
+    uint32_t *rows[3] = { &yuvbuffer[0], &yuvbuffer[Xres + 2], &yuvbuffer[(Xres + 2) * 2] };
+    const uint32_t *src[3] = { sp + prevline, sp, sp + nextline };
+
+    for (int r = 0; r < 3; r++)
+    {
+        for (int i = 0; i < Xres; i++)
+            rows[r][i + 1] = rgb_to_yuv(src[r][i]);
+        rows[r][0] = rows[r][1];
+        rows[r][Xres + 1] = rows[r][Xres];
+    }
+
+    const int offsets[8][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 0 }, { 1, 2 }, { 2, 0 }, { 2, 1 }, { 2, 2 } };
+    int i = 0;
+
+#ifndef NO_SSE
+    const __m128i thresholds = _mm_setr_epi8((char)(trV), (char)(trU >> 8), (char)(trY >> 16), (char)0xff,
+                                             (char)(trV), (char)(trU >> 8), (char)(trY >> 16), (char)0xff,
+                                             (char)(trV), (char)(trU >> 8), (char)(trY >> 16), (char)0xff,
+                                             (char)(trV), (char)(trU >> 8), (char)(trY >> 16), (char)0xff);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 4 <= Xres; i += 4)
+    {
+        __m128i center = _mm_loadu_si128((const __m128i *)(rows[1] + i + 1));
+        __m128i pattern = _mm_setzero_si128();
+        for (int k = 0; k < 8; k++)
+        {
+            __m128i neighbour = _mm_loadu_si128((const __m128i *)(rows[offsets[k][0]] + i + offsets[k][1]));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(center, neighbour), _mm_subs_epu8(neighbour, center));
+            __m128i same = _mm_cmpeq_epi32(_mm_subs_epu8(diff, thresholds), zero);
+            pattern = _mm_or_si128(pattern, _mm_andnot_si128(same, _mm_set1_epi32(1 << k)));
+        }
+        _mm_storeu_si128((__m128i *)(patterns + i), pattern);
+    }
+#endif
+
+    for (; i < Xres; i++)
+    {
+        uint32_t center = rows[1][i + 1];
+        int pattern = 0;
+        for (int k = 0; k < 8; k++)
+        {
+            if (yuv_diff(center, rows[offsets[k][0]][i + offsets[k][1]]))
+                pattern |= 1 << k;
+        }
+        patterns[i] = pattern;
+    }
+}
@@ -35,6 +35,7 @@
 */
 
 #include "c_cvars.h"
+#include "templates.h"
 #include "v_video.h"
 #include "hqnx/hqx.h"
 #ifdef HAVE_MMX
@@ -43,6 +44,10 @@
 #include "xbr/xbrz.h"
 #include "xbr/xbrz_old.h"
 #include "parallel_for.h"
+#include "textures/texturediskcache.h"
+#include "textures/textures.h"
+#include "c_dispatch.h"
+#include "stats.h"
 
 CUSTOM_CVAR(Int, gl_texture_hqresize, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
@@ -89,19 +94,47 @@ CUSTOM_CVAR(Int, gl_texture_hqresize_mt_height, 4, CVAR_ARCHIVE | CVAR_GLOBALCON
 }
 
 
-static void scale2x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
+//===========================================================================
+//
+// Runs a scaler on horizontal slices of the source image, on the worker
+// threads if the image is large enough. The slice function gets the first
+// and the last + 1 source row.
+//
+//===========================================================================
+
+template<typename Function>
+static void RunSlices(const int inWidth, const int inHeight, const Function &sliceFunction)
+{
+	const int thresholdWidth  = gl_texture_hqresize_mt_width;
+	const int thresholdHeight = gl_texture_hqresize_mt_height;
+
+	if (gl_texture_hqresize_multithread
+		&& inWidth  > thresholdWidth
+		&& inHeight > thresholdHeight)
+	{
+		parallel_for(inHeight, thresholdHeight, [&](int sliceY)
+		{
+			sliceFunction(sliceY, MIN(sliceY + thresholdHeight, inHeight));
+		});
+	}
+	else
+	{
+		sliceFunction(0, inHeight);
+	}
+}
+
+static void scale2x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight, int yFirst, int yLast )
 {
 	const int width = 2* inWidth;
-	const int height = 2 * inHeight;
 
-	for ( int i = 0; i < inWidth; ++i )
+	for ( int j = yFirst; j < yLast; ++j )
 	{
-		const int iMinus = (i > 0) ? (i-1) : 0;
-		const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
-		for ( int j = 0; j < inHeight; ++j )
+		const int jMinus = (j > 0) ? (j-1) : 0;
+		const int jPlus = (j < inHeight - 1 ) ? (j+1) : j;
+		for ( int i = 0; i < inWidth; ++i )
 		{
-			const int jMinus = (j > 0) ? (j-1) : 0;
-			const int jPlus = (j < inHeight - 1 ) ? (j+1) : j;
+			const int iMinus = (i > 0) ? (i-1) : 0;
+			const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
 			const uint32_t A = inputBuffer[ iMinus +inWidth*jMinus];
 			const uint32_t B = inputBuffer[ iMinus +inWidth*j    ];
 			const uint32_t C = inputBuffer[ iMinus +inWidth*jPlus];
@@ -126,19 +159,18 @@ static void scale2x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth
 	}
 }
 
-static void scale3x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
+static void scale3x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight, int yFirst, int yLast )
 {
 	const int width = 3* inWidth;
-	const int height = 3 * inHeight;
 
-	for ( int i = 0; i < inWidth; ++i )
+	for ( int j = yFirst; j < yLast; ++j )
 	{
-		const int iMinus = (i > 0) ? (i-1) : 0;
-		const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
-		for ( int j = 0; j < inHeight; ++j )
+		const int jMinus = (j > 0) ? (j-1) : 0;
+		const int jPlus = (j < inHeight - 1 ) ? (j+1) : j;
+		for ( int i = 0; i < inWidth; ++i )
 		{
-			const int jMinus = (j > 0) ? (j-1) : 0;
-			const int jPlus = (j < inHeight - 1 ) ? (j+1) : j;
+			const int iMinus = (i > 0) ? (i-1) : 0;
+			const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
 			const uint32_t A = inputBuffer[ iMinus +inWidth*jMinus];
 			const uint32_t B = inputBuffer[ iMinus +inWidth*j    ];
 			const uint32_t C = inputBuffer[ iMinus +inWidth*jPlus];
@@ -173,16 +205,30 @@ static void scale3x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth
 	}
 }
 
+static void scale2xSlices ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
+{
+	RunSlices(inWidth, inHeight, [=](int yFirst, int yLast)
+	{
+		scale2x(inputBuffer, outputBuffer, inWidth, inHeight, yFirst, yLast);
+	});
+}
+
+static void scale3xSlices ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
+{
+	RunSlices(inWidth, inHeight, [=](int yFirst, int yLast)
+	{
+		scale3x(inputBuffer, outputBuffer, inWidth, inHeight, yFirst, yLast);
+	});
+}
+
 static void scale4x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth, int inHeight )
 {
 	int width = 2* inWidth;
 	int height = 2 * inHeight;
 	uint32_t * buffer2x = new uint32_t[width*height];
 
-	scale2x ( reinterpret_cast<uint32_t*> ( inputBuffer ), reinterpret_cast<uint32_t*> ( buffer2x ), inWidth, inHeight );
-	width *= 2;
-	height *= 2;
-	scale2x ( reinterpret_cast<uint32_t*> ( buffer2x ), reinterpret_cast<uint32_t*> ( outputBuffer ), 2*inWidth, 2*inHeight );
+	scale2xSlices ( reinterpret_cast<uint32_t*> ( inputBuffer ), reinterpret_cast<uint32_t*> ( buffer2x ), inWidth, inHeight );
+	scale2xSlices ( reinterpret_cast<uint32_t*> ( buffer2x ), reinterpret_cast<uint32_t*> ( outputBuffer ), 2*inWidth, 2*inHeight );
 	delete[] buffer2x;
 }
 
@@ -235,7 +281,7 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 }
 #endif
 
-static unsigned char *hqNxHelper( void (*hqNxFunction) ( unsigned*, unsigned*, int, int ),
+static unsigned char *hqNxHelper( void (*hqNxFunction) ( uint32_t*, uint32_t*, int, int, int, int ),
 							  const int N,
 							  unsigned char *inputBuffer,
 							  const int inWidth,
@@ -254,7 +300,10 @@ static unsigned char *hqNxHelper( void (*hqNxFunction) ( unsigned*, unsigned*, i
 	outHeight = N *inHeight;
 
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
-	hqNxFunction( reinterpret_cast<unsigned*>(inputBuffer), reinterpret_cast<unsigned*>(newBuffer), inWidth, inHeight );
+	RunSlices(inWidth, inHeight, [=](int yFirst, int yLast)
+	{
+		hqNxFunction( reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer), inWidth, inHeight, yFirst, yLast );
+	});
 	delete[] inputBuffer;
 	return newBuffer;
 }
@@ -273,25 +322,12 @@ static unsigned char *xbrzHelper( void (*xbrzFunction) ( size_t, const uint32_t*
 	outHeight = N *inHeight;
 
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
-	
-	const int thresholdWidth  = gl_texture_hqresize_mt_width;
-	const int thresholdHeight = gl_texture_hqresize_mt_height;
-	
-	if (gl_texture_hqresize_multithread
-		&& inWidth  > thresholdWidth
-		&& inHeight > thresholdHeight)
-	{
-		parallel_for(inHeight, thresholdHeight, [=](int sliceY)
-		{
-			xbrzFunction(N, reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer),
-				inWidth, inHeight, xbrz::ARGB, xbrz::ScalerCfg(), sliceY, sliceY + thresholdHeight);
-		});
-	}
-	else
+
+	RunSlices(inWidth, inHeight, [=](int yFirst, int yLast)
 	{
 		xbrzFunction(N, reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer),
-			inWidth, inHeight, xbrz::ARGB, xbrz::ScalerCfg(), 0, std::numeric_limits<int>::max());
-	}
+			inWidth, inHeight, xbrz::ARGB, xbrz::ScalerCfg(), yFirst, yLast);
+	});
 
 	delete[] inputBuffer;
 	return newBuffer;
@@ -304,12 +340,57 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+//
+// Runs the selected upscaler. Deletes the input buffer if it returns a new one.
+//
+//===========================================================================
+
+static unsigned char *UpscaleBuffer(int type, unsigned char *inputBuffer, const int inWidth, const int inHeight, int &outWidth, int &outHeight)
+{
+	switch (type)
+	{
+	case 1:
+		return scaleNxHelper( &scale2xSlices, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 2:
+		return scaleNxHelper( &scale3xSlices, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 3:
+		return scaleNxHelper( &scale4x, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 4:
+		return hqNxHelper( &hq2x_32_slice, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 5:
+		return hqNxHelper( &hq3x_32_slice, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 6:
+		return hqNxHelper( &hq4x_32_slice, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+#ifdef HAVE_MMX
+	case 7:
+		return hqNxAsmHelper( &HQnX_asm::hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 8:
+		return hqNxAsmHelper( &HQnX_asm::hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 9:
+		return hqNxAsmHelper( &HQnX_asm::hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+#endif
+	case 10:
+	case 11:
+	case 12:
+		return xbrzHelper(xbrz::scale, type - 8, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+		
+	case 13:
+	case 14:
+	case 15:
+		return xbrzHelper(xbrzOldScale, type - 11, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+		
+	}
+	return inputBuffer;
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in inputBuffer, frees inputBuffer and returns
 //  the upsampled buffer.
 //
 //===========================================================================
+
 unsigned char *FTexture::CreateUpsampledTextureBuffer (unsigned char *inputBuffer, const int inWidth, const int inHeight, int &outWidth, int &outHeight, bool hasAlpha )
 {
 	// [BB] Make sure that outWidth and outHeight denote the size of
@@ -358,39 +439,106 @@ unsigned char *FTexture::CreateUpsampledTextureBuffer (unsigned char *inputBuffe
 		}
 #endif
 
-		switch (type)
+		// Identical input gives identical output, so the result can be looked up by the input's hash
+		if (type > 0 && FTextureDiskCache::IsEnabled())
 		{
-		case 1:
-			return scaleNxHelper( &scale2x, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 2:
-			return scaleNxHelper( &scale3x, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 3:
-			return scaleNxHelper( &scale4x, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 4:
-			return hqNxHelper( &hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 5:
-			return hqNxHelper( &hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 6:
-			return hqNxHelper( &hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-#ifdef HAVE_MMX
-		case 7:
-			return hqNxAsmHelper( &HQnX_asm::hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 8:
-			return hqNxAsmHelper( &HQnX_asm::hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 9:
-			return hqNxAsmHelper( &HQnX_asm::hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-#endif
-		case 10:
-		case 11:
-		case 12:
-			return xbrzHelper(xbrz::scale, type - 8, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-			
-		case 13:
-		case 14:
-		case 15:
-			return xbrzHelper(xbrzOldScale, type - 11, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-			
+			FTextureCacheKey key = FTextureDiskCache::MakeKey(inputBuffer, inWidth * inHeight * 4, TCK_Upscaled, type, inWidth, inHeight);
+			unsigned char *cached = nullptr;
+			FTextureDiskCache::Instance()->Read(key, [&](const uint8_t *pixels, int width, int height, int info)
+			{
+				cached = new unsigned char[width * height * 4];
+				memcpy(cached, pixels, width * height * 4);
+				outWidth = width;
+				outHeight = height;
+			});
+			if (cached != nullptr)
+			{
+				delete[] inputBuffer;
+				return cached;
+			}
+
+			unsigned char *result = UpscaleBuffer(type, inputBuffer, inWidth, inHeight, outWidth, outHeight);
+			if (result != inputBuffer)
+			{
+				FTextureDiskCache::Instance()->Write(key, result, outWidth, outHeight, 0);
+			}
+			return result;
 		}
+		return UpscaleBuffer(type, inputBuffer, inWidth, inHeight, outWidth, outHeight);
 	}
 	return inputBuffer;
 }
+
+//===========================================================================
+//
+// Upscales a set of the loaded textures with every scaler
+//
+// hqresizebench [number of textures]
+//
+//===========================================================================
+
+CCMD(hqresizebench)
+{
+	struct Image
+	{
+		std::vector<unsigned char> Pixels;
+		int Width, Height;
+	};
+
+	int maxcount = argv.argc() > 1 ? atoi(argv[1]) : 200;
+	std::vector<Image> corpus;
+	size_t inputPixels = 0;
+
+	for (int i = 0; i < TexMan.NumTextures() && (int)corpus.size() < maxcount; i++)
+	{
+		FTexture *tex = TexMan.ByIndex(i);
+		if (tex == nullptr || tex->bHasCanvas)
+			continue;
+		if (tex->UseType != ETextureType::Wall && tex->UseType != ETextureType::Flat && tex->UseType != ETextureType::Sprite && tex->UseType != ETextureType::Override)
+			continue;
+		if (tex->GetWidth() <= 0 || tex->GetHeight() <= 0 || tex->GetWidth() > gl_texture_hqresize_maxinputsize || tex->GetHeight() > gl_texture_hqresize_maxinputsize)
+			continue;
+
+		int w, h;
+		unsigned char *buffer = tex->CreateTexBuffer(0, w, h);
+		if (buffer == nullptr)
+			continue;
+		corpus.push_back({ std::vector<unsigned char>(buffer, buffer + w * h * 4), w, h });
+		inputPixels += w * h;
+		delete[] buffer;
+	}
+
+	if (corpus.empty())
+	{
+		Printf("No textures to upscale\n");
+		return;
+	}
+	Printf("%d textures, %.2f Mpixels\n", (int)corpus.size(), inputPixels / 1000000.0);
+
+	static const char *names[] = { "", "Scale2x", "Scale3x", "Scale4x", "hq2x", "hq3x", "hq4x", "hq2x MMX", "hq3x MMX", "hq4x MMX", "xBRZ 2x", "xBRZ 3x", "xBRZ 4x", "xBRZ old 2x", "xBRZ old 3x", "xBRZ old 4x" };
+	for (int type = 1; type <= 15; type++)
+	{
+#ifndef HAVE_MMX
+		if (type >= 7 && type <= 9)
+			continue;
+#endif
+		cycle_t timer;
+		timer.Reset();
+		size_t outputPixels = 0;
+		for (auto &image : corpus)
+		{
+			unsigned char *input = new unsigned char[image.Pixels.size()];
+			memcpy(input, image.Pixels.data(), image.Pixels.size());
+
+			int outWidth, outHeight;
+			timer.Clock();
+			unsigned char *output = UpscaleBuffer(type, input, image.Width, image.Height, outWidth, outHeight);
+			timer.Unclock();
+
+			outputPixels += outWidth * outHeight;
+			delete[] output;
+		}
+		double seconds = MAX(timer.TimeMS() / 1000.0, 0.000001);
+		Printf("%-12s %8.2f ms  %8.2f Mpixels/s in  %8.2f Mpixels/s out\n", names[type], timer.TimeMS(), inputPixels / seconds / 1000000.0, outputPixels / seconds / 1000000.0);
+	}
+}
@@ -46,6 +46,9 @@
 #include "v_video.h"
 #include "m_fixed.h"
 #include "textures/warpbuffer.h"
+#include "textures/bgramipcache.h"
+#include "textures/texturedecoder.h"
+#include "textures/texturediskcache.h"
 #include "hwrenderer/textures/hw_material.h"
 #include "hwrenderer/textures/hw_ihwtexture.h"
 
@@ -213,6 +216,8 @@ FTexture::FTexture (const char *name, int lumpnum)
 
 FTexture::~FTexture ()
 {
+	if (BgraMipEntry != nullptr) FBgraMipCache::Instance()->Remove(this);
+	FTextureDecoder::Cancel(this);
 	FTexture *link = Wads.GetLinkedTexture(SourceLump);
 	if (link == this) Wads.SetLinkedTexture(SourceLump, nullptr);
 	if (areas != nullptr) delete[] areas;
@@ -231,6 +236,7 @@ FTexture::~FTexture ()
 
 void FTexture::Unload()
 {
+	if (BgraMipEntry != nullptr) FBgraMipCache::Instance()->Remove(this);
 	PixelsBgra = std::vector<uint32_t>();
 }
 
@@ -254,7 +260,8 @@ const uint32_t *FTexture::GetColumnBgra(unsigned int column, const Span **spans_
 
 const uint32_t *FTexture::GetPixelsBgra()
 {
-	if (PixelsBgra.empty() || CheckModified(DefaultRenderStyle()))
+	bool released = PixelsBgra.empty();
+	if (released || CheckModified(DefaultRenderStyle()))
 	{
 		if (!GetColumn(DefaultRenderStyle(), 0, nullptr))
 			return nullptr;
@@ -262,8 +269,9 @@ const uint32_t *FTexture::GetPixelsBgra()
 		FBitmap bitmap;
 		bitmap.Create(GetWidth(), GetHeight());
 		CopyTrueColorPixels(&bitmap, 0, 0);
-		GenerateBgraFromBitmap(bitmap);
+		GenerateBgraFromBitmap(bitmap, released);
 	}
+	if (BgraMipEntry != nullptr) FBgraMipCache::Touch(BgraMipEntry);
 	return PixelsBgra.data();
 }
 
@@ -432,7 +440,7 @@ void FTexture::FreeSpans (Span **spans) const
 //
 //==========================================================================
 
-void FTexture::GenerateBgraFromBitmap(const FBitmap &bitmap)
+void FTexture::GenerateBgraFromBitmap(const FBitmap &bitmap, bool reload)
 {
 	CreatePixelsBgraWithMipmaps();
 
@@ -447,7 +455,7 @@ void FTexture::GenerateBgraFromBitmap(const FBitmap &bitmap)
 		}
 	}
 
-	GenerateBgraMipmaps();
+	FBgraMipCache::Instance()->GenerateMipmaps(this, reload);
 }
 
 void FTexture::CreatePixelsBgraWithMipmaps()
@@ -482,123 +490,7 @@ int FTexture::MipmapLevels() const
 
 void FTexture::GenerateBgraMipmaps()
 {
-	struct Color4f
-	{
-		float a, r, g, b;
-		Color4f operator*(const Color4f &v) const { return Color4f{ a * v.a, r * v.r, g * v.g, b * v.b }; }
-		Color4f operator/(const Color4f &v) const { return Color4f{ a / v.a, r / v.r, g / v.g, b / v.b }; }
-		Color4f operator+(const Color4f &v) const { return Color4f{ a + v.a, r + v.r, g + v.g, b + v.b }; }
-		Color4f operator-(const Color4f &v) const { return Color4f{ a - v.a, r - v.r, g - v.g, b - v.b }; }
-		Color4f operator*(float s) const { return Color4f{ a * s, r * s, g * s, b * s }; }
-		Color4f operator/(float s) const { return Color4f{ a / s, r / s, g / s, b / s }; }
-		Color4f operator+(float s) const { return Color4f{ a + s, r + s, g + s, b + s }; }
-		Color4f operator-(float s) const { return Color4f{ a - s, r - s, g - s, b - s }; }
-	};
-
-	int levels = MipmapLevels();
-	std::vector<Color4f> image(PixelsBgra.size());
-
-	// Convert to normalized linear colorspace
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			for (int y = 0; y < Height; y++)
-			{
-				uint32_t c8 = PixelsBgra[x * Height + y];
-				Color4f c;
-				c.a = powf(APART(c8) * (1.0f / 255.0f), 2.2f);
-				c.r = powf(RPART(c8) * (1.0f / 255.0f), 2.2f);
-				c.g = powf(GPART(c8) * (1.0f / 255.0f), 2.2f);
-				c.b = powf(BPART(c8) * (1.0f / 255.0f), 2.2f);
-				image[x * Height + y] = c;
-			}
-		}
-	}
-
-	// Generate mipmaps
-	{
-		std::vector<Color4f> smoothed(Width * Height);
-		Color4f *src = image.data();
-		Color4f *dest = src + Width * Height;
-		for (int i = 1; i < levels; i++)
-		{
-			int srcw = MAX(Width >> (i - 1), 1);
-			int srch = MAX(Height >> (i - 1), 1);
-			int w = MAX(Width >> i, 1);
-			int h = MAX(Height >> i, 1);
-
-			// Downscale
-			for (int x = 0; x < w; x++)
-			{
-				int sx0 = x * 2;
-				int sx1 = MIN((x + 1) * 2, srcw - 1);
-				for (int y = 0; y < h; y++)
-				{
-					int sy0 = y * 2;
-					int sy1 = MIN((y + 1) * 2, srch - 1);
-
-					Color4f src00 = src[sy0 + sx0 * srch];
-					Color4f src01 = src[sy1 + sx0 * srch];
-					Color4f src10 = src[sy0 + sx1 * srch];
-					Color4f src11 = src[sy1 + sx1 * srch];
-					Color4f c = (src00 + src01 + src10 + src11) * 0.25f;
-
-					dest[y + x * h] = c;
-				}
-			}
-
-			// Sharpen filter with a 3x3 kernel:
-			for (int x = 0; x < w; x++)
-			{
-				for (int y = 0; y < h; y++)
-				{
-					Color4f c = { 0.0f, 0.0f, 0.0f, 0.0f };
-					for (int kx = -1; kx < 2; kx++)
-					{
-						for (int ky = -1; ky < 2; ky++)
-						{
-							int a = y + ky;
-							int b = x + kx;
-							if (a < 0) a = h - 1;
-							if (a == h) a = 0;
-							if (b < 0) b = w - 1;
-							if (b == w) b = 0;
-							c = c + dest[a + b * h];
-						}
-					}
-					c = c * (1.0f / 9.0f);
-					smoothed[y + x * h] = c;
-				}
-			}
-			float k = 0.08f;
-			for (int j = 0; j < w * h; j++)
-				dest[j] = dest[j] + (dest[j] - smoothed[j]) * k;
-
-			src = dest;
-			dest += w * h;
-		}
-	}
-
-	// Convert to bgra8 sRGB colorspace
-	{
-		Color4f *src = image.data() + Width * Height;
-		uint32_t *dest = PixelsBgra.data() + Width * Height;
-		for (int i = 1; i < levels; i++)
-		{
-			int w = MAX(Width >> i, 1);
-			int h = MAX(Height >> i, 1);
-			for (int j = 0; j < w * h; j++)
-			{
-				uint32_t a = (uint32_t)clamp(powf(MAX(src[j].a, 0.0f), 1.0f / 2.2f) * 255.0f + 0.5f, 0.0f, 255.0f);
-				uint32_t r = (uint32_t)clamp(powf(MAX(src[j].r, 0.0f), 1.0f / 2.2f) * 255.0f + 0.5f, 0.0f, 255.0f);
-				uint32_t g = (uint32_t)clamp(powf(MAX(src[j].g, 0.0f), 1.0f / 2.2f) * 255.0f + 0.5f, 0.0f, 255.0f);
-				uint32_t b = (uint32_t)clamp(powf(MAX(src[j].b, 0.0f), 1.0f / 2.2f) * 255.0f + 0.5f, 0.0f, 255.0f);
-				dest[j] = (a << 24) | (r << 16) | (g << 8) | b;
-			}
-			src += w * h;
-			dest += w * h;
-		}
-	}
+	FBgraMipCache::FilterMipmaps(PixelsBgra.data(), Width, Height, MipmapLevels());
 }
 
 //==========================================================================
@@ -1358,6 +1250,22 @@ bool FTexture::ProcessData(unsigned char * buffer, int w, int h, bool ispatch)
 	return true;
 }
 
+//===========================================================================
+//
+// For textures that implement DecodeAsync. A decoded image is BGRA, so
+// copies that remap the palette need the original lump.
+//
+//===========================================================================
+
+bool FTexture::CopyDecodedPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal)
+{
+	if (inf != nullptr && inf->palette != nullptr)
+		return false;
+
+	return FTextureDecoder::Take(this, bmp, x, y, rotate, inf, transpal) ||
+		FTextureDiskCache::ReadImage(this, bmp, x, y, rotate, inf, transpal);
+}
+
 //===========================================================================
 // 
 //	Initializes the buffer for the texture data
@@ -0,0 +1,340 @@
+/*
+** texturedecoder.cpp
+**
+** Background decoding of image lumps
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include "texturedecoder.h"
+#include "texturediskcache.h"
+#include "textures.h"
+#include "files.h"
+#include "w_wad.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "stats.h"
+
+// Number of worker threads. 0 = one less than the number of cores.
+CVAR(Int, texture_decode_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Limit for the size of all bitmaps that are queued or waiting to be taken
+static const size_t MaxPendingBytes = 512 << 20;
+
+int FTextureDecoder::Queued;
+int FTextureDecoder::Taken;
+int FTextureDecoder::Dropped;
+int FTextureDecoder::Failed;
+std::atomic<int> FTextureDecoder::ActiveJobs;
+
+ADD_STAT(texturedecoder)
+{
+	FString out;
+	out.Format("queued=%d  taken=%d  dropped=%d  failed=%d  pending=%d", FTextureDecoder::Queued, FTextureDecoder::Taken, FTextureDecoder::Dropped, FTextureDecoder::Failed, 
+		FTextureDecoder::Queued - FTextureDecoder::Taken - FTextureDecoder::Dropped - FTextureDecoder::Failed);
+	return out;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FTextureDecoder *FTextureDecoder::Instance()
+{
+	static FTextureDecoder decoder;
+	return &decoder;
+}
+
+FTextureDecoder::~FTextureDecoder()
+{
+	StopWorkers();
+
+	// Textures can outlive the decoder during shutdown
+	ActiveJobs = 0;
+	mJobs.clear();
+	mQueue.clear();
+}
+
+//==========================================================================
+//
+// Reads the image lump and hands it to the workers
+//
+//==========================================================================
+
+bool FTextureDecoder::Queue(FTexture *tex)
+{
+	if (tex == nullptr || !tex->CanDecodeAsync())
+		return false;
+
+	int lump = tex->GetSourceLump();
+	if (lump < 0)
+		return false;
+
+	size_t size = (size_t)tex->GetWidth() * tex->GetHeight() * 4;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (mJobs.find(tex) != mJobs.end())
+		return true;
+	if (mPendingBytes + size > MaxPendingBytes)
+		return false;
+	lock.unlock();
+
+	JobHandle job = std::make_shared<Job>();
+	job->Texture = tex;
+	job->Size = size;
+	job->Data.resize(Wads.LumpLength(lump));
+	Wads.ReadLump(lump, job->Data.data());
+
+	lock.lock();
+	if (mJobs.find(tex) != mJobs.end())
+		return true;
+	if (mPendingBytes + size > MaxPendingBytes)
+		return false;
+	mJobs[tex] = job;
+	mPendingBytes += size;
+	ActiveJobs++;
+	Queued++;
+	mQueue.push_back(job);
+	StartWorkers();
+	lock.unlock();
+	mWorkCondition.notify_one();
+	return true;
+}
+
+//==========================================================================
+//
+// Copies the decoded image of a queued texture into the bitmap.
+// Returns false if the caller has to decode the image itself.
+//
+//==========================================================================
+
+bool FTextureDecoder::Take(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal)
+{
+	if (ActiveJobs.load(std::memory_order_relaxed) == 0)
+		return false;
+	return Instance()->TakeJob(tex, bmp, x, y, rotate, inf, transpal);
+}
+
+bool FTextureDecoder::TakeJob(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mJobs.find(tex);
+	if (it == mJobs.end())
+		return false;
+
+	JobHandle job = it->second;
+	Release(job);
+
+	if (job->State == Job::Waiting)
+	{
+		// Don't wait for the rest of the queue
+		job->State = Job::Running;
+		lock.unlock();
+		RunJob(job.get());
+		lock.lock();
+		job->State = Job::Done;
+		mDoneCondition.notify_all();
+	}
+	else
+	{
+		mDoneCondition.wait(lock, [&]() { return job->State == Job::Done; });
+	}
+	lock.unlock();
+
+	if (!job->Succeeded)
+	{
+		// Let the texture report the error
+		Failed++;
+		return false;
+	}
+
+	Taken++;
+	bmp->CopyPixelDataRGB(x, y, job->Bitmap.GetPixels(), job->Bitmap.GetWidth(), job->Bitmap.GetHeight(), 4, job->Bitmap.GetPitch(), rotate, CF_BGRA, inf);
+	transpal = job->Transpal;
+	return true;
+}
+
+//==========================================================================
+//
+// Called when a texture is destroyed
+//
+//==========================================================================
+
+void FTextureDecoder::Cancel(FTexture *tex)
+{
+	if (ActiveJobs.load(std::memory_order_relaxed) == 0)
+		return;
+	Instance()->CancelJob(tex);
+}
+
+void FTextureDecoder::CancelJob(FTexture *tex)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	auto it = mJobs.find(tex);
+	if (it == mJobs.end())
+		return;
+
+	JobHandle job = it->second;
+	Release(job);
+	if (job->State == Job::Waiting)
+		job->State = Job::Cancelled;
+	else
+		mDoneCondition.wait(lock, [&]() { return job->State == Job::Done; });	// the worker still uses the texture
+	Dropped++;
+}
+
+void FTextureDecoder::Flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	std::vector<JobHandle> running;
+	for (auto &it : mJobs)
+	{
+		auto &job = it.second;
+		if (job->State == Job::Waiting)
+			job->State = Job::Cancelled;
+		else if (job->State == Job::Running)
+			running.push_back(job);
+		Dropped++;
+	}
+	ActiveJobs -= (int)mJobs.size();
+	mJobs.clear();
+	mPendingBytes = 0;
+
+	// Once the texture is out of the map Cancel can't wait for the worker anymore
+	mDoneCondition.wait(lock, [&]()
+	{
+		for (auto &job : running)
+			if (job->State != Job::Done) return false;
+		return true;
+	});
+}
+
+// Removes a job from the texture map. The caller must hold the lock.
+void FTextureDecoder::Release(const JobHandle &job)
+{
+	mJobs.erase(job->Texture);
+	mPendingBytes -= job->Size;
+	ActiveJobs--;
+}
+
+//==========================================================================
+//
+// Decodes the image. Only touches the job and the texture's header data.
+//
+//==========================================================================
+
+void FTextureDecoder::RunJob(Job *job)
+{
+	try
+	{
+		if (FTextureDiskCache::IsEnabled())
+		{
+			job->Succeeded = FTextureDiskCache::Instance()->DecodeImage(job->Texture, job->Data.data(), job->Data.size(), &job->Bitmap, job->Transpal);
+		}
+		else
+		{
+			FileReader reader;
+			reader.OpenMemory(job->Data.data(), job->Data.size());
+			job->Bitmap.Create(job->Texture->GetWidth(), job->Texture->GetHeight());
+			job->Succeeded = job->Texture->DecodeAsync(reader, &job->Bitmap, job->Transpal);
+		}
+	}
+	catch (...)
+	{
+		job->Succeeded = false;
+	}
+	std::vector<uint8_t>().swap(job->Data);
+	if (!job->Succeeded)
+		job->Bitmap.Destroy();
+}
+
+//==========================================================================
+//
+// Worker threads
+//
+//==========================================================================
+
+void FTextureDecoder::StartWorkers()
+{
+	if (!mWorkers.empty())
+		return;
+
+	int count = texture_decode_threads;
+	if (count <= 0)
+		count = (int)std::thread::hardware_concurrency() - 1;
+	count = clamp(count, 1, 8);
+
+	mStopWorkers = false;
+	for (int i = 0; i < count; i++)
+		mWorkers.push_back(std::thread([=]() { WorkerMain(); }));
+}
+
+void FTextureDecoder::StopWorkers()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStopWorkers = true;
+	lock.unlock();
+	mWorkCondition.notify_all();
+
+	for (auto &worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+void FTextureDecoder::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWorkCondition.wait(lock, [&]() { return mStopWorkers || !mQueue.empty(); });
+		if (mStopWorkers)
+			break;
+
+		JobHandle job = mQueue.front();
+		mQueue.pop_front();
+		if (job->State != Job::Waiting)
+			continue;
+
+		job->State = Job::Running;
+		lock.unlock();
+
+		RunJob(job.get());
+
+		lock.lock();
+		job->State = Job::Done;
+		mDoneCondition.notify_all();
+	}
+}
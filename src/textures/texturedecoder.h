@@ -0,0 +1,127 @@
+/*
+** texturedecoder.h
+**
+** Background decoding of image lumps
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __TEXTUREDECODER_H
+#define __TEXTUREDECODER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include "bitmap.h"
+
+class FTexture;
+
+//==========================================================================
+//
+// Decodes PNG and JPEG textures on a pool of worker threads.
+//
+// Queue reads the image lump on the calling thread, since lump readers
+// are not thread safe, and lets a worker decode it into a BGRA bitmap.
+// The next CopyTrueColorPixels call for the texture copies the bitmap
+// instead of decoding the lump again.
+//
+//==========================================================================
+
+class FTextureDecoder
+{
+public:
+	static FTextureDecoder *Instance();
+	~FTextureDecoder();
+
+	// Returns false if the texture can't be decoded in the background or too much data is pending
+	bool Queue(FTexture *tex);
+
+	// Drops all results nobody asked for
+	void Flush();
+
+	// Called by the textures. Both are cheap if nothing is pending.
+	static bool Take(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal);
+	static void Cancel(FTexture *tex);
+
+	static int Queued;
+	static int Taken;
+	static int Dropped;
+	static int Failed;
+
+private:
+	struct Job
+	{
+		enum
+		{
+			Waiting,
+			Running,
+			Done,
+			Cancelled
+		};
+
+		FTexture *Texture = nullptr;
+		std::vector<uint8_t> Data;
+		FBitmap Bitmap;
+		int Transpal = 0;
+		size_t Size = 0;
+		std::atomic<int> State { Waiting };
+		bool Succeeded = false;
+	};
+
+	typedef std::shared_ptr<Job> JobHandle;
+
+	bool TakeJob(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal);
+	void CancelJob(FTexture *tex);
+	void Release(const JobHandle &job);
+	void RunJob(Job *job);
+	void StartWorkers();
+	void StopWorkers();
+	void WorkerMain();
+
+	std::unordered_map<FTexture *, JobHandle> mJobs;
+	std::deque<JobHandle> mQueue;
+	size_t mPendingBytes = 0;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkCondition;
+	std::condition_variable mDoneCondition;
+	std::vector<std::thread> mWorkers;
+	bool mStopWorkers = false;
+
+	// Number of registered jobs. Lets Take and Cancel skip the lock.
+	static std::atomic<int> ActiveJobs;
+};
+
+#endif
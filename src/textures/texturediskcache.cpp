@@ -0,0 +1,498 @@
+/*
+** texturediskcache.cpp
+**
+** Persistent cache for decoded and upscaled textures
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <sys/utime.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include "texturediskcache.h"
+#include "textures.h"
+#include "bitmap.h"
+#include "files.h"
+#include "w_wad.h"
+#include "md5.h"
+#include "templates.h"
+#include "m_misc.h"
+#include "cmdlib.h"
+#include "i_system.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+
+CVAR(Bool, r_texturecache, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Size limit of the cache directory in megabytes
+CVAR(Int, r_texturecache_size, 512, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Change this whenever the decoders or upscalers produce different output.
+static const uint32_t CacheVersion = 1;
+
+struct FTextureCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	int32_t Width;
+	int32_t Height;
+	int32_t Info;
+	uint32_t Reserved;
+};
+
+static const uint32_t CacheMagic = MAKE_ID('G','Z','T','C');
+
+int FTextureDiskCache::Hits;
+int FTextureDiskCache::Misses;
+
+ADD_STAT(texturecache)
+{
+	FString out;
+	out.Format("hits=%d  misses=%d", FTextureDiskCache::Hits, FTextureDiskCache::Misses);
+	return out;
+}
+
+CCMD(cleartexturecache)
+{
+	FTextureDiskCache::Instance()->Clear();
+}
+
+//==========================================================================
+//
+// Read only memory mapping of a cache file
+//
+//==========================================================================
+
+class FMappedFile
+{
+public:
+	~FMappedFile() { Close(); }
+
+	bool Open(const char *filename);
+	void Close();
+
+	const uint8_t *GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+private:
+	const uint8_t *Data = nullptr;
+	size_t Size = 0;
+#ifdef _WIN32
+	HANDLE File = INVALID_HANDLE_VALUE;
+	HANDLE Mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+
+bool FMappedFile::Open(const char *filename)
+{
+	File = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(File, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (Mapping != nullptr)
+		Data = (const uint8_t *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (Data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	Size = (size_t)size.QuadPart;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (Data != nullptr) UnmapViewOfFile(Data);
+	if (Mapping != nullptr) CloseHandle(Mapping);
+	if (File != INVALID_HANDLE_VALUE) CloseHandle(File);
+	Data = nullptr;
+	Mapping = nullptr;
+	File = INVALID_HANDLE_VALUE;
+	Size = 0;
+}
+
+#else
+
+bool FMappedFile::Open(const char *filename)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *mem = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED)
+		return false;
+
+	Data = (const uint8_t *)mem;
+	Size = info.st_size;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (Data != nullptr) munmap((void *)Data, Size);
+	Data = nullptr;
+	Size = 0;
+}
+
+#endif
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+std::string FTextureCacheKey::ToString() const
+{
+	static const char hex[] = "0123456789abcdef";
+	std::string name;
+	name.reserve(32);
+	for (int i = 0; i < 16; i++)
+	{
+		name += hex[Hash[i] >> 4];
+		name += hex[Hash[i] & 15];
+	}
+	return name;
+}
+
+FTextureCacheKey FTextureDiskCache::MakeKey(const void *data, size_t size, ETextureCacheKind kind, int param, int width, int height)
+{
+	int32_t header[5] = { (int32_t)CacheVersion, kind, param, width, height };
+
+	MD5Context md5;
+	md5.Update((const uint8_t *)header, sizeof(header));
+	md5.Update((const uint8_t *)data, (unsigned)size);
+
+	FTextureCacheKey key;
+	md5.Final(key.Hash);
+	return key;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FTextureDiskCache *FTextureDiskCache::Instance()
+{
+	static FTextureDiskCache cache;
+	return &cache;
+}
+
+FTextureDiskCache::FTextureDiskCache()
+{
+}
+
+bool FTextureDiskCache::IsEnabled()
+{
+	return r_texturecache;
+}
+
+FString FTextureDiskCache::GetFileName(const std::string &name) const
+{
+	FString filename = mPath;
+	filename << name.c_str() << ".tex";
+	return filename;
+}
+
+//==========================================================================
+//
+// Builds the index from the files left by previous sessions. The file
+// modification time stands in for the last use.
+//
+//==========================================================================
+
+void FTextureDiskCache::Scan()
+{
+	if (mScanned)
+		return;
+	mScanned = true;
+
+	mPath = M_GetCachePath(true);
+	mPath << "/textures/";
+	CreatePath(mPath);
+
+	struct FoundFile
+	{
+		std::string Name;
+		size_t Size;
+		time_t Time;
+	};
+	std::vector<FoundFile> files;
+
+	findstate_t findstate;
+	FString spec = mPath + "*.tex";
+	void *handle = I_FindFirst(spec, &findstate);
+	if (handle != (void *)-1)
+	{
+		do
+		{
+			if (I_FindAttr(&findstate) & FA_DIREC)
+				continue;
+
+			const char *filename = I_FindName(&findstate);
+			FString fullname = mPath + filename;
+			struct stat info;
+			if (stat(fullname, &info) == 0 && strlen(filename) == 36)
+			{
+				files.push_back({ std::string(filename, 32), (size_t)info.st_size, info.st_mtime });
+			}
+		} while (I_FindNext(handle, &findstate) == 0);
+		I_FindClose(handle);
+	}
+
+	std::sort(files.begin(), files.end(), [](const FoundFile &a, const FoundFile &b) { return a.Time < b.Time; });
+	for (auto &file : files)
+	{
+		Entry &entry = mEntries[file.Name];
+		entry.Size = file.Size;
+		entry.LastUse = ++mUseCounter;
+		mTotalSize += file.Size;
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FTextureDiskCache::Read(const FTextureCacheKey &key, const std::function<void(const uint8_t *pixels, int width, int height, int info)> &callback)
+{
+	std::string name = key.ToString();
+	FString filename;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		Scan();
+		auto it = mEntries.find(name);
+		if (it == mEntries.end())
+		{
+			Misses++;
+			return false;
+		}
+		it->second.LastUse = ++mUseCounter;
+		filename = GetFileName(name);
+	}
+
+	FMappedFile file;
+	bool valid = false;
+	if (file.Open(filename) && file.GetSize() >= sizeof(FTextureCacheHeader))
+	{
+		const FTextureCacheHeader *header = (const FTextureCacheHeader *)file.GetData();
+		valid = header->Magic == CacheMagic && header->Version == CacheVersion && header->Width > 0 && header->Height > 0 &&
+			file.GetSize() == sizeof(FTextureCacheHeader) + (size_t)header->Width * header->Height * 4;
+		if (valid)
+		{
+			callback(file.GetData() + sizeof(FTextureCacheHeader), header->Width, header->Height, header->Info);
+		}
+	}
+	file.Close();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!valid)
+	{
+		// Truncated or written by an older version
+		auto it = mEntries.find(name);
+		if (it != mEntries.end())
+		{
+			mTotalSize -= it->second.Size;
+			mEntries.erase(it);
+		}
+		remove(filename);
+		Misses++;
+		return false;
+	}
+
+	// Keep the eviction order across sessions
+	utime(filename, nullptr);
+	Hits++;
+	return true;
+}
+
+void FTextureDiskCache::Write(const FTextureCacheKey &key, const uint8_t *pixels, int width, int height, int info)
+{
+	std::string name = key.ToString();
+	FString filename, tempname;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		Scan();
+		if (mEntries.find(name) != mEntries.end())
+			return;
+		filename = GetFileName(name);
+		tempname.Format("%s.%llu.tmp", filename.GetChars(), (unsigned long long)++mUseCounter);
+	}
+
+	FTextureCacheHeader header = { CacheMagic, CacheVersion, width, height, info, 0 };
+	size_t datasize = (size_t)width * height * 4;
+
+	// Write to a temporary file first so that other threads and later sessions never see a partial entry
+	FileWriter *fw = FileWriter::Open(tempname);
+	if (fw == nullptr)
+		return;
+	bool written = fw->Write(&header, sizeof(header)) == sizeof(header) && fw->Write(pixels, datasize) == datasize;
+	delete fw;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	if (!written || mEntries.find(name) != mEntries.end() || rename(tempname, filename) != 0)
+	{
+		remove(tempname);
+		return;
+	}
+
+	Entry &entry = mEntries[name];
+	entry.Size = sizeof(header) + datasize;
+	entry.LastUse = ++mUseCounter;
+	mTotalSize += entry.Size;
+	Evict();
+}
+
+//==========================================================================
+//
+// Deletes the least recently used entries. The caller must hold the lock.
+//
+//==========================================================================
+
+void FTextureDiskCache::Evict()
+{
+	size_t budget = (size_t)MAX(*r_texturecache_size, 16) << 20;
+	if (mTotalSize <= budget)
+		return;
+
+	std::vector<std::pair<uint64_t, std::string>> order;
+	order.reserve(mEntries.size());
+	for (auto &it : mEntries)
+		order.push_back({ it.second.LastUse, it.first });
+	std::sort(order.begin(), order.end());
+
+	// Free some extra room so that this doesn't run for every new entry
+	size_t target = budget - budget / 8;
+	for (auto &item : order)
+	{
+		if (mTotalSize <= target)
+			break;
+		auto it = mEntries.find(item.second);
+		mTotalSize -= it->second.Size;
+		mEntries.erase(it);
+		remove(GetFileName(item.second));
+	}
+}
+
+void FTextureDiskCache::Clear()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	Scan();
+	for (auto &it : mEntries)
+		remove(GetFileName(it.first));
+	mEntries.clear();
+	mTotalSize = 0;
+}
+
+//==========================================================================
+//
+// Decoded images
+//
+//==========================================================================
+
+bool FTextureDiskCache::DecodeImage(FTexture *tex, const uint8_t *data, size_t size, FBitmap *bmp, int &transpal)
+{
+	FTextureCacheKey key = MakeKey(data, size, TCK_Image, 0, tex->GetWidth(), tex->GetHeight());
+
+	bool found = Read(key, [&](const uint8_t *pixels, int width, int height, int info)
+	{
+		bmp->Create(width, height);
+		memcpy(bmp->GetPixels(), pixels, (size_t)width * height * 4);
+		transpal = info;
+	});
+	if (found)
+		return true;
+
+	FileReader reader;
+	reader.OpenMemory(data, size);
+	bmp->Create(tex->GetWidth(), tex->GetHeight());
+	if (!tex->DecodeAsync(reader, bmp, transpal))
+		return false;
+
+	Write(key, bmp->GetPixels(), bmp->GetWidth(), bmp->GetHeight(), transpal);
+	return true;
+}
+
+bool FTextureDiskCache::ReadImage(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal)
+{
+	if (!IsEnabled() || !tex->CanDecodeAsync())
+		return false;
+
+	int lump = tex->GetSourceLump();
+	if (lump < 0)
+		return false;
+
+	std::vector<uint8_t> data(Wads.LumpLength(lump));
+	Wads.ReadLump(lump, data.data());
+
+	FBitmap image;
+	if (!Instance()->DecodeImage(tex, data.data(), data.size(), &image, transpal))
+		return false;
+
+	bmp->CopyPixelDataRGB(x, y, image.GetPixels(), image.GetWidth(), image.GetHeight(), 4, image.GetPitch(), rotate, CF_BGRA, inf);
+	return true;
+}
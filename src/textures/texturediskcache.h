@@ -0,0 +1,120 @@
+/*
+** texturediskcache.h
+**
+** Persistent cache for decoded and upscaled textures
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#ifndef __TEXTUREDISKCACHE_H
+#define __TEXTUREDISKCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <string>
+#include "doomtype.h"
+
+class FTexture;
+class FBitmap;
+struct FCopyInfo;
+
+enum ETextureCacheKind
+{
+	TCK_Image,			// decoded image lump
+	TCK_Upscaled,		// output of CreateUpsampledTextureBuffer
+};
+
+struct FTextureCacheKey
+{
+	uint8_t Hash[16];
+
+	std::string ToString() const;
+};
+
+//==========================================================================
+//
+// Content addressed store for BGRA pixel buffers in the cache directory.
+//
+// Every entry is a file named after the MD5 of its input data and the
+// parameters used to create it, so changed lumps or settings never hit
+// stale entries. Entries are memory mapped for reading. The least
+// recently used ones are deleted when the directory grows beyond
+// r_texturecache_size megabytes.
+//
+//==========================================================================
+
+class FTextureDiskCache
+{
+public:
+	static FTextureDiskCache *Instance();
+	static bool IsEnabled();
+
+	static FTextureCacheKey MakeKey(const void *data, size_t size, ETextureCacheKind kind, int param, int width, int height);
+
+	// Calls the callback with the mapped pixels. Returns false on a miss.
+	bool Read(const FTextureCacheKey &key, const std::function<void(const uint8_t *pixels, int width, int height, int info)> &callback);
+	void Write(const FTextureCacheKey &key, const uint8_t *pixels, int width, int height, int info);
+
+	// Copies the decoded image of the texture's lump into the bitmap, decoding and storing it on a miss.
+	// Returns false if the cache is off or the texture has to decode the lump itself.
+	static bool ReadImage(FTexture *tex, FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal);
+
+	// For the texture decoder threads. Loads or decodes the image into an empty bitmap.
+	bool DecodeImage(FTexture *tex, const uint8_t *data, size_t size, FBitmap *bmp, int &transpal);
+
+	void Clear();
+
+	static int Hits;
+	static int Misses;
+
+private:
+	struct Entry
+	{
+		size_t Size = 0;
+		uint64_t LastUse = 0;
+	};
+
+	FTextureDiskCache();
+	FString GetFileName(const std::string &name) const;
+	void Scan();
+	void Evict();
+
+	std::mutex mMutex;
+	std::unordered_map<std::string, Entry> mEntries;
+	size_t mTotalSize = 0;
+	uint64_t mUseCounter = 0;
+	bool mScanned = false;
+	FString mPath;
+};
+
+#endif
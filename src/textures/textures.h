@@ -110,6 +110,7 @@ enum ECreateTexBufferFlags
 
 
 class FBitmap;
+class FileReader;
 struct FRemapTable;
 struct FCopyInfo;
 class FScanner;
@@ -209,6 +210,8 @@ enum FTextureFormat : uint32_t
 };
 
 // Base texture class
+struct FBgraMipEntry;
+
 class FTexture
 {
 
@@ -311,6 +314,15 @@ public:
 	virtual int CopyTrueColorTranslated(FBitmap *bmp, int x, int y, int rotate, PalEntry *remap, FCopyInfo *inf = NULL);
 	virtual bool UseBasePalette();
 	virtual int GetSourceLump() { return SourceLump; }
+
+	// Background decoding of the source lump. DecodeAsync runs on a worker thread
+	// and may only read the texture's header data.
+	virtual bool CanDecodeAsync() { return false; }
+	virtual bool DecodeAsync(FileReader &lump, FBitmap *bmp, int &transpal) { return false; }
+
+	// Gets the image from the background decoder or the disk cache instead of decoding the lump
+	bool CopyDecodedPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf, int &transpal);
+
 	virtual FTexture *GetRedirect();
 	virtual FTexture *GetRawTexture();		// for FMultiPatchTexture to override
 
@@ -453,8 +465,9 @@ protected:
 	}
 
 	std::vector<uint32_t> PixelsBgra;
+	FBgraMipEntry *BgraMipEntry = nullptr;
 
-	void GenerateBgraFromBitmap(const FBitmap &bitmap);
+	void GenerateBgraFromBitmap(const FBitmap &bitmap, bool reload = false);
 	void CreatePixelsBgraWithMipmaps();
 	void GenerateBgraMipmaps();
 	void GenerateBgraMipmapsFast();
@@ -496,6 +509,7 @@ public:
 	void SetSpriteAdjust();
 
 	friend class FTextureManager;
+	friend class FBgraMipCache;
 };
 
 class FxAddSub;
@@ -52,6 +52,7 @@
 #include "md5.h"
 #include "doomstat.h"
 #include "vm.h"
+#include "stats.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -100,6 +101,145 @@ void uppercopy (char *to, const char *from)
 		to[i] = 0;
 }
 
+//==========================================================================
+//
+// FLumpHashIndex
+//
+//==========================================================================
+
+std::atomic<int> FLumpHashIndex::Lookups;
+std::atomic<int> FLumpHashIndex::Hits;
+std::atomic<int> FLumpHashIndex::Probes;
+
+ADD_STAT(lumpindex)
+{
+	FString out;
+	int lookups = FLumpHashIndex::Lookups, hits = FLumpHashIndex::Hits, probes = FLumpHashIndex::Probes;
+	out.Format("lookups=%d  hits=%d  misses=%d  probes/lookup=%.2f", lookups, hits,
+		lookups - hits, lookups > 0 ? double(probes) / lookups : 0.);
+	return out;
+}
+
+void FLumpHashIndex::Init(unsigned count)
+{
+	// Keep the load factor at or below one half
+	unsigned size = 16;
+	while (size < count * 2) size <<= 1;
+
+	Entries.Resize(size);
+	for (auto &entry : Entries) entry.Lump = -1;
+	Mask = size - 1;
+	Count = 0;
+}
+
+void FLumpHashIndex::Clear()
+{
+	Entries.Reset();
+	Mask = 0;
+	Count = 0;
+}
+
+template<class Match>
+void FLumpHashIndex::Insert(uint64_t hash, int lump, Match match)
+{
+	Entry insert = { uint32_t(hash), lump };
+	uint32_t pos = insert.Hash & Mask;
+	uint32_t dist = 0;
+	bool displaced = false;
+
+	while (true)
+	{
+		Entry &entry = Entries[pos];
+		if (entry.Lump < 0)
+		{
+			entry = insert;
+			Count++;
+			return;
+		}
+		// Once the new key has taken a slot the entry being moved along is known to be unique.
+		if (!displaced && entry.Hash == insert.Hash && match(entry.Lump))
+		{
+			entry.Lump = lump;
+			return;
+		}
+		// Robin hood: take the slot from entries that are closer to their home position
+		uint32_t entrydist = (pos - entry.Hash) & Mask;
+		if (entrydist < dist)
+		{
+			std::swap(entry, insert);
+			dist = entrydist;
+			displaced = true;
+		}
+		pos = (pos + 1) & Mask;
+		dist++;
+	}
+}
+
+template<class Match>
+int FLumpHashIndex::Find(uint64_t hash, Match match) const
+{
+	Lookups.fetch_add(1, std::memory_order_relaxed);
+	if (Count == 0)
+	{
+		return -1;
+	}
+
+	uint32_t hash32 = uint32_t(hash);
+	uint32_t pos = hash32 & Mask;
+	for (uint32_t dist = 0; ; dist++, pos = (pos + 1) & Mask)
+	{
+		const Entry &entry = Entries[pos];
+		// An entry closer to its home position than we are to ours means the key isn't present.
+		if (entry.Lump < 0 || ((pos - entry.Hash) & Mask) < dist)
+		{
+			Probes.fetch_add(dist + 1, std::memory_order_relaxed);
+			return -1;
+		}
+		if (entry.Hash == hash32 && match(entry.Lump))
+		{
+			Probes.fetch_add(dist + 1, std::memory_order_relaxed);
+			Hits.fetch_add(1, std::memory_order_relaxed);
+			return entry.Lump;
+		}
+	}
+}
+
+static inline uint64_t MixLumpHash(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// Case insensitive hash of a path, to match the stricmp comparisons below
+static uint64_t LumpPathHash(const char *name, size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (uint8_t)tolower((uint8_t)name[i]);
+		h *= 0x100000001b3ull;
+	}
+	return MixLumpHash(h);
+}
+
+// Length of a full name without the extension of its last path element
+static size_t NoExtLength(const FString &name)
+{
+	auto dot = name.LastIndexOf('.');
+	auto slash = name.LastIndexOf('/');
+	return dot > slash ? dot : name.Len();
+}
+
+// Short names are already upper case and zero padded
+static uint64_t LumpShortNameHash(uint64_t qname, int space)
+{
+	return MixLumpHash(qname ^ (uint64_t(uint32_t(space)) * 0x9e3779b97f4a7c15ull));
+}
+
 FWadCollection::FWadCollection ()
 : FirstLumpIndex(NULL), NextLumpIndex(NULL),
   FirstLumpIndex_FullName(NULL), NextLumpIndex_FullName(NULL), 
@@ -146,6 +286,11 @@ void FWadCollection::DeleteAll ()
 		NextLumpIndex_NoExt = NULL;
 	}
 
+	FullNameIndex.Clear();
+	NoExtIndex.Clear();
+	ShortNameIndex.Clear();
+	NonZipIndex.Clear();
+
 	LumpInfo.Clear();
 	NumLumps = 0;
 
@@ -430,7 +575,6 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 		char uname[8];
 		uint64_t qname;
 	};
-	uint32_t i;
 
 	if (name == NULL)
 	{
@@ -445,27 +589,26 @@ int FWadCollection::CheckNumForName (const char *name, int space)
 	}
 
 	uppercopy (uname, name);
-	i = FirstLumpIndex[LumpNameHash (uname) % NumLumps];
-
-	while (i != NULL_INDEX)
+	uint64_t key = qname;
+	int lump = ShortNameIndex.Find(LumpShortNameHash(key, space), [&](int i)
 	{
-		FResourceLump *lump = LumpInfo[i].lump;
-
-		if (lump->qwName == qname)
+		return LumpInfo[i].lump->qwName == key && LumpInfo[i].lump->Namespace == space;
+	});
+
+	// If the lump is from one of the special namespaces exclusive to Zips
+	// the check has to be done differently:
+	// If we find a lump with this name in the global namespace that does not come
+	// from a Zip return that. WADs don't know these namespaces and single lumps must
+	// work as well. The later of both lumps wins.
+	if (space > ns_specialzipdirectory)
+	{
+		int global = NonZipIndex.Find(LumpShortNameHash(key, ns_global), [&](int i)
 		{
-			if (lump->Namespace == space) break;
-			// If the lump is from one of the special namespaces exclusive to Zips
-			// the check has to be done differently:
-			// If we find a lump with this name in the global namespace that does not come
-			// from a Zip return that. WADs don't know these namespaces and single lumps must
-			// work as well.
-			if (space > ns_specialzipdirectory && lump->Namespace == ns_global && 
-				!(lump->Flags & LUMPF_ZIPFILE)) break;
-		}
-		i = NextLumpIndex[i];
+			return LumpInfo[i].lump->qwName == key;
+		});
+		if (global > lump) lump = global;
 	}
-
-	return i != NULL_INDEX ? i : -1;
+	return lump;
 }
 
 int FWadCollection::CheckNumForName (const char *name, int space, int wadnum, bool exact)
@@ -542,28 +685,23 @@ int FWadCollection::GetNumForName (const char *name, int space)
 
 int FWadCollection::CheckNumForFullName (const char *name, bool trynormal, int namespc, bool ignoreext)
 {
-	uint32_t i;
-
 	if (name == NULL)
 	{
 		return -1;
 	}
-	uint32_t *fli = ignoreext ? FirstLumpIndex_NoExt : FirstLumpIndex_FullName;
-	uint32_t *nli = ignoreext ? NextLumpIndex_NoExt : NextLumpIndex_FullName;
 	auto len = strlen(name);
+	auto &index = ignoreext ? NoExtIndex : FullNameIndex;
 
-	for (i = fli[MakeKey(name) % NumLumps]; i != NULL_INDEX; i = nli[i])
+	int lump = index.Find(LumpPathHash(name, len), [&](int i)
 	{
-		if (strnicmp(name, LumpInfo[i].lump->FullName, len)) continue;
-		if (LumpInfo[i].lump->FullName[len] == 0) break;	// this is a full match
-		if (ignoreext && LumpInfo[i].lump->FullName[len] == '.') 
-		{
-			// is this the last '.' in the last path element, indicating that the remaining part of the name is only an extension?
-			if (strpbrk(LumpInfo[i].lump->FullName.GetChars() + len + 1, "./") == nullptr) break;	
-		}
-	}
+		const char *fullname = LumpInfo[i].lump->FullName.GetChars();
+		if (strnicmp(name, fullname, len)) return false;
+		if (fullname[len] == 0) return true;	// this is a full match
+		// is this the last '.' in the last path element, indicating that the remaining part of the name is only an extension?
+		return ignoreext && fullname[len] == '.' && strpbrk(fullname + len + 1, "./") == nullptr;
+	});
 
-	if (i != NULL_INDEX) return i;
+	if (lump >= 0) return lump;
 
 	if (trynormal && strlen(name) <= 8 && !strpbrk(name, "./"))
 	{
@@ -776,6 +914,48 @@ void FWadCollection::InitHashChains (void)
 
 		}
 	}
+
+	// The chains are still used for the per-file lookups. Everything else goes
+	// through the hash indices which only need to confirm a single candidate.
+	FullNameIndex.Init(NumLumps);
+	NoExtIndex.Init(NumLumps);
+	ShortNameIndex.Init(NumLumps);
+	NonZipIndex.Init(NumLumps);
+
+	// Ascending order so that later lumps replace earlier ones with the same key
+	for (i = 0; i < (unsigned)NumLumps; i++)
+	{
+		FResourceLump *lump = LumpInfo[i].lump;
+
+		ShortNameIndex.Insert(LumpShortNameHash(lump->qwName, lump->Namespace), i, [=](int other)
+		{
+			return LumpInfo[other].lump->qwName == lump->qwName && LumpInfo[other].lump->Namespace == lump->Namespace;
+		});
+		if (lump->Namespace == ns_global && !(lump->Flags & LUMPF_ZIPFILE))
+		{
+			NonZipIndex.Insert(LumpShortNameHash(lump->qwName, ns_global), i, [=](int other)
+			{
+				return LumpInfo[other].lump->qwName == lump->qwName;
+			});
+		}
+
+		if (lump->FullName.IsNotEmpty())
+		{
+			const char *fullname = lump->FullName.GetChars();
+			size_t len = lump->FullName.Len();
+			FullNameIndex.Insert(LumpPathHash(fullname, len), i, [=](int other)
+			{
+				return stricmp(LumpInfo[other].lump->FullName, fullname) == 0;
+			});
+
+			size_t noextlen = NoExtLength(lump->FullName);
+			NoExtIndex.Insert(LumpPathHash(fullname, noextlen), i, [=](int other)
+			{
+				const FString &othername = LumpInfo[other].lump->FullName;
+				return NoExtLength(othername) == noextlen && strnicmp(othername, fullname, noextlen) == 0;
+			});
+		}
+	}
 }
 
 //==========================================================================
@@ -9,6 +9,7 @@
 #ifndef __W_WAD__
 #define __W_WAD__
 
+#include <atomic>
 #include "files.h"
 #include "doomdef.h"
 #include "tarray.h"
@@ -17,6 +18,39 @@ class FResourceFile;
 struct FResourceLump;
 class FTexture;
 
+// Open addressing hash table with robin hood probing that maps name hashes to lump
+// numbers. The table only stores hashes, so lookups must confirm a candidate against
+// the lump itself. Used by FWadCollection for lookups that would otherwise walk a
+// hash chain and compare strings for every collision.
+class FLumpHashIndex
+{
+public:
+	void Init(unsigned count);
+	void Clear();
+
+	// Inserting a key that is already present replaces its lump
+	template<class Match> void Insert(uint64_t hash, int lump, Match match);
+	template<class Match> int Find(uint64_t hash, Match match) const;
+
+	unsigned Size() const { return Count; }
+
+	// Find can be reached from the background decompression and decode threads
+	static std::atomic<int> Lookups;
+	static std::atomic<int> Hits;
+	static std::atomic<int> Probes;
+
+private:
+	struct Entry
+	{
+		uint32_t Hash;
+		int32_t Lump;
+	};
+
+	TArray<Entry> Entries;
+	uint32_t Mask = 0;
+	unsigned Count = 0;
+};
+
 struct wadinfo_t
 {
 	// Should be "IWAD" or "PWAD".
@@ -197,6 +231,11 @@ protected:
 	uint32_t *FirstLumpIndex_NoExt;	// The same information for fully qualified paths from .zips
 	uint32_t *NextLumpIndex_NoExt;
 
+	FLumpHashIndex FullNameIndex;		// Built by InitHashChains from the final lump list.
+	FLumpHashIndex NoExtIndex;			// Each maps its key to the last lump that has it.
+	FLumpHashIndex ShortNameIndex;		// (namespace, name) pairs
+	FLumpHashIndex NonZipIndex;			// Global namespace lumps that don't come from a Zip
+
 	uint32_t NumLumps;					// Not necessarily the same as LumpInfo.Size()
 	uint32_t NumWads;
 
@@ -0,0 +1,140 @@
+/*
+** workerpool.cpp
+**
+** Worker thread pool for parallel loops
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#include "workerpool.h"
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FWorkerPool::FWorkerPool(std::function<void()> threadinit)
+	: mThreadInit(std::move(threadinit))
+{
+}
+
+FWorkerPool::~FWorkerPool()
+{
+	StopWorkers();
+}
+
+void FWorkerPool::Run(int threads, int count, int batch, const std::function<void(int, int)> &work)
+{
+	if (batch < 1)
+		batch = 1;
+	if (threads <= 1 || count <= batch)
+	{
+		if (count > 0)
+			work(0, count);
+		return;
+	}
+	if ((int)mWorkers.size() != threads - 1)
+		StartWorkers(threads - 1);
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWork = &work;
+	mCount = count;
+	mBatch = batch;
+	mNext = 0;
+	mPending = (count + batch - 1) / batch;
+	mWorkCondition.notify_all();
+
+	// The calling thread takes its share, too
+	while (RunNext(lock)) {}
+	mDoneCondition.wait(lock, [&]() { return mPending == 0; });
+	mWork = nullptr;
+}
+
+// Runs the next range that nobody took yet. The caller must hold the lock.
+bool FWorkerPool::RunNext(std::unique_lock<std::mutex> &lock)
+{
+	if (mNext >= mCount)
+		return false;
+
+	int start = mNext;
+	int end = start + mBatch < mCount ? start + mBatch : mCount;
+	mNext = end;
+	auto work = mWork;
+	lock.unlock();
+	(*work)(start, end);
+	lock.lock();
+	if (--mPending == 0)
+		mDoneCondition.notify_all();
+	return true;
+}
+
+//==========================================================================
+//
+// Worker threads
+//
+//==========================================================================
+
+void FWorkerPool::StartWorkers(int count)
+{
+	StopWorkers();
+
+	mStopWorkers = false;
+	for (int i = 0; i < count; i++)
+		mWorkers.push_back(std::thread([=]() { WorkerMain(); }));
+}
+
+void FWorkerPool::StopWorkers()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mStopWorkers = true;
+	lock.unlock();
+	mWorkCondition.notify_all();
+
+	for (auto &worker : mWorkers)
+		worker.join();
+	mWorkers.clear();
+}
+
+void FWorkerPool::WorkerMain()
+{
+	if (mThreadInit)
+		mThreadInit();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mWorkCondition.wait(lock, [&]() { return mStopWorkers || mNext < mCount; });
+		if (mStopWorkers)
+			break;
+		RunNext(lock);
+	}
+}
@@ -0,0 +1,88 @@
+/*
+** workerpool.h
+**
+** Worker thread pool for parallel loops
+**
+**---------------------------------------------------------------------------
+** Copyright 2018 GZDoom Development Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+*/
+
+#ifndef __WORKERPOOL_H
+#define __WORKERPOOL_H
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+//==========================================================================
+//
+// Splits a loop over a pool of worker threads.
+//
+// The calling thread takes part in the work and Run returns when all of
+// it is done. Ranges are handed out in order, but which thread runs which
+// range is up to chance, so the work function must only touch data that
+// belongs to its own range.
+//
+//==========================================================================
+
+class FWorkerPool
+{
+public:
+	// threadinit is called on every worker thread before it runs any work
+	FWorkerPool(std::function<void()> threadinit = nullptr);
+	~FWorkerPool();
+
+	// Calls work for ranges of batch items that cover [0, count), on up to threads
+	// threads including the caller
+	void Run(int threads, int count, int batch, const std::function<void(int start, int end)> &work);
+
+private:
+	void StartWorkers(int count);
+	void StopWorkers();
+	void WorkerMain();
+	bool RunNext(std::unique_lock<std::mutex> &lock);
+
+	std::function<void()> mThreadInit;
+	const std::function<void(int, int)> *mWork = nullptr;
+	int mCount = 0;
+	int mBatch = 0;
+	int mNext = 0;
+	int mPending = 0;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkCondition;
+	std::condition_variable mDoneCondition;
+	std::vector<std::thread> mWorkers;
+	bool mStopWorkers = false;
+};
+
+#endif